@@ -0,0 +1,94 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "heap.h"
+#include "benchmark.h"
+
+namespace {
+    constexpr size_t kBatchSize = 10000;
+    constexpr size_t kObjectLength = 48;
+    constexpr size_t kIterations = 20;
+
+    //! \brief Measures the cost of spawning and destroying a batch of equally sized objects.
+    //! \param strategy [in] - The allocation strategy to be measured.
+    //! \param batched [in] - True to use the batch interface, otherwise each object is allocated and released individually.
+    //! \param shuffled [in] - True to release the objects in random order, otherwise they are released in the order they were made.
+    //! \param allocateNanoseconds [out] - Receives the average number of nanoseconds taken by each allocation.
+    //! \param releaseNanoseconds [out] - Receives the average number of nanoseconds taken by each release.
+    void measureSpawn(ngen::memory::kAllocationStrategy strategy, bool batched, bool shuffled, double &allocateNanoseconds, double &releaseNanoseconds) {
+        const size_t bufferSize = kBatchSize * (kObjectLength + 128) + 1024 * 1024;
+        std::unique_ptr<char[]> buffer(new char[bufferSize]);
+
+        ngen::memory::Heap heap;
+        heap.initialize(buffer.get(), bufferSize, strategy);
+
+        std::mt19937 random(1234);
+        std::vector<void *> objects(kBatchSize);
+
+        uint64_t allocateElapsed = 0;
+        uint64_t releaseElapsed = 0;
+
+        for (size_t iteration = 0; iteration < kIterations; ++iteration) {
+            ngen::memory::bench::Timer allocateTimer;
+
+            if (batched) {
+                heap.allocBatch(kBatchSize, kObjectLength, 8, objects.data());
+            } else {
+                for (auto &object : objects) {
+                    object = heap.alloc(kObjectLength);
+                }
+            }
+
+            allocateElapsed += allocateTimer.getElapsedNanoseconds();
+
+            if (shuffled) {
+                std::shuffle(objects.begin(), objects.end(), random);
+            }
+
+            ngen::memory::bench::Timer releaseTimer;
+
+            if (batched) {
+                heap.deallocateBatch(objects.data(), kBatchSize);
+            } else {
+                for (auto object : objects) {
+                    heap.deallocate(object, false, nullptr, 0);
+                }
+            }
+
+            releaseElapsed += releaseTimer.getElapsedNanoseconds();
+        }
+
+        allocateNanoseconds = static_cast<double>(allocateElapsed) / (kBatchSize * kIterations);
+        releaseNanoseconds = static_cast<double>(releaseElapsed) / (kBatchSize * kIterations);
+    }
+}
+
+//! \brief Compares individual allocation and release against the batch interface, as used by particle systems.
+NGEN_BENCHMARK(batch) {
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    for (auto strategy : strategies) {
+        for (auto shuffled : { false, true }) {
+            for (auto batched : { false, true }) {
+                double allocateNanoseconds = 0;
+                double releaseNanoseconds = 0;
+
+                measureSpawn(strategy, batched, shuffled, allocateNanoseconds, releaseNanoseconds);
+
+                char variant[64];
+                snprintf(variant, sizeof(variant), "%s/%s/%s", ngen::memory::getAllocationStrategyName(strategy), batched ? "batch" : "single", shuffled ? "shuffled" : "ordered");
+
+                ngen::memory::bench::report("batch", variant, "ns/alloc", allocateNanoseconds);
+                ngen::memory::bench::report("batch", variant, "ns/free", releaseNanoseconds);
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "heap.h"
+#include "benchmark.h"
+
+namespace {
+    constexpr size_t kHoleLength = 64;
+    constexpr size_t kRequestLength = 256;
+    constexpr size_t kRequestCount = 2000;
+
+    //! \brief Measures the cost of locating a fitting free block behind many holes in a fragmented heap.
+    //!
+    //! The heap is split into the requested number of small free blocks separated by live allocations, each request
+    //! is too large for every hole and must be served from one of the free blocks of exactly the requested size. The
+    //! fitting blocks are released before the holes so they sit behind every hole in the free list, and the tail of the
+    //! heap is consumed beforehand so that it cannot serve the requests.
+    //! \param strategy [in] - The allocation strategy to be measured.
+    //! \param holeCount [in] - The number of small free blocks to create before measuring.
+    //! \returns The average number of nanoseconds taken by each allocation.
+    double measureFragmentedAllocation(ngen::memory::kAllocationStrategy strategy, size_t holeCount) {
+        const size_t bufferSize = holeCount * 2 * (kHoleLength + 128) + kRequestCount * (kRequestLength + kHoleLength + 256) + 1024 * 1024;
+        std::unique_ptr<char[]> buffer(new char[bufferSize]);
+
+        ngen::memory::Heap heap;
+        heap.initialize(buffer.get(), bufferSize, strategy);
+
+        std::vector<void *> fittingBlocks(kRequestCount);
+        for (auto &fittingBlock : fittingBlocks) {
+            fittingBlock = heap.alloc(kRequestLength);
+            (void)heap.alloc(kHoleLength);
+        }
+
+        std::vector<void *> holes(holeCount);
+        for (auto &hole : holes) {
+            hole = heap.alloc(kHoleLength);
+            (void)heap.alloc(kHoleLength);
+        }
+
+        for (size_t length = bufferSize; length >= kRequestLength; length /= 2) {
+            while (heap.alloc(length)) {
+            }
+        }
+
+        for (auto fittingBlock : fittingBlocks) {
+            heap.deallocate(fittingBlock, false, nullptr, 0);
+        }
+
+        for (auto hole : holes) {
+            heap.deallocate(hole, false, nullptr, 0);
+        }
+
+        std::vector<void *> requests(kRequestCount);
+
+        ngen::memory::bench::Timer timer;
+
+        for (auto &request : requests) {
+            request = heap.alloc(kRequestLength);
+        }
+
+        const auto elapsed = timer.getElapsedNanoseconds();
+
+        for (auto request : requests) {
+            heap.deallocate(request, false, nullptr, 0);
+        }
+
+        return static_cast<double>(elapsed) / kRequestCount;
+    }
+}
+
+//! \brief Compares free block search cost of each allocation strategy as the number of free blocks grows.
+NGEN_BENCHMARK(free_block_search) {
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    for (size_t holeCount : { 1000, 10000, 50000 }) {
+        for (auto strategy : strategies) {
+            char variant[64];
+            snprintf(variant, sizeof(variant), "%s/%zu_free_blocks", ngen::memory::getAllocationStrategyName(strategy), holeCount);
+
+            ngen::memory::bench::report("free_block_search", variant, "ns/alloc", measureFragmentedAllocation(strategy, holeCount));
+        }
+    }
+}
@@ -0,0 +1,102 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "heap.h"
+#include "huge_page_block.h"
+#include "benchmark.h"
+
+namespace {
+    constexpr size_t kHeapLength = 512 * 1024 * 1024;
+    constexpr size_t kObjectLength = 64;
+    constexpr size_t kAccessCount = 16 * 1024 * 1024;
+
+    struct Node {
+        Node *next;
+        size_t value;
+    };
+
+    //! \brief Measures the cost of randomly accessing objects spread across a large heap.
+    //!
+    //! The heap is filled with small objects, which are then linked in a random order and visited by following the
+    //! links. Each access is likely to touch a different page, so the cost is dominated by TLB misses unless the heap
+    //! is backed by huge pages.
+    //! \param backing [in] - The page backing requested for the heap.
+    //! \param obtained [out] - Receives the page backing that was actually obtained.
+    //! \param accessNanoseconds [out] - Receives the average number of nanoseconds taken by each access.
+    //! \returns True if the heap could be created otherwise false.
+    bool measureRandomAccess(ngen::memory::kPageBacking backing, ngen::memory::kPageBacking &obtained, double &accessNanoseconds) {
+        ngen::memory::HugePageBlock block;
+        if (!block.allocate(kHeapLength, backing)) {
+            return false;
+        }
+
+        obtained = block.getBacking();
+
+        ngen::memory::Heap heap;
+        if (!block.initializeHeap(heap, ngen::memory::kAllocationStrategy::First)) {
+            return false;
+        }
+
+        std::vector<Node *> nodes;
+        nodes.reserve(kHeapLength / kObjectLength);
+
+        while (auto node = static_cast<Node *>(heap.alloc(kObjectLength))) {
+            nodes.push_back(node);
+        }
+
+        std::mt19937 random(1234);
+        std::shuffle(nodes.begin(), nodes.end(), random);
+
+        for (size_t loop = 0; loop < nodes.size(); ++loop) {
+            nodes[loop]->next = nodes[(loop + 1) % nodes.size()];
+            nodes[loop]->value = loop;
+        }
+
+        Node *current = nodes.front();
+        size_t checksum = 0;
+
+        ngen::memory::bench::Timer timer;
+
+        for (size_t loop = 0; loop < kAccessCount; ++loop) {
+            checksum += current->value;
+            current = current->next;
+        }
+
+        accessNanoseconds = static_cast<double>(timer.getElapsedNanoseconds()) / kAccessCount;
+
+        // Consuming the checksum prevents the walk from being optimized away.
+        if (checksum == 1) {
+            printf("\n");
+        }
+
+        return true;
+    }
+}
+
+//! \brief Compares random access across a large heap backed by standard pages and by huge pages.
+NGEN_BENCHMARK(tlb) {
+    const ngen::memory::kPageBacking backings[] = {
+        ngen::memory::kPageBacking::Standard,
+        ngen::memory::kPageBacking::Transparent,
+        ngen::memory::kPageBacking::HugeTLB,
+    };
+
+    for (auto backing : backings) {
+        auto obtained = ngen::memory::kPageBacking::Invalid;
+        double accessNanoseconds = 0;
+
+        if (!measureRandomAccess(backing, obtained, accessNanoseconds)) {
+            continue;
+        }
+
+        // Requested backings that are unavailable fall back, so the variant records the backing that was measured.
+        char variant[64];
+        snprintf(variant, sizeof(variant), "%s/%s", ngen::memory::bench::getBackingName(backing), ngen::memory::bench::getBackingName(obtained));
+
+        ngen::memory::bench::report("tlb", variant, "ns/access", accessNanoseconds);
+    }
+}
@@ -0,0 +1,76 @@
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "heap.h"
+#include "benchmark.h"
+
+namespace {
+    constexpr size_t kSlotCount = 4096;
+    constexpr size_t kOperationCount = 2000000;
+
+    using FastHeap = ngen::memory::BasicHeap<ngen::memory::SearchTLSF, ngen::memory::NoTracking, ngen::memory::NoSentinels, ngen::memory::NoStatistics, ngen::memory::NoLock>;
+    using TrackedHeap = ngen::memory::BasicHeap<ngen::memory::SearchTLSF, ngen::memory::SourceTracking, ngen::memory::HeaderSentinels, ngen::memory::AllocationCounters, ngen::memory::NoLock>;
+
+    //! \brief Measures the cost of replacing random live allocations with new allocations of a random length.
+    //! \tparam THeap - The heap configuration to be measured.
+    //! \tparam TSized - True to release each allocation with its length, as sized delete would, otherwise false.
+    //! \returns The average number of nanoseconds taken by each release and allocation pair.
+    template <typename THeap, bool TSized = false> double measureChurn() {
+        const size_t bufferSize = kSlotCount * 512 + 1024 * 1024;
+        std::unique_ptr<char[]> buffer(new char[bufferSize]);
+
+        THeap heap;
+        heap.initialize(buffer.get(), bufferSize, ngen::memory::kAllocationStrategy::TLSF);
+
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<size_t> lengths(16, 256);
+        std::uniform_int_distribution<size_t> slots(0, kSlotCount - 1);
+
+        std::vector<void *> allocations(kSlotCount);
+        std::vector<size_t> allocationLengths(kSlotCount);
+        for (size_t slot = 0; slot < kSlotCount; ++slot) {
+            allocationLengths[slot] = lengths(random);
+            allocations[slot] = heap.alloc(allocationLengths[slot]);
+        }
+
+        std::vector<size_t> operations(kOperationCount);
+        for (auto &operation : operations) {
+            operation = (slots(random) << 16) | lengths(random);
+        }
+
+        ngen::memory::bench::Timer timer;
+
+        for (auto operation : operations) {
+            const auto slot = operation >> 16;
+            auto &allocation = allocations[slot];
+
+            if constexpr (TSized) {
+                heap.deallocate(allocation, allocationLengths[slot], size_t(0));
+            } else {
+                heap.deallocate(allocation, false, nullptr, 0);
+            }
+
+            allocationLengths[slot] = operation & 0xffff;
+            allocation = heap.alloc(allocationLengths[slot]);
+        }
+
+        const auto elapsed = timer.getElapsedNanoseconds();
+
+        for (auto allocation : allocations) {
+            heap.deallocate(allocation, false, nullptr, 0);
+        }
+
+        return static_cast<double>(elapsed) / kOperationCount;
+    }
+}
+
+//! \brief Compares the default heap against heaps whose policies are fixed at compile time.
+NGEN_BENCHMARK(heap_policies) {
+    ngen::memory::bench::report("heap_policies", "Heap", "ns/op", measureChurn<ngen::memory::Heap>());
+    ngen::memory::bench::report("heap_policies", "TLSF/tracked", "ns/op", measureChurn<TrackedHeap>());
+    ngen::memory::bench::report("heap_policies", "TLSF/untracked", "ns/op", measureChurn<FastHeap>());
+    ngen::memory::bench::report("heap_policies", "TLSF/untracked/sized", "ns/op", measureChurn<FastHeap, true>());
+}
@@ -0,0 +1,58 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "heap.h"
+#include "benchmark.h"
+
+namespace {
+    constexpr size_t kObjectCount = 200000;
+
+    //! \brief Measures the cost of releasing a large population of live objects in random order.
+    //! \param strategy [in] - The allocation strategy to be measured.
+    //! \returns The average number of nanoseconds taken by each release.
+    double measureTeardown(ngen::memory::kAllocationStrategy strategy) {
+        const size_t bufferSize = kObjectCount * (sizeof(ngen::memory::Allocation) + 128) + 1024 * 1024;
+        std::unique_ptr<char[]> buffer(new char[bufferSize]);
+
+        ngen::memory::Heap heap;
+        heap.initialize(buffer.get(), bufferSize, strategy);
+
+        std::mt19937 random(1234);
+        std::uniform_int_distribution<size_t> lengths(16, 96);
+
+        std::vector<void *> objects(kObjectCount);
+        for (auto &object : objects) {
+            object = heap.alloc(lengths(random));
+        }
+
+        std::shuffle(objects.begin(), objects.end(), random);
+
+        ngen::memory::bench::Timer timer;
+
+        for (auto object : objects) {
+            heap.deallocate(object, false, nullptr, 0);
+        }
+
+        return static_cast<double>(timer.getElapsedNanoseconds()) / kObjectCount;
+    }
+}
+
+//! \brief Measures the cost of releasing every object in a large scene, as happens when a level is unloaded.
+NGEN_BENCHMARK(teardown) {
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    for (auto strategy : strategies) {
+        char variant[64];
+        snprintf(variant, sizeof(variant), "%s/%zu_objects", ngen::memory::getAllocationStrategyName(strategy), kObjectCount);
+
+        ngen::memory::bench::report("teardown", variant, "ns/free", measureTeardown(strategy));
+    }
+}
@@ -0,0 +1,590 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif //defined(_MSC_VER)
+
+#include "concurrent_heap.h"
+#include "heap.h"
+#include "heap_profiler.h"
+#include "benchmark.h"
+
+namespace {
+    constexpr size_t kReserveLength = size_t(4) * 1024 * 1024 * 1024;
+    constexpr size_t kCommitLength = 4 * 1024 * 1024;
+    constexpr size_t kConcurrentHeapLength = 64 * 1024 * 1024;
+    constexpr size_t kQueueCapacity = 1024;
+    constexpr size_t kMessageCount = 500000;
+
+    //! \brief The kinds of operation performed by a workload script.
+    enum class kOperation : uint8_t {
+        Allocate,
+        Release,
+    };
+
+    //! \brief A single operation within a workload script, the allocation is stored in or taken from a numbered slot.
+    struct Operation {
+        uint32_t slot;              // Slot holding the allocation
+        uint32_t length;            // Length (in bytes) of the allocation
+        uint32_t alignment;         // Alignment (in bytes) of the allocation, also supplied when it is released
+        kOperation type;            // The operation to be performed
+    };
+
+    //! \brief A sequence of operations generated ahead of time, so every allocator replays exactly the same workload.
+    struct Script {
+        std::vector<Operation> operations;
+        size_t slotCount = 0;
+
+        //! \brief Appends an allocation to the script.
+        void allocate(size_t slot, size_t length, size_t alignment) {
+            operations.push_back({static_cast<uint32_t>(slot), static_cast<uint32_t>(length), static_cast<uint32_t>(alignment), kOperation::Allocate});
+        }
+
+        //! \brief Appends the release of an allocation to the script.
+        void release(size_t slot, size_t alignment) {
+            operations.push_back({static_cast<uint32_t>(slot), 0, static_cast<uint32_t>(alignment), kOperation::Release});
+        }
+    };
+
+    //! \brief Serves the allocations of a workload from a growable Heap using a fixed allocation strategy.
+    class HeapUnderTest {
+    public:
+        explicit HeapUnderTest(ngen::memory::kAllocationStrategy strategy) {
+            m_isValid = m_heap.initializeGrowable(kReserveLength, kCommitLength, strategy);
+        }
+
+        [[nodiscard]] bool isValid() const {
+            return m_isValid;
+        }
+
+        [[nodiscard]] void* allocate(size_t length, size_t alignment) {
+            return m_heap.alignedAlloc(length, alignment);
+        }
+
+        void release(void *ptr, size_t) {
+            m_heap.deallocate(ptr, false, nullptr, 0);
+        }
+
+        void setHeapProfiler(ngen::memory::HeapProfiler *profiler) {
+            m_heap.setHeapProfiler(profiler);
+        }
+
+    private:
+        ngen::memory::Heap m_heap;
+        bool m_isValid;
+    };
+
+    //! \brief Serves the allocations of a workload shared between threads from a ConcurrentHeap.
+    class ConcurrentHeapUnderTest {
+    public:
+        explicit ConcurrentHeapUnderTest(ngen::memory::kAllocationStrategy strategy)
+                : m_buffer(new char[kConcurrentHeapLength]) {
+            m_isValid = m_heap.initialize(m_buffer.get(), kConcurrentHeapLength, strategy);
+        }
+
+        [[nodiscard]] bool isValid() const {
+            return m_isValid;
+        }
+
+        [[nodiscard]] void* allocate(size_t length, size_t alignment) {
+            return m_heap.alignedAlloc(length, alignment);
+        }
+
+        void release(void *ptr, size_t) {
+            m_heap.deallocate(ptr, false, nullptr, 0);
+        }
+
+    private:
+        std::unique_ptr<char[]> m_buffer;
+        ngen::memory::ConcurrentHeap m_heap;
+        bool m_isValid;
+    };
+
+    //! \brief Serves the allocations of a workload from the C runtime, as the baseline the heaps are compared with.
+    class SystemUnderTest {
+    public:
+        [[nodiscard]] bool isValid() const {
+            return true;
+        }
+
+        [[nodiscard]] void* allocate(size_t length, size_t alignment) {
+            if (alignment <= alignof(std::max_align_t)) {
+                return malloc(length);
+            }
+
+#if defined(_MSC_VER)
+            return _aligned_malloc(length, alignment);
+#else
+            // aligned_alloc requires the length to be a multiple of the alignment.
+            return aligned_alloc(alignment, (length + alignment - 1) & ~(alignment - 1));
+#endif //defined(_MSC_VER)
+        }
+
+        void release(void *ptr, size_t alignment) {
+#if defined(_MSC_VER)
+            if (alignment > alignof(std::max_align_t)) {
+                _aligned_free(ptr);
+                return;
+            }
+#endif //defined(_MSC_VER)
+
+            (void)alignment;
+            free(ptr);
+        }
+    };
+
+    //! \brief Performs the operations of a script against an allocator.
+    //! \tparam kMeasureLatency - True to time each operation individually, which adds the cost of reading the clock.
+    //! \param allocator [in] - The allocator the operations are performed against.
+    //! \param script [in] - The operations to be performed.
+    //! \param latencies [out] - Receives the number of nanoseconds taken by each operation, when measured.
+    //! \returns The number of nanoseconds taken to perform every operation.
+    template <bool kMeasureLatency, typename TAllocator>
+    uint64_t runScript(TAllocator &allocator, const Script &script, std::vector<uint32_t> &latencies) {
+        std::vector<void *> slots(script.slotCount);
+
+        if constexpr (kMeasureLatency) {
+            latencies.resize(script.operations.size());
+        }
+
+        ngen::memory::bench::Timer timer;
+
+        for (size_t loop = 0; loop < script.operations.size(); ++loop) {
+            const auto &operation = script.operations[loop];
+
+            [[maybe_unused]] std::chrono::steady_clock::time_point start;
+            if constexpr (kMeasureLatency) {
+                start = std::chrono::steady_clock::now();
+            }
+
+            if (kOperation::Allocate == operation.type) {
+                slots[operation.slot] = allocator.allocate(operation.length, operation.alignment);
+            } else {
+                allocator.release(slots[operation.slot], operation.alignment);
+                slots[operation.slot] = nullptr;
+            }
+
+            if constexpr (kMeasureLatency) {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                latencies[loop] = static_cast<uint32_t>(std::min<int64_t>(elapsed, UINT32_MAX));
+            }
+
+            // Touch each allocation, as a program would, so lazily committed memory is faulted in by every allocator.
+            if (kOperation::Allocate == operation.type && slots[operation.slot]) {
+                *static_cast<volatile char *>(slots[operation.slot]) = 0;
+            }
+        }
+
+        return timer.getElapsedNanoseconds();
+    }
+
+    //! \brief Measures the throughput and latency of an allocator performing the operations of a script.
+    //!
+    //! The script is performed once to bring the allocator to a steady state, once to measure throughput and once
+    //! more timing each operation. Every script releases all of its allocations, so each pass starts from the same state.
+    //! \param benchmark [in] - Name of the benchmark being measured.
+    //! \param variant [in] - Name of the allocator being measured.
+    //! \param allocator [in] - The allocator to be measured.
+    //! \param script [in] - The operations to be performed.
+    template <typename TAllocator>
+    void measureScript(const char *benchmark, const char *variant, TAllocator &allocator, const Script &script) {
+        if (!allocator.isValid()) {
+            return;
+        }
+
+        std::vector<uint32_t> latencies;
+
+        runScript<false>(allocator, script, latencies);
+        const auto elapsed = runScript<false>(allocator, script, latencies);
+        runScript<true>(allocator, script, latencies);
+
+        ngen::memory::bench::reportThroughput(benchmark, variant, script.operations.size(), elapsed);
+        ngen::memory::bench::reportLatencies(benchmark, variant, latencies);
+    }
+
+    //! \brief Measures a script against each allocation strategy and the C runtime.
+    //! \param benchmark [in] - Name of the benchmark being measured.
+    //! \param script [in] - The operations to be performed.
+    void measureStrategies(const char *benchmark, const Script &script) {
+        const ngen::memory::kAllocationStrategy strategies[] = {
+            ngen::memory::kAllocationStrategy::First,
+            ngen::memory::kAllocationStrategy::Smallest,
+            ngen::memory::kAllocationStrategy::TLSF,
+        };
+
+        for (auto strategy : strategies) {
+            HeapUnderTest allocator(strategy);
+            measureScript(benchmark, ngen::memory::getAllocationStrategyName(strategy), allocator, script);
+        }
+
+        SystemUnderTest system;
+        measureScript(benchmark, "malloc", system, script);
+    }
+
+    //! \brief Passes messages allocated by a producer thread through a bounded queue to a consumer thread that releases them.
+    //! \tparam kMeasureLatency - True to time each operation individually, which adds the cost of reading the clock.
+    //! \param allocator [in] - The allocator the messages are allocated from, which must be thread safe.
+    //! \param lengths [in] - The length (in bytes) of each message.
+    //! \param latencies [out] - Receives the number of nanoseconds taken by each allocation followed by each release.
+    //! \returns The number of nanoseconds taken to pass every message.
+    template <bool kMeasureLatency, typename TAllocator>
+    uint64_t runProducerConsumer(TAllocator &allocator, const std::vector<uint32_t> &lengths, std::vector<uint32_t> &latencies) {
+        std::vector<void *> queue(kQueueCapacity);
+        std::atomic<size_t> head(0);
+        std::atomic<size_t> tail(0);
+
+        if constexpr (kMeasureLatency) {
+            latencies.resize(lengths.size() * 2);
+        }
+
+        ngen::memory::bench::Timer timer;
+
+        std::thread consumer([&]() {
+            for (size_t loop = 0; loop < lengths.size(); ++loop) {
+                while (tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+
+                auto ptr = queue[loop % kQueueCapacity];
+                tail.store(loop + 1, std::memory_order_release);
+
+                [[maybe_unused]] std::chrono::steady_clock::time_point start;
+                if constexpr (kMeasureLatency) {
+                    start = std::chrono::steady_clock::now();
+                }
+
+                allocator.release(ptr, 16);
+
+                if constexpr (kMeasureLatency) {
+                    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                    latencies[lengths.size() + loop] = static_cast<uint32_t>(std::min<int64_t>(elapsed, UINT32_MAX));
+                }
+            }
+        });
+
+        for (size_t loop = 0; loop < lengths.size(); ++loop) {
+            [[maybe_unused]] std::chrono::steady_clock::time_point start;
+            if constexpr (kMeasureLatency) {
+                start = std::chrono::steady_clock::now();
+            }
+
+            auto ptr = allocator.allocate(lengths[loop], 16);
+
+            if constexpr (kMeasureLatency) {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                latencies[loop] = static_cast<uint32_t>(std::min<int64_t>(elapsed, UINT32_MAX));
+            }
+
+            if (ptr) {
+                *static_cast<volatile char *>(ptr) = 0;
+            }
+
+            while (loop - tail.load(std::memory_order_acquire) == kQueueCapacity) {
+                std::this_thread::yield();
+            }
+
+            queue[loop % kQueueCapacity] = ptr;
+            head.store(loop + 1, std::memory_order_release);
+        }
+
+        consumer.join();
+        return timer.getElapsedNanoseconds();
+    }
+
+    //! \brief Measures the throughput and latency of an allocator passing messages between a producer and a consumer.
+    //! \param variant [in] - Name of the allocator being measured.
+    //! \param allocator [in] - The allocator to be measured.
+    //! \param lengths [in] - The length (in bytes) of each message.
+    template <typename TAllocator>
+    void measureProducerConsumer(const char *variant, TAllocator &allocator, const std::vector<uint32_t> &lengths) {
+        if (!allocator.isValid()) {
+            return;
+        }
+
+        std::vector<uint32_t> latencies;
+
+        runProducerConsumer<false>(allocator, lengths, latencies);
+        const auto elapsed = runProducerConsumer<false>(allocator, lengths, latencies);
+        runProducerConsumer<true>(allocator, lengths, latencies);
+
+        ngen::memory::bench::reportThroughput("producer_consumer", variant, lengths.size() * 2, elapsed);
+        ngen::memory::bench::reportLatencies("producer_consumer", variant, latencies);
+    }
+
+    //! \brief Selects an allocation length whose logarithm is uniformly distributed, as small objects dominate most programs.
+    //! \param random [in] - The random number generator to be used.
+    //! \param minimumLength [in] - The smallest length (in bytes) that may be selected, must be a power of two.
+    //! \param maximumLength [in] - The largest length (in bytes) that may be selected.
+    //! \returns The selected length (in bytes).
+    size_t selectLength(std::mt19937 &random, size_t minimumLength, size_t maximumLength) {
+        size_t rangeStart = minimumLength;
+        size_t rangeCount = 1;
+
+        while ((minimumLength << rangeCount) < maximumLength) {
+            rangeCount++;
+        }
+
+        rangeStart <<= random() % rangeCount;
+        return std::min(maximumLength, rangeStart + random() % rangeStart);
+    }
+
+    //! \brief Creates a script that repeatedly replaces random live allocations with allocations of a random length.
+    Script createChurnScript() {
+        constexpr size_t kSlotCount = 4096;
+        constexpr size_t kReplacements = 250000;
+
+        std::mt19937 random(1234);
+
+        Script script;
+        script.slotCount = kSlotCount;
+
+        for (size_t slot = 0; slot < kSlotCount; ++slot) {
+            script.allocate(slot, selectLength(random, 16, 2048), 16);
+        }
+
+        for (size_t loop = 0; loop < kReplacements; ++loop) {
+            const auto slot = random() % kSlotCount;
+
+            script.release(slot, 16);
+            script.allocate(slot, selectLength(random, 16, 2048), 16);
+        }
+
+        for (size_t slot = 0; slot < kSlotCount; ++slot) {
+            script.release(slot, 16);
+        }
+
+        return script;
+    }
+
+    //! \brief Creates a script of frames, each making a burst of allocations that are released when the frame ends.
+    //!
+    //! A small fraction of each frame survives into a ring of persistent objects, replacing the oldest of them, so the
+    //! transient allocations of each frame are made around long lived objects scattered through the heap.
+    Script createFrameScript() {
+        constexpr size_t kFrameCount = 100;
+        constexpr size_t kMaximumFrameAllocations = 3000;
+        constexpr size_t kPersistentCount = 256;
+
+        std::mt19937 random(1234);
+
+        Script script;
+        script.slotCount = kPersistentCount + kMaximumFrameAllocations;
+
+        size_t persistentHead = 0;
+        std::vector<bool> isPersistentLive(kPersistentCount);
+
+        for (size_t frame = 0; frame < kFrameCount; ++frame) {
+            const size_t frameAllocations = 1000 + random() % (kMaximumFrameAllocations - 1000);
+
+            for (size_t loop = 0; loop < frameAllocations; ++loop) {
+                const auto length = (0 == random() % 64) ? selectLength(random, 4096, 65536) : selectLength(random, 16, 512);
+                script.allocate(kPersistentCount + loop, length, 16);
+
+                if (0 == random() % 100) {
+                    if (isPersistentLive[persistentHead]) {
+                        script.release(persistentHead, 16);
+                    }
+
+                    script.allocate(persistentHead, selectLength(random, 64, 4096), 16);
+                    isPersistentLive[persistentHead] = true;
+                    persistentHead = (persistentHead + 1) % kPersistentCount;
+                }
+            }
+
+            for (size_t loop = 0; loop < frameAllocations; ++loop) {
+                script.release(kPersistentCount + loop, 16);
+            }
+        }
+
+        for (size_t slot = 0; slot < kPersistentCount; ++slot) {
+            if (isPersistentLive[slot]) {
+                script.release(slot, 16);
+            }
+        }
+
+        return script;
+    }
+
+    //! \brief Creates a script mixing a large population of long lived objects with a stream of short lived ones.
+    //!
+    //! Long lived objects are occasionally replaced, while each short lived object is released after a few further
+    //! short lived objects have been made, as temporaries within a function would be.
+    Script createMixedLifetimeScript() {
+        constexpr size_t kLongLivedCount = 2048;
+        constexpr size_t kShortLivedCount = 32;
+        constexpr size_t kOperationCount = 400000;
+
+        std::mt19937 random(1234);
+
+        Script script;
+        script.slotCount = kLongLivedCount + kShortLivedCount;
+
+        for (size_t slot = 0; slot < kLongLivedCount; ++slot) {
+            script.allocate(slot, selectLength(random, 256, 16384), 16);
+        }
+
+        size_t shortLivedHead = 0;
+        std::vector<bool> isShortLivedLive(kShortLivedCount);
+
+        for (size_t loop = 0; loop < kOperationCount; ++loop) {
+            if (0 == random() % 50) {
+                const auto slot = random() % kLongLivedCount;
+
+                script.release(slot, 16);
+                script.allocate(slot, selectLength(random, 256, 16384), 16);
+                continue;
+            }
+
+            if (isShortLivedLive[shortLivedHead]) {
+                script.release(kLongLivedCount + shortLivedHead, 16);
+            }
+
+            script.allocate(kLongLivedCount + shortLivedHead, selectLength(random, 16, 256), 16);
+            isShortLivedLive[shortLivedHead] = true;
+            shortLivedHead = (shortLivedHead + 1) % kShortLivedCount;
+        }
+
+        for (size_t slot = 0; slot < kLongLivedCount; ++slot) {
+            script.release(slot, 16);
+        }
+
+        for (size_t slot = 0; slot < kShortLivedCount; ++slot) {
+            if (isShortLivedLive[slot]) {
+                script.release(kLongLivedCount + slot, 16);
+            }
+        }
+
+        return script;
+    }
+
+    //! \brief Creates a script replacing buffers aligned for SIMD loads, with the occasional page aligned buffer.
+    Script createSimdBufferScript() {
+        constexpr size_t kSlotCount = 1024;
+        constexpr size_t kReplacements = 200000;
+        constexpr size_t kAlignments[] = { 16, 32, 64 };
+
+        std::mt19937 random(1234);
+
+        Script script;
+        script.slotCount = kSlotCount;
+
+        std::vector<size_t> alignments(kSlotCount);
+
+        const auto allocateBuffer = [&](size_t slot) {
+            size_t alignment = kAlignments[random() % 3];
+            size_t length = selectLength(random, 64, 16384);
+
+            if (0 == random() % 32) {
+                alignment = 4096;
+                length = 65536;
+            }
+
+            script.allocate(slot, (length + alignment - 1) & ~(alignment - 1), alignment);
+            alignments[slot] = alignment;
+        };
+
+        for (size_t slot = 0; slot < kSlotCount; ++slot) {
+            allocateBuffer(slot);
+        }
+
+        for (size_t loop = 0; loop < kReplacements; ++loop) {
+            const auto slot = random() % kSlotCount;
+
+            script.release(slot, alignments[slot]);
+            allocateBuffer(slot);
+        }
+
+        for (size_t slot = 0; slot < kSlotCount; ++slot) {
+            script.release(slot, alignments[slot]);
+        }
+
+        return script;
+    }
+}
+
+//! \brief Replaces random live allocations with allocations of random length, as a long running service would.
+NGEN_BENCHMARK(churn) {
+    measureStrategies("churn", createChurnScript());
+}
+
+//! \brief Measures the churn workload with a heap profiler attached, sampling at decreasing intervals.
+NGEN_BENCHMARK(profiled_churn) {
+    const size_t sampleIntervals[] = {
+        ngen::memory::HeapProfiler::kDefaultSampleInterval,
+        64 * 1024,
+        4 * 1024,
+    };
+
+    const auto script = createChurnScript();
+
+    HeapUnderTest unprofiled(ngen::memory::kAllocationStrategy::TLSF);
+    measureScript("profiled_churn", "TLSF", unprofiled, script);
+
+    for (auto sampleInterval : sampleIntervals) {
+        ngen::memory::HeapProfiler profiler;
+        if (!profiler.initialize(sampleInterval)) {
+            continue;
+        }
+
+        HeapUnderTest allocator(ngen::memory::kAllocationStrategy::TLSF);
+        allocator.setHeapProfiler(&profiler);
+
+        char variant[64];
+        snprintf(variant, sizeof(variant), "TLSF/sample_%zuk", sampleInterval / 1024);
+
+        measureScript("profiled_churn", variant, allocator, script);
+        ngen::memory::bench::report("profiled_churn", variant, "samples", static_cast<double>(profiler.getSamples()));
+
+        allocator.setHeapProfiler(nullptr);
+    }
+}
+
+//! \brief Allocates messages on one thread that are released by another, measured with ConcurrentHeap for each strategy.
+NGEN_BENCHMARK(producer_consumer) {
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    std::mt19937 random(1234);
+
+    std::vector<uint32_t> lengths(kMessageCount);
+    for (auto &length : lengths) {
+        length = static_cast<uint32_t>(selectLength(random, 16, 2048));
+    }
+
+    for (auto strategy : strategies) {
+        ConcurrentHeapUnderTest allocator(strategy);
+        measureProducerConsumer(ngen::memory::getAllocationStrategyName(strategy), allocator, lengths);
+    }
+
+    SystemUnderTest system;
+    measureProducerConsumer("malloc", system, lengths);
+}
+
+//! \brief Makes bursts of allocations that are all released at the end of each frame, as a game loop would.
+NGEN_BENCHMARK(frame) {
+    measureStrategies("frame", createFrameScript());
+}
+
+//! \brief Mixes a large population of long lived objects with a stream of short lived temporaries.
+NGEN_BENCHMARK(mixed_lifetime) {
+    measureStrategies("mixed_lifetime", createMixedLifetimeScript());
+}
+
+//! \brief Replaces buffers aligned for SSE, AVX and AVX-512 loads, with the occasional page aligned buffer.
+NGEN_BENCHMARK(simd_buffers) {
+    measureStrategies("simd_buffers", createSimdBufferScript());
+}
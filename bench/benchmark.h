@@ -0,0 +1,60 @@
+
+#if !defined(MEMORY_BENCHMARK_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_BENCHMARK_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "allocation_strategy.h"
+#include "virtual_memory.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory::bench {
+    using BenchmarkFunction = void (*)();
+
+    //! \brief  Registers a benchmark function with the benchmark executable, instances are created by NGEN_BENCHMARK.
+    class Registration {
+    public:
+        Registration(const char *name, BenchmarkFunction function);
+    };
+
+    //! \brief  Simple wall clock timer used to measure the duration of benchmark loops.
+    class Timer {
+    public:
+        Timer() : m_start(std::chrono::steady_clock::now()) {
+
+        }
+
+        //! \brief Retrieves the time that has elapsed since the timer was created.
+        //! \returns The number of nanoseconds that have elapsed since the timer was created.
+        [[nodiscard]] uint64_t getElapsedNanoseconds() const {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    [[nodiscard]] const char* getBackingName(kPageBacking backing);
+
+    void report(const char *benchmark, const char *variant, const char *metric, double value);
+    void reportThroughput(const char *benchmark, const char *variant, size_t operations, uint64_t elapsedNanoseconds);
+    void reportLatencies(const char *benchmark, const char *variant, std::vector<uint32_t> &latencies);
+}
+
+#define NGEN_BENCHMARK(name) \
+    static void name(); \
+    static const ngen::memory::bench::Registration name##Registration(#name, &name); \
+    static void name()
+
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_BENCHMARK_HEADER_INCLUDED_STRANGE_SECRETS)
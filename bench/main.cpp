@@ -0,0 +1,154 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "benchmark.h"
+
+namespace {
+    struct BenchmarkEntry {
+        const char *name;
+        ngen::memory::bench::BenchmarkFunction function;
+    };
+
+    //! \brief The formats measurements may be written in.
+    enum class kOutputFormat {
+        Text,                       // Aligned columns, intended to be read
+        CSV,                        // One comma separated record per measurement, following a header
+        JSON,                       // An array holding an object for each measurement
+    };
+
+    kOutputFormat outputFormat = kOutputFormat::Text;
+    size_t reportedCount = 0;
+
+    //! \brief Retrieves the list of benchmarks registered with the executable.
+    //! \returns Reference to the list of registered benchmarks.
+    std::vector<BenchmarkEntry>& getBenchmarks() {
+        static std::vector<BenchmarkEntry> benchmarks;
+        return benchmarks;
+    }
+}
+
+namespace ngen::memory::bench {
+    Registration::Registration(const char *name, BenchmarkFunction function) {
+        getBenchmarks().push_back({name, function});
+    }
+
+    //! \brief Retrieves a printable name for the page backing of a memory block.
+    //! \param backing [in] - The page backing whose name is required.
+    //! \returns Pointer to a string containing the name of the page backing.
+    const char *getBackingName(kPageBacking backing) {
+        switch (backing) {
+            case kPageBacking::Standard:
+                return "Standard";
+
+            case kPageBacking::Transparent:
+                return "Transparent";
+
+            case kPageBacking::HugeTLB:
+                return "HugeTLB";
+
+            default:
+                break;
+        }
+
+        return "Invalid";
+    }
+
+    //! \brief Outputs a single measurement made by a benchmark.
+    //! \param benchmark [in] - Name of the benchmark that made the measurement.
+    //! \param variant [in] - Name of the configuration that was measured.
+    //! \param metric [in] - Name of the value that was measured.
+    //! \param value [in] - The measured value.
+    void report(const char *benchmark, const char *variant, const char *metric, double value) {
+        switch (outputFormat) {
+            case kOutputFormat::CSV:
+                printf("%s,%s,%s,%.2f\n", benchmark, variant, metric, value);
+                break;
+
+            case kOutputFormat::JSON:
+                printf("%s\n  {\"benchmark\": \"%s\", \"variant\": \"%s\", \"metric\": \"%s\", \"value\": %.2f}", reportedCount ? "," : "", benchmark, variant, metric, value);
+                break;
+
+            default:
+                printf("%-24s %-32s %-16s %14.2f\n", benchmark, variant, metric, value);
+                break;
+        }
+
+        reportedCount++;
+    }
+
+    //! \brief Outputs the number of operations a benchmark performed each second.
+    //! \param benchmark [in] - Name of the benchmark that made the measurement.
+    //! \param variant [in] - Name of the configuration that was measured.
+    //! \param operations [in] - The number of operations that were performed.
+    //! \param elapsedNanoseconds [in] - The time taken to perform the operations.
+    void reportThroughput(const char *benchmark, const char *variant, size_t operations, uint64_t elapsedNanoseconds) {
+        report(benchmark, variant, "ops/s", elapsedNanoseconds ? static_cast<double>(operations) * 1000000000.0 / static_cast<double>(elapsedNanoseconds) : 0.0);
+    }
+
+    //! \brief Outputs the median and tail latencies of the operations performed by a benchmark.
+    //! \param benchmark [in] - Name of the benchmark that made the measurement.
+    //! \param variant [in] - Name of the configuration that was measured.
+    //! \param latencies [in] - The number of nanoseconds taken by each operation, the samples are sorted in place.
+    void reportLatencies(const char *benchmark, const char *variant, std::vector<uint32_t> &latencies) {
+        if (latencies.empty()) {
+            return;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        const auto percentile = [&latencies](size_t perMille) {
+            return static_cast<double>(latencies[std::min(latencies.size() - 1, latencies.size() * perMille / 1000)]);
+        };
+
+        report(benchmark, variant, "p50_ns", percentile(500));
+        report(benchmark, variant, "p99_ns", percentile(990));
+        report(benchmark, variant, "p999_ns", percentile(999));
+    }
+}
+
+//! \brief Runs the registered benchmarks, if any names are supplied on the command line only those benchmarks are run.
+//!
+//! Measurements are written as aligned text, or as CSV or JSON when --csv or --json is supplied.
+int main(int argc, char *argv[]) {
+    size_t selectedCount = 0;
+
+    for (int loop = 1; loop < argc; ++loop) {
+        if (0 == strcmp(argv[loop], "--csv")) {
+            outputFormat = kOutputFormat::CSV;
+        } else if (0 == strcmp(argv[loop], "--json")) {
+            outputFormat = kOutputFormat::JSON;
+        } else {
+            selectedCount++;
+        }
+    }
+
+    if (kOutputFormat::CSV == outputFormat) {
+        printf("benchmark,variant,metric,value\n");
+    } else if (kOutputFormat::JSON == outputFormat) {
+        printf("[");
+    }
+
+    for (const auto &benchmark : getBenchmarks()) {
+        bool selected = (0 == selectedCount);
+
+        for (int loop = 1; loop < argc; ++loop) {
+            if (0 == strcmp(argv[loop], benchmark.name)) {
+                selected = true;
+            }
+        }
+
+        if (selected) {
+            benchmark.function();
+            fflush(stdout);
+        }
+    }
+
+    if (kOutputFormat::JSON == outputFormat) {
+        printf("\n]\n");
+    }
+
+    return 0;
+}
@@ -16,9 +16,33 @@ namespace ngen::memory {
         //! \brief  Chooses the first free block encountered that has the requested number of bytes available.
         First,
 
-        //! \brief  Scans all free blocks and selects the smallest free block that has the number of requested bytes available.
-        Smallest
+        //! \brief  Selects the smallest free block that has the requested number of bytes available found in a size ordered tree, in logarithmic time unless alignment requires walking to larger blocks.
+        Smallest,
+
+        //! \brief  Selects a free block from size segregated lists located using bitmaps, in constant time.
+        TLSF
     };
+
+    //! \brief Retrieves a printable name for an allocation strategy.
+    //! \param strategy [in] - The allocation strategy whose name is required.
+    //! \returns Pointer to a string containing the name of the allocation strategy.
+    inline const char* getAllocationStrategyName(kAllocationStrategy strategy) {
+        switch (strategy) {
+            case kAllocationStrategy::First:
+                return "First";
+
+            case kAllocationStrategy::Smallest:
+                return "Smallest";
+
+            case kAllocationStrategy::TLSF:
+                return "TLSF";
+
+            default:
+                break;
+        }
+
+        return "Invalid";
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,144 @@
+
+#if !defined(MEMORY_ARENA_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_ARENA_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    class Heap;
+
+    //! \brief  Position within an Arena, allocations made after the marker was taken are released by rewinding to it.
+    using ArenaMarker = size_t;
+
+    //! \brief  Linear allocator that serves allocations by advancing through a single block of memory.
+    //!
+    //! Allocations carry no header and are never released individually, instead the arena is rewound to a marker
+    //! taken earlier or reset entirely, both of which take constant time. This suits transient data such as the
+    //! scratch allocations made during a single frame.
+    class Arena {
+    public:
+        static constexpr size_t kDefaultAlignment = alignof(std::max_align_t);
+
+        Arena();
+        ~Arena();
+
+        Arena(const Arena &other) = delete;
+        Arena &operator=(const Arena &other) = delete;
+
+        bool initialize(void *memoryBlock, size_t blockSize);
+        bool initialize(Heap *heap, size_t blockSize);
+
+        void release();
+
+        [[nodiscard]] void* alloc(size_t dataLength);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* alloc(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        [[nodiscard]] void* allocArray(size_t dataLength);
+        [[nodiscard]] void* alignedAllocArray(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* allocArray(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAllocArray(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        bool deallocate(void *ptr, bool isArray, const char *fileName, size_t line);
+
+        [[nodiscard]] ArenaMarker getMarker() const;
+        bool rewind(ArenaMarker marker);
+        void reset();
+
+        [[nodiscard]] bool owns(const void *ptr) const;
+
+        [[nodiscard]] size_t getSize() const;
+        [[nodiscard]] size_t getUsed() const;
+        [[nodiscard]] size_t getPeakUsed() const;
+        [[nodiscard]] size_t getFailedAllocations() const;
+
+    private:
+        [[nodiscard]] void* allocate(size_t dataLength, size_t alignment);
+
+    private:
+        uintptr_t m_start;
+        uintptr_t m_current;
+        uintptr_t m_end;
+
+        Heap *m_heap;
+        void *m_memoryBlock;
+
+        size_t m_peakUsed;
+        size_t m_failedAllocations;
+    };
+
+    //! \brief  Takes a marker from an arena when constructed and rewinds the arena to it when destroyed.
+    class ArenaScope {
+    public:
+        explicit ArenaScope(Arena &arena) : m_arena(arena), m_marker(arena.getMarker()) {
+
+        }
+
+        ~ArenaScope() {
+            m_arena.rewind(m_marker);
+        }
+
+        ArenaScope(const ArenaScope &other) = delete;
+        ArenaScope &operator=(const ArenaScope &other) = delete;
+
+    private:
+        Arena &m_arena;
+        ArenaMarker m_marker;
+    };
+
+    //! \brief Retrieves a marker describing the current position of the arena.
+    //! \returns Marker that may later be supplied to rewind, to release every allocation made after this call.
+    inline ArenaMarker Arena::getMarker() const {
+        return m_current - m_start;
+    }
+
+    //! \brief Releases every allocation made by the arena.
+    inline void Arena::reset() {
+        m_current = m_start;
+    }
+
+    //! \brief Determines whether or not a pointer lies within the memory managed by the arena.
+    //! \param ptr [in] - The pointer to be tested.
+    //! \returns True if the pointer lies within the memory block of the arena otherwise false.
+    inline bool Arena::owns(const void *ptr) const {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return address >= m_start && address < m_end;
+    }
+
+    //! \brief Retrieves the total size of the arena.
+    //! \returns The size (in bytes) of the memory block managed by this arena.
+    inline size_t Arena::getSize() const {
+        return m_end - m_start;
+    }
+
+    //! \brief Retrieves the number of bytes currently consumed by allocations, including alignment padding.
+    //! \returns The number of bytes consumed since the arena was last reset.
+    inline size_t Arena::getUsed() const {
+        return m_current - m_start;
+    }
+
+    //! \brief Retrieves the largest number of bytes that have been consumed at once during the lifetime of the arena.
+    //! \returns The high water mark (in bytes) of the arena.
+    inline size_t Arena::getPeakUsed() const {
+        return m_peakUsed;
+    }
+
+    //! \brief Retrieves the number of allocation requests that have been requested but failed.
+    //! \returns The number of allocation requests that have been failed by this arena.
+    inline size_t Arena::getFailedAllocations() const {
+        return m_failedAllocations;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_ARENA_HEADER_INCLUDED_STRANGE_SECRETS)
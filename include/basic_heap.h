@@ -0,0 +1,2604 @@
+
+#if !defined(MEMORY_BASIC_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_BASIC_HEAP_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "allocation_strategy.h"
+#include "heap_policies.h"
+#include "heap_profiler.h"
+#include "small_object_allocator.h"
+#include "size_tree_index.h"
+#include "tlsf_index.h"
+#include "trace_recorder.h"
+#include "virtual_memory.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief Header stored before each allocation when tracking or sentinels are enabled.
+    struct TrackedAllocation {
+        size_t tag;             // Reserved for the boundary tag, when the header is located at the start of the block
+        const void *heap;       // The heap from which we were allocated
+        size_t size;            // Size (in bytes) of memory allocation
+        size_t line;            // Line number that made the allocation (debug only)
+        size_t blockSize;       // Total size (in bytes) of allocated memory block, including header and footer.
+        size_t id;              // Global allocation identifier
+        uintptr_t addr;         // Start address of allocation block
+        const char *fileName;   // Path to file that made the allocation (debug only)
+        char sentinel[4];       // Bytes that are used to detect buffer over-runs of allocated data.
+        bool isArray;           // True if allocation was made using array operator
+        bool isSampled;         // True if allocation was sampled by the heap profiler
+        bool isCached;          // True if allocation has been released to a thread cache of a ConcurrentHeap
+    };
+
+    //! \brief Compact header stored before each allocation when tracking is disabled, the block length is read from
+    //! the boundary tag at the start of the block.
+    struct CompactAllocation {
+        size_t tag;             // Reserved for the boundary tag, when the header is located at the start of the block
+        uint32_t offset;        // Distance (in bytes) from the start of the allocation block to this header
+        uint16_t heapIndex;     // Index of the heap from which we were allocated, zero once the allocation is released
+        uint16_t flags;         // Flags describing the allocation, such as whether it was made using an array operator
+    };
+
+    //! \brief An allocation along with the number of bytes that may be used within it, returned by allocAtLeast.
+    struct AllocationResult {
+        void *ptr;              // Pointer to the allocation, null if the allocation could not be made
+        size_t usableSize;      // Number of bytes that may be used at ptr, at least the requested length
+    };
+
+    struct FreeBlock;
+
+    //! \brief Links used by the size index of the heap's allocation strategy, a heap only maintains a single index.
+    union FreeBlockIndex {
+        struct {
+            FreeBlock *previous;    // Previous FreeBlock in the size segregated list
+            FreeBlock *next;        // Next FreeBlock in the size segregated list
+        } bin;                      // Used by kAllocationStrategy::TLSF
+
+        struct {
+            FreeBlock *parent;      // Parent FreeBlock within the size ordered tree
+            FreeBlock *left;        // Child FreeBlock that is smaller than this block
+            FreeBlock *right;       // Child FreeBlock that is larger than this block
+            size_t height;          // Height of the sub-tree rooted at this block
+        } tree;                     // Used by kAllocationStrategy::Smallest
+    };
+
+    //! \brief Header stored at the start of each free block, the size is also stored in the last word of the block.
+    //!
+    //! The first word of every block (free or allocated) is its boundary tag. Free blocks store their plain size, while
+    //! allocated blocks store their size combined with flags describing the block and its physical predecessor.
+    struct FreeBlock {
+        size_t size;            // Total size of memory block (including the FreeBlock structure itself)
+        FreeBlock *previous;    // Previous FreeBlock in linked list
+        FreeBlock *next;        // Next FreeBlock in linked list
+        FreeBlockIndex index;   // Links within the size index of the allocation strategy
+    };
+
+    //! \brief Link stored within the data of an allocation that has been released by a thread that does not own the heap.
+    struct RemoteFree {
+        RemoteFree *next;       // Next allocation released by another thread
+    };
+
+    namespace detail {
+        constexpr size_t kDefaultAlignment = 4;
+        constexpr size_t kMaximumPreservedAlignment = 4096;
+
+        constexpr auto kDefaultAllocationStrategy = kAllocationStrategy::First;
+
+        inline constexpr char kHeaderSentinelData[] = "ALOC";
+        inline constexpr char kFooterSentinelData[] = "COLA";
+
+        constexpr uint16_t kAllocationArray = 1;    // Allocation flag, set when the allocation was made using an array operator
+        constexpr uint16_t kAllocationSampled = 2;  // Allocation flag, set when the allocation was sampled by the heap profiler
+        constexpr uint16_t kAllocationCached = 4;   // Allocation flag, set while the allocation is held by a thread cache
+
+        constexpr size_t kBlockAllocated = 1;       // Boundary tag flag, set when the block is allocated
+        constexpr size_t kPreviousFree = 2;         // Boundary tag flag, set when the physically preceding block is free
+        constexpr size_t kBlockFlags = kBlockAllocated | kPreviousFree;
+
+        constexpr size_t kFreeBlockScavenged = 4;   // Footer flag, set when pages within a free block have been discarded
+
+        constexpr size_t kMinimumFreeBlockLength = sizeof(FreeBlock) + sizeof(size_t);
+        constexpr size_t kMinimumGrowthLength = 64 * 1024;
+
+        [[nodiscard]] uint16_t registerHeap(const void *heap);
+        void unregisterHeap(uint16_t heapIndex);
+
+        [[nodiscard]] size_t nextAllocationId();
+
+        //! \brief Simple helper function to determine whether or not a value is a power of 2.
+        //! \param value [in] - The number to check if it is a valid power of 2.
+        //! \returns True if the supplied value is a power of 2 otherwise returns false.
+        inline bool isPow2(size_t value) {
+            return (0 != value && (value & (value -1)) == 0);
+        }
+
+        //! \brief Given a pointer address, this method returns the next valid address that is aligned with the specified size.
+        //! If the pointer is already aligned, it is returned unchanged.
+        //! \param ptr [in] The pointer address to be aligned.
+        //! \param alignment [in] The desired byte alignment of the pointer.
+        //! \return The pointer address aligned to the specified alignment.
+        template <typename TType> inline TType alignValue(TType value, size_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        //! \brief Retrieves the boundary tag stored in the first word of a block.
+        //! \param block [in] - Address of the start of the block.
+        //! \returns Reference to the boundary tag of the block.
+        inline size_t& getBlockTag(uintptr_t block) {
+            return *reinterpret_cast<size_t *>(block);
+        }
+
+        static_assert(sizeof(std::atomic<size_t>) == sizeof(size_t) && std::atomic<size_t>::is_always_lock_free, "Boundary tags are accessed atomically");
+
+        //! \brief Reads the boundary tag of a block that may have its flags updated by another thread.
+        //!
+        //! The kPreviousFree flag of a live allocation changes whenever the block preceding it is allocated or released,
+        //! while ConcurrentHeap reads the length of the allocation without holding its lock. The flags are therefore
+        //! updated, and the tags of live allocations read, through relaxed atomic operations that compile to plain moves.
+        //! \param block [in] - Address of the start of the block.
+        //! \returns The boundary tag of the block.
+        inline size_t loadBlockTag(uintptr_t block) {
+            return reinterpret_cast<const std::atomic<size_t> *>(block)->load(std::memory_order_relaxed);
+        }
+
+        //! \brief Records whether or not the predecessor of a block is free, the caller must hold the lock of the heap.
+        //! \param block [in] - Address of the start of the block.
+        //! \param isFree [in] - True if the block preceding this one is free otherwise false.
+        inline void setPreviousFree(uintptr_t block, bool isFree) {
+            auto tag = reinterpret_cast<std::atomic<size_t> *>(block);
+            const auto value = tag->load(std::memory_order_relaxed);
+
+            tag->store(isFree ? (value | kPreviousFree) : (value & ~kPreviousFree), std::memory_order_relaxed);
+        }
+
+        //! \brief Retrieves the footer stored in the last word of a free block.
+        //! \param block [in] - The free block whose footer is required.
+        //! \returns Reference to the footer, which holds the size of the block and any footer flags.
+        inline size_t& getFreeBlockFooter(FreeBlock *block) {
+            return *reinterpret_cast<size_t *>(reinterpret_cast<uintptr_t>(block) + block->size - sizeof(size_t));
+        }
+
+        //! \brief Retrieves the number of discarded bytes within a free block, stored in the word preceding its footer.
+        //! \param block [in] - The free block whose discarded length is required, its footer must be flagged as scavenged.
+        //! \returns Reference to the number of bytes within the block whose pages have been discarded.
+        inline size_t& getScavengedLength(FreeBlock *block) {
+            return *reinterpret_cast<size_t *>(reinterpret_cast<uintptr_t>(block) + block->size - sizeof(size_t) * 2);
+        }
+
+        //! \brief Prepares a region of memory as a free block, writing both its header and its footer.
+        //! \param block [in] - Address of the start of the region.
+        //! \param blockLength [in] - Length (in bytes) of the region.
+        //! \returns Pointer to the FreeBlock describing the region, the block is not linked into any list.
+        inline FreeBlock* createFreeBlock(uintptr_t block, size_t blockLength) {
+            assert(blockLength >= kMinimumFreeBlockLength);
+            assert(0 == (blockLength & kBlockFlags));
+
+            auto freeBlock = reinterpret_cast<FreeBlock *>(block);
+            freeBlock->size = blockLength;
+            freeBlock->previous = nullptr;
+            freeBlock->next = nullptr;
+
+            *reinterpret_cast<size_t *>(block + blockLength - sizeof(size_t)) = blockLength;
+            return freeBlock;
+        }
+
+        inline bool validateSentinel(const TrackedAllocation *allocation) {
+            return (   allocation->sentinel[0] == kHeaderSentinelData[0]
+                    && allocation->sentinel[1] == kHeaderSentinelData[1]
+                    && allocation->sentinel[2] == kHeaderSentinelData[2]
+                    && allocation->sentinel[3] == kHeaderSentinelData[3]);
+        }
+
+        //! \brief Retrieves the address of the memory block containing an allocation.
+        //! \param allocation [in] - Header of the allocation.
+        //! \returns The address of the start of the block containing the allocation.
+        inline uintptr_t getAllocationBlock(const TrackedAllocation *allocation) {
+            return allocation->addr;
+        }
+
+        inline uintptr_t getAllocationBlock(const CompactAllocation *allocation) {
+            return reinterpret_cast<uintptr_t>(allocation) - allocation->offset;
+        }
+
+        //! \brief Retrieves the length of the memory block containing an allocation.
+        //! \param allocation [in] - Header of the allocation.
+        //! \returns The length (in bytes) of the block containing the allocation, including its header.
+        inline size_t getAllocationBlockLength(const TrackedAllocation *allocation) {
+            return allocation->blockSize;
+        }
+
+        inline size_t getAllocationBlockLength(const CompactAllocation *allocation) {
+            return loadBlockTag(getAllocationBlock(allocation)) & ~kBlockFlags;
+        }
+
+        //! \brief Determines whether or not an allocation was made using an array operator.
+        //! \param allocation [in] - Header of the allocation.
+        //! \returns True if the allocation was made using an array operator otherwise false.
+        inline bool isArrayAllocation(const TrackedAllocation *allocation) {
+            return allocation->isArray;
+        }
+
+        inline bool isArrayAllocation(const CompactAllocation *allocation) {
+            return 0 != (allocation->flags & kAllocationArray);
+        }
+
+        //! \brief Determines whether or not an allocation was sampled by the heap profiler.
+        //! \param allocation [in] - Header of the allocation.
+        //! \returns True if the allocation was sampled otherwise false.
+        inline bool isSampledAllocation(const TrackedAllocation *allocation) {
+            return allocation->isSampled;
+        }
+
+        inline bool isSampledAllocation(const CompactAllocation *allocation) {
+            return 0 != (allocation->flags & kAllocationSampled);
+        }
+
+        //! \brief Marks an allocation as sampled, so that its release is reported to the heap profiler.
+        //! \param allocation [in] - Header of the allocation.
+        inline void markSampledAllocation(TrackedAllocation *allocation) {
+            allocation->isSampled = true;
+        }
+
+        inline void markSampledAllocation(CompactAllocation *allocation) {
+            allocation->flags |= kAllocationSampled;
+        }
+
+        //! \brief Determines whether or not an allocation is held by a thread cache.
+        //! \param allocation [in] - Header of the allocation.
+        //! \returns True if the allocation has been released to a thread cache otherwise false.
+        inline bool isCachedAllocation(const TrackedAllocation *allocation) {
+            return allocation->isCached;
+        }
+
+        inline bool isCachedAllocation(const CompactAllocation *allocation) {
+            return 0 != (allocation->flags & kAllocationCached);
+        }
+
+        //! \brief Records whether or not an allocation is held by a thread cache.
+        //! \param allocation [in] - Header of the allocation.
+        //! \param isCached [in] - True if the allocation has been released to a thread cache otherwise false.
+        inline void setCachedAllocation(TrackedAllocation *allocation, bool isCached) {
+            allocation->isCached = isCached;
+        }
+
+        inline void setCachedAllocation(CompactAllocation *allocation, bool isCached) {
+            allocation->flags = isCached ? (allocation->flags | kAllocationCached) : (allocation->flags & ~kAllocationCached);
+        }
+    }
+
+    //! \brief  Heap that manages a single block of memory, configured at compile time through a set of policies.
+    //!
+    //! \tparam TSearchPolicy - Selects the strategy used to search for free blocks, or SearchDynamic to choose it when
+    //!                         the heap is initialized.
+    //! \tparam TTrackingPolicy - Determines whether the size, source location and identifier of each allocation are recorded.
+    //! \tparam TSentinelPolicy - Determines whether each allocation header is guarded by a sentinel.
+    //! \tparam TStatisticsPolicy - Records the allocation counters reported by the heap.
+    //! \tparam TLockPolicy - Serializes operations on the heap, if it is to be shared between threads.
+    //!
+    //! Policies that are disabled are removed from the allocation path entirely. Enabling either tracking or
+    //! sentinels selects the TrackedAllocation header, otherwise each allocation carries a CompactAllocation header.
+    template <typename TSearchPolicy, typename TTrackingPolicy, typename TSentinelPolicy, typename TStatisticsPolicy, typename TLockPolicy>
+    class BasicHeap {
+    public:
+        static constexpr bool kTracking = TTrackingPolicy::kEnabled;
+        static constexpr bool kSentinels = TSentinelPolicy::kEnabled;
+
+        using Header = std::conditional_t<kTracking || kSentinels, TrackedAllocation, CompactAllocation>;
+
+        BasicHeap();
+        ~BasicHeap();
+
+        BasicHeap(const BasicHeap &other) = delete;
+        BasicHeap &operator=(const BasicHeap &other) = delete;
+
+        bool initialize(void *memoryBlock, size_t blockSize);
+        bool initialize(void *memoryBlock, size_t blockSize, kAllocationStrategy allocationStrategy);
+
+        bool initializeGrowable(size_t reserveLength, size_t commitLength);
+        bool initializeGrowable(size_t reserveLength, size_t commitLength, kAllocationStrategy allocationStrategy);
+
+        bool enableSmallObjects(size_t regionLength);
+        bool enableRemoteFrees();
+
+        [[nodiscard]] void* alloc(size_t dataLength);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* alloc(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        [[nodiscard]] void* allocArray(size_t dataLength);
+        [[nodiscard]] void* alignedAllocArray(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* allocArray(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAllocArray(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        [[nodiscard]] AllocationResult allocAtLeast(size_t dataLength);
+        [[nodiscard]] AllocationResult allocAtLeast(size_t dataLength, size_t alignment);
+
+        bool deallocate(void *ptr, bool isArray, const char *fileName, size_t line);
+
+        bool deallocate(void *ptr, size_t dataLength, size_t alignment);
+        bool deallocateArray(void *ptr, size_t dataLength, size_t alignment);
+
+        size_t allocBatch(size_t count, size_t dataLength, size_t alignment, void **allocations);
+        size_t deallocateBatch(void **allocations, size_t count);
+
+        size_t processRemoteFrees();
+
+        size_t scavenge(size_t minimumBlockSize, size_t maximumBytes);
+
+        [[nodiscard]] void* reallocate(void *ptr, size_t dataLength);
+        bool tryExpandInPlace(void *ptr, size_t dataLength);
+
+        [[nodiscard]] void* slideAllocation(void *ptr, size_t alignment);
+
+        [[nodiscard]] size_t getUsableSize(const void *ptr) const;
+        [[nodiscard]] bool isUntrackedAllocation(const void *ptr) const;
+        bool setCachedAllocation(void *ptr, bool isCached);
+
+        [[nodiscard]] size_t getSize() const;
+        [[nodiscard]] size_t getReservedSize() const;
+        [[nodiscard]] size_t getAllocations() const;
+        [[nodiscard]] size_t getTotalAllocations() const;
+        [[nodiscard]] size_t getFailedAllocations() const;
+        [[nodiscard]] size_t getScavengedBytes() const;
+        [[nodiscard]] size_t getRefaultedBytes() const;
+
+        [[nodiscard]] HeapStats getStats() const;
+
+        [[nodiscard]] kAllocationStrategy getAllocationStrategy() const;
+
+        [[nodiscard]] bool hasSmallObjects() const;
+        [[nodiscard]] const SmallObjectAllocator& getSmallObjects() const;
+
+        [[nodiscard]] bool hasRemoteFrees() const;
+        [[nodiscard]] bool isGrowable() const;
+
+        void setTraceRecorder(TraceRecorder *recorder);
+        [[nodiscard]] TraceRecorder* getTraceRecorder() const;
+
+        void setHeapProfiler(HeapProfiler *profiler);
+        [[nodiscard]] HeapProfiler* getHeapProfiler() const;
+
+    private:
+        [[nodiscard]] bool initializeMemory(void *memoryBlock, size_t blockSize, size_t indexLength, kAllocationStrategy allocationStrategy);
+        [[nodiscard]] bool growMemory(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] FreeBlock* gatherMemory(uintptr_t blockStart, size_t blockLength);
+        [[nodiscard]] Header* consumeMemory(FreeBlock *freeBlock, size_t dataLength, size_t alignment);
+        [[nodiscard]] Header* createAllocation(uintptr_t blockStart, uintptr_t dataStart, size_t blockLength);
+        [[nodiscard]] uintptr_t getAllocationStart(uintptr_t rawPtr, uintptr_t alignedPtr, uintptr_t endPtr) const;
+        void releaseAlignmentPadding(uintptr_t paddingStart, uintptr_t blockStart);
+        void describeAllocation(Header *allocation, size_t dataLength, bool isArray, const char *fileName, size_t line);
+
+        void insertFreeBlock(FreeBlock *block);
+        void removeFreeBlock(FreeBlock *block);
+
+        [[nodiscard]] size_t takeScavengedBytes(FreeBlock *block);
+        void retainScavengedBytes(uintptr_t blockStart, uintptr_t blockEnd, size_t discardedBytes, uintptr_t remainderStart);
+        static void markScavenged(FreeBlock *block, size_t discardedBytes);
+
+        void indexFreeBlock(FreeBlock *block);
+        void unindexFreeBlock(FreeBlock *block);
+
+        [[nodiscard]] kAllocationStrategy getSearchStrategy() const;
+
+        [[nodiscard]] static size_t getScavengeRange(FreeBlock *block, uintptr_t &rangeStart);
+        [[nodiscard]] static size_t getScavengeRange(uintptr_t blockStart, uintptr_t blockEnd, uintptr_t &rangeStart);
+
+        [[nodiscard]] FreeBlock* findFreeBlock(size_t dataLength, size_t alignment);
+        [[nodiscard]] FreeBlock* findFreeBlock_first(size_t dataLength, size_t alignment, size_t &searchLength) const;
+        [[nodiscard]] FreeBlock* findFreeBlock_smallest(size_t dataLength, size_t alignment, size_t &searchLength) const;
+        [[nodiscard]] FreeBlock* findFreeBlock_tlsf(size_t dataLength, size_t alignment, size_t &searchLength) const;
+        [[nodiscard]] size_t getLargestFreeBlock() const;
+
+        [[nodiscard]] void* allocate(size_t dataLength, size_t alignment, bool isArray, const char *fileName, size_t line);
+
+        [[nodiscard]] Header* findAllocation(const void *ptr) const;
+        [[nodiscard]] bool resizeBlock(Header *allocation, size_t dataLength);
+
+        [[nodiscard]] bool isOwner(const Header *allocation) const;
+        void releaseOwnership(Header *allocation);
+        void releaseBlock(Header *allocation);
+        void releaseMemory(uintptr_t blockStart, size_t blockLength);
+
+        [[nodiscard]] bool releaseSmallObject(void *ptr, bool isArray);
+        [[nodiscard]] bool releaseSized(void *ptr, size_t dataLength, size_t alignment, bool isArray);
+
+        [[nodiscard]] bool releaseRemote(void *ptr, bool isArray);
+        void pushRemoteFree(void *ptr);
+        size_t drainRemoteFrees();
+
+        void traceEvent(kTraceEvent type, const void *ptr, size_t size, size_t alignment, bool isArray);
+
+        [[nodiscard]] bool sampleAllocation(size_t dataLength);
+        void recordSample(Header *allocation, size_t dataLength, const char *fileName, size_t line);
+        void releaseSample(const Header *allocation, const void *ptr);
+
+        [[nodiscard]] bool isRemoteThread() const;
+
+    private:
+        FreeBlock *m_rootBlock;
+        void *m_memoryBlock;
+
+        SmallObjectAllocator m_smallObjects;
+        SizeTreeIndex m_sizeIndex;
+        TlsfIndex m_tlsfIndex;
+        bool m_hasSmallObjects;
+
+        std::atomic<RemoteFree *> m_remoteFrees;
+        std::thread::id m_ownerThread;
+        bool m_hasRemoteFrees;
+
+        kAllocationStrategy m_allocationStrategy;
+
+        uint16_t m_heapIndex;
+
+        uintptr_t m_blockEnd;
+        uintptr_t m_memoryEnd;
+        size_t m_heapLength;
+        size_t m_reservedLength;
+
+        size_t m_scavengedBytes;
+        size_t m_refaultedBytes;
+
+        TStatisticsPolicy m_statistics;
+        TraceRecorder *m_traceRecorder;
+
+        HeapProfiler *m_heapProfiler;
+        size_t m_bytesUntilSample;
+
+        mutable TLockPolicy m_lock;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#define NGEN_BASIC_HEAP_TEMPLATE template <typename TSearchPolicy, typename TTrackingPolicy, typename TSentinelPolicy, typename TStatisticsPolicy, typename TLockPolicy>
+#define NGEN_BASIC_HEAP BasicHeap<TSearchPolicy, TTrackingPolicy, TSentinelPolicy, TStatisticsPolicy, TLockPolicy>
+
+namespace ngen::memory {
+    //! \brief Retrieves the total size of the memory heap.
+    //! \returns The size (in bytes) of the total memory pool managed by this Heap object.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getSize() const {
+        return m_heapLength;
+    }
+
+    //! \brief Retrieves the length of the address space the heap may grow into.
+    //! \returns The size (in bytes) of the address space reserved by a growable heap, otherwise the size of the heap.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getReservedSize() const {
+        return m_reservedLength ? m_reservedLength : m_heapLength;
+    }
+
+    //! \brief Retrieves the number of allocations that are currently live within the heap.
+    //! \returns The number of allocations currently still live within the heap.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getAllocations() const {
+        return m_statistics.getAllocations();
+    }
+
+    //! \brief Retrieves the number of allocations made with this heap during the course of its lifetime.
+    //! \returns The number of allocations made by using the heap during the course of its lifetime.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getTotalAllocations() const {
+        return m_statistics.getTotalAllocations();
+    }
+
+    //! \brief Retrieves the number of allocation requests that have been requested but failed.
+    //! \returns The number of allocation requests that have been failed by this heap.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getFailedAllocations() const {
+        return m_statistics.getFailedAllocations();
+    }
+
+    //! \brief Retrieves the number of bytes returned to the operating system by scavenge, during the lifetime of the heap.
+    //! \returns The number of bytes that have been discarded from within free blocks.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getScavengedBytes() const {
+        return m_scavengedBytes;
+    }
+
+    //! \brief Retrieves the number of scavenged bytes that have since been handed out by the heap, and so fault back in when touched.
+    //!
+    //! Discarded pages that remain free, such as those of the remainder of a block that was allocated from or of a
+    //! block joined with its neighbours, stay scavenged and are not counted. When only some of the pages of a block
+    //! are discarded, the pages handed out are assumed to be the discarded ones.
+    //! \returns The number of scavenged bytes that have been handed out by an allocation.
+    NGEN_BASIC_HEAP_TEMPLATE inline size_t NGEN_BASIC_HEAP::getRefaultedBytes() const {
+        return m_refaultedBytes;
+    }
+
+    //! \brief Retrieves a snapshot of the statistics recorded by the heap.
+    //!
+    //! The largest free block is located when the snapshot is taken, which walks the free list when the First strategy
+    //! is used, the remaining fields are maintained as the heap is used. Fields the statistics policy does not record
+    //! are zero.
+    //! \returns The statistics recorded by the heap.
+    NGEN_BASIC_HEAP_TEMPLATE HeapStats NGEN_BASIC_HEAP::getStats() const {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        HeapStats stats;
+        m_statistics.getStats(stats);
+
+        if constexpr (TStatisticsPolicy::kDetailed) {
+            stats.largestFreeBlock = getLargestFreeBlock();
+
+            if (stats.freeBytes) {
+                stats.fragmentation = 1.0 - static_cast<double>(stats.largestFreeBlock) / static_cast<double>(stats.freeBytes);
+            }
+        }
+
+        return stats;
+    }
+
+    //! \brief Retrieves the allocation strategy being used by this memory heap.
+    //! \reutrns The allocation strategy being used by the mrmoty heap.
+    NGEN_BASIC_HEAP_TEMPLATE inline kAllocationStrategy NGEN_BASIC_HEAP::getAllocationStrategy() const {
+        return m_allocationStrategy;
+    }
+
+    //! \brief Determines whether or not small allocations are being served by the size-class front end.
+    //! \returns True if the small object front end has been enabled for this heap otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE inline bool NGEN_BASIC_HEAP::hasSmallObjects() const {
+        return m_hasSmallObjects;
+    }
+
+    //! \brief Retrieves the size-class allocator used to serve small allocations.
+    //! \returns Reference to the small object allocator owned by this heap.
+    NGEN_BASIC_HEAP_TEMPLATE inline const SmallObjectAllocator& NGEN_BASIC_HEAP::getSmallObjects() const {
+        return m_smallObjects;
+    }
+
+    //! \brief Determines whether or not deallocations made by other threads are queued for the owning thread.
+    //! \returns True if remote frees have been enabled for this heap otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE inline bool NGEN_BASIC_HEAP::hasRemoteFrees() const {
+        return m_hasRemoteFrees;
+    }
+
+    //! \brief Attaches a recorder to the heap, which then records every allocation and release made by the heap.
+    //! \param recorder [in] - The recorder to be attached, or nullptr to stop recording. The recorder must remain valid
+    //!                        until it is detached or the heap is destroyed.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::setTraceRecorder(TraceRecorder *recorder) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+        m_traceRecorder = recorder;
+    }
+
+    //! \brief Retrieves the recorder attached to the heap.
+    //! \returns Pointer to the recorder attached to the heap, or nullptr if the heap is not being recorded.
+    NGEN_BASIC_HEAP_TEMPLATE inline TraceRecorder *NGEN_BASIC_HEAP::getTraceRecorder() const {
+        return m_traceRecorder;
+    }
+
+    //! \brief Attaches a profiler to the heap, which then samples the allocations made by the heap.
+    //!
+    //! Sampled allocations bypass the small object allocator, so that their header records that they were sampled.
+    //! Allocations sampled before the profiler is detached remain live within its profile, as their release is no
+    //! longer reported.
+    //! \param profiler [in] - The profiler to be attached, or nullptr to stop sampling. The profiler must be initialized,
+    //!                        and must remain valid until it is detached or the heap is destroyed.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::setHeapProfiler(HeapProfiler *profiler) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        m_heapProfiler = profiler;
+        m_bytesUntilSample = profiler ? profiler->nextSampleInterval() : 0;
+    }
+
+    //! \brief Retrieves the profiler attached to the heap.
+    //! \returns Pointer to the profiler attached to the heap, or nullptr if the heap is not being profiled.
+    NGEN_BASIC_HEAP_TEMPLATE inline HeapProfiler *NGEN_BASIC_HEAP::getHeapProfiler() const {
+        return m_heapProfiler;
+    }
+
+    //! \brief Determines whether or not the heap commits more memory from its reservation once it is exhausted.
+    //! \returns True if the heap was prepared by initializeGrowable otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE inline bool NGEN_BASIC_HEAP::isGrowable() const {
+        return 0 != m_reservedLength;
+    }
+
+    //! \brief Determines whether or not the calling thread must queue its deallocations for the owning thread.
+    //! \returns True if remote frees are enabled and the calling thread does not own the heap otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE inline bool NGEN_BASIC_HEAP::isRemoteThread() const {
+        return m_hasRemoteFrees && std::this_thread::get_id() != m_ownerThread;
+    }
+
+    //! \brief Records an operation with the attached trace recorder, if there is one.
+    //! \param type [in] - The operation that was made.
+    //! \param ptr [in] - The allocation the operation was made on, null if an allocation failed.
+    //! \param size [in] - Length (in bytes) requested by the operation.
+    //! \param alignment [in] - Alignment (in bytes) requested by the operation.
+    //! \param isArray [in] - True if the allocation was made or released as an array otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE inline void NGEN_BASIC_HEAP::traceEvent(kTraceEvent type, const void *ptr, size_t size, size_t alignment, bool isArray) {
+        if (m_traceRecorder) {
+            m_traceRecorder->record(type, ptr, size, alignment, isArray);
+        }
+    }
+
+    //! \brief Counts an allocation request against the bytes remaining until the heap profiler takes its next sample.
+    //! \param dataLength [in] - The length (in bytes) of the allocation request.
+    //! \returns True if the allocation is to be sampled otherwise false, always false if no profiler is attached.
+    NGEN_BASIC_HEAP_TEMPLATE inline bool NGEN_BASIC_HEAP::sampleAllocation(size_t dataLength) {
+        if (!m_heapProfiler) {
+            return false;
+        }
+
+        if (dataLength < m_bytesUntilSample) {
+            m_bytesUntilSample -= dataLength;
+            return false;
+        }
+
+        m_bytesUntilSample = m_heapProfiler->nextSampleInterval();
+        return true;
+    }
+
+    //! \brief Marks an allocation as sampled and records it with the heap profiler.
+    //! \param allocation [in] - Header of the allocation, which has been described.
+    //! \param dataLength [in] - The length (in bytes) that was requested.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::recordSample(Header *allocation, size_t dataLength, const char *fileName, size_t line) {
+        detail::markSampledAllocation(allocation);
+        m_heapProfiler->recordAllocation(&allocation[1], dataLength, fileName, line);
+    }
+
+    //! \brief Reports the release of an allocation to the heap profiler, if the allocation was sampled.
+    //! \param allocation [in] - Header of the allocation being released.
+    //! \param ptr [in] - Pointer to the allocation being released.
+    NGEN_BASIC_HEAP_TEMPLATE inline void NGEN_BASIC_HEAP::releaseSample(const Header *allocation, const void *ptr) {
+        if (m_heapProfiler && detail::isSampledAllocation(allocation)) {
+            m_heapProfiler->recordRelease(ptr);
+        }
+    }
+
+    //! \brief Retrieves the strategy used to search for free blocks, this is a constant unless the search policy is dynamic.
+    //! \returns The allocation strategy used to search for free blocks.
+    NGEN_BASIC_HEAP_TEMPLATE inline kAllocationStrategy NGEN_BASIC_HEAP::getSearchStrategy() const {
+        if constexpr (TSearchPolicy::kStrategy != kAllocationStrategy::Invalid) {
+            return TSearchPolicy::kStrategy;
+        } else {
+            return m_allocationStrategy;
+        }
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    NGEN_BASIC_HEAP_TEMPLATE NGEN_BASIC_HEAP::BasicHeap()
+            : m_rootBlock(nullptr), m_memoryBlock(nullptr), m_hasSmallObjects(false), m_remoteFrees(nullptr), m_hasRemoteFrees(false),
+              m_allocationStrategy(kAllocationStrategy::Invalid), m_heapIndex(0), m_blockEnd(0), m_memoryEnd(0), m_heapLength(0), m_reservedLength(0), m_scavengedBytes(0), m_refaultedBytes(0), m_traceRecorder(nullptr),
+              m_heapProfiler(nullptr), m_bytesUntilSample(0) {
+
+    }
+
+    NGEN_BASIC_HEAP_TEMPLATE NGEN_BASIC_HEAP::~BasicHeap() {
+        if (m_heapIndex) {
+            detail::unregisterHeap(m_heapIndex);
+        }
+
+        if (m_reservedLength) {
+            VirtualMemory::release(m_memoryBlock, m_reservedLength);
+        }
+    }
+
+    //! \brief Prepares the memory heap for use by the application, using the strategy of the search policy.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be used by this heap object.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::initialize(void *memoryBlock, size_t blockSize) {
+        if constexpr (TSearchPolicy::kStrategy != kAllocationStrategy::Invalid) {
+            return initialize(memoryBlock, blockSize, TSearchPolicy::kStrategy);
+        } else {
+            return initialize(memoryBlock, blockSize, detail::kDefaultAllocationStrategy);
+        }
+    }
+
+    //! \brief Prepares the memory heap for use by the application.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be used by this heap object.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \param allocationStrategy [in] - The allocation strategy to be used by this heap, this must match the search policy
+    //!                                  unless it is SearchDynamic.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::initialize(void *memoryBlock, size_t blockSize, kAllocationStrategy allocationStrategy) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (m_memoryBlock) {
+            return false;
+        }
+
+        if (!memoryBlock) {
+            return false;
+        }
+
+        if (!blockSize) {
+            return false;
+        }
+
+        return initializeMemory(memoryBlock, blockSize, blockSize, allocationStrategy);
+    }
+
+    //! \brief Prepares a heap that reserves a range of address space, and commits memory within it as it is required.
+    //!
+    //! Once the committed memory is exhausted, further pages are committed at the end of the heap and joined with any
+    //! free block that precedes them. The reservation is returned to the operating system when the heap is destroyed.
+    //! \param reserveLength [in] - Length (in bytes) of the address space to be reserved, the heap never grows beyond it.
+    //! \param commitLength [in] - Length (in bytes) of the memory to be committed immediately.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::initializeGrowable(size_t reserveLength, size_t commitLength) {
+        if constexpr (TSearchPolicy::kStrategy != kAllocationStrategy::Invalid) {
+            return initializeGrowable(reserveLength, commitLength, TSearchPolicy::kStrategy);
+        } else {
+            return initializeGrowable(reserveLength, commitLength, detail::kDefaultAllocationStrategy);
+        }
+    }
+
+    //! \brief Prepares a heap that reserves a range of address space, and commits memory within it as it is required.
+    //! \param reserveLength [in] - Length (in bytes) of the address space to be reserved, the heap never grows beyond it.
+    //! \param commitLength [in] - Length (in bytes) of the memory to be committed immediately.
+    //! \param allocationStrategy [in] - The allocation strategy to be used by this heap, this must match the search policy
+    //!                                  unless it is SearchDynamic.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::initializeGrowable(size_t reserveLength, size_t commitLength, kAllocationStrategy allocationStrategy) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (m_memoryBlock) {
+            return false;
+        }
+
+        const auto pageSize = VirtualMemory::getPageSize();
+
+        // The TLSF index is sized for the whole reservation, and must be committed along with the first free block.
+        auto minimumLength = detail::kMinimumFreeBlockLength + alignof(FreeBlock) + sizeof(size_t);
+        if (allocationStrategy == kAllocationStrategy::TLSF) {
+            minimumLength += TlsfIndex::getControlLength(reserveLength);
+        }
+
+        reserveLength = detail::alignValue(reserveLength, pageSize);
+        commitLength = detail::alignValue(std::max(commitLength, minimumLength), pageSize);
+
+        if (!reserveLength || commitLength > reserveLength) {
+            // TODO: Log ERR - reservation is too small to hold the committed memory
+            return false;
+        }
+
+        auto memoryBlock = VirtualMemory::reserve(reserveLength);
+        if (!memoryBlock) {
+            // TODO: Log ERR - unable to reserve address space for the heap
+            return false;
+        }
+
+        m_reservedLength = reserveLength;
+
+        if (!VirtualMemory::commit(memoryBlock, commitLength) || !initializeMemory(memoryBlock, commitLength, reserveLength, allocationStrategy)) {
+            VirtualMemory::release(memoryBlock, reserveLength);
+
+            m_reservedLength = 0;
+            return false;
+        }
+
+        return true;
+    }
+
+    //! \brief Prepares the free list and size index of the heap over a memory block, the lock must be held.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be used by this heap object.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \param indexLength [in] - Length (in bytes) of the largest block the heap may contain, should it grow.
+    //! \param allocationStrategy [in] - The allocation strategy to be used by this heap.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::initializeMemory(void *memoryBlock, size_t blockSize, size_t indexLength, kAllocationStrategy allocationStrategy) {
+        if (allocationStrategy == kAllocationStrategy::Invalid) {
+            return false;
+        }
+
+        if (TSearchPolicy::kStrategy != kAllocationStrategy::Invalid && TSearchPolicy::kStrategy != allocationStrategy) {
+            // TODO: Log ERR - allocation strategy does not match the search policy of the heap
+            return false;
+        }
+
+        // Blocks are kept at multiples of the FreeBlock alignment, so the boundary tag flags are free for use.
+        const auto rawPtr = reinterpret_cast<uintptr_t>(memoryBlock);
+        const auto memoryEnd = (rawPtr + blockSize) / alignof(FreeBlock) * alignof(FreeBlock);
+
+        // A growable heap keeps an allocated epilogue in its last word, which records whether the last block is free.
+        const auto endPtr = m_reservedLength ? memoryEnd - sizeof(size_t) : memoryEnd;
+
+        auto rootPtr = detail::alignValue(rawPtr, alignof(FreeBlock));
+
+        if (allocationStrategy == kAllocationStrategy::TLSF) {
+            // The segregated list heads are stored at the start of the memory block, ahead of the first free block.
+            rootPtr = detail::alignValue(rawPtr + TlsfIndex::getControlLength(indexLength), alignof(FreeBlock));
+        }
+
+        if (rootPtr + detail::kMinimumFreeBlockLength > endPtr) {
+            // TODO: Log ERR - memory block too small to contain a free block
+            return false;
+        }
+
+        if (allocationStrategy == kAllocationStrategy::TLSF) {
+            if (!m_tlsfIndex.initialize(memoryBlock, indexLength)) {
+                return false;
+            }
+        }
+
+        m_heapIndex = detail::registerHeap(this);
+
+        if (!m_heapIndex) {
+            // TODO: Log ERR - too many heaps have been initialized
+            return false;
+        }
+
+        m_rootBlock = nullptr;
+        m_blockEnd = endPtr;
+        m_memoryEnd = memoryEnd;
+        m_heapLength = blockSize;
+        m_memoryBlock = memoryBlock;
+        m_allocationStrategy = allocationStrategy;
+
+        if (endPtr < memoryEnd) {
+            detail::getBlockTag(endPtr) = detail::kBlockAllocated | detail::kPreviousFree;
+        }
+
+        m_statistics.recordGrowth(endPtr - rootPtr);
+        insertFreeBlock(detail::createFreeBlock(rootPtr, endPtr - rootPtr));
+        return true;
+    }
+
+    //! \brief Carves a region from the heap that is used to serve small allocations from size-class pages.
+    //!
+    //! Once enabled, allocations no larger than SmallObjectAllocator::kMaximumObjectSize are served from the region
+    //! without an allocation header. If the region becomes exhausted, small allocations fall back to the general heap.
+    //! Small objects do not record their source location, their array state is recorded by their page.
+    //! \param regionLength [in] - Length (in bytes) of the region to be reserved for small objects.
+    //! \returns True if the small object region was created otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::enableSmallObjects(size_t regionLength) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (!m_memoryBlock || m_hasSmallObjects) {
+            return false;
+        }
+
+        if (regionLength < SmallObjectAllocator::kPageSize * 2) {
+            // TODO: Log ERR - small object region must be large enough to contain a page and its descriptor
+            return false;
+        }
+
+        const auto allocationLength = detail::alignValue(regionLength, alignof(FreeBlock));
+        const auto alignment = SmallObjectAllocator::kPageAlignment;
+
+        auto freeBlock = findFreeBlock(allocationLength, alignment);
+        if (!freeBlock) {
+            return false;
+        }
+
+        // The region is owned by the heap for the remainder of its lifetime, so it is not included in the
+        // allocation counters.
+        auto region = consumeMemory(freeBlock, allocationLength, alignment);
+
+        if constexpr (kTracking || kSentinels) {
+            region->id = kTracking ? detail::nextAllocationId() : 0;
+            region->size = regionLength;
+            region->isArray = false;
+            region->isSampled = false;
+            region->isCached = false;
+            region->fileName = nullptr;
+            region->line = 0;
+        } else {
+            region->flags = 0;
+        }
+
+        const auto initialized = m_smallObjects.initialize(&region[1], regionLength);
+        assert(initialized);
+
+        m_hasSmallObjects = initialized;
+        return m_hasSmallObjects;
+    }
+
+    //! \brief Binds the heap to the calling thread, deallocations made by any other thread are then queued without locking.
+    //!
+    //! Queued deallocations are returned to the heap by the owning thread when it next allocates, or when it calls
+    //! processRemoteFrees. All allocations must be made by the owning thread once remote frees are enabled.
+    //! \returns True if remote frees were enabled otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::enableRemoteFrees() {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (!m_memoryBlock) {
+            // TODO: Log ERR - heap must be initialized before enabling remote frees
+            return false;
+        }
+
+        m_ownerThread = std::this_thread::get_id();
+        m_hasRemoteFrees = true;
+
+        return true;
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::alloc(size_t dataLength) {
+        return allocate(dataLength, detail::kDefaultAlignment, false, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::alignedAlloc(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment, false, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of at least the specified length, reporting the length that may be used.
+    //!
+    //! Blocks are rounded up to the granularity of the heap, and may absorb a remainder too short to form a free block,
+    //! so containers can grow into the usable length without reallocating. The allocation may be released by sized
+    //! deallocate with any length between the requested and the usable length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return The allocation and its usable length, the pointer is null if the allocation could not be made.
+    NGEN_BASIC_HEAP_TEMPLATE AllocationResult NGEN_BASIC_HEAP::allocAtLeast(size_t dataLength) {
+        return allocAtLeast(dataLength, detail::kDefaultAlignment);
+    }
+
+    //! \brief  Allocates a block of memory of at least the specified length, reporting the length that may be used.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return The allocation and its usable length, the pointer is null if the allocation could not be made.
+    NGEN_BASIC_HEAP_TEMPLATE AllocationResult NGEN_BASIC_HEAP::allocAtLeast(size_t dataLength, size_t alignment) {
+        auto ptr = allocate(dataLength, alignment, false, nullptr, 0);
+        return { ptr, getUsableSize(ptr) };
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::alloc(size_t dataLength, const char *fileName, size_t line) {
+        return allocate(dataLength, detail::kDefaultAlignment, false, fileName, line);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        return allocate(dataLength, alignment, false, fileName, line);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::allocArray(size_t dataLength) {
+        return allocate(dataLength, detail::kDefaultAlignment, true, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::alignedAllocArray(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment, true, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::allocArray(size_t dataLength, const char *fileName, size_t line) {
+        return allocate(dataLength, detail::kDefaultAlignment, true, fileName, line);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::alignedAllocArray(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        return allocate(dataLength, alignment, true, fileName, line);
+    }
+
+    //! \brief Attempts to allocate a block of memory with a specified size and alignment.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block to be allocated.
+    //! \param isArray [in] - True if the allocation is an array otherwise false.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    //! \returns Pointer to the allocated memory block or nullptr if the allocation could not be made.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::allocate(size_t dataLength, size_t alignment, bool isArray, const char *fileName, size_t line) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (m_hasRemoteFrees && m_remoteFrees.load(std::memory_order_relaxed)) {
+            drainRemoteFrees();
+        }
+
+        m_statistics.recordRequest(dataLength);
+
+        // Sampled allocations are made from a block, whose header records that the allocation was sampled.
+        const auto isSampled = sampleAllocation(dataLength);
+
+        if (alignment < detail::kDefaultAlignment) {
+            alignment = detail::kDefaultAlignment;
+        }
+
+        if (detail::isPow2(alignment)) {
+            if (m_hasSmallObjects && !isSampled && dataLength <= SmallObjectAllocator::kMaximumObjectSize) {
+                auto object = m_smallObjects.alloc(dataLength, alignment, isArray);
+                if (object) {
+                    m_statistics.recordAllocation(0);
+                    traceEvent(kTraceEvent::Allocate, object, dataLength, alignment, isArray);
+                    return object;
+                }
+            }
+
+            if (alignment < getReservedSize()) {
+                // NOTE: We align the dataLength value when obtaining a memory block to ensure the
+                // end of the memory block is at a suitable location for a new FreeBlock instance to exist.
+                // Empty allocations still reserve a word, which holds the link of a remote free.
+                const auto allocationLength = detail::alignValue(dataLength ? dataLength : 1, alignof(FreeBlock));
+
+                auto freeBlock = findFreeBlock(allocationLength, alignment);
+
+                if (!freeBlock && m_reservedLength && growMemory(allocationLength, alignment)) {
+                    freeBlock = findFreeBlock(allocationLength, alignment);
+                }
+
+                if (freeBlock) {
+                    auto alloc = consumeMemory(freeBlock, allocationLength, alignment);
+                    if (alloc) {
+                        describeAllocation(alloc, dataLength, isArray, fileName, line);
+
+                        if (isSampled) {
+                            recordSample(alloc, dataLength, fileName, line);
+                        }
+
+                        m_statistics.recordAllocation(reinterpret_cast<uintptr_t>(&alloc[1]) - detail::getAllocationBlock(alloc));
+                        traceEvent(kTraceEvent::Allocate, &alloc[1], dataLength, alignment, isArray);
+                        return &alloc[1];
+                    }
+                }
+            } else {
+                // TODO: Log ERR: alignment of {alignment} cannot be satisfied by the memory of the heap.
+            }
+        } else {
+            // TODO: Log ERR: alignment was not a power of 2
+        }
+
+        m_statistics.recordFailure();
+        traceEvent(kTraceEvent::Allocate, nullptr, dataLength, alignment, isArray);
+        return nullptr;
+    }
+
+    //! \brief Releases a memory block previously allocated by this object.
+    //! \param ptr [in] - Pointer to the memory block to be released
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \param fileName [in] - The path of the source file that made the deallocation, this may be null.
+    //! \param line [in] - The line number within the source file where the deallocation was requested.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::deallocate(void *ptr, bool isArray, [[maybe_unused]] const char *fileName, [[maybe_unused]] size_t line) {
+        // We treat an attempt to free a nullptr as always successful.
+        if (ptr) {
+            if (isRemoteThread()) {
+                return releaseRemote(ptr, isArray);
+            }
+
+            std::lock_guard<TLockPolicy> lock(m_lock);
+
+            if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+                return releaseSmallObject(ptr, isArray);
+            }
+
+            const auto lowerMemoryBoundary = reinterpret_cast<uintptr_t>(m_memoryBlock);
+            const auto upperMemoryBoundary = lowerMemoryBoundary + m_heapLength;
+
+            const auto start = reinterpret_cast<uintptr_t>(ptr);
+            auto allocation = reinterpret_cast<Header *>(start - sizeof(Header));
+
+            if (!isOwner(allocation)) {
+                // TODO: Log ERR allocation did not belong to this heap
+                return false;
+            }
+
+            const auto blockStart = detail::getAllocationBlock(allocation);
+            const auto blockSize = detail::getAllocationBlockLength(allocation);
+            const auto blockEnd = blockStart + blockSize;
+
+            if (blockStart < lowerMemoryBoundary || blockStart > upperMemoryBoundary) {
+                // TODO: Log ERR allocation outside valid bounds
+                return false;
+            }
+
+            if (blockEnd < lowerMemoryBoundary || blockEnd > upperMemoryBoundary) {
+                // TODO: Log ERR allocation span outside valid bounds
+                return false;
+            }
+
+            if (detail::isArrayAllocation(allocation) != isArray) {
+                // TODO: Log ERR - array mismatch
+                return false;
+            }
+
+            if (detail::isCachedAllocation(allocation)) {
+                // TODO: Log ERR - allocation is held by a thread cache, it has already been released
+                return false;
+            }
+
+            if constexpr (kSentinels) {
+                if (!detail::validateSentinel(allocation)) {
+                    // TODO: LOG ERR, corrupt memory allocation
+                }
+            }
+
+            traceEvent(kTraceEvent::Deallocate, ptr, 0, 0, isArray);
+            releaseSample(allocation, ptr);
+
+            releaseBlock(allocation);
+            m_statistics.recordRelease(start - blockStart);
+        }
+
+        return true;
+    }
+
+    //! \brief Releases an allocation whose length and alignment are known to the caller, as with C++14 sized delete.
+    //! \param ptr [in] - Pointer to the memory block to be released.
+    //! \param dataLength [in] - The length (in bytes) requested for the allocation, or any length up to the usable size
+    //!                          reported by allocAtLeast.
+    //! \param alignment [in] - The alignment (in bytes) requested for the allocation, or zero if none was requested.
+    //! \returns True if the memory block was released otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::deallocate(void *ptr, size_t dataLength, size_t alignment) {
+        return releaseSized(ptr, dataLength, alignment, false);
+    }
+
+    //! \brief Releases an array allocation whose length and alignment are known to the caller.
+    //! \param ptr [in] - Pointer to the memory block to be released.
+    //! \param dataLength [in] - The length (in bytes) requested for the allocation, or any length up to its usable size.
+    //! \param alignment [in] - The alignment (in bytes) requested for the allocation, or zero if none was requested.
+    //! \returns True if the memory block was released otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::deallocateArray(void *ptr, size_t dataLength, size_t alignment) {
+        return releaseSized(ptr, dataLength, alignment, true);
+    }
+
+    //! \brief Returns a small object to the small object allocator, the lock must be held.
+    //! \param ptr [in] - Pointer to the small object to be released.
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \returns True if the small object was released otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::releaseSmallObject(void *ptr, bool isArray) {
+        traceEvent(kTraceEvent::Deallocate, ptr, 0, 0, isArray);
+
+        if (!m_smallObjects.deallocate(ptr, isArray)) {
+            // TODO: Log ERR - invalid small object release
+            return false;
+        }
+
+        m_statistics.recordRelease(0);
+        return true;
+    }
+
+    //! \brief Releases an allocation using the length and alignment supplied by the caller.
+    //!
+    //! Heaps storing a TrackedAllocation header validate the release as deallocate does, and additionally verify the
+    //! supplied length and alignment against the allocation. Otherwise the caller is trusted to release a live
+    //! allocation of this heap, so the ownership, bounds and array checks are skipped, and allocations too long to be
+    //! small objects are released without testing the small object region. The header is then read only to locate
+    //! the block, as the alignment padding ahead of it cannot be recovered from the length alone. Releases made by a
+    //! thread that does not own the heap are always validated before they are queued.
+    //! \param ptr [in] - Pointer to the memory block to be released.
+    //! \param dataLength [in] - The length (in bytes) requested for the allocation, or any length up to its usable size.
+    //! \param alignment [in] - The alignment (in bytes) requested for the allocation, or zero if none was requested.
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \returns True if the memory block was released otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::releaseSized(void *ptr, [[maybe_unused]] size_t dataLength, [[maybe_unused]] size_t alignment, bool isArray) {
+        // We treat an attempt to free a nullptr as always successful.
+        if (!ptr) {
+            return true;
+        }
+
+        if constexpr (kTracking || kSentinels) {
+            if (alignment && (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1))) {
+                // TODO: Log ERR - alignment does not match the allocation
+                return false;
+            }
+
+            if (!m_hasSmallObjects || !m_smallObjects.owns(ptr)) {
+                // The allocation is live and owned by the caller, so its header may be read without holding the lock.
+                auto allocation = findAllocation(ptr);
+
+                if (allocation) {
+                    const auto usableLength = detail::getAllocationBlock(allocation) + detail::getAllocationBlockLength(allocation) - reinterpret_cast<uintptr_t>(ptr);
+
+                    if (dataLength < allocation->size || dataLength > usableLength) {
+                        // TODO: Log ERR - length does not match the allocation
+                        return false;
+                    }
+                }
+            }
+
+            return deallocate(ptr, isArray, nullptr, 0);
+        } else {
+            if (isRemoteThread()) {
+                return releaseRemote(ptr, isArray);
+            }
+
+            std::lock_guard<TLockPolicy> lock(m_lock);
+
+            if (dataLength <= SmallObjectAllocator::kMaximumObjectSize && m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+                return releaseSmallObject(ptr, isArray);
+            }
+
+            auto allocation = reinterpret_cast<Header *>(reinterpret_cast<uintptr_t>(ptr) - sizeof(Header));
+
+            traceEvent(kTraceEvent::Deallocate, ptr, 0, 0, isArray);
+            releaseSample(allocation, ptr);
+
+            m_statistics.recordRelease(reinterpret_cast<uintptr_t>(ptr) - detail::getAllocationBlock(allocation));
+            releaseBlock(allocation);
+
+            return true;
+        }
+    }
+
+    //! \brief Allocates a number of equally sized blocks, carving as many as possible from each free block that is found.
+    //!
+    //! The free blocks are searched once for a region large enough to hold the whole batch, if none exists the batch
+    //! is carved from as many smaller regions as required. Each region is removed from the free list once, and any
+    //! memory remaining once it has been carved is returned to the free list once.
+    //! \param count [in] - The number of allocations to be made.
+    //! \param dataLength [in] - The length (in bytes) of each allocation.
+    //! \param alignment [in] - The alignment (in bytes) of each allocation, must be a power of two.
+    //! \param allocations [out] - Array of at least count entries that receives the allocations that were made.
+    //! \returns The number of allocations that were made, these occupy the start of the allocations array.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::allocBatch(size_t count, size_t dataLength, size_t alignment, void **allocations) {
+        if (!count || !allocations) {
+            return 0;
+        }
+
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (m_hasRemoteFrees && m_remoteFrees.load(std::memory_order_relaxed)) {
+            drainRemoteFrees();
+        }
+
+        if (alignment < detail::kDefaultAlignment) {
+            alignment = detail::kDefaultAlignment;
+        }
+
+        if (!detail::isPow2(alignment) || alignment >= getReservedSize()) {
+            // TODO: Log ERR: unsupported alignment of {alignment} was requested.
+            for (size_t loop = 0; loop < count; ++loop) {
+                m_statistics.recordRequest(dataLength);
+                m_statistics.recordFailure();
+                traceEvent(kTraceEvent::Allocate, nullptr, dataLength, alignment, false);
+            }
+
+            return 0;
+        }
+
+        const auto allocationLength = detail::alignValue(dataLength ? dataLength : 1, alignof(FreeBlock));
+
+        // Estimate of the span occupied by each block, used to search for a region that holds the entire batch.
+        auto blockStride = detail::alignValue(sizeof(Header) + allocationLength, alignment > alignof(FreeBlock) ? alignment : alignof(FreeBlock));
+        if (blockStride < detail::kMinimumFreeBlockLength) {
+            blockStride = detail::kMinimumFreeBlockLength;
+        }
+
+        size_t allocated = 0;
+
+        while (allocated < count) {
+            FreeBlock *freeBlock = nullptr;
+
+            const auto pending = count - allocated;
+            if (pending > 1 && allocationLength < m_heapLength && pending <= (m_heapLength - allocationLength) / blockStride) {
+                freeBlock = findFreeBlock(allocationLength + (pending - 1) * blockStride, alignment);
+            }
+
+            if (!freeBlock) {
+                freeBlock = findFreeBlock(allocationLength, alignment);
+            }
+
+            if (!freeBlock && m_reservedLength && growMemory(allocationLength + (pending - 1) * blockStride, alignment)) {
+                freeBlock = findFreeBlock(allocationLength, alignment);
+            }
+
+            if (!freeBlock) {
+                break;
+            }
+
+            const auto discardedBytes = takeScavengedBytes(freeBlock);
+            removeFreeBlock(freeBlock);
+
+            const auto regionStart = reinterpret_cast<uintptr_t>(freeBlock);
+            const auto regionEnd = regionStart + freeBlock->size;
+
+            auto blockStart = regionStart;
+
+            while (allocated < count) {
+                const auto dataStart = detail::alignValue(blockStart + sizeof(Header), alignment);
+                if (dataStart >= regionEnd) {
+                    break;
+                }
+
+                const auto allocationStart = getAllocationStart(blockStart, dataStart, regionEnd);
+
+                auto blockLength = dataStart - allocationStart + allocationLength;
+                if (blockLength < detail::kMinimumFreeBlockLength) {
+                    blockLength = detail::kMinimumFreeBlockLength;
+                }
+
+                if (blockLength > regionEnd - allocationStart) {
+                    break;
+                }
+
+                // As with consumeMemory, a remainder too small to form a free block is included in the allocation.
+                const auto remaining = regionEnd - allocationStart - blockLength;
+                if (remaining <= sizeof(Header) || remaining < detail::kMinimumFreeBlockLength) {
+                    blockLength += remaining;
+                }
+
+                auto alloc = createAllocation(allocationStart, dataStart, blockLength);
+                describeAllocation(alloc, dataLength, false, nullptr, 0);
+
+                if (sampleAllocation(dataLength)) {
+                    recordSample(alloc, dataLength, nullptr, 0);
+                }
+
+                if (allocationStart != blockStart) {
+                    releaseAlignmentPadding(blockStart, allocationStart);
+                }
+
+                m_statistics.recordRequest(dataLength);
+                m_statistics.recordAllocation(dataStart - allocationStart);
+                traceEvent(kTraceEvent::Allocate, &alloc[1], dataLength, alignment, false);
+                allocations[allocated++] = &alloc[1];
+
+                blockStart = allocationStart + blockLength;
+            }
+
+            if (blockStart < regionEnd) {
+                // The block following the region already records that its predecessor is free.
+                insertFreeBlock(detail::createFreeBlock(blockStart, regionEnd - blockStart));
+            } else if (regionEnd < m_memoryEnd) {
+                detail::setPreviousFree(regionEnd, false);
+            }
+
+            retainScavengedBytes(regionStart, regionEnd, discardedBytes, blockStart < regionEnd ? blockStart : 0);
+        }
+
+        for (size_t loop = allocated; loop < count; ++loop) {
+            m_statistics.recordRequest(dataLength);
+            m_statistics.recordFailure();
+            traceEvent(kTraceEvent::Allocate, nullptr, dataLength, alignment, false);
+        }
+
+        return allocated;
+    }
+
+    //! \brief Releases a number of non-array allocations made by this heap.
+    //!
+    //! The supplied pointers are sorted by address, so that allocations which are physically adjacent are joined
+    //! with each other before being returned to the free list in a single sweep. Pointers that are not live
+    //! allocations of this heap are skipped, null pointers are treated as successfully released.
+    //! \param allocations [in] - Array of the allocations to be released, the array is reordered by this method.
+    //! \param count [in] - The number of entries within the allocations array.
+    //! \returns The number of allocations that were released successfully.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::deallocateBatch(void **allocations, size_t count) {
+        if (!allocations) {
+            return 0;
+        }
+
+        size_t released = 0;
+
+        if (isRemoteThread()) {
+            for (size_t loop = 0; loop < count; ++loop) {
+                if (!allocations[loop] || releaseRemote(allocations[loop], false)) {
+                    released++;
+                }
+            }
+
+            return released;
+        }
+
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        std::sort(allocations, allocations + count, std::less<void *>());
+
+        const auto lowerMemoryBoundary = reinterpret_cast<uintptr_t>(m_memoryBlock);
+        const auto upperMemoryBoundary = lowerMemoryBoundary + m_heapLength;
+
+        // The run of physically adjacent blocks waiting to be returned to the free list.
+        uintptr_t runStart = 0;
+        uintptr_t runEnd = 0;
+
+        for (size_t loop = 0; loop < count; ++loop) {
+            auto ptr = allocations[loop];
+
+            if (!ptr) {
+                released++;
+                continue;
+            }
+
+            if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+                if (m_smallObjects.deallocate(ptr, false)) {
+                    traceEvent(kTraceEvent::Deallocate, ptr, 0, 0, false);
+                    m_statistics.recordRelease(0);
+                    released++;
+                } else {
+                    // TODO: Log ERR - invalid small object release
+                }
+
+                continue;
+            }
+
+            auto allocation = findAllocation(ptr);
+            if (!allocation) {
+                // TODO: Log ERR allocation did not belong to this heap
+                continue;
+            }
+
+            const auto blockStart = detail::getAllocationBlock(allocation);
+            const auto blockEnd = blockStart + detail::getAllocationBlockLength(allocation);
+
+            if (blockStart < lowerMemoryBoundary || blockEnd > upperMemoryBoundary) {
+                // TODO: Log ERR allocation span outside valid bounds
+                continue;
+            }
+
+            if (detail::isArrayAllocation(allocation)) {
+                // TODO: Log ERR - array mismatch
+                continue;
+            }
+
+            if constexpr (kSentinels) {
+                if (!detail::validateSentinel(allocation)) {
+                    // TODO: LOG ERR, corrupt memory allocation
+                }
+            }
+
+            releaseOwnership(allocation);
+            released++;
+
+            traceEvent(kTraceEvent::Deallocate, ptr, 0, 0, false);
+            releaseSample(allocation, ptr);
+
+            m_statistics.recordRelease(reinterpret_cast<uintptr_t>(ptr) - blockStart);
+
+            if (runEnd != blockStart) {
+                if (runStart) {
+                    releaseMemory(runStart, runEnd - runStart);
+                }
+
+                runStart = blockStart;
+            }
+
+            runEnd = blockEnd;
+        }
+
+        if (runStart) {
+            releaseMemory(runStart, runEnd - runStart);
+        }
+
+        return released;
+    }
+
+    //! \brief Returns the allocations released by other threads to the heap, must be called by the owning thread.
+    //! \returns The number of queued allocations that were released.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::processRemoteFrees() {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+        return drainRemoteFrees();
+    }
+
+    //! \brief Returns the allocations released by other threads to the heap, the lock must be held.
+    //! \returns The number of queued allocations that were released.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::drainRemoteFrees() {
+        auto remoteFree = m_remoteFrees.exchange(nullptr, std::memory_order_acquire);
+
+        size_t released = 0;
+
+        while (remoteFree) {
+            auto next = remoteFree->next;
+
+            if (m_hasSmallObjects && m_smallObjects.owns(remoteFree)) {
+                traceEvent(kTraceEvent::Deallocate, remoteFree, 0, 0, m_smallObjects.isArrayObject(remoteFree));
+
+                if (m_smallObjects.releaseQueued(remoteFree)) {
+                    m_statistics.recordRelease(0);
+                    released++;
+                } else {
+                    // TODO: Log ERR - invalid small object release
+                }
+            } else {
+                auto allocation = reinterpret_cast<Header *>(remoteFree) - 1;
+                const auto overheadLength = reinterpret_cast<uintptr_t>(remoteFree) - detail::getAllocationBlock(allocation);
+
+                traceEvent(kTraceEvent::Deallocate, remoteFree, 0, 0, detail::isArrayAllocation(allocation));
+                releaseSample(allocation, remoteFree);
+
+                releaseBlock(allocation);
+
+                m_statistics.recordRelease(overheadLength);
+                released++;
+            }
+
+            remoteFree = next;
+        }
+
+        return released;
+    }
+
+    //! \brief Returns the memory block of a validated allocation to the heap, coalescing it with its free neighbours.
+    //! \param allocation [in] - Header of the allocation to be released.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::releaseBlock(Header *allocation) {
+        const auto blockStart = detail::getAllocationBlock(allocation);
+        const auto blockSize = detail::getAllocationBlockLength(allocation);
+
+        releaseOwnership(allocation);
+        releaseMemory(blockStart, blockSize);
+    }
+
+    //! \brief Returns a region at the start of a block, or the whole of a block, to the free list.
+    //! \param blockStart [in] - Address of the start of the region, it must begin with a valid boundary tag.
+    //! \param blockLength [in] - Length (in bytes) of the region being released.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::releaseMemory(uintptr_t blockStart, size_t blockLength) {
+        auto freeBlock = gatherMemory(blockStart, blockLength);
+        insertFreeBlock(freeBlock);
+
+        // The block that follows must now record that its predecessor is free.
+        const auto freeEnd = reinterpret_cast<uintptr_t>(freeBlock) + freeBlock->size;
+        if (freeEnd < m_memoryEnd) {
+            detail::setPreviousFree(freeEnd, true);
+        }
+
+        // TODO: In debug builds clear memory block 'freeBlock' with some suitable value
+    }
+
+    //! \brief Commits further memory at the end of a growable heap, the lock must be held.
+    //!
+    //! The epilogue becomes the boundary tag of a block spanning the new extent, which is released so that it joins
+    //! any free block at the end of the heap. A new epilogue is written at the end of the committed memory.
+    //! \param dataLength [in] - The length (in bytes) of the allocation that could not be made.
+    //! \param alignment [in] - The alignment (in bytes) of the allocation that could not be made.
+    //! \returns True if the heap was grown otherwise false, if the reservation is exhausted.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::growMemory(size_t dataLength, size_t alignment) {
+        const auto committedEnd = reinterpret_cast<uintptr_t>(m_memoryBlock) + m_heapLength;
+        const auto available = m_reservedLength - m_heapLength;
+
+        // Sized so the allocation fits within the new extent alone, the heap is grown by a minimum step to avoid
+        // committing memory for every allocation. The TLSF index rounds a request up to the start of the next size
+        // range, which is at most a sixteenth larger, so the extent allows for that too.
+        auto requiredLength = sizeof(Header) + alignment + dataLength + detail::kMinimumFreeBlockLength;
+        requiredLength += requiredLength >> TlsfIndex::kSecondLevelLog2;
+        auto growLength = detail::alignValue(std::max(requiredLength, detail::kMinimumGrowthLength), VirtualMemory::getPageSize());
+
+        if (growLength > available) {
+            // The remainder of the reservation may still be enough, once joined with a free block at the end of the heap.
+            growLength = available;
+        }
+
+        if (!growLength) {
+            return false;
+        }
+
+        if (!VirtualMemory::commit(reinterpret_cast<void *>(committedEnd), growLength)) {
+            // TODO: Log ERR - unable to commit memory within the reservation of the heap
+            return false;
+        }
+
+        const auto blockStart = m_blockEnd;
+
+        auto &tag = detail::getBlockTag(blockStart);
+        tag = growLength | detail::kBlockAllocated | (tag & detail::kPreviousFree);
+
+        m_blockEnd += growLength;
+        m_memoryEnd += growLength;
+        m_heapLength += growLength;
+
+        detail::getBlockTag(m_blockEnd) = detail::kBlockAllocated;
+
+        m_statistics.recordGrowth(growLength);
+        releaseMemory(blockStart, growLength);
+        return true;
+    }
+
+    //! \brief Returns the pages within large free blocks to the operating system, keeping each block intact.
+    //!
+    //! Only whole pages lying between the header and footer of a free block are discarded, so the block remains in
+    //! the free list and is unaffected by the scavenge. The pages fault back in when they are next allocated. Blocks
+    //! whose pages have all been discarded are skipped, a block that has since been joined with resident memory is
+    //! discarded again and only its newly discarded pages are counted.
+    //! The memory of the heap must be private memory allocated from the operating system, such as by VirtualMemory.
+    //! \param minimumBlockSize [in] - Free blocks smaller than this length (in bytes) are not scavenged.
+    //! \param maximumBytes [in] - The number of bytes after which no further blocks are scavenged, limiting the time
+    //!                             the heap is locked by a single pass.
+    //! \returns The number of bytes that were returned to the operating system.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::scavenge(size_t minimumBlockSize, size_t maximumBytes) {
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        size_t scavenged = 0;
+
+        for (auto block = m_rootBlock; block && scavenged < maximumBytes; block = block->next) {
+            if (block->size < minimumBlockSize) {
+                continue;
+            }
+
+            uintptr_t rangeStart = 0;
+            const auto rangeLength = getScavengeRange(block, rangeStart);
+
+            if (!rangeLength) {
+                continue;
+            }
+
+            auto &footer = detail::getFreeBlockFooter(block);
+            const auto discardedLength = (footer & detail::kFreeBlockScavenged) ? detail::getScavengedLength(block) : 0;
+
+            if (discardedLength == rangeLength) {
+                continue;
+            }
+
+            if (!VirtualMemory::discard(reinterpret_cast<void *>(rangeStart), rangeLength)) {
+                // TODO: Log ERR - unable to discard the pages of a free block
+                break;
+            }
+
+            footer |= detail::kFreeBlockScavenged;
+            detail::getScavengedLength(block) = rangeLength;
+
+            scavenged += rangeLength - discardedLength;
+        }
+
+        m_scavengedBytes += scavenged;
+        return scavenged;
+    }
+
+    //! \brief Computes the whole pages lying between the header of a free block and its last two words, which hold the
+    //!        discarded length and the footer.
+    //! \param block [in] - The free block to be examined.
+    //! \param rangeStart [out] - Receives the address of the first whole page within the block.
+    //! \returns The length (in bytes) of the whole pages within the block, zero if the block contains none.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::getScavengeRange(FreeBlock *block, uintptr_t &rangeStart) {
+        const auto blockStart = reinterpret_cast<uintptr_t>(block);
+        return getScavengeRange(blockStart, blockStart + block->size, rangeStart);
+    }
+
+    //! \brief Computes the whole pages that may be discarded within a free block spanning the specified region.
+    //! \param blockStart [in] - Address of the start of the free block.
+    //! \param blockEnd [in] - Address of the end of the free block.
+    //! \param rangeStart [out] - Receives the address of the first whole page within the block.
+    //! \returns The length (in bytes) of the whole pages within the block, zero if the block contains none.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::getScavengeRange(uintptr_t blockStart, uintptr_t blockEnd, uintptr_t &rangeStart) {
+        const auto pageSize = VirtualMemory::getPageSize();
+
+        rangeStart = detail::alignValue(blockStart + sizeof(FreeBlock), pageSize);
+
+        const auto rangeEnd = (blockEnd - sizeof(size_t) * 2) / pageSize * pageSize;
+        return rangeEnd > rangeStart ? rangeEnd - rangeStart : 0;
+    }
+
+    //! \brief Validates and queues an allocation released by a thread that does not own the heap, without taking the lock.
+    //!
+    //! Only the bounds fixed when the heap was initialized and the header of the allocation are read, so the owning
+    //! thread may hold the lock meanwhile. The release is reported to the trace recorder and heap profiler once the
+    //! owning thread drains the queue.
+    //! \param ptr [in] - Pointer to the allocation to be released.
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \returns True if the allocation was queued otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::releaseRemote(void *ptr, bool isArray) {
+        if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+            if (!m_smallObjects.queueRelease(ptr, isArray)) {
+                // TODO: Log ERR - invalid small object release
+                return false;
+            }
+
+            pushRemoteFree(ptr);
+            return true;
+        }
+
+        auto allocation = findAllocation(ptr);
+        if (!allocation) {
+            // TODO: Log ERR allocation did not belong to this heap
+            return false;
+        }
+
+        const auto lowerMemoryBoundary = reinterpret_cast<uintptr_t>(m_memoryBlock);
+        const auto upperMemoryBoundary = m_reservedLength ? lowerMemoryBoundary + m_reservedLength : m_blockEnd;
+
+        const auto blockStart = detail::getAllocationBlock(allocation);
+        const auto blockEnd = blockStart + detail::getAllocationBlockLength(allocation);
+
+        if (blockStart < lowerMemoryBoundary || blockEnd > upperMemoryBoundary) {
+            // TODO: Log ERR allocation span outside valid bounds
+            return false;
+        }
+
+        if (detail::isArrayAllocation(allocation) != isArray) {
+            // TODO: Log ERR - array mismatch
+            return false;
+        }
+
+        if constexpr (kSentinels) {
+            if (!detail::validateSentinel(allocation)) {
+                // TODO: LOG ERR, corrupt memory allocation
+            }
+        }
+
+        // Clearing the owner lets the heap detect the allocation being released twice while it is queued.
+        releaseOwnership(allocation);
+
+        pushRemoteFree(ptr);
+        return true;
+    }
+
+    //! \brief Queues an allocation released by a thread that does not own the heap, without taking any lock.
+    //! \param ptr [in] - Pointer to the validated allocation to be queued.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::pushRemoteFree(void *ptr) {
+        auto remoteFree = static_cast<RemoteFree *>(ptr);
+        auto head = m_remoteFrees.load(std::memory_order_relaxed);
+
+        do {
+            remoteFree->next = head;
+        } while (!m_remoteFrees.compare_exchange_weak(head, remoteFree, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    //! \brief Retrieves the number of bytes that may be used by an allocation made by this heap.
+    //! \param ptr [in] - Pointer to a live allocation made by this heap.
+    //! \returns The number of bytes available at the supplied address, this is at least the requested length. Zero
+    //!          is returned if the pointer was not allocated by this heap.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::getUsableSize(const void *ptr) const {
+        if (!ptr) {
+            return 0;
+        }
+
+        if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+            return m_smallObjects.getObjectSize(ptr);
+        }
+
+        auto allocation = findAllocation(ptr);
+        if (!allocation) {
+            return 0;
+        }
+
+        return detail::getAllocationBlock(allocation) + detail::getAllocationBlockLength(allocation) - reinterpret_cast<uintptr_t>(ptr);
+    }
+
+    //! \brief Determines whether or not an allocation was made without a source location and without an array operator.
+    //!
+    //! Heaps storing a CompactAllocation header do not record the source location, so only the array state is tested.
+    //! \param ptr [in] - Pointer to a live allocation made by this heap.
+    //! \returns True if the allocation carries no tracking information otherwise false, false is also returned if the
+    //!          pointer was not allocated by this heap.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::isUntrackedAllocation(const void *ptr) const {
+        if (!ptr) {
+            return false;
+        }
+
+        if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+            return !m_smallObjects.isArrayObject(ptr);
+        }
+
+        auto allocation = findAllocation(ptr);
+        if (!allocation || detail::isArrayAllocation(allocation)) {
+            return false;
+        }
+
+        if constexpr (kTracking || kSentinels) {
+            return nullptr == allocation->fileName;
+        } else {
+            return true;
+        }
+    }
+
+    //! \brief Records whether or not an allocation is held by a thread cache, which deallocate then refuses to release.
+    //!
+    //! Used by ConcurrentHeap to reject an allocation released a second time while the first release is still cached.
+    //! The header belongs to the caller while the allocation is live or cached, so the lock is not taken.
+    //! \param ptr [in] - Pointer to an allocation made by this heap, it must not be a small object.
+    //! \param isCached [in] - True if the allocation is being released to a thread cache, false when it leaves one.
+    //! \returns True if the state of the allocation was changed, false if it already held the requested state or the
+    //!          pointer was not allocated by this heap.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::setCachedAllocation(void *ptr, bool isCached) {
+        auto allocation = findAllocation(ptr);
+        if (!allocation || detail::isCachedAllocation(allocation) == isCached) {
+            return false;
+        }
+
+        detail::setCachedAllocation(allocation, isCached);
+        return true;
+    }
+
+    //! \brief Resizes an allocation, preferring to grow or shrink its block in place.
+    //!
+    //! The block is grown by absorbing the free block that physically follows it, and shrunk by returning its tail to
+    //! the heap. Only when neither is possible is a new block allocated, the contents copied and the old block released.
+    //! The new block keeps the array state of the allocation, and at least the alignment of its current address.
+    //! \param ptr [in] - Pointer to a live allocation made by this heap, or null to make a new allocation.
+    //! \param dataLength [in] - The length (in bytes) the allocation must hold.
+    //! \returns Pointer to the resized allocation, or null if it could not be resized in which case the original
+    //!          allocation is left untouched.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::reallocate(void *ptr, size_t dataLength) {
+        if (!ptr) {
+            return alloc(dataLength);
+        }
+
+        size_t usableLength = 0;
+        bool isArray = false;
+        const char *fileName = nullptr;
+        size_t line = 0;
+
+        {
+            std::lock_guard<TLockPolicy> lock(m_lock);
+
+            if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+                usableLength = m_smallObjects.getObjectSize(ptr);
+                isArray = m_smallObjects.isArrayObject(ptr);
+
+                if (dataLength <= usableLength) {
+                    traceEvent(kTraceEvent::Resize, ptr, dataLength, 0, isArray);
+                    return ptr;
+                }
+            } else {
+                auto allocation = findAllocation(ptr);
+                if (!allocation) {
+                    // TODO: Log ERR allocation did not belong to this heap
+                    return nullptr;
+                }
+
+                if (resizeBlock(allocation, dataLength)) {
+                    traceEvent(kTraceEvent::Resize, ptr, dataLength, 0, detail::isArrayAllocation(allocation));
+                    return ptr;
+                }
+
+                usableLength = detail::getAllocationBlock(allocation) + detail::getAllocationBlockLength(allocation) - reinterpret_cast<uintptr_t>(ptr);
+                isArray = detail::isArrayAllocation(allocation);
+
+                if constexpr (kTracking) {
+                    fileName = allocation->fileName;
+                    line = allocation->line;
+                }
+            }
+        }
+
+        // Keep the alignment the caller received, the largest power of two that divides the current address. Beyond a
+        // page the address is more likely to be aligned by chance, so larger alignments are not preserved.
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        const auto alignment = std::min<size_t>(address & (~address + 1), detail::kMaximumPreservedAlignment);
+
+        auto resized = allocate(dataLength, alignment, isArray, fileName, line);
+        if (resized) {
+            memcpy(resized, ptr, std::min(usableLength, dataLength));
+
+            [[maybe_unused]] const auto released = deallocate(ptr, isArray, fileName, line);
+            assert(released);
+        }
+
+        return resized;
+    }
+
+    //! \brief Attempts to resize an allocation without moving it.
+    //! \param ptr [in] - Pointer to a live allocation made by this heap.
+    //! \param dataLength [in] - The length (in bytes) the allocation must hold.
+    //! \returns True if the allocation now holds at least the specified length otherwise false, in which case the
+    //!          allocation is unchanged.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::tryExpandInPlace(void *ptr, size_t dataLength) {
+        if (!ptr) {
+            return false;
+        }
+
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+            if (dataLength > m_smallObjects.getObjectSize(ptr)) {
+                return false;
+            }
+
+            traceEvent(kTraceEvent::Resize, ptr, dataLength, 0, m_smallObjects.isArrayObject(ptr));
+            return true;
+        }
+
+        auto allocation = findAllocation(ptr);
+        if (!allocation) {
+            // TODO: Log ERR allocation did not belong to this heap
+            return false;
+        }
+
+        if (!resizeBlock(allocation, dataLength)) {
+            return false;
+        }
+
+        traceEvent(kTraceEvent::Resize, ptr, dataLength, 0, detail::isArrayAllocation(allocation));
+        return true;
+    }
+
+    //! \brief Moves an allocation into the free block that physically precedes it, if there is one.
+    //!
+    //! The header and contents of the allocation are moved to the lowest address within the free block that satisfies
+    //! the alignment, and the memory it vacates is joined with any free block that follows it. Repeating this for each
+    //! allocation in address order slides the allocations toward the start of the heap, gathering the free memory
+    //! between them into a single block. Any pointer into the allocation is invalidated when it is moved.
+    //! \param ptr [in] - Pointer to a live allocation made by this heap, small objects are never moved.
+    //! \param alignment [in] - The alignment (in bytes) the allocation must keep, must be a power of two.
+    //! \returns Pointer to the moved allocation, or null if the allocation could not be moved.
+    NGEN_BASIC_HEAP_TEMPLATE void *NGEN_BASIC_HEAP::slideAllocation(void *ptr, size_t alignment) {
+        if (!ptr || !detail::isPow2(alignment)) {
+            return nullptr;
+        }
+
+        std::lock_guard<TLockPolicy> lock(m_lock);
+
+        if (m_hasSmallObjects && m_smallObjects.owns(ptr)) {
+            return nullptr;
+        }
+
+        auto allocation = findAllocation(ptr);
+        if (!allocation) {
+            // TODO: Log ERR allocation did not belong to this heap
+            return nullptr;
+        }
+
+        const auto blockStart = detail::getAllocationBlock(allocation);
+        const auto blockEnd = blockStart + detail::getAllocationBlockLength(allocation);
+
+        if (!(detail::getBlockTag(blockStart) & detail::kPreviousFree)) {
+            return nullptr;
+        }
+
+        const auto previousLength = *reinterpret_cast<size_t *>(blockStart - sizeof(size_t)) & ~detail::kFreeBlockScavenged;
+        auto previous = reinterpret_cast<FreeBlock *>(blockStart - previousLength);
+
+        assert(previous->size == previousLength);
+
+        // The data keeps its alignment, so it moves to the first suitably aligned address within the free block.
+        const auto dataStart = reinterpret_cast<uintptr_t>(ptr);
+        const auto rawPtr = reinterpret_cast<uintptr_t>(previous);
+        const auto alignedPtr = detail::alignValue(rawPtr + sizeof(Header), std::max(alignment, alignof(FreeBlock)));
+
+        if (alignedPtr >= dataStart) {
+            return nullptr;
+        }
+
+        const auto dataLength = blockEnd - dataStart;
+        const auto previousOverhead = dataStart - blockStart;
+
+        const auto discardedBytes = takeScavengedBytes(previous);
+        removeFreeBlock(previous);
+
+        memmove(reinterpret_cast<void *>(alignedPtr - sizeof(Header)), allocation, sizeof(Header) + dataLength);
+
+        // The vacated memory is only returned to the heap when it is large enough to form a free block.
+        const auto newBlockStart = getAllocationStart(rawPtr, alignedPtr, blockEnd);
+        auto newBlockEnd = std::max(alignedPtr + dataLength, newBlockStart + detail::kMinimumFreeBlockLength);
+
+        if (blockEnd - newBlockEnd < detail::kMinimumFreeBlockLength) {
+            newBlockEnd = blockEnd;
+        }
+
+        auto moved = createAllocation(newBlockStart, alignedPtr, newBlockEnd - newBlockStart);
+
+        if (newBlockStart != rawPtr) {
+            releaseAlignmentPadding(rawPtr, newBlockStart);
+        }
+
+        if (newBlockEnd != blockEnd) {
+            detail::createFreeBlock(newBlockEnd, blockEnd - newBlockEnd);
+            releaseMemory(newBlockEnd, blockEnd - newBlockEnd);
+        }
+
+        retainScavengedBytes(rawPtr, blockStart, discardedBytes, newBlockEnd != blockEnd ? newBlockEnd : 0);
+
+        m_statistics.recordRelocation(previousOverhead, alignedPtr - newBlockStart);
+
+        if (m_heapProfiler && detail::isSampledAllocation(moved)) {
+            m_heapProfiler->recordRelocation(ptr, &moved[1]);
+        }
+
+        traceEvent(kTraceEvent::Allocate, &moved[1], dataLength, alignment, detail::isArrayAllocation(moved));
+        traceEvent(kTraceEvent::Deallocate, ptr, 0, 0, detail::isArrayAllocation(moved));
+
+        return &moved[1];
+    }
+
+    //! \brief Locates the header of a live allocation made by this heap.
+    //!
+    //! Only the bounds fixed when the heap was initialized are read, so the lock need not be held while a growable heap
+    //! is grown by another thread. A growable heap is bounded by its reservation rather than its committed memory.
+    //! \param ptr [in] - Pointer to the allocation, small objects are not supported.
+    //! \returns Pointer to the header of the allocation or null if the pointer is not a live allocation of this heap.
+    NGEN_BASIC_HEAP_TEMPLATE auto NGEN_BASIC_HEAP::findAllocation(const void *ptr) const -> Header * {
+        const auto lowerMemoryBoundary = reinterpret_cast<uintptr_t>(m_memoryBlock);
+        const auto upperMemoryBoundary = m_reservedLength ? lowerMemoryBoundary + m_reservedLength : m_blockEnd;
+        const auto start = reinterpret_cast<uintptr_t>(ptr);
+
+        if (start < lowerMemoryBoundary + sizeof(Header) || start >= upperMemoryBoundary) {
+            return nullptr;
+        }
+
+        auto allocation = reinterpret_cast<Header *>(start - sizeof(Header));
+        if (!isOwner(allocation)) {
+            return nullptr;
+        }
+
+        return allocation;
+    }
+
+    //! \brief Grows or shrinks the block of an allocation in place, the lock must be held.
+    //!
+    //! The alignment padding ahead of the header is unchanged, so the allocation keeps its address. A block only grows
+    //! when the block physically following it is free and large enough, a shrinking block releases its tail if the
+    //! tail is large enough to form a free block.
+    //! \param allocation [in] - Header of the allocation to be resized.
+    //! \param dataLength [in] - The length (in bytes) the allocation must hold.
+    //! \returns True if the block now holds at least the specified length otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::resizeBlock(Header *allocation, size_t dataLength) {
+        const auto blockStart = detail::getAllocationBlock(allocation);
+        const auto dataStart = reinterpret_cast<uintptr_t>(&allocation[1]);
+
+        auto blockLength = detail::getAllocationBlockLength(allocation);
+        auto requiredLength = dataStart - blockStart + detail::alignValue(dataLength ? dataLength : 1, alignof(FreeBlock));
+
+        if (requiredLength < detail::kMinimumFreeBlockLength) {
+            requiredLength = detail::kMinimumFreeBlockLength;
+        }
+
+        auto blockEnd = blockStart + blockLength;
+
+        // The discarded pages of an absorbed neighbour that lie within the returned tail stay discarded.
+        const auto absorbedStart = blockEnd;
+        size_t discardedBytes = 0;
+
+        if (requiredLength > blockLength) {
+            if (blockEnd >= m_memoryEnd || (detail::getBlockTag(blockEnd) & detail::kBlockAllocated)) {
+                return false;
+            }
+
+            auto next = reinterpret_cast<FreeBlock *>(blockEnd);
+            if (blockLength + next->size < requiredLength) {
+                return false;
+            }
+
+            discardedBytes = takeScavengedBytes(next);
+            removeFreeBlock(next);
+
+            blockLength += next->size;
+            blockEnd += next->size;
+
+            // The block following the absorbed one recorded a free predecessor, which is now this allocation.
+            if (blockEnd < m_memoryEnd) {
+                detail::setPreviousFree(blockEnd, false);
+            }
+        }
+
+        // Return any tail that is large enough to form a free block, as consumeMemory does.
+        const auto remaining = blockLength - requiredLength;
+        uintptr_t tail = 0;
+
+        if (remaining > sizeof(Header) && remaining >= detail::kMinimumFreeBlockLength) {
+            blockLength = requiredLength;
+
+            tail = blockStart + blockLength;
+            detail::createFreeBlock(tail, remaining);
+
+            releaseMemory(tail, remaining);
+        }
+
+        retainScavengedBytes(absorbedStart, blockEnd, discardedBytes, tail);
+
+        auto &tag = detail::getBlockTag(blockStart);
+        tag = blockLength | detail::kBlockAllocated | (tag & detail::kPreviousFree);
+
+        if constexpr (kTracking || kSentinels) {
+            allocation->size = dataLength;
+            allocation->blockSize = blockLength;
+        }
+
+        return true;
+    }
+
+    //! \brief Determines whether or not an allocation header records this heap as its owner.
+    //! \param allocation [in] - Header of the allocation to be examined.
+    //! \returns True if the allocation is live and was made by this heap otherwise false.
+    NGEN_BASIC_HEAP_TEMPLATE bool NGEN_BASIC_HEAP::isOwner(const Header *allocation) const {
+        if constexpr (kTracking || kSentinels) {
+            return allocation->heap == this;
+        } else {
+            return allocation->heapIndex == m_heapIndex;
+        }
+    }
+
+    //! \brief Clears the owner recorded by an allocation header, so that the allocation is no longer considered live.
+    //! \param allocation [in] - Header of the allocation being released.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::releaseOwnership(Header *allocation) {
+        if constexpr (kTracking || kSentinels) {
+            allocation->heap = nullptr;
+        } else {
+            allocation->heapIndex = 0;
+        }
+    }
+
+    //! \brief Inserts a FreeBlock instance at the head of our linked list and into the size index of the allocation strategy.
+    //! \param block [in] - The FreeBlock instance to be inserted into our linked list.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::insertFreeBlock(FreeBlock *block) {
+        assert(nullptr != block);
+        assert(nullptr == block->previous);
+        assert(nullptr == block->next);
+
+        block->next = m_rootBlock;
+
+        if (m_rootBlock) {
+            m_rootBlock->previous = block;
+        }
+
+        m_rootBlock = block;
+
+        indexFreeBlock(block);
+        m_statistics.recordFreeBlockInserted(block->size);
+    }
+
+    //! \brief Removes a FreeBlock instance from our linked list and from the size index of the allocation strategy.
+    //!
+    //! Any discarded pages still recorded by the block are counted as refaulted, callers that keep part of the block
+    //! free take the discarded length with takeScavengedBytes beforehand.
+    //! \param block [in] - The FreeBlock instance to be removed, its size must not have changed since it was inserted.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::removeFreeBlock(FreeBlock *block) {
+        assert(nullptr != block);
+
+        m_refaultedBytes += takeScavengedBytes(block);
+
+        unindexFreeBlock(block);
+        m_statistics.recordFreeBlockRemoved(block->size);
+
+        if (block->previous) {
+            block->previous->next = block->next;
+        } else {
+            m_rootBlock = block->next;
+        }
+
+        if (block->next) {
+            block->next->previous = block->previous;
+        }
+
+        block->previous = nullptr;
+        block->next = nullptr;
+    }
+
+    //! \brief Clears the scavenged state of a free block, so that its discarded pages are accounted for by the caller.
+    //! \param block [in] - The free block to be examined, its size must be intact.
+    //! \returns The number of bytes within the block whose pages were discarded.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::takeScavengedBytes(FreeBlock *block) {
+        // Only while scavenged blocks exist must the footer be examined.
+        if (m_scavengedBytes == m_refaultedBytes) {
+            return 0;
+        }
+
+        auto &footer = detail::getFreeBlockFooter(block);
+
+        if (!(footer & detail::kFreeBlockScavenged)) {
+            return 0;
+        }
+
+        footer &= ~detail::kFreeBlockScavenged;
+        return detail::getScavengedLength(block);
+    }
+
+    //! \brief Divides the discarded pages of a free block that has been allocated from, between the memory that was
+    //!        handed out and the free block formed from the memory remaining at its end.
+    //!
+    //! Pages ahead of the scavenge range of the remainder have been handed out, or hold its header, so are counted as
+    //! refaulted. The remaining discarded pages are recorded by the remainder, which must extend at least to the end
+    //! of the original block.
+    //! \param blockStart [in] - Address of the start of the original free block.
+    //! \param blockEnd [in] - Address of the end of the original free block.
+    //! \param discardedBytes [in] - The discarded length taken from the original block by takeScavengedBytes.
+    //! \param remainderStart [in] - Address of the free block formed from the remaining memory, or zero if there is none.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::retainScavengedBytes(uintptr_t blockStart, uintptr_t blockEnd, size_t discardedBytes, uintptr_t remainderStart) {
+        if (!discardedBytes) {
+            return;
+        }
+
+        uintptr_t rangeStart = 0;
+        const auto rangeLength = getScavengeRange(blockStart, blockEnd, rangeStart);
+
+        auto handedOut = rangeLength;
+
+        if (remainderStart) {
+            uintptr_t remainderRange = 0;
+
+            if (getScavengeRange(reinterpret_cast<FreeBlock *>(remainderStart), remainderRange)) {
+                handedOut = std::min(std::max(remainderRange, rangeStart) - rangeStart, rangeLength);
+            }
+        }
+
+        const auto refaulted = std::min(discardedBytes, handedOut);
+        m_refaultedBytes += refaulted;
+
+        if (discardedBytes > refaulted) {
+            markScavenged(reinterpret_cast<FreeBlock *>(remainderStart), discardedBytes - refaulted);
+        }
+    }
+
+    //! \brief Records discarded pages within a free block, adding to any the block already records.
+    //! \param block [in] - The free block containing the discarded pages, its size must be final.
+    //! \param discardedBytes [in] - The number of bytes whose pages are discarded, these must lie within the scavenge
+    //!                               range of the block.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::markScavenged(FreeBlock *block, size_t discardedBytes) {
+        auto &footer = detail::getFreeBlockFooter(block);
+
+        if (footer & detail::kFreeBlockScavenged) {
+            detail::getScavengedLength(block) += discardedBytes;
+        } else {
+            footer |= detail::kFreeBlockScavenged;
+            detail::getScavengedLength(block) = discardedBytes;
+        }
+    }
+
+    //! \brief Adds a free block to the size index used by the current allocation strategy, if it has one.
+    //! \param block [in] - The FreeBlock to be indexed, its size must be final.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::indexFreeBlock(FreeBlock *block) {
+        switch (getSearchStrategy()) {
+            case kAllocationStrategy::Smallest:
+                m_sizeIndex.insert(block);
+                break;
+
+            case kAllocationStrategy::TLSF:
+                m_tlsfIndex.insert(block);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    //! \brief Removes a free block from the size index used by the current allocation strategy, if it has one.
+    //! \param block [in] - The FreeBlock to be removed, this must be called before the size of the block is altered.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::unindexFreeBlock(FreeBlock *block) {
+        switch (getSearchStrategy()) {
+            case kAllocationStrategy::Smallest:
+                m_sizeIndex.remove(block);
+                break;
+
+            case kAllocationStrategy::TLSF:
+                m_tlsfIndex.remove(block);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    //! \brief Given a block of memory being released, this method joins it with any physically adjacent free blocks.
+    //! The neighbouring blocks are located through their boundary tags, so no list needs to be searched. Neighbours that
+    //! are absorbed are removed from the free list, the returned block is not linked into any list. Discarded pages
+    //! within the neighbours remain discarded, and are recorded by the returned block.
+    //! \param blockStart [in] - Address of the start of the block being released, its boundary tag must still be intact.
+    //! \param blockLength [in] - Length (in bytes) of the block being released.
+    //! \returns The FreeBlock instance that contains the gathered memory.
+    NGEN_BASIC_HEAP_TEMPLATE FreeBlock *NGEN_BASIC_HEAP::gatherMemory(uintptr_t blockStart, size_t blockLength) {
+        const auto previousFree = 0 != (detail::getBlockTag(blockStart) & detail::kPreviousFree);
+        const auto blockEnd = blockStart + blockLength;
+
+        size_t discardedBytes = 0;
+
+        if (blockEnd < m_memoryEnd && !(detail::getBlockTag(blockEnd) & detail::kBlockAllocated)) {
+            auto next = reinterpret_cast<FreeBlock *>(blockEnd);
+
+            blockLength += next->size;
+
+            discardedBytes += takeScavengedBytes(next);
+            removeFreeBlock(next);
+        }
+
+        if (previousFree) {
+            const auto previousLength = *reinterpret_cast<size_t *>(blockStart - sizeof(size_t)) & ~detail::kFreeBlockScavenged;
+            auto previous = reinterpret_cast<FreeBlock *>(blockStart - previousLength);
+
+            assert(previous->size == previousLength);
+
+            discardedBytes += takeScavengedBytes(previous);
+            removeFreeBlock(previous);
+
+            blockStart -= previousLength;
+            blockLength += previousLength;
+        }
+
+        auto freeBlock = detail::createFreeBlock(blockStart, blockLength);
+
+        if (discardedBytes) {
+            markScavenged(freeBlock, discardedBytes);
+        }
+
+        return freeBlock;
+    }
+
+    //! \brief Consumes an amount of memory from the specified FreeBlock.
+    //! \param freeBlock [in] - The memory block we are to consume.
+    //! \param dataLength [in] - The number of bytes to be consumed.
+    //! \param alignment [in] - The alignment the allocated memory block must have.
+    NGEN_BASIC_HEAP_TEMPLATE auto NGEN_BASIC_HEAP::consumeMemory(FreeBlock *freeBlock, size_t dataLength, size_t alignment) -> Header * {
+        assert(nullptr != freeBlock);
+
+        const auto discardedBytes = takeScavengedBytes(freeBlock);
+        removeFreeBlock(freeBlock);
+
+        const auto rawPtr = reinterpret_cast<uintptr_t>(freeBlock);
+        const auto endPtr = rawPtr + freeBlock->size;
+
+        const uintptr_t alignedPtr = detail::alignValue(rawPtr + sizeof(Header), alignment);
+        const uintptr_t blockStart = getAllocationStart(rawPtr, alignedPtr, endPtr);
+
+        size_t blockLength = alignedPtr - blockStart + dataLength;
+
+        // Every allocated block must be able to hold a FreeBlock once it has been released.
+        if (blockLength < detail::kMinimumFreeBlockLength) {
+            blockLength = detail::kMinimumFreeBlockLength;
+        }
+
+        size_t remaining = endPtr - blockStart - blockLength;
+
+        // If there isn't enough memory remaining to warrant creating a new free block, then
+        // include it inside the allocation.
+        if (remaining <= sizeof(Header) || remaining < detail::kMinimumFreeBlockLength) {
+            blockLength += remaining;
+            remaining = 0;
+        }
+
+        if (remaining) {
+            // Insert a new FreeBlock into the memory pool from the remaining space, the block that follows
+            // it already records that its predecessor is free.
+            insertFreeBlock(detail::createFreeBlock(blockStart + blockLength, remaining));
+        } else if (endPtr < m_memoryEnd) {
+            detail::setPreviousFree(endPtr, false);
+        }
+
+        retainScavengedBytes(rawPtr, endPtr, discardedBytes, remaining ? blockStart + blockLength : 0);
+
+        // The predecessor of a free block is never free, as neighbouring free blocks are always joined.
+        auto alloc = createAllocation(blockStart, alignedPtr, blockLength);
+
+        if (blockStart != rawPtr) {
+            releaseAlignmentPadding(rawPtr, blockStart);
+        }
+
+        return alloc;
+    }
+
+    //! \brief Determines where the block of an allocation starts within a free block.
+    //!
+    //! Leading alignment padding that is large enough to form a free block is split from the allocation, so that it
+    //! is returned to the free list rather than being wasted until the allocation is released. Smaller padding is
+    //! included in the allocation, the header is then located at the end of the padding.
+    //! \param rawPtr [in] - Address of the start of the free block.
+    //! \param alignedPtr [in] - Address of the data of the allocation.
+    //! \param endPtr [in] - Address of the end of the free block.
+    //! \returns Address at which the block of the allocation starts.
+    NGEN_BASIC_HEAP_TEMPLATE uintptr_t NGEN_BASIC_HEAP::getAllocationStart(uintptr_t rawPtr, uintptr_t alignedPtr, uintptr_t endPtr) const {
+        const auto padding = alignedPtr - sizeof(Header) - rawPtr;
+
+        if (padding >= detail::kMinimumFreeBlockLength && endPtr - rawPtr - padding >= detail::kMinimumFreeBlockLength) {
+            return rawPtr + padding;
+        }
+
+        return rawPtr;
+    }
+
+    //! \brief Returns the alignment padding split from the start of an allocation to the free list.
+    //! \param paddingStart [in] - Address of the start of the padding, its predecessor must not be free.
+    //! \param blockStart [in] - Address of the allocated block following the padding.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::releaseAlignmentPadding(uintptr_t paddingStart, uintptr_t blockStart) {
+        insertFreeBlock(detail::createFreeBlock(paddingStart, blockStart - paddingStart));
+        detail::setPreviousFree(blockStart, true);
+    }
+
+    //! \brief Marks a block as allocated and writes the parts of its header that describe the block.
+    //! \param blockStart [in] - Address of the start of the block, its predecessor must not be free.
+    //! \param dataStart [in] - Address of the data of the allocation, the header is located immediately before it.
+    //! \param blockLength [in] - Length (in bytes) of the block, including its header and alignment padding.
+    //! \returns Pointer to the header of the allocation.
+    NGEN_BASIC_HEAP_TEMPLATE auto NGEN_BASIC_HEAP::createAllocation(uintptr_t blockStart, uintptr_t dataStart, size_t blockLength) -> Header * {
+        detail::getBlockTag(blockStart) = blockLength | detail::kBlockAllocated;
+
+        auto alloc = reinterpret_cast<Header *>(dataStart - sizeof(Header));
+
+        if constexpr (kTracking || kSentinels) {
+            alloc->heap = this;
+            alloc->addr = blockStart;
+            alloc->blockSize = blockLength;
+
+            if constexpr (kSentinels) {
+                alloc->sentinel[0] = detail::kHeaderSentinelData[0];
+                alloc->sentinel[1] = detail::kHeaderSentinelData[1];
+                alloc->sentinel[2] = detail::kHeaderSentinelData[2];
+                alloc->sentinel[3] = detail::kHeaderSentinelData[3];
+
+                // TODO: Also need footer sentinel after memory block
+            }
+        } else {
+            assert(reinterpret_cast<uintptr_t>(alloc) - blockStart <= UINT32_MAX);
+
+            alloc->offset = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(alloc) - blockStart);
+            alloc->heapIndex = m_heapIndex;
+        }
+
+        return alloc;
+    }
+
+    //! \brief Records the details of an allocation request within the header of its block.
+    //! \param allocation [in] - Header of the allocation.
+    //! \param dataLength [in] - The length (in bytes) that was requested.
+    //! \param isArray [in] - True if the allocation is an array otherwise false.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    NGEN_BASIC_HEAP_TEMPLATE void NGEN_BASIC_HEAP::describeAllocation(Header *allocation, size_t dataLength, bool isArray, [[maybe_unused]] const char *fileName, [[maybe_unused]] size_t line) {
+        if constexpr (kTracking || kSentinels) {
+            allocation->isArray = isArray;
+            allocation->isSampled = false;
+            allocation->isCached = false;
+            allocation->size = dataLength;
+
+            if constexpr (kTracking) {
+                allocation->id = detail::nextAllocationId();
+                allocation->fileName = fileName;
+                allocation->line = line;
+            } else {
+                allocation->id = 0;
+                allocation->fileName = nullptr;
+                allocation->line = 0;
+            }
+        } else {
+            allocation->flags = isArray ? detail::kAllocationArray : 0;
+        }
+    }
+
+    //! \brief Searches the available free memory blocks for an appropriate block to be used for the described allocation.
+    //! \param dataLength [in] - The length (in bytes) of the memory block that has requested allocation.
+    //! \param alignment [in] - The alignment (in bytes) the memory allocation requires.
+    //! \returns Pointer to the FreeBlock that can successfully allocate the described memory block.
+    NGEN_BASIC_HEAP_TEMPLATE FreeBlock *NGEN_BASIC_HEAP::findFreeBlock(size_t dataLength, size_t alignment) {
+        FreeBlock *freeBlock = nullptr;
+        size_t searchLength = 0;
+
+        switch (getSearchStrategy()) {
+            case kAllocationStrategy::First:
+                freeBlock = findFreeBlock_first(dataLength, alignment, searchLength);
+                break;
+
+            case kAllocationStrategy::Smallest:
+                freeBlock = findFreeBlock_smallest(dataLength, alignment, searchLength);
+                break;
+
+            case kAllocationStrategy::TLSF:
+                freeBlock = findFreeBlock_tlsf(dataLength, alignment, searchLength);
+                break;
+
+            default:
+                // TODO: Log error - Unknown allocation strategy
+                break;
+        }
+
+        m_statistics.recordSearch(searchLength);
+        return freeBlock;
+    }
+
+    //! \brief Searches the available free memory blocks for an appropriate block to be used for the described allocation, chooses the smallest free block available.
+    //! Blocks are visited in order of size starting from the smallest that could hold the allocation, so the first
+    //! block that can also satisfy the alignment is the smallest suitable block.
+    //! \param dataLength [in] - The length (in bytes) of the memory block that has requested allocation.
+    //! \param alignment [in] - The alignment (in bytes) the memory allocation requires.
+    //! \param searchLength [out] - Receives the number of free blocks that were examined.
+    //! \returns Pointer to the FreeBlock that can successfully allocate the described memory block.
+    NGEN_BASIC_HEAP_TEMPLATE FreeBlock *NGEN_BASIC_HEAP::findFreeBlock_smallest(size_t dataLength, size_t alignment, size_t &searchLength) const {
+        for (FreeBlock *search = m_sizeIndex.lowerBound(sizeof(Header) + dataLength); search; search = SizeTreeIndex::successor(search)) {
+            searchLength++;
+
+            const auto rawPtr = reinterpret_cast<uintptr_t>(search);
+            const auto endPtr = rawPtr + search->size;
+
+            uintptr_t alignedPtr = detail::alignValue(rawPtr + sizeof(Header), alignment);
+            if (alignedPtr >= rawPtr && alignedPtr < endPtr && (endPtr - alignedPtr) >= dataLength) {
+                return search;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //! \brief Searches the available free memory blocks for an appropriate block to be used for the described allocation.
+    //! \param dataLength [in] - The length (in bytes) of the memory block that has requested allocation.
+    //! \param alignment [in] - The alignment (in bytes) the memory allocation requires.
+    //! \param searchLength [out] - Receives the number of free blocks that were examined.
+    //! \returns Pointer to the FreeBlock that can successfully allocate the described memory block.
+    NGEN_BASIC_HEAP_TEMPLATE FreeBlock *NGEN_BASIC_HEAP::findFreeBlock_first(size_t dataLength, size_t alignment, size_t &searchLength) const {
+        for (FreeBlock *search = m_rootBlock; search; search = search->next) {
+            searchLength++;
+
+            if (dataLength <= search->size) {
+                const auto rawPtr = reinterpret_cast<uintptr_t>(search);
+                const auto endPtr = rawPtr + search->size;
+
+                uintptr_t alignedPtr = detail::alignValue(rawPtr + sizeof(Header), alignment);
+                if (alignedPtr > rawPtr && alignedPtr < endPtr && (endPtr - alignedPtr) >= dataLength) {
+                    return search;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    //! \brief Searches the segregated free lists for an appropriate block to be used for the described allocation.
+    //! The block is sized for the worst case alignment padding, so the first block in the selected list is always suitable.
+    //! \param dataLength [in] - The length (in bytes) of the memory block that has requested allocation.
+    //! \param alignment [in] - The alignment (in bytes) the memory allocation requires.
+    //! \param searchLength [out] - Receives one, as the selected list is never walked.
+    //! \returns Pointer to the FreeBlock that can successfully allocate the described memory block.
+    NGEN_BASIC_HEAP_TEMPLATE FreeBlock *NGEN_BASIC_HEAP::findFreeBlock_tlsf(size_t dataLength, size_t alignment, size_t &searchLength) const {
+        if (dataLength >= m_heapLength) {
+            return nullptr;
+        }
+
+        searchLength = 1;
+
+        const auto padding = alignment > alignof(FreeBlock) ? alignment - alignof(FreeBlock) : 0;
+        return m_tlsfIndex.find(sizeof(Header) + padding + dataLength);
+    }
+
+    //! \brief Determines the length of the largest free block, using the size index of the strategy where it has one.
+    //! \returns The length (in bytes) of the largest free block, or zero if there are no free blocks.
+    NGEN_BASIC_HEAP_TEMPLATE size_t NGEN_BASIC_HEAP::getLargestFreeBlock() const {
+        const FreeBlock *largest = nullptr;
+
+        switch (getSearchStrategy()) {
+            case kAllocationStrategy::Smallest:
+                largest = m_sizeIndex.getLargest();
+                break;
+
+            case kAllocationStrategy::TLSF:
+                largest = m_tlsfIndex.findLargest();
+                break;
+
+            default:
+                for (auto search = m_rootBlock; search; search = search->next) {
+                    if (!largest || search->size > largest->size) {
+                        largest = search;
+                    }
+                }
+                break;
+        }
+
+        return largest ? largest->size : 0;
+    }
+}
+
+#undef NGEN_BASIC_HEAP
+#undef NGEN_BASIC_HEAP_TEMPLATE
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_BASIC_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,161 @@
+
+#if !defined(MEMORY_CONCURRENT_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_CONCURRENT_HEAP_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "heap.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    class ConcurrentHeap;
+
+    //! \brief  Limits applied to the per-thread caches of a ConcurrentHeap.
+    struct ThreadCacheLimits {
+        size_t maximumBlockSize = 1024;         // Allocations larger than this bypass the thread cache
+        size_t maximumBlocksPerBucket = 64;     // Number of blocks a single size bucket may hold before it is trimmed
+        size_t maximumCachedBytes = 256 * 1024; // Total bytes a thread may hold in its cache before it is trimmed
+        size_t batchCount = 16;                 // Number of blocks moved between the heap and a cache at once
+    };
+
+    //! \brief  Blocks cached by a single thread for a single ConcurrentHeap, bucketed by size.
+    struct ThreadCache {
+        static constexpr size_t kBucketCount = 16;
+        static constexpr size_t kMinimumBucketLog2 = 4;
+
+        struct CachedBlock {
+            CachedBlock *next;
+        };
+
+        std::atomic<ConcurrentHeap *> heap;     // The heap the cache is attached to, null when unused
+        ThreadCache *previous;                  // Previous cache attached to the same heap
+        ThreadCache *next;                      // Next cache attached to the same heap
+        CachedBlock *buckets[kBucketCount];     // Cached blocks, bucket N holds blocks of at least 16 << N bytes
+        size_t counts[kBucketCount];            // Number of blocks held by each bucket
+        size_t cachedBytes;                     // Total bucket size of all blocks held by the cache
+        std::atomic<size_t> blockCount;         // Total number of blocks held by the cache, readable by other threads
+    };
+
+    //! \brief  Thread safe heap that serves most allocations from per-thread caches.
+    //!
+    //! Each thread that uses the heap keeps its own cache of recently released blocks, bucketed by size. Threads
+    //! allocate from and release to their own cache without locking, and only lock the underlying Heap to move
+    //! blocks in batches when a bucket runs empty or grows beyond its limits. A thread's cache is flushed back
+    //! to the heap automatically when the thread exits, or explicitly through flushThreadCache.
+    //!
+    //! The locks of every live heap are held across fork by handlers registered with pthread_atfork when the first heap
+    //! is constructed. The child returns the blocks cached by threads that did not survive the fork to each heap.
+    //!
+    //! Allocations made with a file name are tracked individually and are always served directly by the underlying
+    //! heap, as are allocations that exceed the cache limits or require more than the fundamental alignment. Untracked
+    //! allocations are not distinguished between array and non-array within the underlying heap, as their blocks
+    //! may be exchanged through the thread caches.
+    class ConcurrentHeap {
+    public:
+        static constexpr size_t kMaximumHeapsPerThread = 8;
+
+        ConcurrentHeap();
+        ~ConcurrentHeap();
+
+        ConcurrentHeap(const ConcurrentHeap &other) = delete;
+        ConcurrentHeap &operator=(const ConcurrentHeap &other) = delete;
+
+        bool initialize(void *memoryBlock, size_t blockSize);
+        bool initialize(void *memoryBlock, size_t blockSize, kAllocationStrategy allocationStrategy);
+        bool initialize(void *memoryBlock, size_t blockSize, kAllocationStrategy allocationStrategy, const ThreadCacheLimits &limits);
+
+        bool initializeGrowable(size_t reserveLength, size_t commitLength);
+        bool initializeGrowable(size_t reserveLength, size_t commitLength, kAllocationStrategy allocationStrategy);
+        bool initializeGrowable(size_t reserveLength, size_t commitLength, kAllocationStrategy allocationStrategy, const ThreadCacheLimits &limits);
+
+        [[nodiscard]] void* alloc(size_t dataLength);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* alloc(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        [[nodiscard]] void* allocArray(size_t dataLength);
+        [[nodiscard]] void* alignedAllocArray(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* allocArray(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAllocArray(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        bool deallocate(void *ptr, bool isArray, const char *fileName, size_t line);
+
+        [[nodiscard]] size_t getUsableSize(const void *ptr) const;
+
+        void flushThreadCache();
+
+        size_t scavenge(size_t minimumBlockSize, size_t maximumBytes);
+
+        void setTraceRecorder(TraceRecorder *recorder);
+        void setHeapProfiler(HeapProfiler *profiler);
+
+        [[nodiscard]] size_t getSize() const;
+        [[nodiscard]] size_t getAllocations() const;
+        [[nodiscard]] size_t getTotalAllocations() const;
+        [[nodiscard]] size_t getFailedAllocations() const;
+        [[nodiscard]] size_t getCachedBlocks() const;
+        [[nodiscard]] size_t getScavengedBytes() const;
+        [[nodiscard]] size_t getRefaultedBytes() const;
+
+        [[nodiscard]] HeapStats getStats() const;
+
+        [[nodiscard]] const ThreadCacheLimits& getLimits() const;
+
+    private:
+        friend class ThreadCacheTable;
+
+        [[nodiscard]] void* allocate(size_t dataLength, size_t alignment, bool isArray, const char *fileName, size_t line);
+
+        [[nodiscard]] ThreadCache* findThreadCache() const;
+        [[nodiscard]] ThreadCache* acquireThreadCache();
+
+        [[nodiscard]] void* refillBucket(ThreadCache *cache, size_t bucket);
+        void flushBucket(ThreadCache *cache, size_t bucket, size_t keepCount);
+        void trimThreadCache(ThreadCache *cache, size_t bucket);
+        void releaseThreadCache(ThreadCache *cache);
+        void detachThreadCache(ThreadCache *cache);
+
+        void reclaimThreadCaches();
+
+        static void prepareFork();
+        static void parentAfterFork();
+        static void childAfterFork();
+
+    private:
+        Heap m_heap;
+        mutable std::mutex m_mutex;
+
+        ThreadCacheLimits m_limits;
+        ThreadCache *m_caches;
+
+        ConcurrentHeap *m_previousHeap;
+        ConcurrentHeap *m_nextHeap;
+
+        size_t m_failedAllocations;
+    };
+
+    //! \brief Retrieves the total size of the memory heap.
+    //! \returns The size (in bytes) of the total memory pool managed by this heap.
+    inline size_t ConcurrentHeap::getSize() const {
+        return m_heap.getSize();
+    }
+
+    //! \brief Retrieves the limits applied to the thread caches of this heap.
+    //! \returns Reference to the limits applied to the thread caches of this heap.
+    inline const ThreadCacheLimits& ConcurrentHeap::getLimits() const {
+        return m_limits;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_CONCURRENT_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
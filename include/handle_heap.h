@@ -0,0 +1,185 @@
+
+#if !defined(MEMORY_HANDLE_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_HANDLE_HEAP_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "heap.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Identifies an allocation made by a HandleHeap, the handle remains valid while the allocation moves.
+    struct MemoryHandle {
+        uint32_t index;             // Index of the entry within the handle table plus one, zero is never a valid handle
+        uint32_t generation;        // Generation of the entry when the handle was issued, detects released handles
+    };
+
+    constexpr MemoryHandle kInvalidHandle = {0, 0};
+
+    inline bool operator==(const MemoryHandle &lhs, const MemoryHandle &rhs) {
+        return lhs.index == rhs.index && lhs.generation == rhs.generation;
+    }
+
+    inline bool operator!=(const MemoryHandle &lhs, const MemoryHandle &rhs) {
+        return !(lhs == rhs);
+    }
+
+    //! \brief  Entry within the handle table of a HandleHeap, describing the current location of an allocation.
+    struct HandleEntry {
+        void *ptr;                  // Current address of the allocation, null while the entry is unused
+        size_t dataLength;          // Length (in bytes) requested for the allocation
+        uint32_t alignment;         // Alignment (in bytes) the allocation keeps when it is moved
+        uint32_t generation;        // Incremented each time the entry is released, so stale handles are rejected
+        uint32_t pinCount;          // Number of outstanding pins, the allocation is never moved while pinned
+        uint32_t nextFree;          // Index plus one of the next unused entry, while this entry is unused
+    };
+
+    //! \brief  Heap whose allocations are referenced through handles, allowing them to be moved to reduce fragmentation.
+    //!
+    //! Live blocks pin the holes between them, so a heap serving a long running program can fail large allocations
+    //! despite holding ample free memory. Allocations made through a HandleHeap are addressed by a MemoryHandle, which
+    //! is resolved to the current address of the allocation through a fixed size handle table. Each call to compact
+    //! slides unpinned allocations toward the start of the heap, in address order, until its time budget is spent, so
+    //! the free memory gathers into a single block at the end of the heap across a number of calls.
+    //!
+    //! Addresses obtained from resolve are invalidated by the next call to compact, unless the handle is pinned. The
+    //! handle table is allocated from the heap when it is initialized, and is never moved. A HandleHeap is not thread safe.
+    class HandleHeap {
+    public:
+        static constexpr size_t kDefaultAlignment = alignof(std::max_align_t);
+
+        HandleHeap();
+
+        HandleHeap(const HandleHeap &other) = delete;
+        HandleHeap &operator=(const HandleHeap &other) = delete;
+
+        bool initialize(void *memoryBlock, size_t blockSize, size_t handleCount);
+        bool initialize(void *memoryBlock, size_t blockSize, size_t handleCount, kAllocationStrategy allocationStrategy);
+
+        [[nodiscard]] MemoryHandle alloc(size_t dataLength);
+        [[nodiscard]] MemoryHandle alignedAlloc(size_t dataLength, size_t alignment);
+
+        bool release(MemoryHandle handle);
+
+        [[nodiscard]] void* resolve(MemoryHandle handle) const;
+        [[nodiscard]] size_t getLength(MemoryHandle handle) const;
+
+        [[nodiscard]] void* pin(MemoryHandle handle);
+        bool unpin(MemoryHandle handle);
+        [[nodiscard]] bool isPinned(MemoryHandle handle) const;
+
+        size_t compact(std::chrono::nanoseconds budget);
+        [[nodiscard]] bool isCompacted() const;
+
+        [[nodiscard]] size_t getHandleCount() const;
+        [[nodiscard]] size_t getLiveHandles() const;
+        [[nodiscard]] size_t getFailedAllocations() const;
+        [[nodiscard]] size_t getRelocations() const;
+        [[nodiscard]] size_t getRelocatedBytes() const;
+
+        [[nodiscard]] const Heap* getHeap() const;
+
+    private:
+        [[nodiscard]] HandleEntry* findEntry(MemoryHandle handle) const;
+        void beginSweep();
+
+    private:
+        std::optional<Heap> m_heap;
+
+        HandleEntry *m_entries;
+        uint32_t *m_sweepOrder;
+        size_t m_handleCount;
+        size_t m_liveHandles;
+        uint32_t m_freeEntry;
+
+        size_t m_sweepLength;
+        size_t m_sweepPosition;
+        bool m_isSweepClean;
+        bool m_isCompacted;
+
+        size_t m_failedAllocations;
+        size_t m_relocations;
+        size_t m_relocatedBytes;
+    };
+
+    //! \brief  Pins a handle when constructed and unpins it when destroyed, the allocation does not move in between.
+    class HandlePin {
+    public:
+        HandlePin(HandleHeap &heap, MemoryHandle handle) : m_heap(heap), m_handle(handle), m_ptr(heap.pin(handle)) {
+
+        }
+
+        ~HandlePin() {
+            if (m_ptr) {
+                m_heap.unpin(m_handle);
+            }
+        }
+
+        HandlePin(const HandlePin &other) = delete;
+        HandlePin &operator=(const HandlePin &other) = delete;
+
+        //! \brief Retrieves the address of the pinned allocation.
+        //! \returns Pointer to the allocation, or null if the handle was not valid.
+        [[nodiscard]] void* get() const {
+            return m_ptr;
+        }
+
+    private:
+        HandleHeap &m_heap;
+        MemoryHandle m_handle;
+        void *m_ptr;
+    };
+
+    //! \brief Determines whether or not the last sweep of the heap found no allocation that could be moved.
+    //! \returns True if nothing has been allocated, released or unpinned since a sweep that moved no allocations.
+    inline bool HandleHeap::isCompacted() const {
+        return m_isCompacted;
+    }
+
+    //! \brief Retrieves the number of entries within the handle table.
+    //! \returns The largest number of allocations the heap may hold at once.
+    inline size_t HandleHeap::getHandleCount() const {
+        return m_handleCount;
+    }
+
+    //! \brief Retrieves the number of handles that are currently live.
+    //! \returns The number of allocations that have been made but not yet released.
+    inline size_t HandleHeap::getLiveHandles() const {
+        return m_liveHandles;
+    }
+
+    //! \brief Retrieves the number of allocation requests that have been requested but failed.
+    //! \returns The number of allocations that failed, either because the heap or the handle table was exhausted.
+    inline size_t HandleHeap::getFailedAllocations() const {
+        return m_failedAllocations;
+    }
+
+    //! \brief Retrieves the number of times an allocation has been moved by compact.
+    //! \returns The number of allocations moved during the lifetime of the heap.
+    inline size_t HandleHeap::getRelocations() const {
+        return m_relocations;
+    }
+
+    //! \brief Retrieves the number of bytes copied by compact.
+    //! \returns The total length (in bytes) of the allocations moved during the lifetime of the heap.
+    inline size_t HandleHeap::getRelocatedBytes() const {
+        return m_relocatedBytes;
+    }
+
+    //! \brief Retrieves the heap the allocations are made from, for access to its statistics.
+    //! \returns Pointer to the underlying heap, or null if the handle heap has not been initialized.
+    inline const Heap* HandleHeap::getHeap() const {
+        return m_heap ? &*m_heap : nullptr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_HANDLE_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
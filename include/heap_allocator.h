@@ -0,0 +1,161 @@
+
+#if !defined(MEMORY_HEAP_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_HEAP_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+#include "heap.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Polymorphic memory resource that obtains its memory from a heap, for use with the std::pmr containers.
+    //!
+    //! The resource does not own the heap, which must outlive the resource and every container using it. As required
+    //! of a memory_resource, std::bad_alloc is thrown when the heap is unable to satisfy a request.
+    //!
+    //! \tparam THeap - The type of heap memory is obtained from, such as Heap or ConcurrentHeap.
+    template <typename THeap = Heap>
+    class HeapMemoryResource : public std::pmr::memory_resource {
+    public:
+        explicit HeapMemoryResource(THeap &heap) : m_heap(&heap) {
+
+        }
+
+        HeapMemoryResource(const HeapMemoryResource &other) = delete;
+        HeapMemoryResource &operator=(const HeapMemoryResource &other) = delete;
+
+        [[nodiscard]] THeap* getHeap() const;
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+    private:
+        THeap *m_heap;
+    };
+
+    //! \brief Retrieves the heap memory is obtained from.
+    //! \returns Pointer to the heap memory is obtained from.
+    template <typename THeap> THeap *HeapMemoryResource<THeap>::getHeap() const {
+        return m_heap;
+    }
+
+    //! \brief Allocates a block of memory from the heap.
+    //! \param bytes [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block to be allocated.
+    //! \returns Pointer to the allocated memory block, std::bad_alloc is thrown if the allocation could not be made.
+    template <typename THeap> void *HeapMemoryResource<THeap>::do_allocate(size_t bytes, size_t alignment) {
+        auto ptr = m_heap->alignedAlloc(bytes, alignment);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+
+        return ptr;
+    }
+
+    //! \brief Returns a block of memory obtained from do_allocate to the heap.
+    //! \param ptr [in] - Pointer to the memory block to be released.
+    template <typename THeap> void HeapMemoryResource<THeap>::do_deallocate(void *ptr, size_t, size_t) {
+        m_heap->deallocate(ptr, false, nullptr, 0);
+    }
+
+    //! \brief Determines whether memory allocated by this resource may be released by another resource.
+    //! \param other [in] - The resource to be compared with.
+    //! \returns True if the other resource obtains its memory from the same heap otherwise false.
+    template <typename THeap> bool HeapMemoryResource<THeap>::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+        auto resource = dynamic_cast<const HeapMemoryResource *>(&other);
+        return resource && resource->m_heap == m_heap;
+    }
+
+    //! \brief  Standard allocator that obtains its memory from a heap, for use with the standard containers.
+    //!
+    //! The only state held by the allocator is the heap, so copies and rebound copies compare equal whenever they share
+    //! a heap. The heap must outlive every container using the allocator. As required of an allocator, std::bad_alloc
+    //! is thrown when the heap is unable to satisfy a request.
+    //!
+    //! \tparam T - The type of object memory is allocated for.
+    //! \tparam THeap - The type of heap memory is obtained from, such as Heap or ConcurrentHeap.
+    template <typename T, typename THeap = Heap>
+    class HeapAllocator {
+    public:
+        using value_type = T;
+
+        // Containers keep the allocator of the container whose contents they take, so nodes never move between heaps.
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        template <typename U>
+        struct rebind {
+            using other = HeapAllocator<U, THeap>;
+        };
+
+        explicit HeapAllocator(THeap &heap) noexcept : m_heap(&heap) {
+
+        }
+
+        template <typename U>
+        HeapAllocator(const HeapAllocator<U, THeap> &other) noexcept : m_heap(other.getHeap()) {
+
+        }
+
+        [[nodiscard]] T* allocate(size_t count);
+        void deallocate(T *ptr, size_t count) noexcept;
+
+        [[nodiscard]] THeap* getHeap() const noexcept;
+
+    private:
+        THeap *m_heap;
+    };
+
+    //! \brief Allocates memory for an array of objects from the heap, the objects are not constructed.
+    //! \param count [in] - The number of objects memory is to be allocated for.
+    //! \returns Pointer to the allocated memory, std::bad_alloc is thrown if the allocation could not be made.
+    template <typename T, typename THeap> T *HeapAllocator<T, THeap>::allocate(size_t count) {
+        if (count > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+
+        auto ptr = m_heap->alignedAlloc(count * sizeof(T), alignof(T));
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T *>(ptr);
+    }
+
+    //! \brief Returns memory obtained from allocate to the heap, the objects must already have been destroyed.
+    //! \param ptr [in] - Pointer to the memory to be released.
+    template <typename T, typename THeap> void HeapAllocator<T, THeap>::deallocate(T *ptr, size_t) noexcept {
+        m_heap->deallocate(ptr, false, nullptr, 0);
+    }
+
+    //! \brief Retrieves the heap memory is obtained from.
+    //! \returns Pointer to the heap memory is obtained from.
+    template <typename T, typename THeap> THeap *HeapAllocator<T, THeap>::getHeap() const noexcept {
+        return m_heap;
+    }
+
+    template <typename T, typename U, typename THeap>
+    bool operator==(const HeapAllocator<T, THeap> &lhs, const HeapAllocator<U, THeap> &rhs) noexcept {
+        return lhs.getHeap() == rhs.getHeap();
+    }
+
+    template <typename T, typename U, typename THeap>
+    bool operator!=(const HeapAllocator<T, THeap> &lhs, const HeapAllocator<U, THeap> &rhs) noexcept {
+        return lhs.getHeap() != rhs.getHeap();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_HEAP_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,275 @@
+
+#if !defined(MEMORY_HEAP_POLICIES_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_HEAP_POLICIES_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif //defined(_MSC_VER)
+
+#include "allocation_strategy.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Search policy that selects the allocation strategy when the heap is initialized.
+    struct SearchDynamic {
+        static constexpr kAllocationStrategy kStrategy = kAllocationStrategy::Invalid;
+    };
+
+    //! \brief  Search policy that always uses kAllocationStrategy::First.
+    struct SearchFirst {
+        static constexpr kAllocationStrategy kStrategy = kAllocationStrategy::First;
+    };
+
+    //! \brief  Search policy that always uses kAllocationStrategy::Smallest.
+    struct SearchSmallest {
+        static constexpr kAllocationStrategy kStrategy = kAllocationStrategy::Smallest;
+    };
+
+    //! \brief  Search policy that always uses kAllocationStrategy::TLSF.
+    struct SearchTLSF {
+        static constexpr kAllocationStrategy kStrategy = kAllocationStrategy::TLSF;
+    };
+
+    //! \brief  Tracking policy that does not record anything about an allocation beyond what the heap requires.
+    struct NoTracking {
+        static constexpr bool kEnabled = false;
+    };
+
+    //! \brief  Tracking policy that records the size, source location and a unique identifier with each allocation.
+    struct SourceTracking {
+        static constexpr bool kEnabled = true;
+    };
+
+    //! \brief  Sentinel policy that does not guard allocations.
+    struct NoSentinels {
+        static constexpr bool kEnabled = false;
+    };
+
+    //! \brief  Sentinel policy that writes a sentinel into each allocation header and verifies it upon release.
+    struct HeaderSentinels {
+        static constexpr bool kEnabled = true;
+    };
+
+    constexpr size_t kStatisticsHistogramLength = 32;
+
+    //! \brief  Snapshot of the statistics recorded by a heap, the fields not recorded by its statistics policy are zero.
+    //!
+    //! Each histogram entry counts the values whose highest set bit is the index of the entry, so entry n counts values
+    //! from 2^n up to 2^(n+1) - 1, values of zero are counted by the first entry and the last entry counts every larger value.
+    struct HeapStats {
+        size_t allocations = 0;                                 // Number of live allocations
+        size_t totalAllocations = 0;                            // Number of allocations made during the lifetime of the heap
+        size_t failedAllocations = 0;                           // Number of allocation requests that could not be satisfied
+
+        size_t bytesInUse = 0;                                  // Bytes not held by free blocks, including headers and padding
+        size_t peakBytesInUse = 0;                              // Largest value of bytesInUse once an allocation was made
+        size_t overheadBytes = 0;                               // Bytes of header and alignment padding ahead of live allocations
+
+        size_t freeBytes = 0;                                   // Bytes held by free blocks
+        size_t freeBlocks = 0;                                  // Number of free blocks
+        size_t largestFreeBlock = 0;                            // Length (in bytes) of the largest free block
+        double fragmentation = 0;                               // Fraction of free bytes outside of the largest free block
+
+        size_t requestSizes[kStatisticsHistogramLength] = {};   // Histogram of the lengths (in bytes) of allocation requests
+        size_t searchLengths[kStatisticsHistogramLength] = {};  // Histogram of the free blocks visited by each search
+    };
+
+    namespace detail {
+        //! \brief Determines the histogram entry that counts a value.
+        //! \param value [in] - The value to be counted.
+        //! \returns Index of the histogram entry that counts the value.
+        inline size_t getHistogramBucket(size_t value) {
+            if (value < 2) {
+                return 0;
+            }
+
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+#else
+            const auto index = 63 - static_cast<size_t>(__builtin_clzll(value));
+#endif //defined(_MSC_VER)
+
+            return index < kStatisticsHistogramLength ? index : kStatisticsHistogramLength - 1;
+        }
+    }
+
+    //! \brief  Statistics policy that does not record any statistics, all counters report zero.
+    class NoStatistics {
+    public:
+        static constexpr bool kDetailed = false;
+
+        void recordAllocation(size_t) {}
+        void recordRelease(size_t) {}
+        void recordRelocation(size_t, size_t) {}
+        void recordFailure() {}
+
+        void recordRequest(size_t) {}
+        void recordSearch(size_t) {}
+
+        void recordGrowth(size_t) {}
+        void recordFreeBlockInserted(size_t) {}
+        void recordFreeBlockRemoved(size_t) {}
+
+        void getStats(HeapStats &) const {}
+
+        [[nodiscard]] size_t getAllocations() const { return 0; }
+        [[nodiscard]] size_t getTotalAllocations() const { return 0; }
+        [[nodiscard]] size_t getFailedAllocations() const { return 0; }
+    };
+
+    //! \brief  Statistics policy that counts live, total and failed allocations.
+    class AllocationCounters {
+    public:
+        static constexpr bool kDetailed = false;
+
+        AllocationCounters() : m_allocations(0), m_totalAllocations(0), m_failedAllocations(0) {
+
+        }
+
+        void recordAllocation(size_t) {
+            m_allocations++;
+            m_totalAllocations++;
+        }
+
+        void recordRelease(size_t) {
+            m_allocations--;
+        }
+
+        void recordRelocation(size_t, size_t) {}
+
+        void recordFailure() {
+            m_failedAllocations++;
+        }
+
+        void recordRequest(size_t) {}
+        void recordSearch(size_t) {}
+
+        void recordGrowth(size_t) {}
+        void recordFreeBlockInserted(size_t) {}
+        void recordFreeBlockRemoved(size_t) {}
+
+        void getStats(HeapStats &stats) const {
+            stats.allocations = m_allocations;
+            stats.totalAllocations = m_totalAllocations;
+            stats.failedAllocations = m_failedAllocations;
+        }
+
+        [[nodiscard]] size_t getAllocations() const { return m_allocations; }
+        [[nodiscard]] size_t getTotalAllocations() const { return m_totalAllocations; }
+        [[nodiscard]] size_t getFailedAllocations() const { return m_failedAllocations; }
+
+    private:
+        size_t m_allocations;
+        size_t m_totalAllocations;
+        size_t m_failedAllocations;
+    };
+
+    //! \brief  Statistics policy that also records occupancy, free blocks and histograms of requests and searches.
+    //!
+    //! Each operation costs a few additions, bytes in use are derived from the length of the heap and its free bytes.
+    class DetailedStatistics : public AllocationCounters {
+    public:
+        static constexpr bool kDetailed = true;
+
+        DetailedStatistics() : m_heapBytes(0), m_freeBytes(0), m_freeBlocks(0), m_peakBytesInUse(0), m_overheadBytes(0), m_requestSizes{}, m_searchLengths{} {
+
+        }
+
+        void recordAllocation(size_t overheadLength) {
+            AllocationCounters::recordAllocation(overheadLength);
+
+            m_overheadBytes += overheadLength;
+
+            const auto bytesInUse = m_heapBytes - m_freeBytes;
+            if (bytesInUse > m_peakBytesInUse) {
+                m_peakBytesInUse = bytesInUse;
+            }
+        }
+
+        void recordRelease(size_t overheadLength) {
+            AllocationCounters::recordRelease(overheadLength);
+            m_overheadBytes -= overheadLength;
+        }
+
+        void recordRelocation(size_t previousOverheadLength, size_t overheadLength) {
+            m_overheadBytes += overheadLength - previousOverheadLength;
+        }
+
+        void recordRequest(size_t dataLength) {
+            m_requestSizes[detail::getHistogramBucket(dataLength)]++;
+        }
+
+        void recordSearch(size_t searchLength) {
+            m_searchLengths[detail::getHistogramBucket(searchLength)]++;
+        }
+
+        void recordGrowth(size_t length) {
+            m_heapBytes += length;
+        }
+
+        void recordFreeBlockInserted(size_t length) {
+            m_freeBytes += length;
+            m_freeBlocks++;
+        }
+
+        void recordFreeBlockRemoved(size_t length) {
+            m_freeBytes -= length;
+            m_freeBlocks--;
+        }
+
+        void getStats(HeapStats &stats) const {
+            AllocationCounters::getStats(stats);
+
+            stats.bytesInUse = m_heapBytes - m_freeBytes;
+            stats.peakBytesInUse = m_peakBytesInUse;
+            stats.overheadBytes = m_overheadBytes;
+            stats.freeBytes = m_freeBytes;
+            stats.freeBlocks = m_freeBlocks;
+
+            for (size_t loop = 0; loop < kStatisticsHistogramLength; ++loop) {
+                stats.requestSizes[loop] = m_requestSizes[loop];
+                stats.searchLengths[loop] = m_searchLengths[loop];
+            }
+        }
+
+    private:
+        size_t m_heapBytes;
+        size_t m_freeBytes;
+        size_t m_freeBlocks;
+        size_t m_peakBytesInUse;
+        size_t m_overheadBytes;
+
+        size_t m_requestSizes[kStatisticsHistogramLength];
+        size_t m_searchLengths[kStatisticsHistogramLength];
+    };
+
+    //! \brief  Lock policy for heaps that are only used by a single thread at a time.
+    class NoLock {
+    public:
+        void lock() {}
+        void unlock() {}
+    };
+
+    //! \brief  Lock policy that serializes every operation on the heap with a mutex.
+    class MutexLock {
+    public:
+        void lock() { m_mutex.lock(); }
+        void unlock() { m_mutex.unlock(); }
+
+    private:
+        std::mutex m_mutex;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_HEAP_POLICIES_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,121 @@
+
+#if !defined(MEMORY_HEAP_PROFILER_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_HEAP_PROFILER_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "heap_policies.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    constexpr size_t kHeapProfileMaximumFrames = 16;
+
+    //! \brief  Allocations made at a single call site, estimated from the allocations sampled there.
+    //!
+    //! A call site is the source location supplied with an allocation when there is one, otherwise the return addresses
+    //! of the call stack that made it. Estimates weight each sample by the inverse of the probability it was sampled.
+    struct HeapProfileSite {
+        const char *fileName;                                   // Source file that made the allocations, null when identified by frames
+        size_t line;                                            // Line number within the source file
+        uintptr_t frames[kHeapProfileMaximumFrames];            // Return addresses of the call stack, innermost first
+        size_t frameCount;                                      // Number of return addresses held by frames
+        size_t samples;                                         // Number of allocations sampled at the site
+        size_t allocatedBytes;                                  // Estimated bytes allocated at the site since profiling began
+        size_t allocatedCount;                                  // Estimated number of allocations made at the site
+        size_t liveBytes;                                       // Estimated bytes allocated at the site and not yet released
+        size_t liveCount;                                       // Estimated number of allocations made at the site and not yet released
+        size_t sizes[kStatisticsHistogramLength];               // Histogram of the lengths (in bytes) of the sampled allocations
+    };
+
+    //! \brief  Samples the allocations made by heaps, building a table of the call sites responsible for them.
+    //!
+    //! A profiler is attached to a heap with setHeapProfiler. The heap counts down the bytes it allocates, sampling
+    //! the allocation that exhausts the count, and draws the next count from an exponential distribution whose mean is
+    //! the sample interval. Each byte is therefore sampled with equal probability, so large allocations are almost
+    //! always sampled while small ones rarely are, and allocations that are not sampled cost a single comparison.
+    //!
+    //! The site and sample tables are allocated when the profiler is initialized, so recording never allocates memory.
+    //! Samples beyond the capacity of either table are counted as dropped. Recording is serialized by the profiler,
+    //! so it may be shared between heaps, and the profile may be read or dumped while it is being recorded.
+    class HeapProfiler {
+    public:
+        static constexpr size_t kDefaultSampleInterval = 512 * 1024;
+        static constexpr size_t kDefaultSiteCapacity = 1024;
+        static constexpr size_t kDefaultSampleCapacity = 16 * 1024;
+
+        HeapProfiler();
+
+        HeapProfiler(const HeapProfiler &other) = delete;
+        HeapProfiler &operator=(const HeapProfiler &other) = delete;
+
+        bool initialize();
+        bool initialize(size_t sampleInterval);
+        bool initialize(size_t sampleInterval, size_t siteCapacity, size_t sampleCapacity);
+
+        [[nodiscard]] size_t nextSampleInterval();
+
+        void recordAllocation(const void *ptr, size_t dataLength, const char *fileName, size_t line);
+        void recordRelease(const void *ptr);
+        void recordRelocation(const void *ptr, const void *relocatedPtr);
+
+        [[nodiscard]] std::vector<HeapProfileSite> getSites() const;
+        bool dump(FILE *file) const;
+
+        [[nodiscard]] bool isInitialized() const;
+        [[nodiscard]] size_t getSampleInterval() const;
+        [[nodiscard]] size_t getSamples() const;
+        [[nodiscard]] size_t getLiveSamples() const;
+        [[nodiscard]] size_t getDroppedSamples() const;
+        [[nodiscard]] std::chrono::nanoseconds getElapsed() const;
+
+    private:
+        //! \brief  An allocation that was sampled and has not yet been released.
+        struct LiveSample {
+            const void *ptr;            // Address of the allocation, null while the slot is unused
+            size_t site;                // Index of the site that made the allocation
+            size_t bytes;               // Estimated bytes represented by the sample
+            size_t count;               // Estimated number of allocations represented by the sample
+        };
+
+        [[nodiscard]] size_t findSite(const char *fileName, size_t line, const uintptr_t *frames, size_t frameCount);
+        [[nodiscard]] size_t findSample(const void *ptr) const;
+        bool insertSample(const LiveSample &sample);
+        void removeSample(size_t slot);
+        void eraseSample(size_t slot);
+
+    private:
+        std::unique_ptr<HeapProfileSite[]> m_sites;
+        std::unique_ptr<uint32_t[]> m_siteIndex;
+        size_t m_siteCapacity;
+        size_t m_siteIndexMask;
+        size_t m_siteCount;
+
+        std::unique_ptr<LiveSample[]> m_liveSamples;
+        size_t m_sampleCapacity;
+        size_t m_sampleMask;
+        size_t m_liveSampleCount;
+
+        size_t m_sampleInterval;
+        uint64_t m_randomState;
+
+        size_t m_samples;
+        size_t m_droppedSamples;
+
+        std::chrono::steady_clock::time_point m_start;
+        mutable std::mutex m_mutex;
+    };
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_HEAP_PROFILER_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,87 @@
+
+#if !defined(MEMORY_HUGE_PAGE_BLOCK_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_HUGE_PAGE_BLOCK_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+#include "allocation_strategy.h"
+#include "virtual_memory.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Memory block allocated from the operating system, backed by huge pages where they are available.
+    //!
+    //! Large heaps touch many pages while searching free blocks and accessing objects, backing them with 2 MB pages
+    //! greatly reduces the number of TLB entries they require. The block first requests explicit huge pages, then
+    //! transparent huge pages, and finally falls back to standard pages. getBacking reports which was obtained.
+    //!
+    //! The block is returned to the operating system when released or destroyed, so any heap initialized over it
+    //! must be destroyed first.
+    class HugePageBlock {
+    public:
+        HugePageBlock();
+        ~HugePageBlock();
+
+        HugePageBlock(const HugePageBlock &other) = delete;
+        HugePageBlock &operator=(const HugePageBlock &other) = delete;
+
+        bool allocate(size_t blockSize);
+        bool allocate(size_t blockSize, kPageBacking backing);
+
+        void release();
+
+        template <typename THeap> bool initializeHeap(THeap &heap) const;
+        template <typename THeap> bool initializeHeap(THeap &heap, kAllocationStrategy allocationStrategy) const;
+
+        [[nodiscard]] void* getMemory() const;
+        [[nodiscard]] size_t getSize() const;
+        [[nodiscard]] kPageBacking getBacking() const;
+
+    private:
+        void *m_memoryBlock;
+        size_t m_blockSize;
+        kPageBacking m_backing;
+    };
+
+    //! \brief Prepares a heap for use over the memory of this block.
+    //! \param heap [in] - The heap to be initialized, it must be destroyed before this block is released.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    template <typename THeap> bool HugePageBlock::initializeHeap(THeap &heap) const {
+        return m_memoryBlock && heap.initialize(m_memoryBlock, m_blockSize);
+    }
+
+    //! \brief Prepares a heap for use over the memory of this block.
+    //! \param heap [in] - The heap to be initialized, it must be destroyed before this block is released.
+    //! \param allocationStrategy [in] - The allocation strategy to be used by the heap.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    template <typename THeap> bool HugePageBlock::initializeHeap(THeap &heap, kAllocationStrategy allocationStrategy) const {
+        return m_memoryBlock && heap.initialize(m_memoryBlock, m_blockSize, allocationStrategy);
+    }
+
+    //! \brief Retrieves the memory allocated by this block.
+    //! \returns Pointer to the start of the memory block, or null if it has not been allocated.
+    inline void *HugePageBlock::getMemory() const {
+        return m_memoryBlock;
+    }
+
+    //! \brief Retrieves the size of the memory allocated by this block.
+    //! \returns The size (in bytes) of the memory block, rounded up to a whole number of huge pages.
+    inline size_t HugePageBlock::getSize() const {
+        return m_blockSize;
+    }
+
+    //! \brief Retrieves the size of the pages backing the memory of this block.
+    //! \returns The page backing that was obtained, or kPageBacking::Invalid if the block has not been allocated.
+    inline kPageBacking HugePageBlock::getBacking() const {
+        return m_backing;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_HUGE_PAGE_BLOCK_HEADER_INCLUDED_STRANGE_SECRETS)
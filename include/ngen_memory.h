@@ -4,7 +4,12 @@
 
 ////////////////////////////////////////////////////////////////////////////
 
+#include "arena.h"
+#include "handle_heap.h"
 #include "heap.h"
+#include "heap_allocator.h"
+#include "concurrent_heap.h"
+#include "sub_heap.h"
 
 
 ////////////////////////////////////////////////////////////////////////////
@@ -70,6 +75,120 @@ inline void operator delete[](void *ptr, ngen::memory::Heap *heap, const char *f
     heap->deallocate(ptr, true, fileName, line);
 }
 
+inline void operator delete(void *ptr, size_t count, ngen::memory::Heap *heap) {
+    heap->deallocate(ptr, count, size_t(0));
+}
+
+inline void operator delete(void *ptr, size_t count, ngen::memory::Heap *heap, size_t alignment) {
+    heap->deallocate(ptr, count, alignment);
+}
+
+inline void operator delete[](void *ptr, size_t count, ngen::memory::Heap *heap) {
+    heap->deallocateArray(ptr, count, 0);
+}
+
+inline void operator delete[](void *ptr, size_t count, ngen::memory::Heap *heap, size_t alignment) {
+    heap->deallocateArray(ptr, count, alignment);
+}
+
+
+inline void* operator new(size_t count, ngen::memory::ConcurrentHeap *heap) {
+    return heap->alloc(count);
+}
+
+inline void* operator new(size_t count, ngen::memory::ConcurrentHeap *heap, size_t alignment) {
+    return heap->alignedAlloc(count, alignment);
+}
+
+inline void* operator new(size_t count, ngen::memory::ConcurrentHeap *heap, const char *fileName, size_t line) {
+    return heap->alloc(count, fileName, line);
+}
+
+inline void* operator new(size_t count, ngen::memory::ConcurrentHeap *heap, size_t alignment, const char *fileName, size_t line) {
+    return heap->alignedAlloc(count, alignment, fileName, line);
+}
+
+inline void* operator new[](size_t count, ngen::memory::ConcurrentHeap *heap) {
+    return heap->allocArray(count);
+}
+
+inline void* operator new[](size_t count, ngen::memory::ConcurrentHeap *heap, size_t alignment) {
+    return heap->alignedAllocArray(count, alignment);
+}
+
+inline void* operator new[](size_t count, ngen::memory::ConcurrentHeap *heap, const char *fileName, size_t line) {
+    return heap->allocArray(count, fileName, line);
+}
+
+inline void* operator new[](size_t count, ngen::memory::ConcurrentHeap *heap, size_t alignment, const char *fileName, size_t line) {
+    return heap->alignedAllocArray(count, alignment, fileName, line);
+}
+
+inline void operator delete(void *ptr, ngen::memory::ConcurrentHeap *heap) {
+    heap->deallocate(ptr, false, nullptr, 0);
+}
+
+inline void operator delete(void *ptr, ngen::memory::ConcurrentHeap *heap, const char *fileName, size_t line) {
+    heap->deallocate(ptr, false, fileName, line);
+}
+
+inline void operator delete[](void *ptr, ngen::memory::ConcurrentHeap *heap) {
+    heap->deallocate(ptr, true, nullptr, 0);
+}
+
+inline void operator delete[](void *ptr, ngen::memory::ConcurrentHeap *heap, const char *fileName, size_t line) {
+    heap->deallocate(ptr, true, fileName, line);
+}
+
+
+inline void* operator new(size_t count, ngen::memory::Arena *arena) {
+    return arena->alloc(count);
+}
+
+inline void* operator new(size_t count, ngen::memory::Arena *arena, size_t alignment) {
+    return arena->alignedAlloc(count, alignment);
+}
+
+inline void* operator new(size_t count, ngen::memory::Arena *arena, const char *fileName, size_t line) {
+    return arena->alloc(count, fileName, line);
+}
+
+inline void* operator new(size_t count, ngen::memory::Arena *arena, size_t alignment, const char *fileName, size_t line) {
+    return arena->alignedAlloc(count, alignment, fileName, line);
+}
+
+inline void* operator new[](size_t count, ngen::memory::Arena *arena) {
+    return arena->allocArray(count);
+}
+
+inline void* operator new[](size_t count, ngen::memory::Arena *arena, size_t alignment) {
+    return arena->alignedAllocArray(count, alignment);
+}
+
+inline void* operator new[](size_t count, ngen::memory::Arena *arena, const char *fileName, size_t line) {
+    return arena->allocArray(count, fileName, line);
+}
+
+inline void* operator new[](size_t count, ngen::memory::Arena *arena, size_t alignment, const char *fileName, size_t line) {
+    return arena->alignedAllocArray(count, alignment, fileName, line);
+}
+
+inline void operator delete(void *ptr, ngen::memory::Arena *arena) {
+    arena->deallocate(ptr, false, nullptr, 0);
+}
+
+inline void operator delete(void *ptr, ngen::memory::Arena *arena, const char *fileName, size_t line) {
+    arena->deallocate(ptr, false, fileName, line);
+}
+
+inline void operator delete[](void *ptr, ngen::memory::Arena *arena) {
+    arena->deallocate(ptr, true, nullptr, 0);
+}
+
+inline void operator delete[](void *ptr, ngen::memory::Arena *arena, const char *fileName, size_t line) {
+    arena->deallocate(ptr, true, fileName, line);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,126 @@
+
+#if !defined(MEMORY_RING_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_RING_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Allocator for data that is released in roughly the order it was allocated, such as streamed messages.
+    //!
+    //! Allocations are made at the head of a circular buffer and reclaimed from its tail, so neither requires any
+    //! search. An allocation released before older allocations is recorded as an out of order release, its memory
+    //! is reclaimed once every older allocation has also been released.
+    //!
+    //! An allocation that does not fit before the end of the buffer normally skips the remaining space and is made
+    //! from the start of the buffer. Where supported, initializeMirrored maps the same memory twice back to back,
+    //! so an allocation may run past the end of the buffer and still be contiguous.
+    class RingAllocator {
+    public:
+        static constexpr size_t kDefaultAlignment = 16;
+        static constexpr size_t kMaximumAlignment = 4096;
+
+        RingAllocator();
+        ~RingAllocator();
+
+        RingAllocator(const RingAllocator &other) = delete;
+        RingAllocator &operator=(const RingAllocator &other) = delete;
+
+        bool initialize(void *memoryBlock, size_t blockSize);
+        bool initializeMirrored(size_t blockSize);
+
+        [[nodiscard]] void* alloc(size_t dataLength);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment);
+
+        bool deallocate(void *ptr);
+
+        [[nodiscard]] bool owns(const void *ptr) const;
+        [[nodiscard]] bool isMirrored() const;
+
+        [[nodiscard]] size_t getSize() const;
+        [[nodiscard]] size_t getUsed() const;
+        [[nodiscard]] size_t getAllocations() const;
+        [[nodiscard]] size_t getFailedAllocations() const;
+        [[nodiscard]] size_t getOutOfOrderReleases() const;
+
+        [[nodiscard]] static bool isMirroringSupported();
+
+    private:
+        struct Record {
+            size_t length;      // Length (in bytes) of the record, including this header
+            size_t state;       // Whether the record is live, released or skipped padding
+        };
+
+        [[nodiscard]] Record* getRecord(size_t position) const;
+        void writeSkipRecord(size_t position, size_t length);
+        void reclaimRecords();
+
+        void releaseMirror();
+
+    private:
+        uintptr_t m_memoryBlock;
+        size_t m_capacity;
+
+        size_t m_head;
+        size_t m_tail;
+
+        bool m_isMirrored;
+
+        size_t m_allocations;
+        size_t m_failedAllocations;
+        size_t m_outOfOrderReleases;
+    };
+
+    //! \brief Determines whether or not a pointer lies within the memory managed by the allocator.
+    //! \param ptr [in] - The pointer to be tested.
+    //! \returns True if the pointer lies within the buffer, or its mirror, otherwise false.
+    inline bool RingAllocator::owns(const void *ptr) const {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return address >= m_memoryBlock && address < m_memoryBlock + (m_isMirrored ? m_capacity * 2 : m_capacity);
+    }
+
+    //! \brief Determines whether or not the buffer is mapped twice, so that allocations may wrap around its end.
+    //! \returns True if the allocator was prepared by initializeMirrored otherwise false.
+    inline bool RingAllocator::isMirrored() const {
+        return m_isMirrored;
+    }
+
+    //! \brief Retrieves the total size of the buffer.
+    //! \returns The size (in bytes) of the buffer managed by this allocator.
+    inline size_t RingAllocator::getSize() const {
+        return m_capacity;
+    }
+
+    //! \brief Retrieves the number of bytes between the tail and the head of the buffer.
+    //! \returns The number of bytes that are not available for allocation, including headers and padding.
+    inline size_t RingAllocator::getUsed() const {
+        return m_head - m_tail;
+    }
+
+    //! \brief Retrieves the number of allocations that are currently live within the allocator.
+    //! \returns The number of allocations currently still live within the allocator.
+    inline size_t RingAllocator::getAllocations() const {
+        return m_allocations;
+    }
+
+    //! \brief Retrieves the number of allocation requests that have been requested but failed.
+    //! \returns The number of allocation requests that have been failed by this allocator.
+    inline size_t RingAllocator::getFailedAllocations() const {
+        return m_failedAllocations;
+    }
+
+    //! \brief Retrieves the number of allocations that were released while an older allocation was still live.
+    //! \returns The number of out of order releases made during the lifetime of the allocator.
+    inline size_t RingAllocator::getOutOfOrderReleases() const {
+        return m_outOfOrderReleases;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_RING_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,130 @@
+
+#if !defined(MEMORY_SCAVENGER_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_SCAVENGER_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Limits applied to the passes made by a Scavenger.
+    struct ScavengerLimits {
+        size_t minimumBlockSize = 256 * 1024;                   // Free blocks smaller than this are not scavenged
+        size_t maximumBytesPerPass = 16 * 1024 * 1024;          // Number of bytes after which a pass stops scavenging
+        std::chrono::milliseconds interval{100};                // Delay between the passes made by the background thread
+    };
+
+    //! \brief  Periodically returns the pages within large free blocks of a heap to the operating system.
+    //!
+    //! Passes are made either inline through scavenge, or by a background thread between start and stop. Each pass
+    //! discards at most maximumBytesPerPass, and the background thread waits for the interval between passes, so
+    //! scavenging does not hold the heap's lock for long while it is in active use.
+    //!
+    //! \tparam THeap - The type of heap to be scavenged, it must be thread safe if the background thread is used,
+    //!                 such as a ConcurrentHeap or a BasicHeap using the MutexLock policy.
+    template <typename THeap>
+    class Scavenger {
+    public:
+        explicit Scavenger(THeap &heap) : m_heap(heap), m_isStopping(false) {
+
+        }
+
+        ~Scavenger() {
+            stop();
+        }
+
+        Scavenger(const Scavenger &other) = delete;
+        Scavenger &operator=(const Scavenger &other) = delete;
+
+        bool start(const ScavengerLimits &limits);
+        void stop();
+
+        size_t scavenge();
+
+        [[nodiscard]] bool isRunning() const;
+        [[nodiscard]] const ScavengerLimits& getLimits() const;
+
+    private:
+        void run();
+
+    private:
+        THeap &m_heap;
+        ScavengerLimits m_limits;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_isStopping;
+    };
+
+    //! \brief Starts a background thread that scavenges the heap until stop is called.
+    //! \param limits [in] - The limits applied to each pass made by the background thread.
+    //! \returns True if the background thread was started otherwise false, if it is already running.
+    template <typename THeap> bool Scavenger<THeap>::start(const ScavengerLimits &limits) {
+        if (m_thread.joinable()) {
+            return false;
+        }
+
+        m_limits = limits;
+        m_isStopping = false;
+        m_thread = std::thread(&Scavenger::run, this);
+
+        return true;
+    }
+
+    //! \brief Stops the background thread, waiting for any pass it is making to complete.
+    template <typename THeap> void Scavenger<THeap>::stop() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+
+        m_wake.notify_all();
+        m_thread.join();
+    }
+
+    //! \brief Makes a single pass over the heap on the calling thread.
+    //! \returns The number of bytes that were returned to the operating system.
+    template <typename THeap> size_t Scavenger<THeap>::scavenge() {
+        return m_heap.scavenge(m_limits.minimumBlockSize, m_limits.maximumBytesPerPass);
+    }
+
+    //! \brief Determines whether or not the background thread is running.
+    //! \returns True if the background thread has been started and not stopped otherwise false.
+    template <typename THeap> bool Scavenger<THeap>::isRunning() const {
+        return m_thread.joinable();
+    }
+
+    //! \brief Retrieves the limits applied to each pass.
+    //! \returns Reference to the limits applied to each pass made by this scavenger.
+    template <typename THeap> const ScavengerLimits& Scavenger<THeap>::getLimits() const {
+        return m_limits;
+    }
+
+    //! \brief Entry point of the background thread, makes a pass each interval until the scavenger is stopped.
+    template <typename THeap> void Scavenger<THeap>::run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (!m_wake.wait_for(lock, m_limits.interval, [this] { return m_isStopping; })) {
+            lock.unlock();
+            scavenge();
+            lock.lock();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_SCAVENGER_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,57 @@
+
+#if !defined(MEMORY_SIZE_TREE_INDEX_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_SIZE_TREE_INDEX_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    struct FreeBlock;
+
+    //! \brief  Size ordered index over the free blocks of a heap.
+    //!
+    //! The index is an AVL tree whose nodes are embedded within the free blocks themselves, ordered by size and then
+    //! by address. This allows the smallest block of at least a given size to be located in logarithmic time.
+    class SizeTreeIndex {
+    public:
+        SizeTreeIndex();
+        ~SizeTreeIndex() = default;
+
+        SizeTreeIndex(const SizeTreeIndex &other) = delete;
+        SizeTreeIndex &operator=(const SizeTreeIndex &other) = delete;
+
+        void insert(FreeBlock *block);
+        void remove(FreeBlock *block);
+
+        [[nodiscard]] FreeBlock* lowerBound(size_t blockLength) const;
+        [[nodiscard]] static FreeBlock* successor(FreeBlock *block);
+        [[nodiscard]] FreeBlock* getLargest() const;
+
+        [[nodiscard]] size_t getCount() const;
+
+    private:
+        void replaceChild(FreeBlock *parent, FreeBlock *oldChild, FreeBlock *newChild);
+        FreeBlock* rotateLeft(FreeBlock *block);
+        FreeBlock* rotateRight(FreeBlock *block);
+        void rebalance(FreeBlock *block);
+
+    private:
+        FreeBlock *m_root;
+        size_t m_count;
+    };
+
+    //! \brief Retrieves the number of free blocks within the index.
+    //! \returns The number of free blocks currently stored within the index.
+    inline size_t SizeTreeIndex::getCount() const {
+        return m_count;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_SIZE_TREE_INDEX_HEADER_INCLUDED_STRANGE_SECRETS)
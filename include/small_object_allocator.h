@@ -0,0 +1,130 @@
+
+#if !defined(MEMORY_SMALL_OBJECT_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_SMALL_OBJECT_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Size-class allocator that serves small fixed size objects from pages carved out of a single region.
+    //!
+    //! The region is divided into fixed size pages, each page is assigned to a single size class when it is first
+    //! required and objects are then served from an intrusive free list within the page. Allocation and release are
+    //! both constant time and objects carry no per-allocation header.
+    //!
+    //! Each page descriptor holds a bit per object recording whether it is live and whether it was allocated as an
+    //! array, so that releases of free objects and array mismatches are rejected as they are for heap blocks. Only
+    //! queueRelease may be called by a thread other than the one using the allocator, it claims a third bit so that
+    //! an object cannot be queued twice.
+    class SmallObjectAllocator {
+    public:
+        static constexpr size_t kPageSize = 4096;
+        static constexpr size_t kPageAlignment = 64;
+        static constexpr size_t kSizeClassCount = 8;
+        static constexpr size_t kMaximumObjectSize = 128;
+        static constexpr size_t kMaximumPageObjects = kPageSize / 8;
+
+        SmallObjectAllocator();
+        ~SmallObjectAllocator() = default;
+
+        SmallObjectAllocator(const SmallObjectAllocator &other) = delete;
+        SmallObjectAllocator &operator=(const SmallObjectAllocator &other) = delete;
+
+        bool initialize(void *memoryBlock, size_t blockSize);
+
+        [[nodiscard]] void* alloc(size_t dataLength, size_t alignment, bool isArray);
+        bool deallocate(void *ptr, bool isArray);
+
+        [[nodiscard]] bool queueRelease(const void *ptr, bool isArray);
+        bool releaseQueued(void *ptr);
+
+        [[nodiscard]] bool owns(const void *ptr) const;
+        [[nodiscard]] size_t getObjectSize(const void *ptr) const;
+        [[nodiscard]] bool isArrayObject(const void *ptr) const;
+
+        [[nodiscard]] size_t getPageCount() const;
+        [[nodiscard]] size_t getFreePageCount() const;
+        [[nodiscard]] size_t getAllocations() const;
+
+        [[nodiscard]] static size_t getSizeClassLength(size_t sizeClass);
+
+    private:
+        struct FreeObject {
+            FreeObject *next;
+        };
+
+        using ObjectMask = std::atomic<uint64_t>[kMaximumPageObjects / 64];
+
+        struct Page {
+            FreeObject *freeList;         // Objects that have been released back to this page
+            Page *previous;               // Previous page in the owning list
+            Page *next;                   // Next page in the owning list
+            uint32_t sizeClass;           // Index of the size class this page is currently serving
+            uint32_t used;                // Number of live objects within the page
+            uint32_t capacity;            // Total number of objects the page is able to hold
+            uint32_t bumpIndex;           // Index of the first object that has never been handed out
+            ObjectMask liveObjects;       // Objects that are currently allocated
+            ObjectMask arrayObjects;      // Objects that were allocated as arrays
+            ObjectMask queuedObjects;     // Live objects claimed by queueRelease and not yet released
+        };
+
+        [[nodiscard]] Page* getPage(const void *ptr) const;
+        [[nodiscard]] bool getObjectIndex(const Page *page, const void *ptr, size_t &index) const;
+        void releaseObject(Page *page, void *ptr, size_t index);
+        [[nodiscard]] uintptr_t getPageAddress(const Page *page) const;
+
+        [[nodiscard]] Page* acquirePage(size_t sizeClass);
+        void releasePage(Page *page);
+
+        static void pushPage(Page *&list, Page *page);
+        static void removePage(Page *&list, Page *page);
+
+    private:
+        Page *m_pages;
+        Page *m_freePages;
+        Page *m_partialPages[kSizeClassCount];
+
+        uintptr_t m_firstPage;
+        uintptr_t m_lastPage;
+
+        size_t m_pageCount;
+        size_t m_freePageCount;
+        size_t m_allocations;
+    };
+
+    //! \brief Determines whether or not a pointer lies within the page region managed by this allocator.
+    //! \param ptr [in] - The pointer to be tested.
+    //! \returns True if the pointer was served by this allocator otherwise false.
+    inline bool SmallObjectAllocator::owns(const void *ptr) const {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return address >= m_firstPage && address < m_lastPage;
+    }
+
+    //! \brief Retrieves the number of pages available to the allocator.
+    //! \returns The total number of pages within the region managed by this allocator.
+    inline size_t SmallObjectAllocator::getPageCount() const {
+        return m_pageCount;
+    }
+
+    //! \brief Retrieves the number of pages not currently assigned to a size class.
+    //! \returns The number of pages that are unused and available to any size class.
+    inline size_t SmallObjectAllocator::getFreePageCount() const {
+        return m_freePageCount;
+    }
+
+    //! \brief Retrieves the number of objects that are currently live within the allocator.
+    //! \returns The number of objects currently still live within the allocator.
+    inline size_t SmallObjectAllocator::getAllocations() const {
+        return m_allocations;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_SMALL_OBJECT_ALLOCATOR_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,211 @@
+
+#if !defined(MEMORY_SUB_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_SUB_HEAP_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "heap.h"
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  Determines how a SubHeap behaves once its budget has been exhausted.
+    enum class kBudgetPolicy {
+        FailFast,                   // Allocations that do not fit within the budget fail
+        FallbackToParent,           // Allocations that do not fit within the budget are made from the parent heap
+    };
+
+    //! \brief  Heap carved from a region of a parent heap, accounting for the memory used by a single subsystem.
+    //!
+    //! The region is allocated from the parent when the sub heap is initialized, and its length is the budget of the
+    //! sub heap. Each allocation and release updates a fixed set of counters, so the memory in use by the subsystem
+    //! named by the tag is known at any time without walking the heap. Once the region is exhausted, allocations either
+    //! fail or are made from the parent, where they are counted separately so that overspending remains visible.
+    //!
+    //! The whole region is returned to the parent by release, or when the sub heap is destroyed, regardless of the
+    //! allocations it still holds. Allocations made from the parent remain valid after release, and may still be
+    //! released through the sub heap, which records them so that allocations of other users of the parent are
+    //! rejected. Destroying the sub heap returns them to the parent. Neither the parent nor the sub heap is thread safe,
+    //! so both must be used from a single thread.
+    class SubHeap {
+    public:
+        SubHeap();
+        ~SubHeap();
+
+        SubHeap(const SubHeap &other) = delete;
+        SubHeap &operator=(const SubHeap &other) = delete;
+
+        bool initialize(Heap &parent, const char *tag, size_t budget, kBudgetPolicy budgetPolicy);
+        bool initialize(Heap &parent, const char *tag, size_t budget, kBudgetPolicy budgetPolicy, kAllocationStrategy allocationStrategy);
+
+        size_t release();
+
+        [[nodiscard]] void* alloc(size_t dataLength);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment);
+
+        [[nodiscard]] void* alloc(size_t dataLength, const char *fileName, size_t line);
+        [[nodiscard]] void* alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+
+        bool deallocate(void *ptr, bool isArray, const char *fileName, size_t line);
+
+        [[nodiscard]] bool owns(const void *ptr) const;
+        [[nodiscard]] bool isInitialized() const;
+
+        [[nodiscard]] const char* getTag() const;
+        [[nodiscard]] size_t getBudget() const;
+        [[nodiscard]] kBudgetPolicy getBudgetPolicy() const;
+
+        [[nodiscard]] size_t getBytesInUse() const;
+        [[nodiscard]] size_t getPeakBytesInUse() const;
+        [[nodiscard]] size_t getAllocations() const;
+        [[nodiscard]] size_t getTotalAllocations() const;
+        [[nodiscard]] size_t getFailedAllocations() const;
+        [[nodiscard]] size_t getFallbackAllocations() const;
+        [[nodiscard]] size_t getFallbackBytes() const;
+        [[nodiscard]] size_t getTotalFallbackAllocations() const;
+
+        [[nodiscard]] Heap* getParent() const;
+        [[nodiscard]] const Heap* getHeap() const;
+
+    private:
+        //! \brief Record stored at the end of each allocation made from the parent, linking it to the sub heap.
+        struct FallbackAllocation {
+            SubHeap *owner;                 // The sub heap that made the allocation, null once it has been released
+            void *address;                  // Address of the allocation returned to the application
+            FallbackAllocation *previous;   // Previous allocation made from the parent by the same sub heap
+            FallbackAllocation *next;       // Next allocation made from the parent by the same sub heap
+        };
+
+        static constexpr size_t kFallbackOverhead = sizeof(FallbackAllocation) + alignof(FallbackAllocation) - 1;
+
+        [[nodiscard]] void* allocate(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+        [[nodiscard]] void* allocateFallback(size_t dataLength, size_t alignment, const char *fileName, size_t line);
+        void recordAllocation(size_t usableSize);
+
+        [[nodiscard]] static FallbackAllocation* locateFallback(const void *ptr, size_t usableSize);
+        [[nodiscard]] FallbackAllocation* findFallback(const void *ptr, size_t usableSize) const;
+        void linkFallback(FallbackAllocation *fallback);
+        void unlinkFallback(FallbackAllocation *fallback);
+
+    private:
+        std::optional<Heap> m_heap;
+        Heap *m_parent;
+        void *m_region;
+        const char *m_tag;
+        size_t m_budget;
+        kBudgetPolicy m_budgetPolicy;
+        FallbackAllocation *m_fallbacks;
+
+        size_t m_bytesInUse;
+        size_t m_peakBytesInUse;
+        size_t m_allocations;
+        size_t m_totalAllocations;
+        size_t m_failedAllocations;
+        size_t m_fallbackAllocations;
+        size_t m_fallbackBytes;
+        size_t m_totalFallbackAllocations;
+    };
+
+    //! \brief Determines whether or not an address lies within the region of the sub heap.
+    //! \param ptr [in] - The address to be tested.
+    //! \returns True if the address lies within the region otherwise false, allocations made from the parent are not owned.
+    inline bool SubHeap::owns(const void *ptr) const {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        const auto start = reinterpret_cast<uintptr_t>(m_region);
+
+        return m_region && address >= start && address < start + m_budget;
+    }
+
+    //! \brief Determines whether or not the sub heap holds a region of its parent.
+    //! \returns True if the sub heap has been initialized and not yet released otherwise false.
+    inline bool SubHeap::isInitialized() const {
+        return m_region != nullptr;
+    }
+
+    //! \brief Retrieves the tag naming the subsystem the sub heap accounts for.
+    //! \returns The tag supplied when the sub heap was initialized, or null if it has never been initialized.
+    inline const char* SubHeap::getTag() const {
+        return m_tag;
+    }
+
+    //! \brief Retrieves the length of the region allocated from the parent.
+    //! \returns The budget (in bytes) of the sub heap, which includes the overhead of its allocations.
+    inline size_t SubHeap::getBudget() const {
+        return m_budget;
+    }
+
+    //! \brief Retrieves the behaviour of the sub heap once its budget has been exhausted.
+    //! \returns The budget policy supplied when the sub heap was initialized.
+    inline kBudgetPolicy SubHeap::getBudgetPolicy() const {
+        return m_budgetPolicy;
+    }
+
+    //! \brief Retrieves the number of bytes held by the live allocations, including those made from the parent.
+    //! \returns The total usable length (in bytes) of the allocations that have been made but not yet released.
+    inline size_t SubHeap::getBytesInUse() const {
+        return m_bytesInUse;
+    }
+
+    //! \brief Retrieves the largest number of bytes that have been held by the live allocations at once.
+    //! \returns The peak usable length (in bytes) of the allocations made through the sub heap.
+    inline size_t SubHeap::getPeakBytesInUse() const {
+        return m_peakBytesInUse;
+    }
+
+    //! \brief Retrieves the number of allocations that are currently live, including those made from the parent.
+    //! \returns The number of allocations that have been made but not yet released.
+    inline size_t SubHeap::getAllocations() const {
+        return m_allocations;
+    }
+
+    //! \brief Retrieves the number of allocations made during the lifetime of the sub heap.
+    //! \returns The number of allocation requests that succeeded.
+    inline size_t SubHeap::getTotalAllocations() const {
+        return m_totalAllocations;
+    }
+
+    //! \brief Retrieves the number of allocation requests that have been requested but failed.
+    //! \returns The number of allocations that could be made from neither the region nor, where permitted, the parent.
+    inline size_t SubHeap::getFailedAllocations() const {
+        return m_failedAllocations;
+    }
+
+    //! \brief Retrieves the number of live allocations that were made from the parent once the budget was exhausted.
+    //! \returns The number of allocations made from the parent that have not yet been released.
+    inline size_t SubHeap::getFallbackAllocations() const {
+        return m_fallbackAllocations;
+    }
+
+    //! \brief Retrieves the number of bytes held by the live allocations that were made from the parent.
+    //! \returns The usable length (in bytes) of the allocations made beyond the budget that have not yet been released.
+    inline size_t SubHeap::getFallbackBytes() const {
+        return m_fallbackBytes;
+    }
+
+    //! \brief Retrieves the number of allocations made from the parent during the lifetime of the sub heap.
+    //! \returns The number of allocation requests that exceeded the budget and were served by the parent.
+    inline size_t SubHeap::getTotalFallbackAllocations() const {
+        return m_totalFallbackAllocations;
+    }
+
+    //! \brief Retrieves the heap the region was allocated from.
+    //! \returns Pointer to the parent heap, or null if the sub heap has never been initialized.
+    inline Heap* SubHeap::getParent() const {
+        return m_parent;
+    }
+
+    //! \brief Retrieves the heap that manages the region, for access to its statistics.
+    //! \returns Pointer to the heap managing the region, or null if the sub heap does not hold a region.
+    inline const Heap* SubHeap::getHeap() const {
+        return m_heap ? &*m_heap : nullptr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_SUB_HEAP_HEADER_INCLUDED_STRANGE_SECRETS)
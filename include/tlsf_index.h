@@ -0,0 +1,70 @@
+
+#if !defined(MEMORY_TLSF_INDEX_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_TLSF_INDEX_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    struct FreeBlock;
+
+    //! \brief  Two-level segregated fit index over the free blocks of a heap.
+    //!
+    //! Free blocks are grouped into lists by size, the first level splits sizes by power of two and the second level
+    //! divides each power of two into linear ranges. A bitmap is kept for each level so a list containing a suitable
+    //! block can be located with a pair of bit scans, regardless of the number of free blocks.
+    //!
+    //! The list heads and second level bitmaps are stored in a control block supplied by the owner, which allows
+    //! the index to be sized according to the length of the heap it describes.
+    class TlsfIndex {
+    public:
+        static constexpr size_t kSecondLevelLog2 = 4;
+        static constexpr size_t kSecondLevelCount = 1 << kSecondLevelLog2;
+        static constexpr size_t kFirstLevelShift = kSecondLevelLog2 + 3;
+        static constexpr size_t kSmallBlockSize = 1 << kFirstLevelShift;
+        static constexpr size_t kMaximumFirstLevelCount = 64;
+
+        TlsfIndex();
+        ~TlsfIndex() = default;
+
+        TlsfIndex(const TlsfIndex &other) = delete;
+        TlsfIndex &operator=(const TlsfIndex &other) = delete;
+
+        [[nodiscard]] static size_t getControlLength(size_t heapLength);
+
+        bool initialize(void *control, size_t heapLength);
+
+        void insert(FreeBlock *block);
+        void remove(FreeBlock *block);
+
+        [[nodiscard]] FreeBlock* find(size_t blockLength) const;
+        [[nodiscard]] FreeBlock* findLargest() const;
+
+        [[nodiscard]] size_t getFirstLevelCount() const;
+
+    private:
+        [[nodiscard]] static size_t getFirstLevelCount(size_t heapLength);
+        static void mapping(size_t blockLength, size_t &firstLevel, size_t &secondLevel);
+
+    private:
+        uint64_t m_firstLevelBitmap;
+        uint32_t *m_secondLevelBitmaps;
+        FreeBlock **m_heads;
+        size_t m_firstLevelCount;
+    };
+
+    //! \brief Retrieves the number of first level size ranges tracked by the index.
+    //! \returns The number of first level size ranges tracked by the index.
+    inline size_t TlsfIndex::getFirstLevelCount() const {
+        return m_firstLevelCount;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_TLSF_INDEX_HEADER_INCLUDED_STRANGE_SECRETS)
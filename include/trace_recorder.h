@@ -0,0 +1,118 @@
+
+#if !defined(MEMORY_TRACE_RECORDER_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_TRACE_RECORDER_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    //! \brief  The operations that are recorded within an allocation trace.
+    enum class kTraceEvent : uint8_t {
+        Invalid,
+        Allocate,                   // An allocation was requested, the handle is zero if it failed
+        Deallocate,                 // An allocation was released
+        Resize,                     // An allocation was resized in place, a resize that moves records Allocate and Deallocate
+    };
+
+    constexpr uint8_t kTraceEventArray = 1;             // The allocation was made or released as an array
+
+    //! \brief  A single operation within an allocation trace, as stored within a trace file.
+    struct TraceEvent {
+        uint64_t timestamp;         // Nanoseconds elapsed between the recorder being opened and the operation
+        uint64_t handle;            // Identifies the allocation, unique among the allocations live at the same time
+        uint64_t size;              // Length (in bytes) requested by the operation
+        uint32_t alignment;         // Alignment (in bytes) requested by the operation
+        kTraceEvent type;           // The operation that was made
+        uint8_t flags;              // Combination of the kTraceEvent flags, such as kTraceEventArray
+        uint16_t reserved;
+    };
+
+    static_assert(32 == sizeof(TraceEvent), "TraceEvent is stored directly within trace files");
+
+    //! \brief  Header stored at the start of every trace file.
+    struct TraceFileHeader {
+        uint32_t magic;             // Identifies the file as an allocation trace
+        uint32_t version;           // Version of the trace file format
+        uint32_t eventLength;       // Length (in bytes) of each event within the file
+        uint32_t reserved;
+    };
+
+    //! \brief  Records the operations made on a heap into a ring of events, which is written to a file whenever it fills.
+    //!
+    //! A recorder is attached to a heap with setTraceRecorder, the heap then records each allocation and release it
+    //! makes. Handles are the addresses of the allocations, which are unique among live allocations, so replaying a
+    //! trace only requires a mapping from each live handle to the allocation made by the replay. Recording is
+    //! serialized by the recorder, so it may be attached to heaps that release allocations from several threads.
+    class TraceRecorder {
+    public:
+        static constexpr size_t kDefaultCapacity = 4096;
+        static constexpr uint32_t kMagic = 0x5254474e;     // 'NGTR'
+        static constexpr uint32_t kVersion = 1;
+
+        TraceRecorder();
+        ~TraceRecorder();
+
+        TraceRecorder(const TraceRecorder &other) = delete;
+        TraceRecorder &operator=(const TraceRecorder &other) = delete;
+
+        bool open(const char *path);
+        bool open(const char *path, size_t capacity);
+        void close();
+
+        bool flush();
+
+        void record(kTraceEvent type, const void *ptr, size_t size, size_t alignment, bool isArray);
+
+        [[nodiscard]] bool isOpen() const;
+        [[nodiscard]] size_t getCapacity() const;
+        [[nodiscard]] size_t getRecordedEvents() const;
+        [[nodiscard]] size_t getFailedWrites() const;
+
+    private:
+        bool writeEvents();
+
+    private:
+        FILE *m_file;
+        std::unique_ptr<TraceEvent[]> m_events;
+        size_t m_capacity;
+        size_t m_count;
+
+        std::chrono::steady_clock::time_point m_start;
+        mutable std::mutex m_mutex;
+
+        size_t m_recordedEvents;
+        size_t m_failedWrites;
+    };
+
+    //! \brief  Reads the events stored within a trace file written by TraceRecorder.
+    class TraceReader {
+    public:
+        TraceReader();
+        ~TraceReader();
+
+        TraceReader(const TraceReader &other) = delete;
+        TraceReader &operator=(const TraceReader &other) = delete;
+
+        bool open(const char *path);
+        void close();
+
+        bool next(TraceEvent &event);
+
+    private:
+        FILE *m_file;
+    };
+
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_TRACE_RECORDER_HEADER_INCLUDED_STRANGE_SECRETS)
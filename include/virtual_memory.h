@@ -0,0 +1,50 @@
+
+#if !defined(MEMORY_VIRTUAL_MEMORY_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_VIRTUAL_MEMORY_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace ngen::memory {
+    constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    //! \brief  Enumeration defining the size of the pages that back a range of memory.
+    enum class kPageBacking {
+        Invalid,
+
+        //! \brief  Memory is backed by pages of the default size.
+        Standard,
+
+        //! \brief  Transparent huge pages were requested for the memory, the kernel may still back parts of it with standard pages.
+        Transparent,
+
+        //! \brief  Memory is backed by huge pages from the pool reserved by the system, using MAP_HUGETLB.
+        HugeTLB
+    };
+
+    //! \brief  Thin wrappers around the virtual memory interface of the operating system.
+    //!
+    //! Address space is reserved without being backed by memory, pages within the reservation are then committed
+    //! as they are required. Alternatively allocate commits a range in a single step, optionally backed by huge pages.
+    //! Addresses and lengths supplied to these functions must be multiples of the page size.
+    namespace VirtualMemory {
+        [[nodiscard]] size_t getPageSize();
+
+        [[nodiscard]] void* reserve(size_t length);
+        void release(void *address, size_t length);
+
+        bool commit(void *address, size_t length);
+        bool discard(void *address, size_t length);
+
+        [[nodiscard]] void* allocate(size_t length, kPageBacking backing, kPageBacking *result);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_VIRTUAL_MEMORY_HEADER_INCLUDED_STRANGE_SECRETS)
@@ -0,0 +1,412 @@
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include "concurrent_heap.h"
+#include "virtual_memory.h"
+
+namespace {
+    constexpr size_t kDefaultReserveLength = size_t(64) * 1024 * 1024 * 1024;
+    constexpr size_t kCommitLength = 4 * 1024 * 1024;
+    constexpr size_t kBootstrapLength = 256 * 1024;
+    constexpr size_t kFundamentalAlignment = alignof(std::max_align_t);
+
+    //! \brief  Header stored ahead of each bootstrap allocation, recording its length for realloc and malloc_usable_size.
+    struct BootstrapAllocation {
+        size_t dataLength;
+    };
+
+    // Allocations made while the heap is being initialized are carved from this buffer, and are never reclaimed.
+    alignas(kFundamentalAlignment) unsigned char bootstrapBuffer[kBootstrapLength];
+    std::atomic<size_t> bootstrapOffset(0);
+
+    // The heap lives in static storage and is never destroyed, as allocations are released until the process exits.
+    alignas(ngen::memory::ConcurrentHeap) unsigned char heapStorage[sizeof(ngen::memory::ConcurrentHeap)];
+    std::atomic<ngen::memory::ConcurrentHeap *> heapInstance(nullptr);
+    std::atomic<bool> isInitializing(false);
+
+    //! \brief Writes a message to the standard error stream and terminates the process, without allocating memory.
+    //! \param message [in] - The message to be written.
+    [[noreturn]] void fatalError(const char *message) {
+        auto result = write(STDERR_FILENO, message, strlen(message));
+        (void)result;
+
+        abort();
+    }
+
+    //! \brief Retrieves the length of address space reserved by the heap, which may be set through NGEN_MALLOC_RESERVE.
+    //! \returns The length (in bytes) of the address space to be reserved.
+    size_t getReserveLength() {
+        auto value = getenv("NGEN_MALLOC_RESERVE");
+        if (value) {
+            const auto reserveLength = strtoull(value, nullptr, 10);
+
+            if (reserveLength) {
+                return static_cast<size_t>(reserveLength);
+            }
+        }
+
+        return kDefaultReserveLength;
+    }
+
+    //! \brief Determines whether or not an allocation was made from the bootstrap buffer.
+    //! \param ptr [in] - Pointer to the allocation to be tested.
+    //! \returns True if the allocation lies within the bootstrap buffer otherwise false.
+    inline bool isBootstrapAllocation(const void *ptr) {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        const auto start = reinterpret_cast<uintptr_t>(bootstrapBuffer);
+
+        return address >= start && address < start + kBootstrapLength;
+    }
+
+    //! \brief Allocates memory from the bootstrap buffer, used while the heap is being initialized.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, must be a power of two.
+    //! \returns Pointer to the allocated memory block, or null if the bootstrap buffer has been exhausted.
+    void *allocateBootstrap(size_t dataLength, size_t alignment) {
+        if (alignment < kFundamentalAlignment) {
+            alignment = kFundamentalAlignment;
+        }
+
+        const auto start = reinterpret_cast<uintptr_t>(bootstrapBuffer);
+        auto offset = bootstrapOffset.load(std::memory_order_relaxed);
+
+        for (;;) {
+            const auto address = (start + offset + sizeof(BootstrapAllocation) + alignment - 1) & ~(alignment - 1);
+            const auto end = address + dataLength;
+
+            if (end < address || end > start + kBootstrapLength) {
+                return nullptr;
+            }
+
+            if (bootstrapOffset.compare_exchange_weak(offset, end - start, std::memory_order_relaxed)) {
+                reinterpret_cast<BootstrapAllocation *>(address)[-1].dataLength = dataLength;
+                return reinterpret_cast<void *>(address);
+            }
+        }
+    }
+
+    //! \brief Constructs and initializes the heap, unless another call is already doing so.
+    //! \returns Pointer to the heap, or null if it is still being initialized by another call.
+    ngen::memory::ConcurrentHeap *initializeHeap() {
+        // Calls made while the heap is initialized, whether reentrant or from another thread, use the bootstrap buffer.
+        if (isInitializing.exchange(true, std::memory_order_acq_rel)) {
+            return heapInstance.load(std::memory_order_acquire);
+        }
+
+        auto heap = new(heapStorage) ngen::memory::ConcurrentHeap();
+
+        if (!heap->initializeGrowable(getReserveLength(), kCommitLength, ngen::memory::kAllocationStrategy::TLSF)) {
+            fatalError("memory_malloc: unable to reserve address space for the heap\n");
+        }
+
+        heapInstance.store(heap, std::memory_order_release);
+        return heap;
+    }
+
+    //! \brief Retrieves the heap that serves allocations, initializing it on first use.
+    //! \returns Pointer to the heap, or null while it is being initialized.
+    inline ngen::memory::ConcurrentHeap *getHeap() {
+        auto heap = heapInstance.load(std::memory_order_acquire);
+        return heap ? heap : initializeHeap();
+    }
+
+    //! \brief Allocates a block of memory with the specified alignment.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, must be a power of two.
+    //! \returns Pointer to the allocated memory block, or null with errno set to ENOMEM if it could not be allocated.
+    void *allocate(size_t dataLength, size_t alignment) {
+        // Every successful allocation is unique, including those of zero bytes.
+        if (!dataLength) {
+            dataLength = 1;
+        }
+
+        auto heap = getHeap();
+
+        void *result;
+        if (!heap) {
+            result = allocateBootstrap(dataLength, alignment);
+        } else if (alignment <= kFundamentalAlignment) {
+            result = heap->alloc(dataLength);
+        } else {
+            result = heap->alignedAlloc(dataLength, alignment);
+        }
+
+        if (!result) {
+            errno = ENOMEM;
+        }
+
+        return result;
+    }
+
+    //! \brief Releases a block of memory, blocks within the bootstrap buffer are ignored.
+    //! \param ptr [in] - Pointer to the memory block to be released, this may be null.
+    void release(void *ptr) {
+        if (!ptr || isBootstrapAllocation(ptr)) {
+            return;
+        }
+
+        auto heap = heapInstance.load(std::memory_order_acquire);
+        if (heap) {
+            heap->deallocate(ptr, false, nullptr, 0);
+        }
+    }
+
+    //! \brief Retrieves the number of bytes that may be used by a block of memory.
+    //! \param ptr [in] - Pointer to the memory block, this may be null.
+    //! \returns The number of bytes available at the supplied address, zero if the pointer is null.
+    size_t getUsableSize(const void *ptr) {
+        if (!ptr) {
+            return 0;
+        }
+
+        if (isBootstrapAllocation(ptr)) {
+            return static_cast<const BootstrapAllocation *>(ptr)[-1].dataLength;
+        }
+
+        auto heap = heapInstance.load(std::memory_order_acquire);
+        return heap ? heap->getUsableSize(ptr) : 0;
+    }
+
+    //! \brief Rounds an alignment up to the nearest power of two.
+    //! \param alignment [in] - The alignment to be rounded.
+    //! \returns The smallest power of two that is not less than the alignment, or zero if there is none.
+    size_t roundAlignment(size_t alignment) {
+        size_t result = kFundamentalAlignment;
+
+        while (result < alignment && result) {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+    //! \brief Determines whether or not a value is a power of two.
+    //! \param value [in] - The value to be tested.
+    //! \returns True if the value is a non-zero power of two otherwise false.
+    inline bool isPowerOfTwo(size_t value) {
+        return value && !(value & (value - 1));
+    }
+
+    //! \brief Allocates memory for operator new, calling the new handler until the allocation succeeds.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, must be a power of two.
+    //! \returns Pointer to the allocated memory block, std::bad_alloc is thrown if there is no new handler.
+    void *allocateOrThrow(size_t dataLength, size_t alignment) {
+        for (;;) {
+            auto result = allocate(dataLength, alignment);
+            if (result) {
+                return result;
+            }
+
+            auto handler = std::get_new_handler();
+            if (!handler) {
+                throw std::bad_alloc();
+            }
+
+            handler();
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+
+extern "C" {
+    void *malloc(size_t size) noexcept {
+        return allocate(size, kFundamentalAlignment);
+    }
+
+    void free(void *ptr) noexcept {
+        release(ptr);
+    }
+
+    void *calloc(size_t count, size_t size) noexcept {
+        if (size && count > SIZE_MAX / size) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+
+        auto result = allocate(count * size, kFundamentalAlignment);
+        if (result) {
+            memset(result, 0, count * size);
+        }
+
+        return result;
+    }
+
+    void *realloc(void *ptr, size_t size) noexcept {
+        if (!ptr) {
+            return allocate(size, kFundamentalAlignment);
+        }
+
+        if (!size) {
+            release(ptr);
+            return nullptr;
+        }
+
+        // Blocks are kept in place unless they must grow, or would waste more than half of their length.
+        const auto usableSize = getUsableSize(ptr);
+        if (size <= usableSize && size >= usableSize / 2 && !isBootstrapAllocation(ptr)) {
+            return ptr;
+        }
+
+        auto result = allocate(size, kFundamentalAlignment);
+        if (result) {
+            memcpy(result, ptr, size < usableSize ? size : usableSize);
+            release(ptr);
+        }
+
+        return result;
+    }
+
+    void *reallocarray(void *ptr, size_t count, size_t size) noexcept {
+        if (size && count > SIZE_MAX / size) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+
+        return realloc(ptr, count * size);
+    }
+
+    int posix_memalign(void **memptr, size_t alignment, size_t size) noexcept {
+        if (!isPowerOfTwo(alignment) || alignment % sizeof(void *)) {
+            return EINVAL;
+        }
+
+        auto result = allocate(size, alignment);
+        if (!result) {
+            return ENOMEM;
+        }
+
+        *memptr = result;
+        return 0;
+    }
+
+    void *aligned_alloc(size_t alignment, size_t size) noexcept {
+        if (!isPowerOfTwo(alignment)) {
+            errno = EINVAL;
+            return nullptr;
+        }
+
+        return allocate(size, alignment);
+    }
+
+    void *memalign(size_t alignment, size_t size) noexcept {
+        const auto roundedAlignment = roundAlignment(alignment);
+        if (!roundedAlignment) {
+            errno = EINVAL;
+            return nullptr;
+        }
+
+        return allocate(size, roundedAlignment);
+    }
+
+    void *valloc(size_t size) noexcept {
+        return allocate(size, ngen::memory::VirtualMemory::getPageSize());
+    }
+
+    void *pvalloc(size_t size) noexcept {
+        const auto pageSize = ngen::memory::VirtualMemory::getPageSize();
+        if (size > SIZE_MAX - pageSize) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+
+        return allocate((size + pageSize - 1) & ~(pageSize - 1), pageSize);
+    }
+
+    size_t malloc_usable_size(void *ptr) noexcept {
+        return getUsableSize(ptr);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+
+void *operator new(size_t count) {
+    return allocateOrThrow(count, kFundamentalAlignment);
+}
+
+void *operator new[](size_t count) {
+    return allocateOrThrow(count, kFundamentalAlignment);
+}
+
+void *operator new(size_t count, std::align_val_t alignment) {
+    return allocateOrThrow(count, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t count, std::align_val_t alignment) {
+    return allocateOrThrow(count, static_cast<size_t>(alignment));
+}
+
+void *operator new(size_t count, const std::nothrow_t &) noexcept {
+    return allocate(count, kFundamentalAlignment);
+}
+
+void *operator new[](size_t count, const std::nothrow_t &) noexcept {
+    return allocate(count, kFundamentalAlignment);
+}
+
+void *operator new(size_t count, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocate(count, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t count, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return allocate(count, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *ptr) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    release(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    release(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    release(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+    release(ptr);
+}
@@ -0,0 +1,235 @@
+
+#include <cstdint>
+#include <cassert>
+
+#include "arena.h"
+#include "heap.h"
+
+namespace {
+    //! \brief Simple helper function to determine whether or not a value is a power of 2.
+    //! \param value [in] - The number to check if it is a valid power of 2.
+    //! \returns True if the supplied value is a power of 2 otherwise returns false.
+    inline bool isPow2(size_t value) {
+        return (0 != value && (value & (value -1)) == 0);
+    }
+}
+
+namespace ngen::memory {
+    Arena::Arena()
+            : m_start(0), m_current(0), m_end(0), m_heap(nullptr), m_memoryBlock(nullptr), m_peakUsed(0), m_failedAllocations(0) {
+
+    }
+
+    Arena::~Arena() {
+        release();
+    }
+
+    //! \brief Prepares the arena for use by the application.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be used by this arena.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \returns True if the arena was initialized successfully otherwise false.
+    bool Arena::initialize(void *memoryBlock, size_t blockSize) {
+        if (m_memoryBlock) {
+            return false;
+        }
+
+        if (!memoryBlock) {
+            return false;
+        }
+
+        if (!blockSize) {
+            return false;
+        }
+
+        m_memoryBlock = memoryBlock;
+        m_start = reinterpret_cast<uintptr_t>(memoryBlock);
+        m_current = m_start;
+        m_end = m_start + blockSize;
+        m_peakUsed = 0;
+
+        return true;
+    }
+
+    //! \brief Prepares the arena for use by the application, carving its memory block from a heap.
+    //!
+    //! The memory block is returned to the heap when the arena is released or destroyed.
+    //! \param heap [in] - The heap from which the memory block of the arena is allocated.
+    //! \param blockSize [in] - Length (in bytes) of the memory block to be allocated for the arena.
+    //! \returns True if the arena was initialized successfully otherwise false.
+    bool Arena::initialize(Heap *heap, size_t blockSize) {
+        if (m_memoryBlock || !heap) {
+            return false;
+        }
+
+        auto memoryBlock = heap->alignedAlloc(blockSize, kDefaultAlignment);
+        if (!memoryBlock) {
+            // TODO: Log ERR - unable to allocate the memory block of the arena
+            return false;
+        }
+
+        if (!initialize(memoryBlock, blockSize)) {
+            heap->deallocate(memoryBlock, false, nullptr, 0);
+            return false;
+        }
+
+        m_heap = heap;
+        return true;
+    }
+
+    //! \brief Releases every allocation and detaches the arena from its memory block, returning it to its heap if required.
+    void Arena::release() {
+        if (m_heap) {
+            m_heap->deallocate(m_memoryBlock, false, nullptr, 0);
+        }
+
+        m_start = 0;
+        m_current = 0;
+        m_end = 0;
+        m_heap = nullptr;
+        m_memoryBlock = nullptr;
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::alloc(size_t dataLength) {
+        return allocate(dataLength, kDefaultAlignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::alignedAlloc(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length, the source location is not recorded by the arena.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::alloc(size_t dataLength, const char *, size_t) {
+        return allocate(dataLength, kDefaultAlignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length, the source location is not recorded by the arena.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::alignedAlloc(size_t dataLength, size_t alignment, const char *, size_t) {
+        return allocate(dataLength, alignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length, arrays are not distinguished by the arena.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::allocArray(size_t dataLength) {
+        return allocate(dataLength, kDefaultAlignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length, arrays are not distinguished by the arena.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::alignedAllocArray(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length, arrays are not distinguished by the arena.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::allocArray(size_t dataLength, const char *, size_t) {
+        return allocate(dataLength, kDefaultAlignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length, arrays are not distinguished by the arena.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *Arena::alignedAllocArray(size_t dataLength, size_t alignment, const char *, size_t) {
+        return allocate(dataLength, alignment);
+    }
+
+    //! \brief Accepts the release of an allocation made by this arena, the memory is reclaimed by rewind or reset.
+    //! \param ptr [in] - Pointer to the allocation being released.
+    //! \param isArray [in] - Unused, arrays are not distinguished by the arena.
+    //! \param fileName [in] - The path of the source file that made the deallocation, this may be null.
+    //! \param line [in] - The line number within the source file where the deallocation was requested.
+    //! \returns True if the pointer is null or was allocated by this arena otherwise false.
+    bool Arena::deallocate(void *ptr, bool, const char *, size_t) {
+        return !ptr || owns(ptr);
+    }
+
+    //! \brief Releases every allocation made after a marker was taken.
+    //! \param marker [in] - Marker previously returned by getMarker, since which the arena has not been rewound further.
+    //! \returns True if the arena was rewound otherwise false, if the marker lies beyond the current position.
+    bool Arena::rewind(ArenaMarker marker) {
+        if (marker > m_current - m_start) {
+            // TODO: Log ERR - marker is ahead of the current position of the arena
+            return false;
+        }
+
+        m_current = m_start + marker;
+        return true;
+    }
+
+    //! \brief Attempts to allocate a block of memory with a specified size and alignment.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block to be allocated.
+    //! \returns Pointer to the allocated memory block or nullptr if the allocation could not be made.
+    void *Arena::allocate(size_t dataLength, size_t alignment) {
+        if (!isPow2(alignment)) {
+            // TODO: Log ERR: alignment was not a power of 2
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        if (!m_memoryBlock) {
+            // TODO: Log ERR: arena has not been initialized
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        const auto alignedPtr = (m_current + alignment - 1) & ~(alignment - 1);
+
+        if (alignedPtr < m_current || alignedPtr > m_end || dataLength > m_end - alignedPtr) {
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        m_current = alignedPtr + dataLength;
+
+        if (m_current - m_start > m_peakUsed) {
+            m_peakUsed = m_current - m_start;
+        }
+
+        return reinterpret_cast<void *>(alignedPtr);
+    }
+}
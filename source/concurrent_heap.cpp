@@ -0,0 +1,841 @@
+
+#include "concurrent_heap.h"
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif //defined(_MSC_VER)
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif //!defined(_WIN32)
+
+
+////////////////////////////////////////////////////////////////////////////
+
+namespace {
+    using ngen::memory::ThreadCache;
+
+    // Largest alignment guaranteed by blocks exchanged through the thread caches, the fundamental alignment as for malloc.
+    constexpr size_t kCacheAlignment = alignof(std::max_align_t);
+
+    // Guards the attachment of thread caches to heaps and the list of live heaps, acquired before the lock of any heap.
+    std::mutex threadCacheMutex;
+
+    // Heaps that have been constructed and not yet destroyed, guarded by the thread cache mutex.
+    ngen::memory::ConcurrentHeap *liveHeaps = nullptr;
+
+    // Ensures the fork handlers shared by every heap are registered only once within the process.
+    std::once_flag forkHandlerFlag;
+
+    //! \brief Retrieves the index of the most significant bit set within a value.
+    //! \param value [in] - The value to be examined, must not be zero.
+    //! \returns Zero based index of the most significant set bit.
+    inline size_t findLastSet(size_t value) {
+        assert(0 != value);
+
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return (sizeof(unsigned long long) * 8 - 1) - __builtin_clzll(value);
+#endif //defined(_MSC_VER)
+    }
+
+    //! \brief Retrieves the length of the blocks held by a bucket of a thread cache.
+    //! \param bucket [in] - Index of the bucket whose block length is required.
+    //! \returns The length (in bytes) of blocks held by the specified bucket.
+    inline size_t getBucketLength(size_t bucket) {
+        return size_t(1) << (bucket + ThreadCache::kMinimumBucketLog2);
+    }
+
+    //! \brief Selects the bucket whose blocks are all large enough to satisfy a request.
+    //! \param dataLength [in] - The length (in bytes) of the request.
+    //! \returns Index of the smallest bucket whose block length is at least the requested length.
+    inline size_t getAllocationBucket(size_t dataLength) {
+        if (dataLength <= getBucketLength(0)) {
+            return 0;
+        }
+
+        return findLastSet(dataLength - 1) + 1 - ThreadCache::kMinimumBucketLog2;
+    }
+
+    //! \brief Selects the bucket a released block belongs to, based on the number of usable bytes within it.
+    //! \param usableLength [in] - The usable length (in bytes) of the block, must be at least the smallest bucket length.
+    //! \returns Index of the largest bucket whose block length does not exceed the usable length.
+    inline size_t getReleaseBucket(size_t usableLength) {
+        assert(usableLength >= getBucketLength(0));
+        return findLastSet(usableLength) - ThreadCache::kMinimumBucketLog2;
+    }
+
+    //! \brief Adjusts the number of blocks held by a thread cache, visible to other threads.
+    //! \param cache [in] - The thread cache to be updated, must be owned by the calling thread.
+    //! \param count [in] - The new number of blocks held by the cache.
+    inline void publishBlockCount(ThreadCache *cache, size_t count) {
+        cache->blockCount.store(count, std::memory_order_relaxed);
+    }
+
+    //! \brief Clears a thread cache so that it may be attached to a heap.
+    //! \param cache [in] - The thread cache to be cleared.
+    void resetThreadCache(ThreadCache *cache) {
+        cache->previous = nullptr;
+        cache->next = nullptr;
+        cache->cachedBytes = 0;
+
+        for (size_t loop = 0; loop < ThreadCache::kBucketCount; ++loop) {
+            cache->buckets[loop] = nullptr;
+            cache->counts[loop] = 0;
+        }
+
+        publishBlockCount(cache, 0);
+    }
+
+    //! \brief Restricts the limits of the thread caches to the blocks the buckets are able to hold.
+    //! \param limits [in] - The limits requested for the thread caches.
+    //! \returns The limits to be applied to the thread caches.
+    ngen::memory::ThreadCacheLimits clampLimits(const ngen::memory::ThreadCacheLimits &limits) {
+        auto result = limits;
+
+        const auto maximumBucketLength = getBucketLength(ThreadCache::kBucketCount - 1);
+        if (result.maximumBlockSize > maximumBucketLength) {
+            result.maximumBlockSize = maximumBucketLength;
+        }
+
+        return result;
+    }
+}
+
+namespace ngen::memory {
+    //! \brief  Thread caches owned by a single thread, one for each heap the thread has used.
+    class ThreadCacheTable {
+    public:
+        ThreadCacheTable();
+        ~ThreadCacheTable();
+
+        ThreadCacheTable(const ThreadCacheTable &other) = delete;
+        ThreadCacheTable &operator=(const ThreadCacheTable &other) = delete;
+
+        ThreadCache caches[ConcurrentHeap::kMaximumHeapsPerThread];
+    };
+
+    namespace {
+        thread_local ThreadCacheTable threadCaches;
+
+        // Set once the thread's caches have been flushed on exit, so that releases made by later thread_local
+        // destructors are served by the heap rather than attaching a cache that would outlive the thread.
+        thread_local bool isThreadExiting = false;
+    }
+
+    ThreadCacheTable::ThreadCacheTable() {
+        for (auto &cache : caches) {
+            cache.heap.store(nullptr, std::memory_order_relaxed);
+            resetThreadCache(&cache);
+        }
+    }
+
+    //! \brief Flushes the caches of an exiting thread back to the heaps they are attached to.
+    ThreadCacheTable::~ThreadCacheTable() {
+        isThreadExiting = true;
+
+        for (auto &cache : caches) {
+            if (cache.heap.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> guard(threadCacheMutex);
+
+                // The heap may have been destroyed while we were waiting.
+                auto heap = cache.heap.load(std::memory_order_relaxed);
+                if (heap) {
+                    heap->releaseThreadCache(&cache);
+                }
+            }
+        }
+    }
+
+    //! \brief Adds the heap to the list of live heaps, registering the fork handlers of the process if necessary.
+    ConcurrentHeap::ConcurrentHeap()
+    : m_caches(nullptr)
+    , m_previousHeap(nullptr)
+    , m_nextHeap(nullptr)
+    , m_failedAllocations(0) {
+#if !defined(_WIN32)
+        std::call_once(forkHandlerFlag, []() {
+            if (pthread_atfork(prepareFork, parentAfterFork, childAfterFork)) {
+                // TODO: Log ERR - unable to register the fork handlers, a forked child may inherit a held lock
+            }
+        });
+#endif //!defined(_WIN32)
+
+        std::lock_guard<std::mutex> guard(threadCacheMutex);
+
+        m_nextHeap = liveHeaps;
+        if (liveHeaps) {
+            liveHeaps->m_previousHeap = this;
+        }
+
+        liveHeaps = this;
+    }
+
+    //! \brief Detaches any thread caches still attached to the heap, the blocks they hold are discarded with the heap.
+    ConcurrentHeap::~ConcurrentHeap() {
+        std::lock_guard<std::mutex> guard(threadCacheMutex);
+
+        if (m_previousHeap) {
+            m_previousHeap->m_nextHeap = m_nextHeap;
+        } else {
+            liveHeaps = m_nextHeap;
+        }
+
+        if (m_nextHeap) {
+            m_nextHeap->m_previousHeap = m_previousHeap;
+        }
+
+        auto cache = m_caches;
+        while (cache) {
+            auto next = cache->next;
+
+            cache->previous = nullptr;
+            cache->next = nullptr;
+            cache->heap.store(nullptr, std::memory_order_release);
+
+            cache = next;
+        }
+
+        m_caches = nullptr;
+    }
+
+    //! \brief  Prepares the heap for use with the default allocation strategy and thread cache limits.
+    //! \param  memoryBlock [in] -
+    //!         Pointer to the block of memory to be managed by the heap.
+    //! \param  blockSize [in] -
+    //!         The size (in bytes) of the block of memory to be managed by the heap.
+    //! \return True if the heap was initialized successfully otherwise false.
+    bool ConcurrentHeap::initialize(void *memoryBlock, size_t blockSize) {
+        return initialize(memoryBlock, blockSize, kAllocationStrategy::First);
+    }
+
+    //! \brief  Prepares the heap for use with the default thread cache limits.
+    //! \param  memoryBlock [in] -
+    //!         Pointer to the block of memory to be managed by the heap.
+    //! \param  blockSize [in] -
+    //!         The size (in bytes) of the block of memory to be managed by the heap.
+    //! \param  allocationStrategy [in] -
+    //!         The strategy used by the underlying heap to select free blocks.
+    //! \return True if the heap was initialized successfully otherwise false.
+    bool ConcurrentHeap::initialize(void *memoryBlock, size_t blockSize, kAllocationStrategy allocationStrategy) {
+        return initialize(memoryBlock, blockSize, allocationStrategy, ThreadCacheLimits());
+    }
+
+    //! \brief  Prepares the heap for use.
+    //! \param  memoryBlock [in] -
+    //!         Pointer to the block of memory to be managed by the heap.
+    //! \param  blockSize [in] -
+    //!         The size (in bytes) of the block of memory to be managed by the heap.
+    //! \param  allocationStrategy [in] -
+    //!         The strategy used by the underlying heap to select free blocks.
+    //! \param  limits [in] -
+    //!         The limits applied to the cache of each thread using the heap.
+    //! \return True if the heap was initialized successfully otherwise false.
+    bool ConcurrentHeap::initialize(void *memoryBlock, size_t blockSize, kAllocationStrategy allocationStrategy, const ThreadCacheLimits &limits) {
+        if (0 == limits.batchCount) {
+            // TODO: Log ERR - thread caches must move at least one block at a time
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_heap.initialize(memoryBlock, blockSize, allocationStrategy)) {
+            return false;
+        }
+
+        m_limits = clampLimits(limits);
+        return true;
+    }
+
+    //! \brief  Prepares a heap that reserves a range of address space and commits memory within it as it is required,
+    //!         using the default allocation strategy and thread cache limits.
+    //! \param  reserveLength [in] -
+    //!         Length (in bytes) of the address space to be reserved, the heap never grows beyond it.
+    //! \param  commitLength [in] -
+    //!         Length (in bytes) of the memory to be committed immediately.
+    //! \return True if the heap was initialized successfully otherwise false.
+    bool ConcurrentHeap::initializeGrowable(size_t reserveLength, size_t commitLength) {
+        return initializeGrowable(reserveLength, commitLength, kAllocationStrategy::First);
+    }
+
+    //! \brief  Prepares a heap that reserves a range of address space and commits memory within it as it is required,
+    //!         using the default thread cache limits.
+    //! \param  reserveLength [in] -
+    //!         Length (in bytes) of the address space to be reserved, the heap never grows beyond it.
+    //! \param  commitLength [in] -
+    //!         Length (in bytes) of the memory to be committed immediately.
+    //! \param  allocationStrategy [in] -
+    //!         The strategy used by the underlying heap to select free blocks.
+    //! \return True if the heap was initialized successfully otherwise false.
+    bool ConcurrentHeap::initializeGrowable(size_t reserveLength, size_t commitLength, kAllocationStrategy allocationStrategy) {
+        return initializeGrowable(reserveLength, commitLength, allocationStrategy, ThreadCacheLimits());
+    }
+
+    //! \brief  Prepares a heap that reserves a range of address space and commits memory within it as it is required.
+    //! \param  reserveLength [in] -
+    //!         Length (in bytes) of the address space to be reserved, the heap never grows beyond it.
+    //! \param  commitLength [in] -
+    //!         Length (in bytes) of the memory to be committed immediately.
+    //! \param  allocationStrategy [in] -
+    //!         The strategy used by the underlying heap to select free blocks.
+    //! \param  limits [in] -
+    //!         The limits applied to the cache of each thread using the heap.
+    //! \return True if the heap was initialized successfully otherwise false.
+    bool ConcurrentHeap::initializeGrowable(size_t reserveLength, size_t commitLength, kAllocationStrategy allocationStrategy, const ThreadCacheLimits &limits) {
+        if (0 == limits.batchCount) {
+            // TODO: Log ERR - thread caches must move at least one block at a time
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_heap.initializeGrowable(reserveLength, commitLength, allocationStrategy)) {
+            return false;
+        }
+
+        m_limits = clampLimits(limits);
+        return true;
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::alloc(size_t dataLength) {
+        return allocate(dataLength, kCacheAlignment, false, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::alignedAlloc(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment, false, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::alloc(size_t dataLength, const char *fileName, size_t line) {
+        return allocate(dataLength, kCacheAlignment, false, fileName, line);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        return allocate(dataLength, alignment, false, fileName, line);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::allocArray(size_t dataLength) {
+        return allocate(dataLength, kCacheAlignment, true, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::alignedAllocArray(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment, true, nullptr, 0);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::allocArray(size_t dataLength, const char *fileName, size_t line) {
+        return allocate(dataLength, kCacheAlignment, true, fileName, line);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  fileName [in] -
+    //!         Pointer to string containing the path of the file where the allocation took place.
+    //! \param  line [in] -
+    //!         The line number within the source file where the allocation took place.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *ConcurrentHeap::alignedAllocArray(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        return allocate(dataLength, alignment, true, fileName, line);
+    }
+
+    //! \brief Attempts to allocate a block of memory from the thread cache, or from the underlying heap.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block to be allocated.
+    //! \param isArray [in] - True if the allocation is an array otherwise false.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    //! \returns Pointer to the allocated memory block or nullptr if the allocation could not be made.
+    void *ConcurrentHeap::allocate(size_t dataLength, size_t alignment, bool isArray, const char *fileName, size_t line) {
+        // Released blocks may be handed to any cached request, so every block carries the alignment the caches guarantee.
+        if (alignment < kCacheAlignment) {
+            alignment = kCacheAlignment;
+        }
+
+        if (!fileName) {
+            if (alignment <= kCacheAlignment && dataLength <= m_limits.maximumBlockSize) {
+                auto cache = acquireThreadCache();
+
+                if (cache) {
+                    const auto bucket = getAllocationBucket(dataLength);
+
+                    auto block = cache->buckets[bucket];
+                    if (block) {
+                        cache->buckets[bucket] = block->next;
+                        cache->counts[bucket]--;
+                        cache->cachedBytes -= getBucketLength(bucket);
+
+                        publishBlockCount(cache, cache->blockCount.load(std::memory_order_relaxed) - 1);
+
+                        [[maybe_unused]] const auto uncached = m_heap.setCachedAllocation(block, false);
+                        assert(uncached);
+
+                        return block;
+                    }
+
+                    auto result = refillBucket(cache, bucket);
+                    if (result) {
+                        return result;
+                    }
+                }
+            }
+
+            // Untracked blocks may be exchanged through the thread caches, so are never arrays within the heap.
+            isArray = false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto result = isArray ? m_heap.alignedAllocArray(dataLength, alignment, fileName, line)
+                              : m_heap.alignedAlloc(dataLength, alignment, fileName, line);
+
+        if (!result) {
+            m_failedAllocations++;
+        }
+
+        return result;
+    }
+
+    //! \brief Releases a memory block previously allocated by this object.
+    //! \param ptr [in] - Pointer to the memory block to be released
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \param fileName [in] - The path of the source file that made the deallocation, this may be null.
+    //! \param line [in] - The line number within the source file where the deallocation was requested.
+    //! \returns True if the memory block was released otherwise false.
+    bool ConcurrentHeap::deallocate(void *ptr, bool isArray, const char *fileName, size_t line) {
+        // We treat an attempt to free a nullptr as always successful.
+        if (!ptr) {
+            return true;
+        }
+
+        // The block is live and owned by the caller, so its header may be read without holding the lock. Only the
+        // bounds of the heap fixed at initialization are read alongside it, never those changed by growth.
+        if (!fileName && m_heap.isUntrackedAllocation(ptr)) {
+            const auto usableLength = m_heap.getUsableSize(ptr);
+
+            if (usableLength >= getBucketLength(0)) {
+                const auto bucket = getReleaseBucket(usableLength);
+
+                if (getBucketLength(bucket) <= m_limits.maximumBlockSize) {
+                    auto cache = acquireThreadCache();
+
+                    if (cache) {
+                        if (!m_heap.setCachedAllocation(ptr, true)) {
+                            // TODO: Log ERR - allocation is already held by a thread cache
+                            return false;
+                        }
+
+                        auto block = static_cast<ThreadCache::CachedBlock *>(ptr);
+                        block->next = cache->buckets[bucket];
+
+                        cache->buckets[bucket] = block;
+                        cache->counts[bucket]++;
+                        cache->cachedBytes += getBucketLength(bucket);
+
+                        publishBlockCount(cache, cache->blockCount.load(std::memory_order_relaxed) + 1);
+
+                        if (cache->counts[bucket] > m_limits.maximumBlocksPerBucket || cache->cachedBytes > m_limits.maximumCachedBytes) {
+                            trimThreadCache(cache, bucket);
+                        }
+
+                        return true;
+                    }
+                }
+            }
+
+            // Untracked blocks are never arrays within the heap, whichever operator they were allocated with.
+            isArray = false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.deallocate(ptr, isArray, fileName, line);
+    }
+
+    //! \brief Acquires the locks of every live heap ahead of a fork, so that the child does not inherit a lock held by a
+    //!        thread that does not exist within it. Registered with pthread_atfork once for the process.
+    void ConcurrentHeap::prepareFork() {
+        threadCacheMutex.lock();
+
+        for (auto heap = liveHeaps; heap; heap = heap->m_nextHeap) {
+            heap->m_mutex.lock();
+        }
+    }
+
+    //! \brief Releases the locks acquired by prepareFork, within the process that called fork.
+    void ConcurrentHeap::parentAfterFork() {
+        for (auto heap = liveHeaps; heap; heap = heap->m_nextHeap) {
+            heap->m_mutex.unlock();
+        }
+
+        threadCacheMutex.unlock();
+    }
+
+    //! \brief Releases the locks acquired by prepareFork within the child, returning the blocks cached by every other
+    //!        thread to each heap, as only the thread that called fork exists within the child.
+    void ConcurrentHeap::childAfterFork() {
+        for (auto heap = liveHeaps; heap; heap = heap->m_nextHeap) {
+            heap->reclaimThreadCaches();
+            heap->m_mutex.unlock();
+        }
+
+        threadCacheMutex.unlock();
+    }
+
+    //! \brief Returns the blocks held by the caches of threads other than the caller to the heap, detaching the caches.
+    //!
+    //! Only used within the child of a fork, where the heap lock and the thread cache mutex are held by the caller.
+    void ConcurrentHeap::reclaimThreadCaches() {
+        auto cache = m_caches;
+
+        while (cache) {
+            auto next = cache->next;
+
+            if (cache < std::begin(threadCaches.caches) || cache >= std::end(threadCaches.caches)) {
+                for (size_t loop = 0; loop < ThreadCache::kBucketCount; ++loop) {
+                    flushBucket(cache, loop, 0);
+                }
+
+                detachThreadCache(cache);
+            }
+
+            cache = next;
+        }
+    }
+
+    //! \brief Retrieves the number of bytes that may be used by an allocation made by this heap.
+    //! \param ptr [in] - Pointer to a live allocation made by this heap.
+    //! \returns The number of bytes available at the supplied address, this is at least the requested length. Zero
+    //!          is returned if the pointer was not allocated by this heap.
+    size_t ConcurrentHeap::getUsableSize(const void *ptr) const {
+        // The block is live and owned by the caller, so its header may be read without holding the lock. Only the
+        // bounds of the heap fixed at initialization are read alongside it, never those changed by growth.
+        return m_heap.getUsableSize(ptr);
+    }
+
+    //! \brief Returns all blocks held by the calling thread's cache to the underlying heap.
+    void ConcurrentHeap::flushThreadCache() {
+        auto cache = findThreadCache();
+
+        if (cache) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (size_t loop = 0; loop < ThreadCache::kBucketCount; ++loop) {
+                flushBucket(cache, loop, 0);
+            }
+        }
+    }
+
+    //! \brief Returns the pages within large free blocks of the underlying heap to the operating system.
+    //!
+    //! Blocks held by thread caches are not free within the underlying heap, so they are not scavenged.
+    //! \param minimumBlockSize [in] - Free blocks smaller than this length (in bytes) are not scavenged.
+    //! \param maximumBytes [in] - The number of bytes after which no further blocks are scavenged.
+    //! \returns The number of bytes that were returned to the operating system.
+    size_t ConcurrentHeap::scavenge(size_t minimumBlockSize, size_t maximumBytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.scavenge(minimumBlockSize, maximumBytes);
+    }
+
+    //! \brief Attaches a recorder to the underlying heap, which then records every allocation and release it makes.
+    //!
+    //! Requests served by thread caches do not reach the underlying heap, so only the blocks moving between the caches
+    //! and the underlying heap are recorded for them.
+    //! \param recorder [in] - The recorder to be attached, or nullptr to stop recording.
+    void ConcurrentHeap::setTraceRecorder(TraceRecorder *recorder) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_heap.setTraceRecorder(recorder);
+    }
+
+    //! \brief Attaches a profiler to the underlying heap, which then samples the allocations it makes.
+    //!
+    //! Requests served by thread caches do not reach the underlying heap, so blocks are sampled as they move from the
+    //! underlying heap into the caches, and a sampled block remains live within the profile until it is returned.
+    //! \param profiler [in] - The profiler to be attached, or nullptr to stop sampling.
+    void ConcurrentHeap::setHeapProfiler(HeapProfiler *profiler) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_heap.setHeapProfiler(profiler);
+    }
+
+    //! \brief Retrieves the number of allocations that are currently live within the heap.
+    //! \returns The number of allocations currently live, excluding blocks held by thread caches.
+    size_t ConcurrentHeap::getAllocations() const {
+        const auto cachedBlocks = getCachedBlocks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto allocations = m_heap.getAllocations();
+
+        return allocations > cachedBlocks ? allocations - cachedBlocks : 0;
+    }
+
+    //! \brief Retrieves the number of allocations made from the underlying heap during the course of its lifetime.
+    //! \returns The number of allocations made from the underlying heap, blocks reused by thread caches are not counted.
+    size_t ConcurrentHeap::getTotalAllocations() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.getTotalAllocations();
+    }
+
+    //! \brief Retrieves the number of allocation requests that have been requested but failed.
+    //! \returns The number of allocation requests that have been failed by this heap.
+    size_t ConcurrentHeap::getFailedAllocations() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_failedAllocations;
+    }
+
+    //! \brief Retrieves the number of bytes returned to the operating system by scavenge.
+    //! \returns The number of bytes that have been discarded from within free blocks of the underlying heap.
+    size_t ConcurrentHeap::getScavengedBytes() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.getScavengedBytes();
+    }
+
+    //! \brief Retrieves the number of scavenged bytes that have since been reused by the underlying heap.
+    //! \returns The number of scavenged bytes whose free block has been allocated from or joined with a neighbour.
+    size_t ConcurrentHeap::getRefaultedBytes() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_heap.getRefaultedBytes();
+    }
+
+    //! \brief Retrieves a snapshot of the statistics recorded by the underlying heap.
+    //!
+    //! Blocks held by thread caches are allocated from the underlying heap, so they are counted as bytes in use but
+    //! not as live allocations. Requests served by the thread caches do not reach the histograms of the underlying heap.
+    //! \returns The statistics recorded by the underlying heap.
+    HeapStats ConcurrentHeap::getStats() const {
+        const auto cachedBlocks = getCachedBlocks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto stats = m_heap.getStats();
+        stats.allocations = stats.allocations > cachedBlocks ? stats.allocations - cachedBlocks : 0;
+        stats.failedAllocations = m_failedAllocations;
+
+        return stats;
+    }
+
+    //! \brief Retrieves the number of blocks currently held within thread caches.
+    //! \returns The number of blocks that are allocated from the underlying heap but held by thread caches.
+    size_t ConcurrentHeap::getCachedBlocks() const {
+        std::lock_guard<std::mutex> guard(threadCacheMutex);
+
+        size_t cachedBlocks = 0;
+
+        for (auto cache = m_caches; cache; cache = cache->next) {
+            cachedBlocks += cache->blockCount.load(std::memory_order_relaxed);
+        }
+
+        return cachedBlocks;
+    }
+
+    //! \brief Retrieves the calling thread's cache for this heap.
+    //! \returns Pointer to the thread cache attached to this heap, or null if the thread does not have one.
+    ThreadCache *ConcurrentHeap::findThreadCache() const {
+        for (auto &cache : threadCaches.caches) {
+            if (cache.heap.load(std::memory_order_relaxed) == this) {
+                return &cache;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //! \brief Retrieves the calling thread's cache for this heap, attaching a new cache if necessary.
+    //! \returns Pointer to the thread cache attached to this heap, or null if the thread has no caches available.
+    ThreadCache *ConcurrentHeap::acquireThreadCache() {
+        auto cache = findThreadCache();
+        if (cache || isThreadExiting) {
+            return cache;
+        }
+
+        std::lock_guard<std::mutex> guard(threadCacheMutex);
+
+        for (auto &available : threadCaches.caches) {
+            if (!available.heap.load(std::memory_order_relaxed)) {
+                resetThreadCache(&available);
+
+                available.next = m_caches;
+                if (m_caches) {
+                    m_caches->previous = &available;
+                }
+
+                m_caches = &available;
+                available.heap.store(this, std::memory_order_release);
+
+                return &available;
+            }
+        }
+
+        // TODO: Log WARN - thread has exhausted its thread caches, allocations will be served by the heap directly
+        return nullptr;
+    }
+
+    //! \brief Allocates a batch of blocks for an empty bucket, while holding the lock once.
+    //! \param cache [in] - The thread cache whose bucket is to be refilled.
+    //! \param bucket [in] - Index of the bucket to be refilled.
+    //! \returns Pointer to a block to be returned to the caller, the remainder of the batch is held by the bucket.
+    void *ConcurrentHeap::refillBucket(ThreadCache *cache, size_t bucket) {
+        const auto bucketLength = getBucketLength(bucket);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto result = m_heap.alignedAlloc(bucketLength, kCacheAlignment);
+        if (result) {
+            size_t refilled = 0;
+
+            for (size_t loop = 1; loop < m_limits.batchCount; ++loop) {
+                if (cache->counts[bucket] >= m_limits.maximumBlocksPerBucket || cache->cachedBytes + bucketLength > m_limits.maximumCachedBytes) {
+                    break;
+                }
+
+                auto block = static_cast<ThreadCache::CachedBlock *>(m_heap.alignedAlloc(bucketLength, kCacheAlignment));
+                if (!block) {
+                    break;
+                }
+
+                [[maybe_unused]] const auto cached = m_heap.setCachedAllocation(block, true);
+                assert(cached);
+
+                block->next = cache->buckets[bucket];
+
+                cache->buckets[bucket] = block;
+                cache->counts[bucket]++;
+                cache->cachedBytes += bucketLength;
+
+                refilled++;
+            }
+
+            publishBlockCount(cache, cache->blockCount.load(std::memory_order_relaxed) + refilled);
+        }
+
+        return result;
+    }
+
+    //! \brief Returns blocks held by a bucket of a thread cache to the underlying heap, the lock must be held.
+    //! \param cache [in] - The thread cache whose bucket is to be flushed.
+    //! \param bucket [in] - Index of the bucket to be flushed.
+    //! \param keepCount [in] - The number of blocks that should remain within the bucket.
+    void ConcurrentHeap::flushBucket(ThreadCache *cache, size_t bucket, size_t keepCount) {
+        const auto bucketLength = getBucketLength(bucket);
+
+        size_t flushed = 0;
+
+        while (cache->counts[bucket] > keepCount) {
+            auto block = cache->buckets[bucket];
+            cache->buckets[bucket] = block->next;
+            cache->counts[bucket]--;
+            cache->cachedBytes -= bucketLength;
+
+            [[maybe_unused]] const auto uncached = m_heap.setCachedAllocation(block, false);
+            assert(uncached);
+
+            // Only untracked blocks are cached, so the heap always accepts them back.
+            [[maybe_unused]] const auto released = m_heap.deallocate(block, false, nullptr, 0);
+            assert(released);
+
+            flushed++;
+        }
+
+        publishBlockCount(cache, cache->blockCount.load(std::memory_order_relaxed) - flushed);
+    }
+
+    //! \brief Returns blocks to the underlying heap until a thread cache is within its limits.
+    //! \param cache [in] - The thread cache to be trimmed.
+    //! \param bucket [in] - Index of the bucket that a block was most recently released to.
+    void ConcurrentHeap::trimThreadCache(ThreadCache *cache, size_t bucket) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (cache->counts[bucket] > m_limits.maximumBlocksPerBucket) {
+            const auto batchCount = m_limits.batchCount < m_limits.maximumBlocksPerBucket ? m_limits.batchCount : m_limits.maximumBlocksPerBucket;
+            flushBucket(cache, bucket, m_limits.maximumBlocksPerBucket - batchCount);
+        }
+
+        // Release the largest blocks first, as they contribute the most towards the byte limit.
+        for (size_t loop = ThreadCache::kBucketCount; loop > 0 && cache->cachedBytes > m_limits.maximumCachedBytes; --loop) {
+            flushBucket(cache, loop - 1, 0);
+        }
+    }
+
+    //! \brief Flushes a thread cache and detaches it from the heap, the thread cache mutex must be held.
+    //! \param cache [in] - The thread cache to be released.
+    void ConcurrentHeap::releaseThreadCache(ThreadCache *cache) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (size_t loop = 0; loop < ThreadCache::kBucketCount; ++loop) {
+                flushBucket(cache, loop, 0);
+            }
+        }
+
+        detachThreadCache(cache);
+    }
+
+    //! \brief Removes a thread cache from the list of caches attached to the heap, the thread cache mutex must be held.
+    //! \param cache [in] - The thread cache to be detached, its buckets must already have been flushed.
+    void ConcurrentHeap::detachThreadCache(ThreadCache *cache) {
+        if (cache->previous) {
+            cache->previous->next = cache->next;
+        } else {
+            m_caches = cache->next;
+        }
+
+        if (cache->next) {
+            cache->next->previous = cache->previous;
+        }
+
+        cache->previous = nullptr;
+        cache->next = nullptr;
+        cache->heap.store(nullptr, std::memory_order_release);
+    }
+}
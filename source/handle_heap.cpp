@@ -0,0 +1,290 @@
+
+#include <algorithm>
+#include <cstdint>
+
+#include "handle_heap.h"
+
+namespace ngen::memory {
+    HandleHeap::HandleHeap()
+            : m_entries(nullptr), m_sweepOrder(nullptr), m_handleCount(0), m_liveHandles(0), m_freeEntry(0), m_sweepLength(0)
+            , m_sweepPosition(0), m_isSweepClean(false), m_isCompacted(true), m_failedAllocations(0), m_relocations(0), m_relocatedBytes(0) {
+
+    }
+
+    //! \brief Prepares the heap for use by the application.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be managed by this heap.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \param handleCount [in] - The largest number of allocations the heap may hold at once.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    bool HandleHeap::initialize(void *memoryBlock, size_t blockSize, size_t handleCount) {
+        return initialize(memoryBlock, blockSize, handleCount, detail::kDefaultAllocationStrategy);
+    }
+
+    //! \brief Prepares the heap for use by the application.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be managed by this heap.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \param handleCount [in] - The largest number of allocations the heap may hold at once.
+    //! \param allocationStrategy [in] - The strategy used to search for free blocks.
+    //! \returns True if the heap was initialized successfully otherwise false.
+    bool HandleHeap::initialize(void *memoryBlock, size_t blockSize, size_t handleCount, kAllocationStrategy allocationStrategy) {
+        if (m_entries) {
+            return false;
+        }
+
+        if (!handleCount || handleCount >= UINT32_MAX) {
+            // TODO: Log ERR - unsupported number of handles
+            return false;
+        }
+
+        m_heap.emplace();
+
+        if (!m_heap->initialize(memoryBlock, blockSize, allocationStrategy)) {
+            m_heap.reset();
+            return false;
+        }
+
+        // The table is the first allocation made by the heap, so it lies at the start and never obstructs compaction.
+        auto entries = static_cast<HandleEntry *>(m_heap->alignedAlloc(handleCount * sizeof(HandleEntry), alignof(HandleEntry)));
+        auto sweepOrder = static_cast<uint32_t *>(m_heap->alignedAlloc(handleCount * sizeof(uint32_t), alignof(uint32_t)));
+
+        if (!entries || !sweepOrder) {
+            // TODO: Log ERR - memory block too small to contain the handle table
+            m_heap->deallocate(entries, false, nullptr, 0);
+            m_heap->deallocate(sweepOrder, false, nullptr, 0);
+
+            m_heap.reset();
+            return false;
+        }
+
+        for (size_t loop = 0; loop < handleCount; ++loop) {
+            entries[loop].ptr = nullptr;
+            entries[loop].dataLength = 0;
+            entries[loop].alignment = 0;
+            entries[loop].generation = 1;
+            entries[loop].pinCount = 0;
+            entries[loop].nextFree = loop + 1 < handleCount ? static_cast<uint32_t>(loop + 2) : 0;
+        }
+
+        m_entries = entries;
+        m_sweepOrder = sweepOrder;
+        m_handleCount = handleCount;
+        m_freeEntry = 1;
+
+        return true;
+    }
+
+    //! \brief Allocates a block of memory from the heap.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \returns Handle of the allocation, or kInvalidHandle if the allocation could not be made.
+    MemoryHandle HandleHeap::alloc(size_t dataLength) {
+        return alignedAlloc(dataLength, kDefaultAlignment);
+    }
+
+    //! \brief Allocates a block of memory from the heap, the allocation keeps its alignment whenever it is moved.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, must be a power of two.
+    //! \returns Handle of the allocation, or kInvalidHandle if the allocation could not be made.
+    MemoryHandle HandleHeap::alignedAlloc(size_t dataLength, size_t alignment) {
+        if (!m_freeEntry || alignment > UINT32_MAX) {
+            // TODO: Log ERR - handle table exhausted
+            m_failedAllocations++;
+            return kInvalidHandle;
+        }
+
+        auto ptr = m_heap->alignedAlloc(dataLength, alignment);
+        if (!ptr) {
+            m_failedAllocations++;
+            return kInvalidHandle;
+        }
+
+        const auto index = m_freeEntry;
+        auto &entry = m_entries[index - 1];
+
+        m_freeEntry = entry.nextFree;
+
+        entry.ptr = ptr;
+        entry.dataLength = dataLength;
+        entry.alignment = static_cast<uint32_t>(alignment);
+        entry.pinCount = 0;
+        entry.nextFree = 0;
+
+        m_liveHandles++;
+        m_isSweepClean = false;
+        m_isCompacted = false;
+
+        return {index, entry.generation};
+    }
+
+    //! \brief Releases an allocation made by this heap, the handle is no longer valid once released.
+    //! \param handle [in] - Handle of the allocation to be released, it must not be pinned.
+    //! \returns True if the allocation was released otherwise false.
+    bool HandleHeap::release(MemoryHandle handle) {
+        auto entry = findEntry(handle);
+        if (!entry) {
+            // TODO: Log ERR - invalid handle released
+            return false;
+        }
+
+        if (entry->pinCount) {
+            // TODO: Log ERR - pinned allocation released
+            return false;
+        }
+
+        m_heap->deallocate(entry->ptr, false, nullptr, 0);
+
+        entry->ptr = nullptr;
+        entry->generation++;
+        entry->nextFree = m_freeEntry;
+
+        m_freeEntry = handle.index;
+        m_liveHandles--;
+
+        m_isSweepClean = false;
+        m_isCompacted = false;
+
+        return true;
+    }
+
+    //! \brief Retrieves the current address of an allocation, which remains valid until the next call to compact.
+    //! \param handle [in] - Handle of the allocation.
+    //! \returns Pointer to the allocation, or null if the handle is not valid.
+    void *HandleHeap::resolve(MemoryHandle handle) const {
+        auto entry = findEntry(handle);
+        return entry ? entry->ptr : nullptr;
+    }
+
+    //! \brief Retrieves the length requested when an allocation was made.
+    //! \param handle [in] - Handle of the allocation.
+    //! \returns The length (in bytes) of the allocation, or zero if the handle is not valid.
+    size_t HandleHeap::getLength(MemoryHandle handle) const {
+        auto entry = findEntry(handle);
+        return entry ? entry->dataLength : 0;
+    }
+
+    //! \brief Prevents an allocation from being moved, until it has been unpinned as many times as it was pinned.
+    //! \param handle [in] - Handle of the allocation to be pinned.
+    //! \returns Pointer to the allocation, which remains valid while it is pinned, or null if the handle is not valid.
+    void *HandleHeap::pin(MemoryHandle handle) {
+        auto entry = findEntry(handle);
+        if (!entry) {
+            return nullptr;
+        }
+
+        entry->pinCount++;
+        return entry->ptr;
+    }
+
+    //! \brief Releases a pin taken on an allocation, allowing it to be moved once no pins remain.
+    //! \param handle [in] - Handle of the allocation to be unpinned.
+    //! \returns True if a pin was released otherwise false.
+    bool HandleHeap::unpin(MemoryHandle handle) {
+        auto entry = findEntry(handle);
+        if (!entry || !entry->pinCount) {
+            return false;
+        }
+
+        if (!--entry->pinCount) {
+            m_isSweepClean = false;
+            m_isCompacted = false;
+        }
+
+        return true;
+    }
+
+    //! \brief Determines whether or not an allocation is currently pinned.
+    //! \param handle [in] - Handle of the allocation.
+    //! \returns True if the handle is valid and pinned otherwise false.
+    bool HandleHeap::isPinned(MemoryHandle handle) const {
+        auto entry = findEntry(handle);
+        return entry && entry->pinCount;
+    }
+
+    //! \brief Slides unpinned allocations toward the start of the heap until the time budget has been spent.
+    //!
+    //! Allocations are visited in address order, each moving into the free block that precedes it, so a complete
+    //! sweep gathers the free memory between unpinned allocations into the block that follows them. A sweep may span
+    //! many calls, allocations made or released in between are accounted for by the next sweep. The budget is
+    //! examined between moves, so a single call may exceed it by the time taken to copy one allocation.
+    //! \param budget [in] - The time the call may spend moving allocations.
+    //! \returns The number of allocations that were moved, any addresses previously resolved for them are invalid.
+    size_t HandleHeap::compact(std::chrono::nanoseconds budget) {
+        const auto start = std::chrono::steady_clock::now();
+        size_t relocations = 0;
+
+        while (!m_isCompacted) {
+            if (m_sweepPosition == m_sweepLength) {
+                beginSweep();
+
+                if (!m_sweepLength) {
+                    m_isCompacted = true;
+                    break;
+                }
+            }
+
+            auto &entry = m_entries[m_sweepOrder[m_sweepPosition++]];
+
+            if (entry.ptr && !entry.pinCount) {
+                auto moved = m_heap->slideAllocation(entry.ptr, entry.alignment);
+
+                if (moved) {
+                    entry.ptr = moved;
+
+                    m_relocations++;
+                    m_relocatedBytes += entry.dataLength;
+                    m_isSweepClean = false;
+
+                    relocations++;
+                }
+            }
+
+            // A sweep that moved nothing, with no changes to the heap while it ran, leaves nothing further to move.
+            if (m_sweepPosition == m_sweepLength && m_isSweepClean) {
+                m_isCompacted = true;
+                break;
+            }
+
+            if (std::chrono::steady_clock::now() - start >= budget) {
+                break;
+            }
+        }
+
+        return relocations;
+    }
+
+    //! \brief Locates the entry of the handle table referenced by a handle.
+    //! \param handle [in] - The handle whose entry is required.
+    //! \returns Pointer to the entry, or null if the handle is not live.
+    HandleEntry *HandleHeap::findEntry(MemoryHandle handle) const {
+        if (!handle.index || handle.index > m_handleCount) {
+            return nullptr;
+        }
+
+        auto entry = &m_entries[handle.index - 1];
+        if (!entry->ptr || entry->generation != handle.generation) {
+            return nullptr;
+        }
+
+        return entry;
+    }
+
+    //! \brief Starts a sweep of the heap by ordering the live handles by the address of their allocation.
+    void HandleHeap::beginSweep() {
+        size_t count = 0;
+
+        for (size_t loop = 0; loop < m_handleCount; ++loop) {
+            if (m_entries[loop].ptr) {
+                m_sweepOrder[count++] = static_cast<uint32_t>(loop);
+            }
+        }
+
+        const auto entries = m_entries;
+
+        std::sort(m_sweepOrder, m_sweepOrder + count, [entries](uint32_t lhs, uint32_t rhs) {
+            return reinterpret_cast<uintptr_t>(entries[lhs].ptr) < reinterpret_cast<uintptr_t>(entries[rhs].ptr);
+        });
+
+        m_sweepLength = count;
+        m_sweepPosition = 0;
+        m_isSweepClean = true;
+    }
+}
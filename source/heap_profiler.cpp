@@ -0,0 +1,524 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__GLIBC__) || defined(__APPLE__)
+#include <dlfcn.h>
+#include <execinfo.h>
+#define NGEN_HEAP_PROFILER_BACKTRACE 1
+#endif //defined(_WIN32)
+
+#include "heap_profiler.h"
+
+namespace {
+    constexpr size_t kInvalidSite = SIZE_MAX;
+    constexpr size_t kInvalidSample = SIZE_MAX;
+
+    //! \brief Scrambles the bits of a value, so that similar values are spread across a hash table.
+    //! \param value [in] - The value to be hashed.
+    //! \returns The hash of the value.
+    uint64_t hashValue(uint64_t value) {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ull;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebull;
+        value ^= value >> 31;
+
+        return value;
+    }
+
+    //! \brief Determines the length of a hash table that holds the specified number of entries at most half full.
+    //! \param capacity [in] - The largest number of entries held by the table.
+    //! \returns The number of slots within the table, always a power of two.
+    size_t getTableLength(size_t capacity) {
+        size_t length = 1;
+
+        while (length < capacity * 2) {
+            length <<= 1;
+        }
+
+        return length;
+    }
+
+    //! \brief Captures the return addresses of the calling thread's stack.
+    //! \param frames [out] - Receives the return addresses, innermost first.
+    //! \param skipFrames [in] - The number of innermost frames to be omitted, beyond the frame of this function.
+    //! \returns The number of return addresses that were captured.
+    size_t captureFrames(uintptr_t *frames, size_t skipFrames) {
+        void *addresses[ngen::memory::kHeapProfileMaximumFrames + 4];
+
+        const auto maximumFrames = std::min<size_t>(skipFrames + 1 + ngen::memory::kHeapProfileMaximumFrames, std::size(addresses));
+
+#if defined(_WIN32)
+        const auto captured = static_cast<size_t>(RtlCaptureStackBackTrace(0, static_cast<DWORD>(maximumFrames), addresses, nullptr));
+#elif defined(NGEN_HEAP_PROFILER_BACKTRACE)
+        const auto captured = static_cast<size_t>(backtrace(addresses, static_cast<int>(maximumFrames)));
+#else
+        const size_t captured = 0;
+#endif //defined(_WIN32)
+
+        size_t count = 0;
+
+        for (size_t loop = skipFrames + 1; loop < captured; ++loop) {
+            frames[count++] = reinterpret_cast<uintptr_t>(addresses[loop]);
+        }
+
+        return count;
+    }
+
+    //! \brief Outputs a return address, with the module and symbol containing it when they can be determined.
+    //! \param file [in] - The file the address is written to.
+    //! \param index [in] - Position of the address within its call stack.
+    //! \param address [in] - The return address to be written.
+    void dumpFrame(FILE *file, size_t index, uintptr_t address) {
+#if defined(NGEN_HEAP_PROFILER_BACKTRACE)
+        Dl_info info;
+
+        if (dladdr(reinterpret_cast<void *>(address), &info) && info.dli_fname) {
+            const auto moduleName = strrchr(info.dli_fname, '/') ? strrchr(info.dli_fname, '/') + 1 : info.dli_fname;
+            const auto offset = address - reinterpret_cast<uintptr_t>(info.dli_fbase);
+
+            fprintf(file, "        #%-2zu 0x%016llx %s+0x%llx%s%s\n", index, static_cast<unsigned long long>(address), moduleName,
+                    static_cast<unsigned long long>(offset), info.dli_sname ? " " : "", info.dli_sname ? info.dli_sname : "");
+            return;
+        }
+#endif //defined(NGEN_HEAP_PROFILER_BACKTRACE)
+
+        fprintf(file, "        #%-2zu 0x%016llx\n", index, static_cast<unsigned long long>(address));
+    }
+}
+
+namespace ngen::memory {
+    HeapProfiler::HeapProfiler()
+            : m_siteCapacity(0), m_siteIndexMask(0), m_siteCount(0), m_sampleCapacity(0), m_sampleMask(0), m_liveSampleCount(0)
+            , m_sampleInterval(0), m_randomState(0), m_samples(0), m_droppedSamples(0) {
+
+    }
+
+    //! \brief Prepares the profiler for use, sampling once in every kDefaultSampleInterval bytes.
+    //! \returns True if the profiler was initialized successfully otherwise false.
+    bool HeapProfiler::initialize() {
+        return initialize(kDefaultSampleInterval, kDefaultSiteCapacity, kDefaultSampleCapacity);
+    }
+
+    //! \brief Prepares the profiler for use.
+    //! \param sampleInterval [in] - The mean number of bytes allocated between samples, one samples every allocation.
+    //! \returns True if the profiler was initialized successfully otherwise false.
+    bool HeapProfiler::initialize(size_t sampleInterval) {
+        return initialize(sampleInterval, kDefaultSiteCapacity, kDefaultSampleCapacity);
+    }
+
+    //! \brief Prepares the profiler for use.
+    //! \param sampleInterval [in] - The mean number of bytes allocated between samples, one samples every allocation.
+    //! \param siteCapacity [in] - The largest number of call sites the profiler records.
+    //! \param sampleCapacity [in] - The largest number of sampled allocations that may be live at once.
+    //! \returns True if the profiler was initialized successfully otherwise false.
+    bool HeapProfiler::initialize(size_t sampleInterval, size_t siteCapacity, size_t sampleCapacity) {
+        if (!sampleInterval || !siteCapacity || !sampleCapacity || siteCapacity >= UINT32_MAX) {
+            // TODO: Log ERR - invalid profiler configuration
+            return false;
+        }
+
+        // The first capture of a call stack may load the unwinder, which allocates, so it is made before recording.
+        uintptr_t frames[kHeapProfileMaximumFrames];
+        [[maybe_unused]] const auto frameCount = captureFrames(frames, 0);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_sites) {
+            return false;
+        }
+
+        const auto siteIndexLength = getTableLength(siteCapacity);
+        const auto sampleLength = getTableLength(sampleCapacity);
+
+        m_sites.reset(new HeapProfileSite[siteCapacity]);
+        m_siteIndex.reset(new uint32_t[siteIndexLength]());
+        m_siteCapacity = siteCapacity;
+        m_siteIndexMask = siteIndexLength - 1;
+        m_siteCount = 0;
+
+        m_liveSamples.reset(new LiveSample[sampleLength]());
+        m_sampleCapacity = sampleCapacity;
+        m_sampleMask = sampleLength - 1;
+        m_liveSampleCount = 0;
+
+        m_sampleInterval = sampleInterval;
+        m_start = std::chrono::steady_clock::now();
+        m_randomState = hashValue(static_cast<uint64_t>(m_start.time_since_epoch().count()) ^ reinterpret_cast<uintptr_t>(this)) | 1;
+
+        return true;
+    }
+
+    //! \brief Draws the number of bytes a heap allocates before it samples its next allocation.
+    //!
+    //! The intervals are drawn from an exponential distribution, so sampling is a Poisson process over the bytes
+    //! allocated, and the probability of an allocation being sampled does not depend on the allocations before it.
+    //! \returns The number of bytes until the next sample, at least one.
+    size_t HeapProfiler::nextSampleInterval() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // A profiler that has not been initialized is never sampled.
+        if (!m_sampleInterval) {
+            return SIZE_MAX;
+        }
+
+        if (1 == m_sampleInterval) {
+            return 1;
+        }
+
+        m_randomState ^= m_randomState >> 12;
+        m_randomState ^= m_randomState << 25;
+        m_randomState ^= m_randomState >> 27;
+
+        // A uniform value within (0, 1], from the upper 53 bits of the generator.
+        const auto uniform = static_cast<double>(((m_randomState * 0x2545f4914f6cdd1dull) >> 11) + 1) * (1.0 / 9007199254740992.0);
+        const auto interval = -std::log(uniform) * static_cast<double>(m_sampleInterval);
+
+        return interval < 1.0 ? 1 : static_cast<size_t>(interval);
+    }
+
+    //! \brief Records an allocation that was sampled by a heap.
+    //! \param ptr [in] - Address of the allocation.
+    //! \param dataLength [in] - The length (in bytes) that was requested.
+    //! \param fileName [in] - The path of the source file that made the allocation, null to identify it by its call stack.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    void HeapProfiler::recordAllocation(const void *ptr, size_t dataLength, const char *fileName, size_t line) {
+        uintptr_t frames[kHeapProfileMaximumFrames];
+        const auto frameCount = fileName ? 0 : captureFrames(frames, 1);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_sites) {
+            return;
+        }
+
+        // Each sample stands for the allocations of its length that were not sampled, in inverse proportion to the
+        // probability of an allocation of that length being sampled.
+        const auto length = std::max<size_t>(dataLength, 1);
+
+        LiveSample sample = {ptr, 0, length, 1};
+
+        if (m_sampleInterval > 1) {
+            const auto probability = -std::expm1(-static_cast<double>(length) / static_cast<double>(m_sampleInterval));
+
+            sample.bytes = static_cast<size_t>(std::llround(static_cast<double>(length) / probability));
+            sample.count = static_cast<size_t>(std::llround(1.0 / probability));
+        }
+
+        m_samples++;
+
+        sample.site = findSite(fileName, line, frames, frameCount);
+        if (kInvalidSite == sample.site) {
+            // TODO: Log WARN - site table exhausted
+            m_droppedSamples++;
+            return;
+        }
+
+        auto &site = m_sites[sample.site];
+        site.samples++;
+        site.allocatedBytes += sample.bytes;
+        site.allocatedCount += sample.count;
+        site.sizes[detail::getHistogramBucket(dataLength)]++;
+
+        // An entry for the same address belongs to an allocation whose release was not seen, so it is replaced.
+        const auto existing = findSample(ptr);
+        if (kInvalidSample != existing) {
+            removeSample(existing);
+        }
+
+        if (!insertSample(sample)) {
+            // TODO: Log WARN - sample table exhausted
+            m_droppedSamples++;
+            return;
+        }
+
+        site.liveBytes += sample.bytes;
+        site.liveCount += sample.count;
+    }
+
+    //! \brief Records the release of an allocation, which is ignored unless the allocation was sampled.
+    //! \param ptr [in] - Address of the allocation that was released.
+    void HeapProfiler::recordRelease(const void *ptr) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_sites) {
+            return;
+        }
+
+        const auto slot = findSample(ptr);
+        if (kInvalidSample != slot) {
+            removeSample(slot);
+        }
+    }
+
+    //! \brief Records that a sampled allocation has been moved by its heap.
+    //! \param ptr [in] - Address of the allocation before it was moved.
+    //! \param relocatedPtr [in] - Address of the allocation once it has been moved.
+    void HeapProfiler::recordRelocation(const void *ptr, const void *relocatedPtr) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_sites) {
+            return;
+        }
+
+        const auto slot = findSample(ptr);
+        if (kInvalidSample == slot) {
+            return;
+        }
+
+        // The allocation remains live, so the entry is moved without changing the live estimates of its site.
+        auto sample = m_liveSamples[slot];
+        eraseSample(slot);
+
+        sample.ptr = relocatedPtr;
+
+        [[maybe_unused]] const auto inserted = insertSample(sample);
+        assert(inserted);
+    }
+
+    //! \brief Retrieves a snapshot of the call sites recorded by the profiler.
+    //! \returns The call sites, ordered by their estimated live bytes and then by their estimated allocated bytes.
+    std::vector<HeapProfileSite> HeapProfiler::getSites() const {
+        std::vector<HeapProfileSite> sites;
+
+        // Memory for the snapshot is obtained before the lock is taken, as the allocation may itself be sampled.
+        size_t capacity;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            capacity = m_siteCapacity;
+        }
+
+        sites.reserve(capacity);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            sites.assign(m_sites.get(), m_sites.get() + std::min(m_siteCount, capacity));
+        }
+
+        std::sort(sites.begin(), sites.end(), [](const HeapProfileSite &lhs, const HeapProfileSite &rhs) {
+            if (lhs.liveBytes != rhs.liveBytes) {
+                return lhs.liveBytes > rhs.liveBytes;
+            }
+
+            return lhs.allocatedBytes > rhs.allocatedBytes;
+        });
+
+        return sites;
+    }
+
+    //! \brief Writes a readable report of the call sites recorded by the profiler.
+    //!
+    //! Sites identified by their call stack list each return address, with the module and offset that addr2line
+    //! or a debugger requires to resolve it, and the symbol containing it when the module exports one.
+    //! \param file [in] - The file the report is written to, such as stdout.
+    //! \returns True if the report was written otherwise false.
+    bool HeapProfiler::dump(FILE *file) const {
+        if (!file || !isInitialized()) {
+            return false;
+        }
+
+        const auto sites = getSites();
+        const auto seconds = std::chrono::duration<double>(getElapsed()).count();
+
+        fprintf(file, "heap profile: %zu sites, %zu samples, %zu live samples, %zu dropped, sample interval %zu bytes, %.3f s\n",
+                sites.size(), getSamples(), getLiveSamples(), getDroppedSamples(), getSampleInterval(), seconds);
+        fprintf(file, "%14s %10s %14s %12s %14s %8s  %s\n", "live_bytes", "live_count", "alloc_bytes", "alloc_count", "alloc_bytes/s", "samples", "site");
+
+        for (const auto &site : sites) {
+            fprintf(file, "%14zu %10zu %14zu %12zu %14.0f %8zu  ", site.liveBytes, site.liveCount, site.allocatedBytes, site.allocatedCount,
+                    seconds > 0.0 ? static_cast<double>(site.allocatedBytes) / seconds : 0.0, site.samples);
+
+            if (site.fileName) {
+                fprintf(file, "%s:%zu\n", site.fileName, site.line);
+            } else {
+                fprintf(file, "<%zu frames>\n", site.frameCount);
+
+                for (size_t loop = 0; loop < site.frameCount; ++loop) {
+                    dumpFrame(file, loop, site.frames[loop]);
+                }
+            }
+
+            fprintf(file, "        sizes:");
+
+            for (size_t loop = 0; loop < kStatisticsHistogramLength; ++loop) {
+                if (site.sizes[loop]) {
+                    fprintf(file, " %zu+:%zu", loop ? size_t(1) << loop : 0, site.sizes[loop]);
+                }
+            }
+
+            fprintf(file, "\n");
+        }
+
+        return 0 == ferror(file);
+    }
+
+    //! \brief Determines whether or not the profiler has been initialized.
+    //! \returns True if the profiler is ready to record samples otherwise false.
+    bool HeapProfiler::isInitialized() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return nullptr != m_sites;
+    }
+
+    //! \brief Retrieves the mean number of bytes allocated between samples.
+    //! \returns The sample interval (in bytes).
+    size_t HeapProfiler::getSampleInterval() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sampleInterval;
+    }
+
+    //! \brief Retrieves the number of allocations sampled since the profiler was initialized.
+    //! \returns The number of allocations that have been sampled, including those that were dropped.
+    size_t HeapProfiler::getSamples() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_samples;
+    }
+
+    //! \brief Retrieves the number of sampled allocations that have not yet been released.
+    //! \returns The number of live allocations held by the sample table.
+    size_t HeapProfiler::getLiveSamples() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_liveSampleCount;
+    }
+
+    //! \brief Retrieves the number of samples that could not be recorded in full, because a table was exhausted.
+    //! \returns The number of samples missing from the site table, or from the live estimates of their site.
+    size_t HeapProfiler::getDroppedSamples() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_droppedSamples;
+    }
+
+    //! \brief Retrieves the time that has passed since the profiler was initialized, over which allocation rates are measured.
+    //! \returns The time elapsed since the profiler was initialized, or zero if it has not been initialized.
+    std::chrono::nanoseconds HeapProfiler::getElapsed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_sites) {
+            return std::chrono::nanoseconds(0);
+        }
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+    }
+
+    //! \brief Locates the entry of the site table for a call site, creating it if required, the lock must be held.
+    //! \param fileName [in] - The path of the source file that made the allocation, null if identified by its frames.
+    //! \param line [in] - The line number within the source file.
+    //! \param frames [in] - The return addresses of the call stack, used when there is no source file.
+    //! \param frameCount [in] - The number of return addresses held by frames.
+    //! \returns Index of the site, or kInvalidSite if the site table is full.
+    size_t HeapProfiler::findSite(const char *fileName, size_t line, const uintptr_t *frames, size_t frameCount) {
+        auto hash = hashValue(reinterpret_cast<uintptr_t>(fileName) ^ hashValue(line));
+
+        for (size_t loop = 0; loop < frameCount; ++loop) {
+            hash = hashValue(hash ^ frames[loop]);
+        }
+
+        for (auto slot = hash & m_siteIndexMask;; slot = (slot + 1) & m_siteIndexMask) {
+            const auto entry = m_siteIndex[slot];
+
+            if (!entry) {
+                if (m_siteCount == m_siteCapacity) {
+                    return kInvalidSite;
+                }
+
+                auto &site = m_sites[m_siteCount];
+                memset(&site, 0, sizeof(site));
+
+                site.fileName = fileName;
+                site.line = line;
+                site.frameCount = frameCount;
+
+                for (size_t loop = 0; loop < frameCount; ++loop) {
+                    site.frames[loop] = frames[loop];
+                }
+
+                m_siteIndex[slot] = static_cast<uint32_t>(++m_siteCount);
+                return m_siteCount - 1;
+            }
+
+            const auto &site = m_sites[entry - 1];
+
+            if (site.fileName == fileName && site.line == line && site.frameCount == frameCount &&
+                std::equal(frames, frames + frameCount, site.frames)) {
+                return entry - 1;
+            }
+        }
+    }
+
+    //! \brief Locates the entry of the sample table for a live allocation, the lock must be held.
+    //! \param ptr [in] - Address of the allocation.
+    //! \returns Slot of the sample within the table, or kInvalidSample if the allocation was not sampled.
+    size_t HeapProfiler::findSample(const void *ptr) const {
+        for (auto slot = hashValue(reinterpret_cast<uintptr_t>(ptr)) & m_sampleMask;; slot = (slot + 1) & m_sampleMask) {
+            if (m_liveSamples[slot].ptr == ptr) {
+                return slot;
+            }
+
+            if (!m_liveSamples[slot].ptr) {
+                return kInvalidSample;
+            }
+        }
+    }
+
+    //! \brief Adds a live allocation to the sample table, the lock must be held.
+    //! \param sample [in] - The sampled allocation, its address must not already be within the table.
+    //! \returns True if the sample was added otherwise false, if the table is full.
+    bool HeapProfiler::insertSample(const LiveSample &sample) {
+        if (m_liveSampleCount == m_sampleCapacity) {
+            return false;
+        }
+
+        auto slot = hashValue(reinterpret_cast<uintptr_t>(sample.ptr)) & m_sampleMask;
+
+        while (m_liveSamples[slot].ptr) {
+            slot = (slot + 1) & m_sampleMask;
+        }
+
+        m_liveSamples[slot] = sample;
+        m_liveSampleCount++;
+
+        return true;
+    }
+
+    //! \brief Removes a live allocation from the sample table and the live estimates of its site, the lock must be held.
+    //! \param slot [in] - Slot of the sample within the table.
+    void HeapProfiler::removeSample(size_t slot) {
+        auto &site = m_sites[m_liveSamples[slot].site];
+        site.liveBytes -= m_liveSamples[slot].bytes;
+        site.liveCount -= m_liveSamples[slot].count;
+
+        eraseSample(slot);
+    }
+
+    //! \brief Removes an entry from the sample table without changing the live estimates of its site, the lock must
+    //!        be held.
+    //!
+    //! The entries following the slot are moved back over it where their probe sequence allows, so that lookups
+    //! never require markers for removed entries.
+    //! \param slot [in] - Slot of the sample within the table.
+    void HeapProfiler::eraseSample(size_t slot) {
+        auto hole = slot;
+
+        for (auto next = (slot + 1) & m_sampleMask; m_liveSamples[next].ptr; next = (next + 1) & m_sampleMask) {
+            const auto home = hashValue(reinterpret_cast<uintptr_t>(m_liveSamples[next].ptr)) & m_sampleMask;
+
+            // The entry may only move back if the hole lies between its home slot and its current slot.
+            if (((next - home) & m_sampleMask) >= ((next - hole) & m_sampleMask)) {
+                m_liveSamples[hole] = m_liveSamples[next];
+                hole = next;
+            }
+        }
+
+        m_liveSamples[hole].ptr = nullptr;
+        m_liveSampleCount--;
+    }
+}
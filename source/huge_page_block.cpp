@@ -0,0 +1,56 @@
+
+#include <cstdint>
+
+#include "huge_page_block.h"
+
+namespace ngen::memory {
+    HugePageBlock::HugePageBlock()
+            : m_memoryBlock(nullptr), m_blockSize(0), m_backing(kPageBacking::Invalid) {
+
+    }
+
+    HugePageBlock::~HugePageBlock() {
+        release();
+    }
+
+    //! \brief Allocates the memory block, preferring explicit huge pages.
+    //! \param blockSize [in] - Length (in bytes) of the memory block, this is rounded up to a whole number of huge pages.
+    //! \returns True if the memory block was allocated otherwise false.
+    bool HugePageBlock::allocate(size_t blockSize) {
+        return allocate(blockSize, kPageBacking::HugeTLB);
+    }
+
+    //! \brief Allocates the memory block, falling back to smaller pages if the preferred backing is unavailable.
+    //! \param blockSize [in] - Length (in bytes) of the memory block, this is rounded up to a whole number of huge pages.
+    //! \param backing [in] - The page backing that is preferred for the memory block.
+    //! \returns True if the memory block was allocated otherwise false.
+    bool HugePageBlock::allocate(size_t blockSize, kPageBacking backing) {
+        if (m_memoryBlock || !blockSize) {
+            return false;
+        }
+
+        const auto length = (blockSize + kHugePageSize - 1) & ~(kHugePageSize - 1);
+
+        auto memoryBlock = VirtualMemory::allocate(length, backing, &m_backing);
+        if (!memoryBlock) {
+            // TODO: Log ERR - unable to allocate memory from the operating system
+            return false;
+        }
+
+        m_memoryBlock = memoryBlock;
+        m_blockSize = length;
+
+        return true;
+    }
+
+    //! \brief Returns the memory block to the operating system.
+    void HugePageBlock::release() {
+        if (m_memoryBlock) {
+            VirtualMemory::release(m_memoryBlock, m_blockSize);
+        }
+
+        m_memoryBlock = nullptr;
+        m_blockSize = 0;
+        m_backing = kPageBacking::Invalid;
+    }
+}
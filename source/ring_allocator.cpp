@@ -0,0 +1,305 @@
+
+#include <cstdint>
+#include <cassert>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif //defined(__linux__)
+
+#include "ring_allocator.h"
+
+namespace {
+    constexpr size_t kRecordAlignment = 16;
+
+    constexpr size_t kRecordLive = 0x4c495645;          // 'LIVE'
+    constexpr size_t kRecordReleased = 0x46524545;      // 'FREE'
+    constexpr size_t kRecordSkip = 0x534b4950;          // 'SKIP'
+
+    //! \brief Simple helper function to determine whether or not a value is a power of 2.
+    //! \param value [in] - The number to check if it is a valid power of 2.
+    //! \returns True if the supplied value is a power of 2 otherwise returns false.
+    inline bool isPow2(size_t value) {
+        return (0 != value && (value & (value -1)) == 0);
+    }
+
+    //! \brief Rounds a value up to the next multiple of an alignment.
+    //! \param value [in] - The value to be rounded.
+    //! \param alignment [in] - The alignment to round the value to, must be a power of 2.
+    //! \returns The smallest multiple of alignment that is not less than value.
+    inline size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    //! \brief Computes the padding required before a record, so that the data following it has a specified alignment.
+    //! \param address [in] - The address at which the record would otherwise be placed.
+    //! \param headerLength [in] - The length (in bytes) of the record header.
+    //! \param alignment [in] - The alignment required by the data following the record header.
+    //! \returns The number of bytes to be skipped before the record header is written.
+    inline size_t getPadding(uintptr_t address, size_t headerLength, size_t alignment) {
+        return alignUp(address + headerLength, alignment) - headerLength - address;
+    }
+}
+
+namespace ngen::memory {
+    RingAllocator::RingAllocator()
+            : m_memoryBlock(0), m_capacity(0), m_head(0), m_tail(0), m_isMirrored(false), m_allocations(0), m_failedAllocations(0), m_outOfOrderReleases(0) {
+
+    }
+
+    RingAllocator::~RingAllocator() {
+        releaseMirror();
+    }
+
+    //! \brief Prepares the allocator for use by the application.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be used by this allocator.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \returns True if the allocator was initialized successfully otherwise false.
+    bool RingAllocator::initialize(void *memoryBlock, size_t blockSize) {
+        if (m_capacity) {
+            return false;
+        }
+
+        if (!memoryBlock) {
+            return false;
+        }
+
+        const auto start = reinterpret_cast<uintptr_t>(memoryBlock);
+        const auto alignedStart = alignUp(start, kRecordAlignment);
+
+        if (blockSize < alignedStart - start + sizeof(Record) * 2) {
+            // TODO: Log ERR - memory block is too small to hold a single allocation
+            return false;
+        }
+
+        m_memoryBlock = alignedStart;
+        m_capacity = (blockSize - (alignedStart - start)) & ~(kRecordAlignment - 1);
+        m_head = 0;
+        m_tail = 0;
+
+        return true;
+    }
+
+    //! \brief Prepares the allocator for use with a buffer that is mapped twice in consecutive address ranges.
+    //!
+    //! Writing beyond the end of the first mapping writes to the start of the buffer, so an allocation that wraps
+    //! around the end of the buffer remains contiguous. The buffer is allocated from the operating system and is
+    //! unmapped when the allocator is destroyed.
+    //! \param blockSize [in] - Length (in bytes) of the buffer, this is rounded up to a multiple of the page size.
+    //! \returns True if the allocator was initialized successfully otherwise false.
+    bool RingAllocator::initializeMirrored(size_t blockSize) {
+#if defined(__linux__)
+        if (m_capacity || !blockSize) {
+            return false;
+        }
+
+        const auto capacity = alignUp(blockSize, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+
+        const auto descriptor = memfd_create("ngen_ring_allocator", MFD_CLOEXEC);
+        if (descriptor < 0) {
+            // TODO: Log ERR - unable to create the memory file backing the buffer
+            return false;
+        }
+
+        if (0 != ftruncate(descriptor, static_cast<off_t>(capacity))) {
+            // TODO: Log ERR - unable to size the memory file backing the buffer
+            close(descriptor);
+            return false;
+        }
+
+        auto reserved = mmap(nullptr, capacity * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == reserved) {
+            // TODO: Log ERR - unable to reserve the address range of the buffer
+            close(descriptor);
+            return false;
+        }
+
+        auto first = mmap(reserved, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, descriptor, 0);
+        auto second = mmap(static_cast<char *>(reserved) + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, descriptor, 0);
+
+        // The mappings keep the memory file alive, the descriptor is no longer required.
+        close(descriptor);
+
+        if (MAP_FAILED == first || MAP_FAILED == second) {
+            // TODO: Log ERR - unable to map the buffer twice
+            munmap(reserved, capacity * 2);
+            return false;
+        }
+
+        m_memoryBlock = reinterpret_cast<uintptr_t>(reserved);
+        m_capacity = capacity;
+        m_head = 0;
+        m_tail = 0;
+        m_isMirrored = true;
+
+        return true;
+#else
+        (void)blockSize;
+        return false;
+#endif //defined(__linux__)
+    }
+
+    //! \brief Determines whether or not initializeMirrored is supported by the current platform.
+    //! \returns True if the buffer may be mirrored otherwise false.
+    bool RingAllocator::isMirroringSupported() {
+#if defined(__linux__)
+        return true;
+#else
+        return false;
+#endif //defined(__linux__)
+    }
+
+    //! \brief  Allocates a block of memory of a specified length at the head of the buffer.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *RingAllocator::alloc(size_t dataLength) {
+        return alignedAlloc(dataLength, kDefaultAlignment);
+    }
+
+    //! \brief  Allocates a block of memory of a specified length at the head of the buffer.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two no greater than kMaximumAlignment.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *RingAllocator::alignedAlloc(size_t dataLength, size_t alignment) {
+        if (!isPow2(alignment) || alignment > kMaximumAlignment) {
+            // TODO: Log ERR: alignment was not a supported power of 2
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        if (!m_capacity || dataLength > m_capacity) {
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        alignment = alignment < kRecordAlignment ? kRecordAlignment : alignment;
+
+        const auto recordLength = sizeof(Record) + alignUp(dataLength, kRecordAlignment);
+        const auto offset = m_head % m_capacity;
+
+        size_t skipLength = 0;
+        size_t padding = getPadding(m_memoryBlock + offset, sizeof(Record), alignment);
+
+        if (!m_isMirrored && offset + padding + recordLength > m_capacity) {
+            // The allocation does not fit before the end of the buffer, so the remaining space is skipped.
+            skipLength = m_capacity - offset;
+            padding = getPadding(m_memoryBlock, sizeof(Record), alignment);
+        }
+
+        if (skipLength + padding + recordLength > m_capacity - getUsed()) {
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        if (skipLength) {
+            writeSkipRecord(m_head, skipLength);
+            m_head += skipLength;
+        }
+
+        if (padding) {
+            writeSkipRecord(m_head, padding);
+            m_head += padding;
+        }
+
+        auto record = getRecord(m_head);
+        record->length = recordLength;
+        record->state = kRecordLive;
+
+        m_head += recordLength;
+        m_allocations++;
+
+        return record + 1;
+    }
+
+    //! \brief Releases an allocation made by this allocator.
+    //!
+    //! Memory is reclaimed from the tail of the buffer, so an allocation released while older allocations are still
+    //! live is counted as an out of order release and its memory is not available until they have also been released.
+    //! \param ptr [in] - Pointer to the allocation being released.
+    //! \returns True if the pointer is null or was a live allocation made by this allocator otherwise false.
+    bool RingAllocator::deallocate(void *ptr) {
+        if (!ptr) {
+            return true;
+        }
+
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+
+        if (!owns(ptr) || 0 != (address & (kRecordAlignment - 1)) || address - m_memoryBlock < sizeof(Record)) {
+            // TODO: Log ERR - pointer was not allocated by this allocator
+            return false;
+        }
+
+        auto record = reinterpret_cast<Record *>(address) - 1;
+        if (kRecordLive != record->state) {
+            // TODO: Log ERR - allocation is not live, it may have already been released
+            return false;
+        }
+
+        // Any padding at the tail is skipped, so the tail refers to the oldest live allocation.
+        reclaimRecords();
+
+        const auto offset = (reinterpret_cast<uintptr_t>(record) - m_memoryBlock) % m_capacity;
+        if (offset != m_tail % m_capacity) {
+            // TODO: Log WARN - allocation was released before an older allocation
+            m_outOfOrderReleases++;
+        }
+
+        record->state = kRecordReleased;
+        m_allocations--;
+
+        reclaimRecords();
+        return true;
+    }
+
+    //! \brief Retrieves the record stored at a position within the buffer.
+    //! \param position [in] - Position (in bytes) of the record, this may exceed the capacity of the buffer.
+    //! \returns Pointer to the record within the buffer.
+    RingAllocator::Record *RingAllocator::getRecord(size_t position) const {
+        return reinterpret_cast<Record *>(m_memoryBlock + position % m_capacity);
+    }
+
+    //! \brief Writes a record describing space that is not used by any allocation.
+    //! \param position [in] - Position (in bytes) of the space to be skipped.
+    //! \param length [in] - Length (in bytes) of the space to be skipped, this must be able to hold a record.
+    void RingAllocator::writeSkipRecord(size_t position, size_t length) {
+        assert(length >= sizeof(Record));
+
+        auto record = getRecord(position);
+        record->length = length;
+        record->state = kRecordSkip;
+    }
+
+    //! \brief Advances the tail of the buffer past every released or skipped record, up to the oldest live allocation.
+    void RingAllocator::reclaimRecords() {
+        while (m_tail != m_head) {
+            auto record = getRecord(m_tail);
+            if (kRecordLive == record->state) {
+                break;
+            }
+
+            m_tail += record->length;
+        }
+
+        if (m_tail == m_head) {
+            // The buffer is empty, restarting at its beginning avoids skipping space at its end.
+            m_head = 0;
+            m_tail = 0;
+        }
+    }
+
+    //! \brief Unmaps the buffer if it was mapped by initializeMirrored.
+    void RingAllocator::releaseMirror() {
+#if defined(__linux__)
+        if (m_isMirrored) {
+            munmap(reinterpret_cast<void *>(m_memoryBlock), m_capacity * 2);
+        }
+#endif //defined(__linux__)
+
+        m_memoryBlock = 0;
+        m_capacity = 0;
+        m_isMirrored = false;
+    }
+}
@@ -0,0 +1,262 @@
+
+#include <cstdint>
+#include <cassert>
+
+#include "heap.h"
+#include "size_tree_index.h"
+
+namespace {
+    using ngen::memory::FreeBlock;
+
+    //! \brief Determines the ordering of two free blocks within the tree, blocks are ordered by size and then address.
+    //! \param lhs [in] - The first block to be compared.
+    //! \param rhs [in] - The second block to be compared.
+    //! \returns True if lhs should be placed before rhs otherwise false.
+    inline bool isOrderedBefore(const FreeBlock *lhs, const FreeBlock *rhs) {
+        return lhs->size < rhs->size || (lhs->size == rhs->size && lhs < rhs);
+    }
+
+    //! \brief Retrieves the height of a sub-tree.
+    //! \param block [in] - The root of the sub-tree, may be null.
+    //! \returns The height of the sub-tree, an empty sub-tree has a height of zero.
+    inline ptrdiff_t getHeight(const FreeBlock *block) {
+        return block ? static_cast<ptrdiff_t>(block->index.tree.height) : 0;
+    }
+
+    //! \brief Recomputes the height of a node from the height of its children.
+    //! \param block [in] - The node whose height is to be updated.
+    inline void updateHeight(FreeBlock *block) {
+        const auto leftHeight = getHeight(block->index.tree.left);
+        const auto rightHeight = getHeight(block->index.tree.right);
+
+        block->index.tree.height = static_cast<size_t>((leftHeight > rightHeight ? leftHeight : rightHeight) + 1);
+    }
+}
+
+namespace ngen::memory {
+    SizeTreeIndex::SizeTreeIndex()
+            : m_root(nullptr), m_count(0) {
+
+    }
+
+    //! \brief Adds a free block to the index.
+    //! \param block [in] - The free block to be added, the block must not already be within the index.
+    void SizeTreeIndex::insert(FreeBlock *block) {
+        assert(nullptr != block);
+
+        auto &tree = block->index.tree;
+        tree.left = nullptr;
+        tree.right = nullptr;
+        tree.height = 1;
+
+        FreeBlock *parent = nullptr;
+        FreeBlock **link = &m_root;
+
+        while (*link) {
+            parent = *link;
+            link = isOrderedBefore(block, parent) ? &parent->index.tree.left : &parent->index.tree.right;
+        }
+
+        *link = block;
+        tree.parent = parent;
+
+        rebalance(parent);
+        m_count++;
+    }
+
+    //! \brief Removes a free block from the index.
+    //! \param block [in] - The free block to be removed, its size must not have changed since it was inserted.
+    void SizeTreeIndex::remove(FreeBlock *block) {
+        assert(nullptr != block);
+        assert(m_count > 0);
+
+        auto &tree = block->index.tree;
+        FreeBlock *rebalanceFrom;
+
+        if (tree.left && tree.right) {
+            // Move the in-order successor into the position held by the block being removed.
+            auto replacement = tree.right;
+            while (replacement->index.tree.left) {
+                replacement = replacement->index.tree.left;
+            }
+
+            auto &replacementTree = replacement->index.tree;
+
+            if (replacementTree.parent == block) {
+                rebalanceFrom = replacement;
+            } else {
+                rebalanceFrom = replacementTree.parent;
+
+                rebalanceFrom->index.tree.left = replacementTree.right;
+                if (replacementTree.right) {
+                    replacementTree.right->index.tree.parent = rebalanceFrom;
+                }
+
+                replacementTree.right = tree.right;
+                tree.right->index.tree.parent = replacement;
+            }
+
+            replacementTree.left = tree.left;
+            tree.left->index.tree.parent = replacement;
+            replacementTree.height = tree.height;
+
+            replaceChild(tree.parent, block, replacement);
+        } else {
+            rebalanceFrom = tree.parent;
+            replaceChild(tree.parent, block, tree.left ? tree.left : tree.right);
+        }
+
+        tree.parent = nullptr;
+        tree.left = nullptr;
+        tree.right = nullptr;
+
+        rebalance(rebalanceFrom);
+        m_count--;
+    }
+
+    //! \brief Locates the smallest free block that is at least the specified length.
+    //! \param blockLength [in] - The minimum length (in bytes) of the free block.
+    //! \returns Pointer to the smallest free block of at least the specified length or nullptr if none was available.
+    FreeBlock *SizeTreeIndex::lowerBound(size_t blockLength) const {
+        FreeBlock *selected = nullptr;
+
+        for (auto search = m_root; search;) {
+            if (search->size >= blockLength) {
+                selected = search;
+                search = search->index.tree.left;
+            } else {
+                search = search->index.tree.right;
+            }
+        }
+
+        return selected;
+    }
+
+    //! \brief Retrieves the largest free block within the index.
+    //! \returns The largest free block or nullptr if the index is empty.
+    FreeBlock *SizeTreeIndex::getLargest() const {
+        auto largest = m_root;
+
+        while (largest && largest->index.tree.right) {
+            largest = largest->index.tree.right;
+        }
+
+        return largest;
+    }
+
+    //! \brief Retrieves the next free block within the index, in order of size.
+    //! \param block [in] - The free block whose successor is required.
+    //! \returns The next largest free block or nullptr if the supplied block was the largest.
+    FreeBlock *SizeTreeIndex::successor(FreeBlock *block) {
+        assert(nullptr != block);
+
+        if (block->index.tree.right) {
+            block = block->index.tree.right;
+
+            while (block->index.tree.left) {
+                block = block->index.tree.left;
+            }
+
+            return block;
+        }
+
+        auto parent = block->index.tree.parent;
+
+        while (parent && block == parent->index.tree.right) {
+            block = parent;
+            parent = parent->index.tree.parent;
+        }
+
+        return parent;
+    }
+
+    //! \brief Replaces the child of a node, updating the root of the tree if the node has no parent.
+    //! \param parent [in] - The node whose child is to be replaced, may be null.
+    //! \param oldChild [in] - The child being replaced.
+    //! \param newChild [in] - The node taking the place of the old child, may be null.
+    void SizeTreeIndex::replaceChild(FreeBlock *parent, FreeBlock *oldChild, FreeBlock *newChild) {
+        if (!parent) {
+            m_root = newChild;
+        } else if (parent->index.tree.left == oldChild) {
+            parent->index.tree.left = newChild;
+        } else {
+            parent->index.tree.right = newChild;
+        }
+
+        if (newChild) {
+            newChild->index.tree.parent = parent;
+        }
+    }
+
+    //! \brief Rotates a sub-tree to the left, promoting the right child of the supplied node.
+    //! \param block [in] - The root of the sub-tree to be rotated.
+    //! \returns The new root of the sub-tree.
+    FreeBlock *SizeTreeIndex::rotateLeft(FreeBlock *block) {
+        auto pivot = block->index.tree.right;
+
+        block->index.tree.right = pivot->index.tree.left;
+        if (pivot->index.tree.left) {
+            pivot->index.tree.left->index.tree.parent = block;
+        }
+
+        replaceChild(block->index.tree.parent, block, pivot);
+
+        pivot->index.tree.left = block;
+        block->index.tree.parent = pivot;
+
+        updateHeight(block);
+        updateHeight(pivot);
+        return pivot;
+    }
+
+    //! \brief Rotates a sub-tree to the right, promoting the left child of the supplied node.
+    //! \param block [in] - The root of the sub-tree to be rotated.
+    //! \returns The new root of the sub-tree.
+    FreeBlock *SizeTreeIndex::rotateRight(FreeBlock *block) {
+        auto pivot = block->index.tree.left;
+
+        block->index.tree.left = pivot->index.tree.right;
+        if (pivot->index.tree.right) {
+            pivot->index.tree.right->index.tree.parent = block;
+        }
+
+        replaceChild(block->index.tree.parent, block, pivot);
+
+        pivot->index.tree.right = block;
+        block->index.tree.parent = pivot;
+
+        updateHeight(block);
+        updateHeight(pivot);
+        return pivot;
+    }
+
+    //! \brief Restores the balance of the tree, walking from the supplied node to the root.
+    //! \param block [in] - The deepest node whose sub-tree may have changed height, may be null.
+    void SizeTreeIndex::rebalance(FreeBlock *block) {
+        while (block) {
+            updateHeight(block);
+
+            const auto balance = getHeight(block->index.tree.left) - getHeight(block->index.tree.right);
+
+            if (balance > 1) {
+                auto left = block->index.tree.left;
+
+                if (getHeight(left->index.tree.left) < getHeight(left->index.tree.right)) {
+                    rotateLeft(left);
+                }
+
+                block = rotateRight(block);
+            } else if (balance < -1) {
+                auto right = block->index.tree.right;
+
+                if (getHeight(right->index.tree.right) < getHeight(right->index.tree.left)) {
+                    rotateRight(right);
+                }
+
+                block = rotateLeft(block);
+            }
+
+            block = block->index.tree.parent;
+        }
+    }
+}
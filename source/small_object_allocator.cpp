@@ -0,0 +1,435 @@
+
+#include <cstdint>
+#include <cassert>
+#include <new>
+
+#include "small_object_allocator.h"
+
+namespace {
+    using ngen::memory::SmallObjectAllocator;
+
+    //! \brief Length (in bytes) of the objects served by each size class.
+    constexpr size_t kSizeClassLengths[SmallObjectAllocator::kSizeClassCount] = {
+        8, 16, 24, 32, 48, 64, 96, 128
+    };
+
+    //! \brief Maps a request length (rounded up to a multiple of 8 bytes) to the smallest size class able to hold it.
+    constexpr uint8_t kSizeClassLookup[SmallObjectAllocator::kMaximumObjectSize / 8 + 1] = {
+        0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7
+    };
+
+    //! \brief Given a pointer address, this method returns the next valid address that is aligned with the specified size.
+    //! If the pointer is already aligned, it is returned unchanged.
+    //! \param ptr [in] The pointer address to be aligned.
+    //! \param alignment [in] The desired byte alignment of the pointer.
+    //! \return The pointer address aligned to the specified alignment.
+    template <typename TType> inline TType alignValue(TType value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    //! \brief Determines the largest alignment that every object within a size class is guaranteed to have.
+    //! \param sizeClass [in] - Index of the size class whose alignment is to be determined.
+    //! \returns The alignment (in bytes) of all objects served by the size class.
+    inline size_t getSizeClassAlignment(size_t sizeClass) {
+        const auto length = kSizeClassLengths[sizeClass];
+        const auto alignment = length & (~length + 1);
+
+        return alignment < SmallObjectAllocator::kPageAlignment ? alignment : SmallObjectAllocator::kPageAlignment;
+    }
+
+    //! \brief Determines whether or not the bit of an object is set within a page mask.
+    //! \param mask [in] - The page mask to be examined.
+    //! \param index [in] - Index of the object within its page.
+    //! \returns True if the bit of the object is set otherwise false.
+    inline bool testObject(const std::atomic<uint64_t> *mask, size_t index) {
+        return 0 != (mask[index / 64].load(std::memory_order_relaxed) & (uint64_t(1) << (index % 64)));
+    }
+
+    //! \brief Sets or clears the bit of an object within a page mask that only the allocating thread modifies.
+    //! \param mask [in] - The page mask to be modified.
+    //! \param index [in] - Index of the object within its page.
+    //! \param value [in] - True if the bit is to be set otherwise false.
+    inline void assignObject(std::atomic<uint64_t> *mask, size_t index, bool value) {
+        const auto bit = uint64_t(1) << (index % 64);
+        const auto word = mask[index / 64].load(std::memory_order_relaxed);
+
+        mask[index / 64].store(value ? (word | bit) : (word & ~bit), std::memory_order_relaxed);
+    }
+}
+
+namespace ngen::memory {
+    SmallObjectAllocator::SmallObjectAllocator()
+            : m_pages(nullptr), m_freePages(nullptr), m_partialPages{}, m_firstPage(0), m_lastPage(0),
+              m_pageCount(0), m_freePageCount(0), m_allocations(0) {
+
+    }
+
+    //! \brief Prepares the allocator for use, dividing the supplied memory into pages.
+    //! \param memoryBlock [in] - Pointer to the raw memory block to be used by this allocator.
+    //! \param blockSize [in] - Length (in bytes) of the memory block pointed to by the memoryBlock parameter.
+    //! \returns True if the allocator was initialized successfully otherwise false.
+    bool SmallObjectAllocator::initialize(void *memoryBlock, size_t blockSize) {
+        if (m_pages) {
+            return false;
+        }
+
+        if (!memoryBlock) {
+            return false;
+        }
+
+        // The page descriptors live at the start of the region, separate from the pages themselves so the
+        // whole of each page is available for objects.
+        const auto rawPtr = reinterpret_cast<uintptr_t>(memoryBlock);
+        const auto descriptorStart = alignValue(rawPtr, alignof(Page));
+        const auto endPtr = rawPtr + blockSize;
+
+        if (descriptorStart >= endPtr) {
+            return false;
+        }
+
+        auto pageCount = (endPtr - descriptorStart) / (kPageSize + sizeof(Page));
+
+        while (pageCount) {
+            const auto firstPage = alignValue(descriptorStart + pageCount * sizeof(Page), kPageAlignment);
+
+            if (firstPage + pageCount * kPageSize <= endPtr) {
+                break;
+            }
+
+            pageCount--;
+        }
+
+        if (!pageCount) {
+            // TODO: Log ERR - region too small to contain a single page
+            return false;
+        }
+
+        m_pages = reinterpret_cast<Page *>(descriptorStart);
+        m_pageCount = pageCount;
+        m_firstPage = alignValue(descriptorStart + pageCount * sizeof(Page), kPageAlignment);
+        m_lastPage = m_firstPage + pageCount * kPageSize;
+
+        // Build the list of unassigned pages in reverse, so pages are handed out in address order.
+        for (size_t loop = pageCount; loop > 0; --loop) {
+            auto page = new(&m_pages[loop - 1]) Page{};
+            pushPage(m_freePages, page);
+        }
+
+        m_freePageCount = pageCount;
+        return true;
+    }
+
+    //! \brief  Allocates a small object of at least the specified length.
+    //! \param  dataLength [in] -
+    //!         Length (in bytes) of the memory block to be allocated.
+    //! \param  alignment [in] -
+    //!         Specifies the alignment of the allocated memory block. Must be a power of two.
+    //! \param  isArray [in] -
+    //!         True if the object is allocated by an array new operator otherwise false.
+    //! \return Pointer to a memory block at least of the specified length or null if it could not be allocated.
+    void *SmallObjectAllocator::alloc(size_t dataLength, size_t alignment, bool isArray) {
+        if (!m_pages || dataLength > kMaximumObjectSize) {
+            return nullptr;
+        }
+
+        auto sizeClass = static_cast<size_t>(kSizeClassLookup[(dataLength + 7) / 8]);
+
+        // Objects are packed back to back within a page, so step up to a size class whose length
+        // guarantees the requested alignment.
+        while (sizeClass < kSizeClassCount && getSizeClassAlignment(sizeClass) < alignment) {
+            sizeClass++;
+        }
+
+        if (sizeClass >= kSizeClassCount) {
+            return nullptr;
+        }
+
+        auto page = m_partialPages[sizeClass];
+
+        if (!page) {
+            page = acquirePage(sizeClass);
+
+            if (!page) {
+                return nullptr;
+            }
+        }
+
+        void *object;
+        size_t index;
+
+        if (page->freeList) {
+            object = page->freeList;
+            page->freeList = page->freeList->next;
+
+            index = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(object) - getPageAddress(page)) / static_cast<uint32_t>(kSizeClassLengths[sizeClass]);
+        } else {
+            assert(page->bumpIndex < page->capacity);
+            index = page->bumpIndex++;
+            object = reinterpret_cast<void *>(getPageAddress(page) + index * kSizeClassLengths[sizeClass]);
+        }
+
+        assignObject(page->liveObjects, index, true);
+        assignObject(page->arrayObjects, index, isArray);
+
+        page->used++;
+
+        if (page->used == page->capacity) {
+            removePage(m_partialPages[sizeClass], page);
+        }
+
+        m_allocations++;
+        return object;
+    }
+
+    //! \brief Releases an object previously allocated by this allocator.
+    //! \param ptr [in] - Pointer to the object to be released.
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \returns True if the object was released otherwise false.
+    bool SmallObjectAllocator::deallocate(void *ptr, bool isArray) {
+        if (!owns(ptr)) {
+            return false;
+        }
+
+        auto page = getPage(ptr);
+
+        size_t index;
+        if (!getObjectIndex(page, ptr, index)) {
+            // TODO: Log ERR - pointer does not reference the start of an object
+            return false;
+        }
+
+        if (!testObject(page->liveObjects, index) || testObject(page->queuedObjects, index)) {
+            // TODO: Log ERR - object has already been released
+            return false;
+        }
+
+        if (testObject(page->arrayObjects, index) != isArray) {
+            // TODO: Log ERR - array mismatch
+            return false;
+        }
+
+        releaseObject(page, ptr, index);
+        return true;
+    }
+
+    //! \brief Validates the release of an object by a thread other than the one using the allocator, claiming it so
+    //!        that it cannot be released again before releaseQueued is called for it.
+    //!
+    //! This may be called while another thread is using the allocator, the page descriptor is only read besides the
+    //! claim made on the bit of the object.
+    //! \param ptr [in] - Pointer to the object to be released.
+    //! \param isArray [in] - True if the deallocation came from an array delete operator otherwise false.
+    //! \returns True if the object was claimed, and must be passed to releaseQueued, otherwise false.
+    bool SmallObjectAllocator::queueRelease(const void *ptr, bool isArray) {
+        if (!owns(ptr)) {
+            return false;
+        }
+
+        auto page = getPage(ptr);
+
+        size_t index;
+        if (!getObjectIndex(page, ptr, index)) {
+            // TODO: Log ERR - pointer does not reference the start of an object
+            return false;
+        }
+
+        if (!testObject(page->liveObjects, index)) {
+            // TODO: Log ERR - object has already been released
+            return false;
+        }
+
+        if (testObject(page->arrayObjects, index) != isArray) {
+            // TODO: Log ERR - array mismatch
+            return false;
+        }
+
+        const auto bit = uint64_t(1) << (index % 64);
+
+        if (page->queuedObjects[index / 64].fetch_or(bit, std::memory_order_relaxed) & bit) {
+            // TODO: Log ERR - object has already been released
+            return false;
+        }
+
+        return true;
+    }
+
+    //! \brief Releases an object that was claimed by queueRelease.
+    //! \param ptr [in] - Pointer to the object to be released.
+    //! \returns True if the object was released otherwise false.
+    bool SmallObjectAllocator::releaseQueued(void *ptr) {
+        if (!owns(ptr)) {
+            return false;
+        }
+
+        auto page = getPage(ptr);
+
+        size_t index;
+        if (!getObjectIndex(page, ptr, index)) {
+            return false;
+        }
+
+        const auto bit = uint64_t(1) << (index % 64);
+
+        if (!(page->queuedObjects[index / 64].fetch_and(~bit, std::memory_order_relaxed) & bit)) {
+            // TODO: Log ERR - object was not queued for release
+            return false;
+        }
+
+        releaseObject(page, ptr, index);
+        return true;
+    }
+
+    //! \brief Returns a live object to the free list of its page.
+    //! \param page [in] - The page containing the object.
+    //! \param ptr [in] - Pointer to the object to be released.
+    //! \param index [in] - Index of the object within its page.
+    void SmallObjectAllocator::releaseObject(Page *page, void *ptr, size_t index) {
+        assert(page->used);
+        assignObject(page->liveObjects, index, false);
+
+        if (page->used == page->capacity) {
+            pushPage(m_partialPages[page->sizeClass], page);
+        }
+
+        auto object = static_cast<FreeObject *>(ptr);
+        object->next = page->freeList;
+        page->freeList = object;
+        page->used--;
+
+        if (!page->used) {
+            releasePage(page);
+        }
+
+        m_allocations--;
+    }
+
+    //! \brief Retrieves the usable length of an object served by this allocator.
+    //! \param ptr [in] - Pointer to an object previously allocated by this allocator.
+    //! \returns The length (in bytes) of the object or zero if the pointer was not served by this allocator.
+    size_t SmallObjectAllocator::getObjectSize(const void *ptr) const {
+        if (!owns(ptr)) {
+            return 0;
+        }
+
+        return kSizeClassLengths[getPage(ptr)->sizeClass];
+    }
+
+    //! \brief Determines whether or not a live object was allocated as an array.
+    //! \param ptr [in] - Pointer to a live object previously allocated by this allocator.
+    //! \returns True if the object was allocated by an array new operator otherwise false.
+    bool SmallObjectAllocator::isArrayObject(const void *ptr) const {
+        if (!owns(ptr)) {
+            return false;
+        }
+
+        auto page = getPage(ptr);
+
+        size_t index;
+        return getObjectIndex(page, ptr, index) && testObject(page->arrayObjects, index);
+    }
+
+    //! \brief Retrieves the length of the objects served by a size class.
+    //! \param sizeClass [in] - Index of the size class whose length is required.
+    //! \returns The length (in bytes) of each object within the size class, or zero if the size class is invalid.
+    size_t SmallObjectAllocator::getSizeClassLength(size_t sizeClass) {
+        return sizeClass < kSizeClassCount ? kSizeClassLengths[sizeClass] : 0;
+    }
+
+    //! \brief Retrieves the descriptor of the page containing the specified pointer.
+    //! \param ptr [in] - Pointer within the page region, must be owned by this allocator.
+    //! \returns The descriptor of the page that contains the pointer.
+    SmallObjectAllocator::Page *SmallObjectAllocator::getPage(const void *ptr) const {
+        assert(owns(ptr));
+        return &m_pages[(reinterpret_cast<uintptr_t>(ptr) - m_firstPage) / kPageSize];
+    }
+
+    //! \brief Determines the index of an object within its page.
+    //! \param page [in] - The page containing the pointer.
+    //! \param ptr [in] - Pointer within the page.
+    //! \param index [out] - Receives the index of the object that starts at the pointer.
+    //! \returns True if the pointer references the start of an object otherwise false.
+    bool SmallObjectAllocator::getObjectIndex(const Page *page, const void *ptr, size_t &index) const {
+        const auto offset = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr) - getPageAddress(page));
+        const auto length = static_cast<uint32_t>(kSizeClassLengths[page->sizeClass]);
+
+        if (offset % length) {
+            return false;
+        }
+
+        index = offset / length;
+        return true;
+    }
+
+    //! \brief Retrieves the address of the first byte of memory described by a page descriptor.
+    //! \param page [in] - The page descriptor whose memory address is required.
+    //! \returns The address of the memory described by the page.
+    uintptr_t SmallObjectAllocator::getPageAddress(const Page *page) const {
+        return m_firstPage + static_cast<size_t>(page - m_pages) * kPageSize;
+    }
+
+    //! \brief Assigns an unused page to the specified size class.
+    //! \param sizeClass [in] - The size class the page is to serve.
+    //! \returns The page that was assigned or nullptr if no pages were available.
+    SmallObjectAllocator::Page *SmallObjectAllocator::acquirePage(size_t sizeClass) {
+        auto page = m_freePages;
+
+        if (!page) {
+            return nullptr;
+        }
+
+        removePage(m_freePages, page);
+        m_freePageCount--;
+
+        page->freeList = nullptr;
+        page->sizeClass = static_cast<uint32_t>(sizeClass);
+        page->used = 0;
+        page->capacity = static_cast<uint32_t>(kPageSize / kSizeClassLengths[sizeClass]);
+        page->bumpIndex = 0;
+
+        pushPage(m_partialPages[sizeClass], page);
+        return page;
+    }
+
+    //! \brief Returns a page that no longer contains any live objects to the pool of unused pages.
+    //! \param page [in] - The empty page to be released.
+    void SmallObjectAllocator::releasePage(Page *page) {
+        assert(0 == page->used);
+
+        removePage(m_partialPages[page->sizeClass], page);
+        pushPage(m_freePages, page);
+
+        m_freePageCount++;
+    }
+
+    //! \brief Inserts a page at the head of a page list.
+    //! \param list [in] - The head of the list the page is to be inserted into.
+    //! \param page [in] - The page to be inserted.
+    void SmallObjectAllocator::pushPage(Page *&list, Page *page) {
+        page->previous = nullptr;
+        page->next = list;
+
+        if (list) {
+            list->previous = page;
+        }
+
+        list = page;
+    }
+
+    //! \brief Removes a page from a page list.
+    //! \param list [in] - The head of the list the page is to be removed from.
+    //! \param page [in] - The page to be removed.
+    void SmallObjectAllocator::removePage(Page *&list, Page *page) {
+        if (page->previous) {
+            page->previous->next = page->next;
+        } else {
+            list = page->next;
+        }
+
+        if (page->next) {
+            page->next->previous = page->previous;
+        }
+
+        page->previous = nullptr;
+        page->next = nullptr;
+    }
+}
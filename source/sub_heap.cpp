@@ -0,0 +1,330 @@
+
+#include "sub_heap.h"
+
+namespace ngen::memory {
+    SubHeap::SubHeap()
+            : m_parent(nullptr), m_region(nullptr), m_tag(nullptr), m_budget(0), m_budgetPolicy(kBudgetPolicy::FailFast), m_fallbacks(nullptr), m_bytesInUse(0), m_peakBytesInUse(0)
+            , m_allocations(0), m_totalAllocations(0), m_failedAllocations(0), m_fallbackAllocations(0), m_fallbackBytes(0), m_totalFallbackAllocations(0) {
+
+    }
+
+    SubHeap::~SubHeap() {
+        release();
+
+        // Allocations made from the parent are recorded by the sub heap, so they cannot outlive it.
+        while (m_fallbacks) {
+            auto fallback = m_fallbacks;
+
+            if (!deallocate(fallback->address, false, nullptr, 0)) {
+                // TODO: Log ERR - parent heap rejected an allocation made by the sub heap
+                unlinkFallback(fallback);
+            }
+        }
+    }
+
+    //! \brief Allocates the region of the sub heap from its parent and prepares it for use by the application.
+    //! \param parent [in] - The heap the region is allocated from, which must outlive the region.
+    //! \param tag [in] - Name of the subsystem the sub heap accounts for, the string is not copied.
+    //! \param budget [in] - Length (in bytes) of the region, which includes the overhead of the allocations made from it.
+    //! \param budgetPolicy [in] - The behaviour of the sub heap once its budget has been exhausted.
+    //! \returns True if the sub heap was initialized successfully otherwise false.
+    bool SubHeap::initialize(Heap &parent, const char *tag, size_t budget, kBudgetPolicy budgetPolicy) {
+        return initialize(parent, tag, budget, budgetPolicy, detail::kDefaultAllocationStrategy);
+    }
+
+    //! \brief Allocates the region of the sub heap from its parent and prepares it for use by the application.
+    //! \param parent [in] - The heap the region is allocated from, which must outlive the region.
+    //! \param tag [in] - Name of the subsystem the sub heap accounts for, the string is not copied.
+    //! \param budget [in] - Length (in bytes) of the region, which includes the overhead of the allocations made from it.
+    //! \param budgetPolicy [in] - The behaviour of the sub heap once its budget has been exhausted.
+    //! \param allocationStrategy [in] - The strategy used to search for free blocks within the region.
+    //! \returns True if the sub heap was initialized successfully otherwise false.
+    bool SubHeap::initialize(Heap &parent, const char *tag, size_t budget, kBudgetPolicy budgetPolicy, kAllocationStrategy allocationStrategy) {
+        if (m_region) {
+            return false;
+        }
+
+        if (m_allocations) {
+            // TODO: Log ERR - allocations made from the previous parent have not been released
+            return false;
+        }
+
+        if (!tag || !budget) {
+            return false;
+        }
+
+        auto region = parent.alloc(budget);
+        if (!region) {
+            // TODO: Log ERR - parent heap unable to supply the region
+            return false;
+        }
+
+        m_heap.emplace();
+
+        if (!m_heap->initialize(region, budget, allocationStrategy)) {
+            m_heap.reset();
+            parent.deallocate(region, false, nullptr, 0);
+            return false;
+        }
+
+        m_parent = &parent;
+        m_region = region;
+        m_tag = tag;
+        m_budget = budget;
+        m_budgetPolicy = budgetPolicy;
+
+        m_bytesInUse = 0;
+        m_peakBytesInUse = 0;
+        m_totalAllocations = 0;
+        m_failedAllocations = 0;
+        m_fallbackBytes = 0;
+        m_totalFallbackAllocations = 0;
+
+        return true;
+    }
+
+    //! \brief Returns the whole region to the parent heap, typically when the subsystem shuts down.
+    //!
+    //! Allocations still held within the region are abandoned, and must not be accessed once it has been released.
+    //! Allocations made from the parent remain valid, and may still be released through the sub heap.
+    //! \returns The number of allocations that were abandoned within the region, zero for a clean shutdown.
+    size_t SubHeap::release() {
+        if (!m_region) {
+            return 0;
+        }
+
+        const auto abandoned = m_allocations - m_fallbackAllocations;
+
+        m_heap.reset();
+        m_parent->deallocate(m_region, false, nullptr, 0);
+        m_region = nullptr;
+
+        m_allocations = m_fallbackAllocations;
+        m_bytesInUse = m_fallbackBytes;
+
+        return abandoned;
+    }
+
+    //! \brief Allocates a block of memory from the sub heap.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \returns Pointer to the allocated memory block, or null if the allocation could not be made.
+    void *SubHeap::alloc(size_t dataLength) {
+        return allocate(dataLength, 0, nullptr, 0);
+    }
+
+    //! \brief Allocates a block of memory from the sub heap with the specified alignment.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, must be a power of two.
+    //! \returns Pointer to the allocated memory block, or null if the allocation could not be made.
+    void *SubHeap::alignedAlloc(size_t dataLength, size_t alignment) {
+        return allocate(dataLength, alignment, nullptr, 0);
+    }
+
+    //! \brief Allocates a block of memory from the sub heap.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    //! \returns Pointer to the allocated memory block, or null if the allocation could not be made.
+    void *SubHeap::alloc(size_t dataLength, const char *fileName, size_t line) {
+        return allocate(dataLength, 0, fileName, line);
+    }
+
+    //! \brief Allocates a block of memory from the sub heap with the specified alignment.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, must be a power of two.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    //! \returns Pointer to the allocated memory block, or null if the allocation could not be made.
+    void *SubHeap::alignedAlloc(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        return allocate(dataLength, alignment, fileName, line);
+    }
+
+    //! \brief Returns an allocation made by the sub heap, whether it was made from the region or the parent.
+    //! \param ptr [in] - Pointer to the allocation to be released.
+    //! \param isArray [in] - True if the allocation is being released as an array otherwise false.
+    //! \param fileName [in] - The path of the source file that released the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was released.
+    //! \returns True if the allocation was released otherwise false.
+    bool SubHeap::deallocate(void *ptr, bool isArray, const char *fileName, size_t line) {
+        // We treat an attempt to free a nullptr as always successful.
+        if (!ptr) {
+            return true;
+        }
+
+        if (owns(ptr)) {
+            const auto usableSize = m_heap->getUsableSize(ptr);
+
+            if (!m_heap->deallocate(ptr, isArray, fileName, line)) {
+                return false;
+            }
+
+            m_bytesInUse -= usableSize;
+            m_allocations--;
+
+            return true;
+        }
+
+        const auto usableSize = m_fallbacks ? m_parent->getUsableSize(ptr) : 0;
+
+        auto fallback = findFallback(ptr, usableSize);
+        if (!fallback) {
+            // TODO: Log ERR - attempting to release memory not allocated by this sub heap
+            return false;
+        }
+
+        unlinkFallback(fallback);
+
+        if (!m_parent->deallocate(ptr, isArray, fileName, line)) {
+            linkFallback(fallback);
+            return false;
+        }
+
+        m_bytesInUse -= usableSize;
+        m_fallbackBytes -= usableSize;
+        m_allocations--;
+        m_fallbackAllocations--;
+
+        return true;
+    }
+
+    //! \brief Makes an allocation from the region, falling back to the parent if permitted once the region is exhausted.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, zero selects the default alignment.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    //! \returns Pointer to the allocated memory block, or null if the allocation could not be made.
+    void *SubHeap::allocate(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        if (!m_region) {
+            // TODO: Log ERR - sub heap has not been initialized
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        auto ptr = alignment ? m_heap->alignedAlloc(dataLength, alignment, fileName, line) : m_heap->alloc(dataLength, fileName, line);
+        if (ptr) {
+            recordAllocation(m_heap->getUsableSize(ptr));
+            return ptr;
+        }
+
+        if (kBudgetPolicy::FallbackToParent != m_budgetPolicy) {
+            // TODO: Log ERR - budget exhausted
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        ptr = allocateFallback(dataLength, alignment, fileName, line);
+        if (!ptr) {
+            m_failedAllocations++;
+            return nullptr;
+        }
+
+        const auto usableSize = m_parent->getUsableSize(ptr);
+
+        m_fallbackBytes += usableSize;
+        m_fallbackAllocations++;
+        m_totalFallbackAllocations++;
+
+        recordAllocation(usableSize);
+        return ptr;
+    }
+
+    //! \brief Makes an allocation from the parent, recording it at the end of its block so that it can be recognized.
+    //! \param dataLength [in] - The length (in bytes) of the memory block to be allocated.
+    //! \param alignment [in] - The alignment (in bytes) of the memory block, zero selects the default alignment.
+    //! \param fileName [in] - The path of the source file that made the allocation, this may be null.
+    //! \param line [in] - The line number within the source file where the allocation was requested.
+    //! \returns Pointer to the allocated memory block, or null if the allocation could not be made.
+    void *SubHeap::allocateFallback(size_t dataLength, size_t alignment, const char *fileName, size_t line) {
+        if (dataLength > SIZE_MAX - kFallbackOverhead) {
+            return nullptr;
+        }
+
+        const auto allocationLength = dataLength + kFallbackOverhead;
+
+        auto ptr = alignment ? m_parent->alignedAlloc(allocationLength, alignment, fileName, line) : m_parent->alloc(allocationLength, fileName, line);
+        if (!ptr) {
+            return nullptr;
+        }
+
+        auto fallback = locateFallback(ptr, m_parent->getUsableSize(ptr));
+        fallback->address = ptr;
+
+        linkFallback(fallback);
+        return ptr;
+    }
+
+    //! \brief Updates the counters of the sub heap with an allocation that has been made.
+    //! \param usableSize [in] - The number of bytes that may be used by the allocation.
+    void SubHeap::recordAllocation(size_t usableSize) {
+        m_bytesInUse += usableSize;
+        m_allocations++;
+        m_totalAllocations++;
+
+        if (m_bytesInUse > m_peakBytesInUse) {
+            m_peakBytesInUse = m_bytesInUse;
+        }
+    }
+
+    //! \brief Retrieves the record stored at the end of an allocation made from the parent.
+    //! \param ptr [in] - Pointer to the allocation.
+    //! \param usableSize [in] - The number of bytes the parent reports may be used by the allocation.
+    //! \returns Pointer to the record, which lies beyond the length requested for the allocation.
+    SubHeap::FallbackAllocation *SubHeap::locateFallback(const void *ptr, size_t usableSize) {
+        const auto end = reinterpret_cast<uintptr_t>(ptr) + usableSize - sizeof(FallbackAllocation);
+        return reinterpret_cast<FallbackAllocation *>(end / alignof(FallbackAllocation) * alignof(FallbackAllocation));
+    }
+
+    //! \brief Determines whether or not an allocation of the parent was made by this sub heap.
+    //! \param ptr [in] - Pointer to the allocation.
+    //! \param usableSize [in] - The number of bytes the parent reports may be used by the allocation, zero if the
+    //!                          parent did not make the allocation.
+    //! \returns Pointer to the record of the allocation, or null if it was not made from the parent by this sub heap.
+    SubHeap::FallbackAllocation *SubHeap::findFallback(const void *ptr, size_t usableSize) const {
+        if (usableSize < kFallbackOverhead) {
+            return nullptr;
+        }
+
+        auto fallback = locateFallback(ptr, usableSize);
+
+        if (fallback->owner != this || fallback->address != ptr) {
+            return nullptr;
+        }
+
+        // The record must also be linked into the list of the sub heap, as the allocation may belong to another user.
+        if (fallback->previous ? fallback->previous->next != fallback : m_fallbacks != fallback) {
+            return nullptr;
+        }
+
+        return fallback;
+    }
+
+    //! \brief Adds the record of an allocation made from the parent to the list held by the sub heap.
+    //! \param fallback [in] - The record to be added.
+    void SubHeap::linkFallback(FallbackAllocation *fallback) {
+        fallback->owner = this;
+        fallback->previous = nullptr;
+        fallback->next = m_fallbacks;
+
+        if (m_fallbacks) {
+            m_fallbacks->previous = fallback;
+        }
+
+        m_fallbacks = fallback;
+    }
+
+    //! \brief Removes the record of an allocation made from the parent from the list held by the sub heap.
+    //! \param fallback [in] - The record to be removed.
+    void SubHeap::unlinkFallback(FallbackAllocation *fallback) {
+        if (fallback->previous) {
+            fallback->previous->next = fallback->next;
+        } else {
+            m_fallbacks = fallback->next;
+        }
+
+        if (fallback->next) {
+            fallback->next->previous = fallback->previous;
+        }
+
+        fallback->owner = nullptr;
+    }
+}
@@ -0,0 +1,235 @@
+
+#include <cstdint>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif //defined(_MSC_VER)
+
+#include "heap.h"
+#include "tlsf_index.h"
+
+namespace {
+    //! \brief Retrieves the index of the most significant bit set within a value.
+    //! \param value [in] - The value to be scanned, must not be zero.
+    //! \returns Zero based index of the most significant set bit.
+    inline size_t findLastSet(uint64_t value) {
+        assert(0 != value);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return 63 - static_cast<size_t>(__builtin_clzll(value));
+#endif //defined(_MSC_VER)
+    }
+
+    //! \brief Retrieves the index of the least significant bit set within a value.
+    //! \param value [in] - The value to be scanned, must not be zero.
+    //! \returns Zero based index of the least significant set bit.
+    inline size_t findFirstSet(uint64_t value) {
+        assert(0 != value);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return static_cast<size_t>(__builtin_ctzll(value));
+#endif //defined(_MSC_VER)
+    }
+}
+
+namespace ngen::memory {
+    TlsfIndex::TlsfIndex()
+            : m_firstLevelBitmap(0), m_secondLevelBitmaps(nullptr), m_heads(nullptr), m_firstLevelCount(0) {
+
+    }
+
+    //! \brief Determines the number of first level size ranges required to describe a heap.
+    //! \param heapLength [in] - Length (in bytes) of the largest free block the index must describe.
+    //! \returns The number of first level size ranges required.
+    size_t TlsfIndex::getFirstLevelCount(size_t heapLength) {
+        if (heapLength < kSmallBlockSize) {
+            return 1;
+        }
+
+        return findLastSet(heapLength) - kFirstLevelShift + 2;
+    }
+
+    //! \brief Determines the length of the control block required by an index describing a heap of the specified size.
+    //! \param heapLength [in] - Length (in bytes) of the largest free block the index must describe.
+    //! \returns The length (in bytes) of the control block that must be supplied when initializing the index.
+    size_t TlsfIndex::getControlLength(size_t heapLength) {
+        const auto firstLevelCount = getFirstLevelCount(heapLength);
+
+        return firstLevelCount * kSecondLevelCount * sizeof(FreeBlock *) + firstLevelCount * sizeof(uint32_t);
+    }
+
+    //! \brief Prepares the index for use.
+    //! \param control [in] - Pointer to memory of at least getControlLength(heapLength) bytes, suitably aligned for a pointer.
+    //! \param heapLength [in] - Length (in bytes) of the largest free block the index must describe.
+    //! \returns True if the index was initialized successfully otherwise false.
+    bool TlsfIndex::initialize(void *control, size_t heapLength) {
+        if (m_heads || !control) {
+            return false;
+        }
+
+        m_firstLevelCount = getFirstLevelCount(heapLength);
+
+        if (m_firstLevelCount > kMaximumFirstLevelCount) {
+            return false;
+        }
+
+        m_heads = static_cast<FreeBlock **>(control);
+        m_secondLevelBitmaps = reinterpret_cast<uint32_t *>(&m_heads[m_firstLevelCount * kSecondLevelCount]);
+        m_firstLevelBitmap = 0;
+
+        for (size_t loop = 0; loop < m_firstLevelCount * kSecondLevelCount; ++loop) {
+            m_heads[loop] = nullptr;
+        }
+
+        for (size_t loop = 0; loop < m_firstLevelCount; ++loop) {
+            m_secondLevelBitmaps[loop] = 0;
+        }
+
+        return true;
+    }
+
+    //! \brief Computes the list that a free block of the specified length belongs to.
+    //! \param blockLength [in] - Length (in bytes) of the free block.
+    //! \param firstLevel [out] - Receives the first level index of the list.
+    //! \param secondLevel [out] - Receives the second level index of the list.
+    void TlsfIndex::mapping(size_t blockLength, size_t &firstLevel, size_t &secondLevel) {
+        if (blockLength < kSmallBlockSize) {
+            firstLevel = 0;
+            secondLevel = blockLength / (kSmallBlockSize / kSecondLevelCount);
+        } else {
+            const auto lastSet = findLastSet(blockLength);
+
+            secondLevel = (blockLength >> (lastSet - kSecondLevelLog2)) ^ kSecondLevelCount;
+            firstLevel = lastSet - kFirstLevelShift + 1;
+        }
+    }
+
+    //! \brief Adds a free block to the index.
+    //! \param block [in] - The free block to be added, the block must not already be within the index.
+    void TlsfIndex::insert(FreeBlock *block) {
+        assert(nullptr != block);
+
+        size_t firstLevel, secondLevel;
+        mapping(block->size, firstLevel, secondLevel);
+
+        assert(firstLevel < m_firstLevelCount);
+
+        auto &head = m_heads[firstLevel * kSecondLevelCount + secondLevel];
+
+        block->index.bin.previous = nullptr;
+        block->index.bin.next = head;
+
+        if (head) {
+            head->index.bin.previous = block;
+        }
+
+        head = block;
+
+        m_firstLevelBitmap |= uint64_t(1) << firstLevel;
+        m_secondLevelBitmaps[firstLevel] |= uint32_t(1) << secondLevel;
+    }
+
+    //! \brief Removes a free block from the index.
+    //! \param block [in] - The free block to be removed, its size must not have changed since it was inserted.
+    void TlsfIndex::remove(FreeBlock *block) {
+        assert(nullptr != block);
+
+        size_t firstLevel, secondLevel;
+        mapping(block->size, firstLevel, secondLevel);
+
+        assert(firstLevel < m_firstLevelCount);
+
+        if (block->index.bin.next) {
+            block->index.bin.next->index.bin.previous = block->index.bin.previous;
+        }
+
+        if (block->index.bin.previous) {
+            block->index.bin.previous->index.bin.next = block->index.bin.next;
+        } else {
+            auto &head = m_heads[firstLevel * kSecondLevelCount + secondLevel];
+            assert(head == block);
+
+            head = block->index.bin.next;
+
+            if (!head) {
+                m_secondLevelBitmaps[firstLevel] &= ~(uint32_t(1) << secondLevel);
+
+                if (!m_secondLevelBitmaps[firstLevel]) {
+                    m_firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+                }
+            }
+        }
+
+        block->index.bin.previous = nullptr;
+        block->index.bin.next = nullptr;
+    }
+
+    //! \brief Locates a free block that is at least the specified length.
+    //!
+    //! The requested length is rounded up to the start of the next list, so any block within the selected list
+    //! is large enough and no list needs to be walked.
+    //! \param blockLength [in] - The minimum length (in bytes) of the free block.
+    //! \returns Pointer to a free block of at least the specified length or nullptr if none was available.
+    FreeBlock *TlsfIndex::find(size_t blockLength) const {
+        if (!m_heads) {
+            return nullptr;
+        }
+
+        if (blockLength >= kSmallBlockSize) {
+            blockLength += (size_t(1) << (findLastSet(blockLength) - kSecondLevelLog2)) - 1;
+        }
+
+        size_t firstLevel, secondLevel;
+        mapping(blockLength, firstLevel, secondLevel);
+
+        if (firstLevel >= m_firstLevelCount) {
+            return nullptr;
+        }
+
+        auto secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~uint32_t(0) << secondLevel);
+
+        if (!secondLevelMap) {
+            const auto firstLevelMap = m_firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1));
+
+            if (!firstLevelMap) {
+                return nullptr;
+            }
+
+            firstLevel = findFirstSet(firstLevelMap);
+            secondLevelMap = m_secondLevelBitmaps[firstLevel];
+        }
+
+        secondLevel = findFirstSet(secondLevelMap);
+        return m_heads[firstLevel * kSecondLevelCount + secondLevel];
+    }
+
+    //! \brief Locates the largest free block within the index.
+    //!
+    //! Only the list holding the largest sizes is walked, as the blocks within a list are not ordered by size.
+    //! \returns Pointer to the largest free block or nullptr if the index is empty.
+    FreeBlock *TlsfIndex::findLargest() const {
+        if (!m_heads || !m_firstLevelBitmap) {
+            return nullptr;
+        }
+
+        const auto firstLevel = findLastSet(m_firstLevelBitmap);
+        const auto secondLevel = findLastSet(m_secondLevelBitmaps[firstLevel]);
+
+        FreeBlock *largest = nullptr;
+
+        for (auto search = m_heads[firstLevel * kSecondLevelCount + secondLevel]; search; search = search->index.bin.next) {
+            if (!largest || search->size > largest->size) {
+                largest = search;
+            }
+        }
+
+        return largest;
+    }
+}
@@ -0,0 +1,224 @@
+
+#include <cstdint>
+
+#include "trace_recorder.h"
+
+namespace ngen::memory {
+    TraceRecorder::TraceRecorder()
+            : m_file(nullptr), m_capacity(0), m_count(0), m_recordedEvents(0), m_failedWrites(0) {
+
+    }
+
+    TraceRecorder::~TraceRecorder() {
+        close();
+    }
+
+    //! \brief Creates a trace file and prepares the recorder to record events into it.
+    //! \param path [in] - Path of the trace file to be created, an existing file is replaced.
+    //! \returns True if the trace file was created otherwise false.
+    bool TraceRecorder::open(const char *path) {
+        return open(path, kDefaultCapacity);
+    }
+
+    //! \brief Creates a trace file and prepares the recorder to record events into it.
+    //! \param path [in] - Path of the trace file to be created, an existing file is replaced.
+    //! \param capacity [in] - The number of events held in memory before they are written to the file.
+    //! \returns True if the trace file was created otherwise false.
+    bool TraceRecorder::open(const char *path, size_t capacity) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_file || !path || !capacity) {
+            return false;
+        }
+
+        auto file = fopen(path, "wb");
+        if (!file) {
+            // TODO: Log ERR - unable to create the trace file
+            return false;
+        }
+
+        TraceFileHeader header = {};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.eventLength = sizeof(TraceEvent);
+
+        if (1 != fwrite(&header, sizeof(header), 1, file)) {
+            // TODO: Log ERR - unable to write the header of the trace file
+            fclose(file);
+            return false;
+        }
+
+        m_events.reset(new TraceEvent[capacity]);
+        m_capacity = capacity;
+        m_count = 0;
+        m_file = file;
+        m_start = std::chrono::steady_clock::now();
+
+        return true;
+    }
+
+    //! \brief Writes any events held in memory to the trace file and closes it.
+    void TraceRecorder::close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_file) {
+            return;
+        }
+
+        writeEvents();
+
+        fclose(m_file);
+        m_file = nullptr;
+
+        m_events.reset();
+        m_capacity = 0;
+    }
+
+    //! \brief Writes the events held in memory to the trace file.
+    //! \returns True if the events were written otherwise false.
+    bool TraceRecorder::flush() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_file) {
+            return false;
+        }
+
+        return writeEvents() && 0 == fflush(m_file);
+    }
+
+    //! \brief Records a single operation made on a heap, does nothing if the recorder has not been opened.
+    //! \param type [in] - The operation that was made.
+    //! \param ptr [in] - The allocation the operation was made on, null if an allocation failed.
+    //! \param size [in] - Length (in bytes) requested by the operation.
+    //! \param alignment [in] - Alignment (in bytes) requested by the operation.
+    //! \param isArray [in] - True if the allocation was made or released as an array otherwise false.
+    void TraceRecorder::record(kTraceEvent type, const void *ptr, size_t size, size_t alignment, bool isArray) {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_file) {
+            return;
+        }
+
+        auto &event = m_events[m_count++];
+        event.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        event.handle = reinterpret_cast<uintptr_t>(ptr);
+        event.size = size;
+        event.alignment = static_cast<uint32_t>(alignment);
+        event.type = type;
+        event.flags = isArray ? kTraceEventArray : 0;
+        event.reserved = 0;
+
+        m_recordedEvents++;
+
+        if (m_count == m_capacity) {
+            writeEvents();
+        }
+    }
+
+    //! \brief Determines whether or not the recorder is writing to a file.
+    //! \returns True if the recorder has been opened otherwise false.
+    bool TraceRecorder::isOpen() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return nullptr != m_file;
+    }
+
+    //! \brief Retrieves the number of events held in memory before they are written to the file.
+    //! \returns The number of events the ring holds.
+    size_t TraceRecorder::getCapacity() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_capacity;
+    }
+
+    //! \brief Retrieves the number of events recorded since the recorder was created.
+    //! \returns The number of events that have been recorded.
+    size_t TraceRecorder::getRecordedEvents() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_recordedEvents;
+    }
+
+    //! \brief Retrieves the number of times events could not be written to the trace file, those events are lost.
+    //! \returns The number of writes to the trace file that failed.
+    size_t TraceRecorder::getFailedWrites() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_failedWrites;
+    }
+
+    //! \brief Writes the events held in memory to the trace file, the lock must be held.
+    //! \returns True if the events were written otherwise false.
+    bool TraceRecorder::writeEvents() {
+        if (!m_count) {
+            return true;
+        }
+
+        const auto count = m_count;
+        m_count = 0;
+
+        if (count != fwrite(m_events.get(), sizeof(TraceEvent), count, m_file)) {
+            // TODO: Log ERR - unable to write events to the trace file
+            m_failedWrites++;
+            return false;
+        }
+
+        return true;
+    }
+
+    TraceReader::TraceReader() : m_file(nullptr) {
+
+    }
+
+    TraceReader::~TraceReader() {
+        close();
+    }
+
+    //! \brief Opens a trace file and validates its header.
+    //! \param path [in] - Path of the trace file to be read.
+    //! \returns True if the trace file was opened otherwise false.
+    bool TraceReader::open(const char *path) {
+        if (m_file || !path) {
+            return false;
+        }
+
+        auto file = fopen(path, "rb");
+        if (!file) {
+            // TODO: Log ERR - unable to open the trace file
+            return false;
+        }
+
+        TraceFileHeader header = {};
+
+        if (1 != fread(&header, sizeof(header), 1, file)) {
+            fclose(file);
+            return false;
+        }
+
+        if (TraceRecorder::kMagic != header.magic || TraceRecorder::kVersion != header.version || sizeof(TraceEvent) != header.eventLength) {
+            // TODO: Log ERR - the file is not a trace of a supported version
+            fclose(file);
+            return false;
+        }
+
+        m_file = file;
+        return true;
+    }
+
+    //! \brief Closes the trace file.
+    void TraceReader::close() {
+        if (m_file) {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    //! \brief Reads the next event from the trace file.
+    //! \param event [out] - Receives the event that was read.
+    //! \returns True if an event was read otherwise false, once the end of the trace has been reached.
+    bool TraceReader::next(TraceEvent &event) {
+        if (!m_file) {
+            return false;
+        }
+
+        return 1 == fread(&event, sizeof(event), 1, m_file);
+    }
+}
@@ -0,0 +1,157 @@
+
+#include <cstdint>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif //defined(_WIN32)
+
+#include "virtual_memory.h"
+
+namespace ngen::memory::VirtualMemory {
+    //! \brief Retrieves the granularity with which memory is committed by the operating system.
+    //! \returns The size (in bytes) of a page of memory.
+    size_t getPageSize() {
+#if defined(_WIN32)
+        static const auto pageSize = [] {
+            SYSTEM_INFO systemInfo;
+            GetSystemInfo(&systemInfo);
+
+            return static_cast<size_t>(systemInfo.dwPageSize);
+        }();
+
+        return pageSize;
+#else
+        static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return pageSize;
+#endif //defined(_WIN32)
+    }
+
+    //! \brief Reserves a range of address space that is not backed by memory, the range may not be accessed until committed.
+    //! \param length [in] - Length (in bytes) of the range to be reserved.
+    //! \returns Pointer to the start of the reserved range or null if it could not be reserved.
+    void *reserve(size_t length) {
+#if defined(_WIN32)
+        return VirtualAlloc(nullptr, length, MEM_RESERVE, PAGE_NOACCESS);
+#else
+        auto address = mmap(nullptr, length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return MAP_FAILED == address ? nullptr : address;
+#endif //defined(_WIN32)
+    }
+
+    //! \brief Returns a range of address space previously reserved, along with any memory committed within it.
+    //! \param address [in] - Pointer returned by reserve.
+    //! \param length [in] - Length (in bytes) that was supplied to reserve.
+    void release(void *address, size_t length) {
+#if defined(_WIN32)
+        (void)length;
+        VirtualFree(address, 0, MEM_RELEASE);
+#else
+        munmap(address, length);
+#endif //defined(_WIN32)
+    }
+
+    //! \brief Backs a range of pages within a reservation with memory, so that it may be read and written.
+    //! \param address [in] - Address of the first page to be committed.
+    //! \param length [in] - Length (in bytes) of the range to be committed.
+    //! \returns True if the range was committed otherwise false.
+    bool commit(void *address, size_t length) {
+#if defined(_WIN32)
+        return nullptr != VirtualAlloc(address, length, MEM_COMMIT, PAGE_READWRITE);
+#else
+        return 0 == mprotect(address, length, PROT_READ | PROT_WRITE);
+#endif //defined(_WIN32)
+    }
+
+    //! \brief Returns the memory backing a range of pages to the operating system, the range remains accessible.
+    //!
+    //! The contents of the range are discarded, the pages are backed by memory again when they are next touched.
+    //! \param address [in] - Address of the first page to be discarded.
+    //! \param length [in] - Length (in bytes) of the range to be discarded.
+    //! \returns True if the range was discarded otherwise false.
+    bool discard(void *address, size_t length) {
+#if defined(_WIN32)
+        return nullptr != VirtualAlloc(address, length, MEM_RESET, PAGE_READWRITE);
+#elif defined(__APPLE__)
+        return 0 == madvise(address, length, MADV_FREE);
+#else
+        return 0 == madvise(address, length, MADV_DONTNEED);
+#endif //defined(_WIN32)
+    }
+
+    //! \brief Allocates a range of committed memory, preferring the page size that was requested.
+    //!
+    //! Should the requested backing be unavailable, explicit huge pages fall back to transparent huge pages and
+    //! transparent huge pages fall back to standard pages. Huge pages are only supported on Linux. Memory allocated
+    //! by this function is returned with release.
+    //! \param length [in] - Length (in bytes) of the memory to be allocated, a multiple of kHugePageSize for huge pages.
+    //! \param backing [in] - The page backing that is preferred for the memory.
+    //! \param result [out] - Receives the page backing of the memory, this may be null.
+    //! \returns Pointer to the allocated memory or null if it could not be allocated.
+    void *allocate(size_t length, kPageBacking backing, kPageBacking *result) {
+        if (!length || backing == kPageBacking::Invalid) {
+            return nullptr;
+        }
+
+        void *address = nullptr;
+        auto allocated = kPageBacking::Standard;
+
+#if defined(__linux__)
+        if (backing == kPageBacking::HugeTLB && 0 == (length & (kHugePageSize - 1))) {
+            address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (MAP_FAILED == address) {
+                // TODO: Log WARN - huge page pool is unavailable or exhausted, falling back to transparent huge pages
+                address = nullptr;
+                backing = kPageBacking::Transparent;
+            } else {
+                allocated = kPageBacking::HugeTLB;
+            }
+        }
+
+        if (!address && backing != kPageBacking::Standard) {
+            // Over allocate so that the range can be trimmed to start on a huge page boundary, as only aligned
+            // huge pages can be backed by the kernel.
+            auto mapped = mmap(nullptr, length + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (MAP_FAILED != mapped) {
+                const auto start = reinterpret_cast<uintptr_t>(mapped);
+                const auto aligned = (start + kHugePageSize - 1) & ~(kHugePageSize - 1);
+
+                if (aligned > start) {
+                    munmap(mapped, aligned - start);
+                }
+
+                munmap(reinterpret_cast<void *>(aligned + length), start + kHugePageSize - aligned);
+
+                address = reinterpret_cast<void *>(aligned);
+                allocated = (0 == madvise(address, length, MADV_HUGEPAGE)) ? kPageBacking::Transparent : kPageBacking::Standard;
+            }
+        }
+
+        if (!address) {
+            address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == address) {
+                return nullptr;
+            }
+
+            // Opt out of transparent huge pages, so standard pages are used even if the system enables them by default.
+            madvise(address, length, MADV_NOHUGEPAGE);
+        }
+#elif defined(_WIN32)
+        address = VirtualAlloc(nullptr, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        address = (MAP_FAILED == address) ? nullptr : address;
+#endif //defined(__linux__)
+
+        if (address && result) {
+            *result = allocated;
+        }
+
+        return address;
+    }
+}
@@ -0,0 +1,142 @@
+
+#include <memory>
+#include "ngen_memory.h"
+#include "test_utilities.h"
+#include "gtest/gtest.h"
+
+const size_t kArenaBufferSize = 4096;
+
+namespace {
+    struct ArenaObject {
+        ArenaObject() : a(1), b(2.0) {
+
+        }
+
+        uint32_t a;
+        double b;
+    };
+}
+
+TEST(Arena, Initialize) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kArenaBufferSize]);
+
+    ngen::memory::Arena arena;
+    EXPECT_EQ(nullptr, arena.alloc(16));
+    EXPECT_EQ(nullptr, arena.alloc(0));
+    EXPECT_EQ(2, arena.getFailedAllocations());
+
+    EXPECT_FALSE(arena.initialize(static_cast<void *>(nullptr), kArenaBufferSize));
+    EXPECT_FALSE(arena.initialize(static_cast<ngen::memory::Heap *>(nullptr), kArenaBufferSize));
+    EXPECT_FALSE(arena.initialize(allocationBuffer.get(), 0));
+
+    EXPECT_TRUE(arena.initialize(allocationBuffer.get(), kArenaBufferSize));
+    EXPECT_FALSE(arena.initialize(allocationBuffer.get(), kArenaBufferSize));
+
+    EXPECT_EQ(kArenaBufferSize, arena.getSize());
+    EXPECT_EQ(0, arena.getUsed());
+
+    // A released arena fails every request until it is initialized again.
+    arena.release();
+    EXPECT_EQ(nullptr, arena.alloc(0));
+    EXPECT_EQ(3, arena.getFailedAllocations());
+}
+
+TEST(Arena, BumpAllocation) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kArenaBufferSize]);
+
+    ngen::memory::Arena arena;
+    EXPECT_TRUE(arena.initialize(allocationBuffer.get(), kArenaBufferSize));
+
+    auto first = static_cast<char *>(arena.alloc(10));
+    auto second = static_cast<char *>(arena.alloc(10));
+    EXPECT_NE(nullptr, first);
+    EXPECT_NE(nullptr, second);
+    EXPECT_TRUE(validateAlignment(first, ngen::memory::Arena::kDefaultAlignment));
+    EXPECT_TRUE(validateAlignment(second, ngen::memory::Arena::kDefaultAlignment));
+    EXPECT_LE(first + 10, second);
+
+    auto aligned = arena.alignedAlloc(1, 256);
+    EXPECT_NE(nullptr, aligned);
+    EXPECT_TRUE(validateAlignment(aligned, 256));
+    EXPECT_EQ(nullptr, arena.alignedAlloc(1, 3));
+
+    EXPECT_TRUE(arena.owns(first));
+    EXPECT_TRUE(arena.deallocate(first, false, nullptr, 0));
+    EXPECT_FALSE(arena.deallocate(allocationBuffer.get() + kArenaBufferSize, false, nullptr, 0));
+
+    // Requests that exceed the remaining space fail without disturbing the arena.
+    const auto used = arena.getUsed();
+    EXPECT_EQ(nullptr, arena.alloc(kArenaBufferSize));
+    EXPECT_EQ(used, arena.getUsed());
+    EXPECT_EQ(2, arena.getFailedAllocations());
+
+    EXPECT_NE(nullptr, arena.alloc(kArenaBufferSize - used - ngen::memory::Arena::kDefaultAlignment));
+}
+
+TEST(Arena, Markers) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kArenaBufferSize]);
+
+    ngen::memory::Arena arena;
+    EXPECT_TRUE(arena.initialize(allocationBuffer.get(), kArenaBufferSize));
+
+    void *persistent = arena.alloc(64);
+    EXPECT_NE(nullptr, persistent);
+
+    const auto marker = arena.getMarker();
+    void *scratch = arena.alloc(512);
+    EXPECT_NE(nullptr, scratch);
+
+    EXPECT_TRUE(arena.rewind(marker));
+    EXPECT_EQ(marker, arena.getUsed());
+    EXPECT_EQ(scratch, arena.alloc(512));
+
+    // Markers beyond the current position are rejected.
+    EXPECT_TRUE(arena.rewind(marker));
+    EXPECT_FALSE(arena.rewind(marker + 512));
+
+    {
+        ngen::memory::ArenaScope scope(arena);
+        EXPECT_NE(nullptr, arena.alloc(1024));
+        EXPECT_LT(1024, arena.getUsed());
+    }
+
+    EXPECT_EQ(marker, arena.getUsed());
+    EXPECT_LT(1024, arena.getPeakUsed());
+
+    arena.reset();
+    EXPECT_EQ(0, arena.getUsed());
+    EXPECT_EQ(persistent, arena.alloc(64));
+}
+
+TEST(Arena, CarvedFromHeap) {
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+
+    {
+        ngen::memory::Arena arena;
+        EXPECT_FALSE(arena.initialize(&heap, bufferSize));
+        EXPECT_TRUE(arena.initialize(&heap, kArenaBufferSize));
+        EXPECT_EQ(1, heap.getAllocations());
+
+        auto object = NGEN_NEW(&arena) ArenaObject;
+        EXPECT_NE(nullptr, object);
+        EXPECT_TRUE(arena.owns(object));
+        EXPECT_EQ(1, object->a);
+        EXPECT_EQ(2.0, object->b);
+
+        auto objects = NGEN_NEW(&arena) ArenaObject[16];
+        EXPECT_TRUE(arena.owns(objects));
+        EXPECT_EQ(1, objects[15].a);
+
+        auto aligned = NGEN_ALIGNED_NEW(&arena, 64) ArenaObject;
+        EXPECT_TRUE(validateAlignment(aligned, 64));
+
+        // Allocations made by the arena are not visible to the heap.
+        EXPECT_EQ(1, heap.getAllocations());
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
@@ -0,0 +1,435 @@
+
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "basic_heap.h"
+#include "test_utilities.h"
+#include "gtest/gtest.h"
+
+const size_t kBasicHeapBufferSize = 256 * 1024;
+
+namespace {
+    using FastHeap = ngen::memory::BasicHeap<ngen::memory::SearchTLSF, ngen::memory::NoTracking, ngen::memory::NoSentinels, ngen::memory::NoStatistics, ngen::memory::NoLock>;
+    using DebugHeap = ngen::memory::BasicHeap<ngen::memory::SearchFirst, ngen::memory::SourceTracking, ngen::memory::HeaderSentinels, ngen::memory::AllocationCounters, ngen::memory::NoLock>;
+    using SharedHeap = ngen::memory::BasicHeap<ngen::memory::SearchSmallest, ngen::memory::NoTracking, ngen::memory::NoSentinels, ngen::memory::AllocationCounters, ngen::memory::MutexLock>;
+    using StatisticsHeap = ngen::memory::BasicHeap<ngen::memory::SearchDynamic, ngen::memory::NoTracking, ngen::memory::NoSentinels, ngen::memory::DetailedStatistics, ngen::memory::NoLock>;
+
+    std::mutex ownerMutex;
+
+    //! \brief Lock policy whose mutex the test may hold, as though the owning thread were within the heap.
+    class OwnerLock {
+    public:
+        void lock() { ownerMutex.lock(); }
+        void unlock() { ownerMutex.unlock(); }
+    };
+
+    using OwnedHeap = ngen::memory::BasicHeap<ngen::memory::SearchSmallest, ngen::memory::NoTracking, ngen::memory::NoSentinels, ngen::memory::AllocationCounters, OwnerLock>;
+}
+
+TEST(BasicHeap, HeaderSelection) {
+    EXPECT_TRUE((std::is_same_v<ngen::memory::CompactAllocation, FastHeap::Header>));
+    EXPECT_TRUE((std::is_same_v<ngen::memory::TrackedAllocation, DebugHeap::Header>));
+    EXPECT_TRUE((std::is_same_v<ngen::memory::CompactAllocation, SharedHeap::Header>));
+}
+
+TEST(BasicHeap, SearchPolicy) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    FastHeap heap;
+
+    // A heap with a fixed search policy only accepts the strategy of the policy.
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize, ngen::memory::kAllocationStrategy::First));
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize, ngen::memory::kAllocationStrategy::Smallest));
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+    EXPECT_EQ(ngen::memory::kAllocationStrategy::TLSF, heap.getAllocationStrategy());
+}
+
+TEST(BasicHeap, NoStatistics) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    FastHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+
+    std::vector<void *> allocations(100);
+    for (size_t loop = 0; loop < allocations.size(); ++loop) {
+        allocations[loop] = heap.alignedAlloc(8 + loop * 13, 16);
+        EXPECT_NE(nullptr, allocations[loop]);
+        EXPECT_TRUE(validateAlignment(allocations[loop], 16));
+    }
+
+    EXPECT_EQ(nullptr, heap.alloc(kBasicHeapBufferSize));
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getTotalAllocations());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+    EXPECT_EQ(0, heap.getStats().bytesInUse);
+
+    for (auto allocation : allocations) {
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    // Every block has been coalesced, so the whole heap can be allocated once more.
+    auto large = heap.alloc(kBasicHeapBufferSize / 2);
+    EXPECT_NE(nullptr, large);
+    EXPECT_TRUE(heap.deallocate(large, false, nullptr, 0));
+}
+
+TEST(BasicHeap, SourceTracking) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    DebugHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+
+    const auto line = static_cast<size_t>(__LINE__);
+    auto allocation = heap.allocArray(100, __FILE__, line);
+    EXPECT_NE(nullptr, allocation);
+
+    auto header = reinterpret_cast<ngen::memory::TrackedAllocation *>(allocation) - 1;
+    EXPECT_EQ(&heap, header->heap);
+    EXPECT_EQ(100, header->size);
+    EXPECT_EQ(line, header->line);
+    EXPECT_STREQ(__FILE__, header->fileName);
+    EXPECT_TRUE(header->isArray);
+
+    EXPECT_EQ(1, heap.getAllocations());
+    EXPECT_FALSE(heap.deallocate(allocation, false, __FILE__, __LINE__));
+    EXPECT_TRUE(heap.deallocate(allocation, true, __FILE__, __LINE__));
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(1, heap.getTotalAllocations());
+
+    // The header no longer records an owner, so releasing it again is detected.
+    EXPECT_FALSE(heap.deallocate(allocation, true, __FILE__, __LINE__));
+}
+
+TEST(BasicHeap, MutexLock) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize * 16]);
+
+    SharedHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize * 16));
+
+    constexpr size_t kThreadCount = 4;
+    constexpr size_t kAllocationCount = 2000;
+
+    std::vector<std::thread> threads;
+
+    for (size_t thread = 0; thread < kThreadCount; ++thread) {
+        threads.emplace_back([&heap, thread]() {
+            std::vector<void *> allocations;
+
+            for (size_t loop = 0; loop < kAllocationCount; ++loop) {
+                auto allocation = heap.alloc(8 + (loop * 37 + thread * 11) % 600);
+                ASSERT_NE(nullptr, allocation);
+
+                allocations.push_back(allocation);
+
+                if (allocations.size() > 16) {
+                    EXPECT_TRUE(heap.deallocate(allocations.front(), false, nullptr, 0));
+                    allocations.erase(allocations.begin());
+                }
+            }
+
+            for (auto allocation : allocations) {
+                EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(kThreadCount * kAllocationCount, heap.getTotalAllocations());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+}
+
+TEST(BasicHeap, RemoteFreeWhileLocked) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    OwnedHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(16 * 1024));
+    EXPECT_TRUE(heap.enableRemoteFrees());
+
+    void *allocations[] = { heap.alloc(32), heap.alloc(512), heap.allocArray(1024), heap.alloc(2048) };
+    void *batch[] = { heap.alloc(16), heap.alloc(700), nullptr };
+
+    for (auto allocation : allocations) {
+        EXPECT_NE(nullptr, allocation);
+    }
+
+    // Remote releases must be queued while the owning thread holds the lock of the heap.
+    std::unique_lock<std::mutex> lock(ownerMutex);
+
+    auto remote = std::async(std::launch::async, [&heap, &allocations, &batch]() {
+        return heap.deallocate(allocations[0], false, nullptr, 0) &&
+               heap.deallocate(allocations[1], 512, 0) &&
+               !heap.deallocate(allocations[1], false, nullptr, 0) &&
+               !heap.deallocate(allocations[2], false, nullptr, 0) &&
+               heap.deallocateArray(allocations[2], 1024, 0) &&
+               heap.deallocate(allocations[3], false, nullptr, 0) &&
+               3 == heap.deallocateBatch(batch, 3);
+    });
+
+    const auto status = remote.wait_for(std::chrono::seconds(10));
+    lock.unlock();
+
+    EXPECT_EQ(std::future_status::ready, status);
+    EXPECT_TRUE(remote.get());
+
+    EXPECT_EQ(6, heap.getAllocations());
+    EXPECT_EQ(6, heap.processRemoteFrees());
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getSmallObjects().getAllocations());
+}
+
+TEST(BasicHeap, DetailedStatistics) {
+    const size_t allocationLength = 100;
+    const size_t allocationCount = 10;
+
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    for (auto strategy : strategies) {
+        std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+        StatisticsHeap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize, strategy));
+
+        const auto initial = heap.getStats();
+        EXPECT_EQ(0, initial.bytesInUse);
+        EXPECT_EQ(1, initial.freeBlocks);
+        EXPECT_EQ(initial.freeBytes, initial.largestFreeBlock);
+        EXPECT_EQ(0, initial.fragmentation);
+
+        void *allocations[allocationCount];
+        for (auto &allocation : allocations) {
+            allocation = heap.alloc(allocationLength);
+            EXPECT_NE(nullptr, allocation);
+        }
+
+        const auto allocated = heap.getStats();
+        EXPECT_EQ(allocationCount, allocated.allocations);
+        EXPECT_EQ(allocationCount * sizeof(StatisticsHeap::Header), allocated.overheadBytes);
+        EXPECT_LE(allocationCount * (allocationLength + sizeof(StatisticsHeap::Header)), allocated.bytesInUse);
+        EXPECT_EQ(allocated.bytesInUse, allocated.peakBytesInUse);
+        EXPECT_EQ(initial.freeBytes, allocated.freeBytes + allocated.bytesInUse);
+        EXPECT_EQ(allocationCount, allocated.requestSizes[ngen::memory::detail::getHistogramBucket(allocationLength)]);
+
+        size_t searches = 0;
+        for (auto count : allocated.searchLengths) {
+            searches += count;
+        }
+
+        EXPECT_EQ(allocationCount, searches);
+
+        // Releasing every other allocation leaves holes that cannot join, fragmenting the free memory.
+        for (size_t loop = 0; loop < allocationCount; loop += 2) {
+            EXPECT_TRUE(heap.deallocate(allocations[loop], false, nullptr, 0));
+        }
+
+        const auto fragmented = heap.getStats();
+        EXPECT_EQ(allocationCount / 2 + 1, fragmented.freeBlocks);
+        EXPECT_GT(fragmented.freeBytes, fragmented.largestFreeBlock);
+        EXPECT_LT(0, fragmented.fragmentation);
+        EXPECT_GT(allocated.bytesInUse, fragmented.bytesInUse);
+        EXPECT_EQ(allocated.peakBytesInUse, fragmented.peakBytesInUse);
+
+        for (size_t loop = 1; loop < allocationCount; loop += 2) {
+            EXPECT_TRUE(heap.deallocate(allocations[loop], false, nullptr, 0));
+        }
+
+        const auto released = heap.getStats();
+        EXPECT_EQ(0, released.allocations);
+        EXPECT_EQ(0, released.bytesInUse);
+        EXPECT_EQ(0, released.overheadBytes);
+        EXPECT_EQ(1, released.freeBlocks);
+        EXPECT_EQ(0, released.fragmentation);
+
+        EXPECT_EQ(nullptr, heap.alloc(kBasicHeapBufferSize));
+        EXPECT_EQ(1, heap.getStats().failedAllocations);
+    }
+}
+
+TEST(BasicHeap, SlideAllocation) {
+    const size_t allocationLength = 256;
+    const size_t allocationCount = 4;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    StatisticsHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+
+    void *allocations[allocationCount];
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        allocations[loop] = heap.alloc(allocationLength);
+        EXPECT_NE(nullptr, allocations[loop]);
+        memset(allocations[loop], static_cast<int>(loop + 1), allocationLength);
+    }
+
+    const auto allocated = heap.getStats();
+
+    // An allocation can only move into a free block that precedes it.
+    EXPECT_EQ(nullptr, heap.slideAllocation(allocations[0], 8));
+    EXPECT_EQ(nullptr, heap.slideAllocation(allocations[2], 8));
+    EXPECT_EQ(nullptr, heap.slideAllocation(allocations[1], 3));
+    EXPECT_EQ(nullptr, heap.slideAllocation(nullptr, 8));
+
+    EXPECT_TRUE(heap.deallocate(allocations[0], false, nullptr, 0));
+
+    for (size_t loop = 1; loop < allocationCount; ++loop) {
+        auto moved = heap.slideAllocation(allocations[loop], 8);
+        ASSERT_NE(nullptr, moved);
+        EXPECT_GT(allocations[loop], moved);
+
+        for (size_t offset = 0; offset < allocationLength; ++offset) {
+            EXPECT_EQ(static_cast<char>(loop + 1), static_cast<char *>(moved)[offset]);
+        }
+
+        EXPECT_LE(allocationLength, heap.getUsableSize(moved));
+        allocations[loop] = moved;
+    }
+
+    // The free memory between the allocations has been gathered into the block at the end of the heap.
+    const auto slid = heap.getStats();
+    EXPECT_EQ(1, slid.freeBlocks);
+    EXPECT_EQ(slid.freeBytes, slid.largestFreeBlock);
+    EXPECT_EQ(allocationCount - 1, slid.allocations);
+    EXPECT_EQ((allocationCount - 1) * sizeof(StatisticsHeap::Header), slid.overheadBytes);
+    EXPECT_EQ(nullptr, heap.slideAllocation(allocations[1], 8));
+
+    for (size_t loop = 1; loop < allocationCount; ++loop) {
+        EXPECT_TRUE(heap.deallocate(allocations[loop], false, nullptr, 0));
+    }
+
+    const auto released = heap.getStats();
+    EXPECT_EQ(0, released.bytesInUse);
+    EXPECT_EQ(0, released.overheadBytes);
+    EXPECT_EQ(allocated.freeBytes + allocated.bytesInUse, released.freeBytes);
+}
+
+TEST(BasicHeap, SlideAlignedAllocation) {
+    const size_t alignment = 256;
+
+    // The padding ahead of the aligned allocation depends upon the address of the buffer, when long enough it is split
+    // from the allocation and may be reused by the allocation that follows. Aligning the buffer fixes the layout.
+    struct alignas(alignment) AlignedBuffer {
+        char data[kBasicHeapBufferSize];
+    };
+
+    std::unique_ptr<AlignedBuffer> allocationBuffer(new AlignedBuffer);
+
+    DebugHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer->data, kBasicHeapBufferSize));
+
+    auto first = heap.alloc(1024);
+    auto second = heap.alignedAlloc(100, alignment);
+    auto third = heap.alloc(100);
+
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    ASSERT_NE(nullptr, third);
+
+    memset(second, 0x5a, 100);
+    EXPECT_TRUE(heap.deallocate(first, false, nullptr, 0));
+
+    // The allocation keeps its alignment when it moves, and remains a valid allocation of the heap.
+    auto moved = heap.slideAllocation(second, alignment);
+    ASSERT_NE(nullptr, moved);
+    EXPECT_GT(second, moved);
+    EXPECT_TRUE(validateAlignment(moved, alignment));
+
+    for (size_t offset = 0; offset < 100; ++offset) {
+        EXPECT_EQ(0x5a, static_cast<unsigned char *>(moved)[offset]);
+    }
+
+    EXPECT_TRUE(heap.deallocate(moved, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(third, false, nullptr, 0));
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(BasicHeap, SizedDeallocateValidation) {
+    const size_t allocationLength = 100;
+    const size_t alignment = 64;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    DebugHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+
+    auto allocation = heap.alignedAlloc(allocationLength, alignment);
+    ASSERT_NE(nullptr, allocation);
+
+    const auto usableSize = heap.getUsableSize(allocation);
+
+    // Lengths outside the requested and usable length, or a stricter alignment, are rejected.
+    EXPECT_FALSE(heap.deallocate(allocation, allocationLength - 1, alignment));
+    EXPECT_FALSE(heap.deallocate(allocation, usableSize + 1, alignment));
+    EXPECT_FALSE(heap.deallocate(allocation, allocationLength, kBasicHeapBufferSize));
+    EXPECT_FALSE(heap.deallocateArray(allocation, allocationLength, alignment));
+    EXPECT_EQ(1, heap.getAllocations());
+
+    EXPECT_TRUE(heap.deallocate(allocation, usableSize, alignment));
+    EXPECT_EQ(0, heap.getAllocations());
+
+    // Double releases are still detected.
+    EXPECT_FALSE(heap.deallocate(allocation, allocationLength, alignment));
+}
+
+TEST(BasicHeap, SizedDeallocate) {
+    const size_t allocationCount = 256;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kBasicHeapBufferSize]);
+
+    StatisticsHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(32 * 1024));
+
+    const auto initial = heap.getStats();
+
+    void *allocations[allocationCount];
+    size_t lengths[allocationCount];
+
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        const auto alignment = size_t(4) << (loop % 5);
+
+        lengths[loop] = (loop * 37) % 1024 + 1;
+        allocations[loop] = heap.alignedAlloc(lengths[loop], alignment);
+        ASSERT_NE(nullptr, allocations[loop]);
+        memset(allocations[loop], 0xcd, lengths[loop]);
+    }
+
+    // Releasing in a scattered order exercises the joining of neighbouring free blocks.
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        const auto index = (loop * 97) % allocationCount;
+        EXPECT_TRUE(heap.deallocate(allocations[index], lengths[index], size_t(4) << (index % 5)));
+    }
+
+    const auto released = heap.getStats();
+    EXPECT_EQ(initial.allocations, released.allocations);
+    EXPECT_EQ(initial.bytesInUse, released.bytesInUse);
+    EXPECT_EQ(initial.overheadBytes, released.overheadBytes);
+    EXPECT_EQ(initial.freeBytes, released.freeBytes);
+    EXPECT_EQ(0, heap.getSmallObjects().getAllocations());
+
+    FastHeap fastHeap;
+    EXPECT_TRUE(fastHeap.initialize(allocationBuffer.get(), kBasicHeapBufferSize));
+
+    auto result = fastHeap.allocAtLeast(1000);
+    ASSERT_NE(nullptr, result.ptr);
+    EXPECT_LE(1000, result.usableSize);
+    EXPECT_TRUE(fastHeap.deallocate(result.ptr, result.usableSize, size_t(0)));
+
+    auto whole = fastHeap.alloc(kBasicHeapBufferSize / 2);
+    EXPECT_NE(nullptr, whole);
+    EXPECT_TRUE(fastHeap.deallocate(whole, kBasicHeapBufferSize / 2, size_t(0)));
+}
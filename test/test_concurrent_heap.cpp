@@ -0,0 +1,518 @@
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif //defined(__unix__) || defined(__APPLE__)
+
+#include "concurrent_heap.h"
+#include "test_utilities.h"
+#include "gtest/gtest.h"
+
+const size_t kConcurrentHeapBufferSize = 4 * 1024 * 1024;
+
+namespace {
+    //! \brief  Releases an allocation when the thread that owns it exits, after the thread's caches have been flushed.
+    struct ExitRelease {
+        ngen::memory::ConcurrentHeap *heap = nullptr;
+        void *ptr = nullptr;
+
+        ~ExitRelease() {
+            if (heap) {
+                heap->deallocate(ptr, false, nullptr, 0);
+            }
+        }
+    };
+
+    thread_local ExitRelease exitRelease;
+}
+
+TEST(ConcurrentHeap, Initialize) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+
+    ngen::memory::ThreadCacheLimits limits;
+    limits.batchCount = 0;
+
+    EXPECT_FALSE(heap.initialize(nullptr, kConcurrentHeapBufferSize));
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize, ngen::memory::kAllocationStrategy::TLSF, limits));
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize));
+
+    EXPECT_EQ(kConcurrentHeapBufferSize, heap.getSize());
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getCachedBlocks());
+}
+
+TEST(ConcurrentHeap, CacheRefillAndReuse) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ThreadCacheLimits limits;
+    limits.batchCount = 8;
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize, ngen::memory::kAllocationStrategy::TLSF, limits));
+
+    // The first allocation refills the bucket with a whole batch of blocks.
+    auto first = heap.alloc(40);
+    EXPECT_NE(nullptr, first);
+    EXPECT_TRUE(validateAlignment(first, 8));
+    EXPECT_EQ(1, heap.getAllocations());
+    EXPECT_EQ(limits.batchCount - 1, heap.getCachedBlocks());
+    EXPECT_EQ(limits.batchCount, heap.getTotalAllocations());
+
+    // Requests rounding to the same bucket are served from the cache without touching the heap.
+    auto second = heap.alloc(64);
+    EXPECT_NE(nullptr, second);
+    EXPECT_EQ(2, heap.getAllocations());
+    EXPECT_EQ(limits.batchCount, heap.getTotalAllocations());
+
+    // A released block is reused by the next request of the same size.
+    heap.deallocate(second, false, nullptr, 0);
+    EXPECT_EQ(1, heap.getAllocations());
+    EXPECT_EQ(second, heap.alloc(50));
+
+    heap.deallocate(second, false, nullptr, 0);
+    heap.deallocate(first, false, nullptr, 0);
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(limits.batchCount, heap.getCachedBlocks());
+
+    heap.flushThreadCache();
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getCachedBlocks());
+}
+
+TEST(ConcurrentHeap, CacheLimits) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ThreadCacheLimits limits;
+    limits.maximumBlockSize = 256;
+    limits.maximumBlocksPerBucket = 16;
+    limits.maximumCachedBytes = 2048;
+    limits.batchCount = 4;
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize, ngen::memory::kAllocationStrategy::First, limits));
+
+    std::vector<void *> allocations(64);
+    for (auto &allocation : allocations) {
+        allocation = heap.alloc(32);
+        EXPECT_NE(nullptr, allocation);
+    }
+
+    for (auto allocation : allocations) {
+        heap.deallocate(allocation, false, nullptr, 0);
+        EXPECT_GE(limits.maximumBlocksPerBucket, heap.getCachedBlocks());
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+
+    // Bucket lengths are powers of two, so the byte limit caps the number of large blocks held.
+    for (auto &allocation : allocations) {
+        allocation = heap.alloc(256);
+        EXPECT_NE(nullptr, allocation);
+    }
+
+    for (auto allocation : allocations) {
+        heap.deallocate(allocation, false, nullptr, 0);
+    }
+
+    EXPECT_GE(limits.maximumCachedBytes / 256 + limits.maximumBlocksPerBucket, heap.getCachedBlocks());
+
+    // Allocations larger than the limit are served by the heap directly.
+    const auto totalAllocations = heap.getTotalAllocations();
+    const auto cachedBlocks = heap.getCachedBlocks();
+
+    auto large = heap.alloc(1024);
+    EXPECT_NE(nullptr, large);
+    EXPECT_EQ(totalAllocations + 1, heap.getTotalAllocations());
+
+    heap.deallocate(large, false, nullptr, 0);
+    EXPECT_EQ(cachedBlocks, heap.getCachedBlocks());
+
+    heap.flushThreadCache();
+    EXPECT_EQ(0, heap.getCachedBlocks());
+}
+
+TEST(ConcurrentHeap, TrackedAllocations) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize));
+
+    auto tracked = heap.allocArray(64, __FILE__, __LINE__);
+    EXPECT_NE(nullptr, tracked);
+    EXPECT_EQ(0, heap.getCachedBlocks());
+
+    // Tracked allocations are validated by the underlying heap.
+    EXPECT_FALSE(heap.deallocate(tracked, false, __FILE__, __LINE__));
+    EXPECT_TRUE(heap.deallocate(tracked, true, __FILE__, __LINE__));
+    EXPECT_EQ(0, heap.getCachedBlocks());
+
+    // Array blocks of the underlying heap are never cached, even when released without a file name.
+    tracked = heap.allocArray(64, __FILE__, __LINE__);
+    EXPECT_NE(nullptr, tracked);
+    EXPECT_FALSE(heap.deallocate(tracked, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(tracked, true, nullptr, 0));
+    EXPECT_EQ(0, heap.getCachedBlocks());
+
+    auto aligned = heap.alignedAlloc(64, 128);
+    EXPECT_NE(nullptr, aligned);
+    EXPECT_TRUE(validateAlignment(aligned, 128));
+    EXPECT_EQ(0, heap.getCachedBlocks());
+
+    heap.deallocate(aligned, false, nullptr, 0);
+    heap.flushThreadCache();
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(ConcurrentHeap, DoubleRelease) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize));
+
+    auto allocation = heap.alloc(64);
+    EXPECT_NE(nullptr, allocation);
+
+    // A block held by the thread cache is not accepted a second time, by the cache or by the underlying heap.
+    EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    const auto cachedBlocks = heap.getCachedBlocks();
+
+    EXPECT_FALSE(heap.deallocate(allocation, false, nullptr, 0));
+    EXPECT_FALSE(heap.deallocate(allocation, false, __FILE__, __LINE__));
+    EXPECT_EQ(cachedBlocks, heap.getCachedBlocks());
+
+    auto first = heap.alloc(64);
+    auto second = heap.alloc(64);
+    EXPECT_NE(nullptr, first);
+    EXPECT_NE(nullptr, second);
+    EXPECT_NE(first, second);
+
+    // A block handed out again by the cache may be released once more.
+    EXPECT_TRUE(heap.deallocate(first, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(second, false, nullptr, 0));
+
+    // Once flushed, a block is free within the underlying heap and is rejected there.
+    heap.flushThreadCache();
+    EXPECT_EQ(0, heap.getCachedBlocks());
+    EXPECT_FALSE(heap.deallocate(first, false, nullptr, 0));
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(ConcurrentHeap, ThreadExitFlushesCache) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize));
+
+    std::thread worker([&heap]() {
+        std::vector<void *> allocations(100);
+        for (auto &allocation : allocations) {
+            allocation = heap.alloc(24);
+        }
+
+        for (auto allocation : allocations) {
+            heap.deallocate(allocation, false, nullptr, 0);
+        }
+    });
+
+    worker.join();
+
+    EXPECT_EQ(0, heap.getCachedBlocks());
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(ConcurrentHeap, ReleaseAfterThreadExit) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize));
+
+    std::thread worker([&heap]() {
+        // Constructed ahead of the thread's caches, so it is destroyed after they have been flushed.
+        exitRelease.heap = &heap;
+        exitRelease.ptr = heap.alloc(24);
+    });
+
+    worker.join();
+
+    // The late release must reach the heap, rather than a cache attached to the exited thread.
+    EXPECT_EQ(0, heap.getCachedBlocks());
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(ConcurrentHeap, CrossThreadRelease) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    for (auto strategy : { ngen::memory::kAllocationStrategy::First, ngen::memory::kAllocationStrategy::Smallest, ngen::memory::kAllocationStrategy::TLSF }) {
+        ngen::memory::ConcurrentHeap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize, strategy));
+
+        constexpr size_t kThreadCount = 4;
+        constexpr size_t kAllocationCount = 2000;
+
+        std::vector<std::vector<void *>> allocations(kThreadCount);
+        std::vector<std::thread> threads;
+
+        for (size_t thread = 0; thread < kThreadCount; ++thread) {
+            threads.emplace_back([&heap, &allocations, thread]() {
+                for (size_t loop = 0; loop < kAllocationCount; ++loop) {
+                    const auto length = 8 + (loop * 37 + thread * 11) % 600;
+
+                    auto allocation = static_cast<unsigned char *>(heap.alloc(length));
+                    ASSERT_NE(nullptr, allocation);
+                    memset(allocation, static_cast<int>(thread), length);
+
+                    if (loop & 1) {
+                        allocations[thread].push_back(allocation);
+                    } else {
+                        heap.deallocate(allocation, false, nullptr, 0);
+                    }
+                }
+            });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(kThreadCount * kAllocationCount / 2, heap.getAllocations());
+
+        // Release every allocation from a thread other than the one that made it.
+        threads.clear();
+        for (size_t thread = 0; thread < kThreadCount; ++thread) {
+            threads.emplace_back([&heap, &allocations, thread]() {
+                for (auto allocation : allocations[(thread + 1) % kThreadCount]) {
+                    EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+                }
+            });
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(0, heap.getAllocations());
+        EXPECT_EQ(0, heap.getCachedBlocks());
+        EXPECT_EQ(0, heap.getFailedAllocations());
+    }
+}
+
+TEST(ConcurrentHeap, Growable) {
+    constexpr size_t kReserveLength = 64 * 1024 * 1024;
+    constexpr size_t kCommitLength = 64 * 1024;
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initializeGrowable(kReserveLength, kCommitLength, ngen::memory::kAllocationStrategy::TLSF));
+    EXPECT_FALSE(heap.initializeGrowable(kReserveLength, kCommitLength));
+
+    const auto initialSize = heap.getSize();
+
+    std::vector<void *> allocations;
+
+    for (size_t loop = 0; loop < 64; ++loop) {
+        auto allocation = heap.alloc(8 * 1024 + loop);
+        ASSERT_NE(nullptr, allocation);
+
+        EXPECT_TRUE(validateAlignment(allocation, alignof(std::max_align_t)));
+        EXPECT_LE(8 * 1024 + loop, heap.getUsableSize(allocation));
+
+        allocations.push_back(allocation);
+    }
+
+    // Cached blocks carry the fundamental alignment, as they may be handed to any request.
+    auto cached = heap.alloc(40);
+    EXPECT_TRUE(validateAlignment(cached, alignof(std::max_align_t)));
+    EXPECT_LE(40, heap.getUsableSize(cached));
+    EXPECT_EQ(0, heap.getUsableSize(nullptr));
+
+    EXPECT_LT(initialSize, heap.getSize());
+
+    for (auto allocation : allocations) {
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    EXPECT_TRUE(heap.deallocate(cached, false, nullptr, 0));
+    heap.flushThreadCache();
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(ConcurrentHeap, GrowableConcurrentRelease) {
+    constexpr size_t kReserveLength = 64 * 1024 * 1024;
+    constexpr size_t kCommitLength = 64 * 1024;
+    constexpr size_t kThreadCount = 4;
+    constexpr size_t kAllocationCount = 256;
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initializeGrowable(kReserveLength, kCommitLength));
+
+    // Releases read the header of their allocation without the lock while other threads grow the heap.
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < kThreadCount; ++thread) {
+        threads.emplace_back([&heap, thread]() {
+            std::vector<void *> allocations;
+
+            for (size_t loop = 0; loop < kAllocationCount; ++loop) {
+                const auto length = 1024 + (loop + thread) * 64;
+
+                auto allocation = heap.alloc(length);
+                ASSERT_NE(nullptr, allocation);
+                EXPECT_LE(length, heap.getUsableSize(allocation));
+
+                allocations.push_back(allocation);
+            }
+
+            for (auto allocation : allocations) {
+                EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+            }
+
+            heap.flushThreadCache();
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(ConcurrentHeap, Fork) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kConcurrentHeapBufferSize));
+
+    std::atomic<bool> isCached(false);
+    std::atomic<bool> isForked(false);
+
+    // The worker keeps its blocks cached while the process forks, and does not exist within the child.
+    std::thread worker([&heap, &isCached, &isForked]() {
+        std::vector<void *> allocations(100);
+        for (auto &allocation : allocations) {
+            allocation = heap.alloc(24);
+        }
+
+        for (auto allocation : allocations) {
+            heap.deallocate(allocation, false, nullptr, 0);
+        }
+
+        isCached = true;
+
+        while (!isForked) {
+            std::this_thread::yield();
+        }
+    });
+
+    while (!isCached) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_NE(0, heap.getCachedBlocks());
+
+    // The fork handlers registered by the heap hold its locks across the fork.
+    const auto child = fork();
+    if (0 == child) {
+        // The blocks cached by the worker have been returned to the heap, and the heap remains usable.
+        auto allocation = heap.alloc(64);
+        const auto isUsable = allocation && heap.deallocate(allocation, false, nullptr, 0);
+
+        heap.flushThreadCache();
+        _exit(isUsable && 0 == heap.getCachedBlocks() && 0 == heap.getAllocations() ? 0 : 1);
+    }
+
+    isForked = true;
+    worker.join();
+
+    ASSERT_NE(-1, child);
+
+    int status = 0;
+    EXPECT_EQ(child, waitpid(child, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+
+    EXPECT_EQ(0, heap.getCachedBlocks());
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(ConcurrentHeap, ForkMultipleHeaps) {
+    std::unique_ptr<char[]> firstBuffer(new char[kConcurrentHeapBufferSize]);
+    std::unique_ptr<char[]> secondBuffer(new char[kConcurrentHeapBufferSize]);
+
+    ngen::memory::ConcurrentHeap first;
+    EXPECT_TRUE(first.initialize(firstBuffer.get(), kConcurrentHeapBufferSize));
+
+    ngen::memory::ConcurrentHeap second;
+    EXPECT_TRUE(second.initialize(secondBuffer.get(), kConcurrentHeapBufferSize));
+
+    std::atomic<bool> isCached(false);
+    std::atomic<bool> isForked(false);
+
+    // The worker keeps blocks cached by both heaps while the process forks.
+    std::thread worker([&first, &second, &isCached, &isForked]() {
+        for (auto heap : { &first, &second }) {
+            std::vector<void *> allocations(100);
+            for (auto &allocation : allocations) {
+                allocation = heap->alloc(24);
+            }
+
+            for (auto allocation : allocations) {
+                heap->deallocate(allocation, false, nullptr, 0);
+            }
+        }
+
+        isCached = true;
+
+        while (!isForked) {
+            std::this_thread::yield();
+        }
+    });
+
+    while (!isCached) {
+        std::this_thread::yield();
+    }
+
+    EXPECT_NE(0, first.getCachedBlocks());
+    EXPECT_NE(0, second.getCachedBlocks());
+
+    const auto child = fork();
+    if (0 == child) {
+        auto isUsable = true;
+
+        for (auto heap : { &first, &second }) {
+            auto allocation = heap->alloc(64);
+            isUsable = isUsable && allocation && heap->deallocate(allocation, false, nullptr, 0);
+
+            heap->flushThreadCache();
+            isUsable = isUsable && 0 == heap->getCachedBlocks() && 0 == heap->getAllocations();
+        }
+
+        _exit(isUsable ? 0 : 1);
+    }
+
+    isForked = true;
+    worker.join();
+
+    ASSERT_NE(-1, child);
+
+    int status = 0;
+    EXPECT_EQ(child, waitpid(child, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+
+    EXPECT_EQ(0, first.getCachedBlocks());
+    EXPECT_EQ(0, second.getCachedBlocks());
+}
+#endif //defined(__unix__) || defined(__APPLE__)
@@ -0,0 +1,341 @@
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "handle_heap.h"
+#include "gtest/gtest.h"
+
+const size_t kHandleHeapBufferSize = 64 * 1024;
+const size_t kHandleHeapHandleCount = 256;
+
+namespace {
+    //! \brief Helper method that fills an allocation with a value identifying it.
+    //! \param heap [in] - The heap that made the allocation.
+    //! \param handle [in] - Handle of the allocation to be filled.
+    //! \param value [in] - The value written to every byte of the allocation.
+    void fillAllocation(ngen::memory::HandleHeap &heap, ngen::memory::MemoryHandle handle, unsigned char value) {
+        memset(heap.resolve(handle), value, heap.getLength(handle));
+    }
+
+    //! \brief Helper method that determines whether or not every byte of an allocation holds the specified value.
+    //! \param heap [in] - The heap that made the allocation.
+    //! \param handle [in] - Handle of the allocation to be verified.
+    //! \param value [in] - The value every byte of the allocation is expected to hold.
+    //! \returns True if the allocation holds the value otherwise false.
+    bool validateAllocation(ngen::memory::HandleHeap &heap, ngen::memory::MemoryHandle handle, unsigned char value) {
+        auto ptr = static_cast<const unsigned char *>(heap.resolve(handle));
+        if (!ptr) {
+            return false;
+        }
+
+        for (size_t loop = 0; loop < heap.getLength(handle); ++loop) {
+            if (value != ptr[loop]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //! \brief Helper method that compacts a heap until no further allocations can be moved.
+    //! \param heap [in] - The heap to be compacted.
+    //! \param budget [in] - The time budget of each call to compact.
+    //! \returns The number of allocations that were moved.
+    size_t compactHeap(ngen::memory::HandleHeap &heap, std::chrono::nanoseconds budget) {
+        size_t relocations = 0;
+
+        for (size_t loop = 0; loop < 100000 && !heap.isCompacted(); ++loop) {
+            relocations += heap.compact(budget);
+        }
+
+        return relocations;
+    }
+}
+
+TEST(HandleHeap, Initialization) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_EQ(0, heap.getHandleCount());
+    EXPECT_TRUE(heap.isCompacted());
+
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, 0));
+    EXPECT_FALSE(heap.initialize(nullptr, kHandleHeapBufferSize, kHandleHeapHandleCount));
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+
+    EXPECT_EQ(kHandleHeapHandleCount, heap.getHandleCount());
+    EXPECT_EQ(0, heap.getLiveHandles());
+
+    EXPECT_NE(nullptr, heap.getHeap());
+
+    // The handle table must fit within the memory block, a failed attempt leaves the heap ready to be initialized.
+    std::unique_ptr<char[]> smallBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap small;
+    EXPECT_FALSE(small.initialize(smallBuffer.get(), 1024, kHandleHeapHandleCount));
+    EXPECT_EQ(0, small.getHandleCount());
+    EXPECT_EQ(nullptr, small.getHeap());
+    EXPECT_EQ(ngen::memory::kInvalidHandle, small.alloc(16));
+
+    EXPECT_TRUE(small.initialize(smallBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+    EXPECT_EQ(kHandleHeapHandleCount, small.getHandleCount());
+    EXPECT_EQ(2, small.getHeap()->getAllocations());
+}
+
+TEST(HandleHeap, Handles) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+
+    auto handle = heap.alloc(100);
+    EXPECT_NE(ngen::memory::kInvalidHandle, handle);
+    EXPECT_NE(nullptr, heap.resolve(handle));
+    EXPECT_EQ(100, heap.getLength(handle));
+    EXPECT_EQ(1, heap.getLiveHandles());
+
+    EXPECT_EQ(nullptr, heap.resolve(ngen::memory::kInvalidHandle));
+    EXPECT_FALSE(heap.release(ngen::memory::kInvalidHandle));
+
+    EXPECT_TRUE(heap.release(handle));
+    EXPECT_EQ(0, heap.getLiveHandles());
+
+    // A released handle is never resolved, even once its entry has been reused.
+    auto reused = heap.alloc(100);
+    EXPECT_EQ(handle.index, reused.index);
+    EXPECT_NE(handle.generation, reused.generation);
+
+    EXPECT_EQ(nullptr, heap.resolve(handle));
+    EXPECT_EQ(0, heap.getLength(handle));
+    EXPECT_FALSE(heap.release(handle));
+    EXPECT_NE(nullptr, heap.resolve(reused));
+
+    EXPECT_TRUE(heap.release(reused));
+}
+
+TEST(HandleHeap, HandleExhaustion) {
+    const size_t handleCount = 4;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, handleCount));
+
+    ngen::memory::MemoryHandle handles[handleCount];
+    for (auto &handle : handles) {
+        handle = heap.alloc(16);
+        EXPECT_NE(ngen::memory::kInvalidHandle, handle);
+    }
+
+    EXPECT_EQ(ngen::memory::kInvalidHandle, heap.alloc(16));
+    EXPECT_EQ(1, heap.getFailedAllocations());
+
+    // Releasing a handle makes its entry available once again.
+    EXPECT_TRUE(heap.release(handles[2]));
+    handles[2] = heap.alloc(16);
+    EXPECT_NE(ngen::memory::kInvalidHandle, handles[2]);
+
+    for (auto &handle : handles) {
+        EXPECT_TRUE(heap.release(handle));
+    }
+}
+
+TEST(HandleHeap, Compaction) {
+    const size_t allocationLength = 512;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+
+    std::vector<ngen::memory::MemoryHandle> handles;
+
+    for (auto handle = heap.alloc(allocationLength); ngen::memory::kInvalidHandle != handle; handle = heap.alloc(allocationLength)) {
+        fillAllocation(heap, handle, static_cast<unsigned char>(handles.size()));
+        handles.push_back(handle);
+    }
+
+    ASSERT_LT(16, handles.size());
+
+    // Releasing every other allocation leaves ample free memory, but no hole large enough for a larger allocation.
+    for (size_t loop = 0; loop < handles.size(); loop += 2) {
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+
+    const auto largeLength = allocationLength * (handles.size() / 4);
+    EXPECT_EQ(ngen::memory::kInvalidHandle, heap.alloc(largeLength));
+    EXPECT_FALSE(heap.isCompacted());
+
+    const auto relocations = compactHeap(heap, std::chrono::seconds(1));
+    EXPECT_TRUE(heap.isCompacted());
+    EXPECT_LT(0, relocations);
+    EXPECT_EQ(relocations, heap.getRelocations());
+    EXPECT_EQ(relocations * allocationLength, heap.getRelocatedBytes());
+
+    // The contents of the allocations moved with them.
+    for (size_t loop = 1; loop < handles.size(); loop += 2) {
+        EXPECT_TRUE(validateAllocation(heap, handles[loop], static_cast<unsigned char>(loop)));
+    }
+
+    auto large = heap.alloc(largeLength);
+    EXPECT_NE(ngen::memory::kInvalidHandle, large);
+    EXPECT_NE(nullptr, heap.resolve(large));
+
+    // Compacting a compacted heap moves nothing.
+    EXPECT_TRUE(heap.release(large));
+    EXPECT_EQ(0, compactHeap(heap, std::chrono::seconds(1)));
+
+    for (size_t loop = 1; loop < handles.size(); loop += 2) {
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+
+    EXPECT_EQ(0, heap.getLiveHandles());
+}
+
+TEST(HandleHeap, Pinning) {
+    const size_t allocationLength = 256;
+    const size_t allocationCount = 16;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+
+    ngen::memory::MemoryHandle handles[allocationCount];
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        handles[loop] = heap.alloc(allocationLength);
+        ASSERT_NE(ngen::memory::kInvalidHandle, handles[loop]);
+        fillAllocation(heap, handles[loop], static_cast<unsigned char>(loop));
+    }
+
+    for (size_t loop = 0; loop < allocationCount; loop += 2) {
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+
+    auto pinned = heap.pin(handles[7]);
+    EXPECT_NE(nullptr, pinned);
+    EXPECT_TRUE(heap.isPinned(handles[7]));
+    EXPECT_FALSE(heap.release(handles[7]));
+
+    {
+        ngen::memory::HandlePin pin(heap, handles[9]);
+        EXPECT_NE(nullptr, pin.get());
+        EXPECT_TRUE(heap.isPinned(handles[9]));
+
+        auto scoped = pin.get();
+
+        compactHeap(heap, std::chrono::seconds(1));
+        EXPECT_TRUE(heap.isCompacted());
+
+        // Pinned allocations remain where they are, while those around them move.
+        EXPECT_EQ(pinned, heap.resolve(handles[7]));
+        EXPECT_EQ(scoped, heap.resolve(handles[9]));
+        EXPECT_LT(0, heap.getRelocations());
+    }
+
+    EXPECT_FALSE(heap.isPinned(handles[9]));
+    EXPECT_FALSE(heap.isCompacted());
+
+    EXPECT_TRUE(heap.unpin(handles[7]));
+    EXPECT_FALSE(heap.unpin(handles[7]));
+    EXPECT_FALSE(heap.isPinned(handles[7]));
+
+    compactHeap(heap, std::chrono::seconds(1));
+    EXPECT_TRUE(heap.isCompacted());
+
+    for (size_t loop = 1; loop < allocationCount; loop += 2) {
+        EXPECT_TRUE(validateAllocation(heap, handles[loop], static_cast<unsigned char>(loop)));
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+}
+
+TEST(HandleHeap, IncrementalCompaction) {
+    const size_t allocationLength = 128;
+    const size_t allocationCount = 64;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount, ngen::memory::kAllocationStrategy::TLSF));
+
+    ngen::memory::MemoryHandle handles[allocationCount];
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        handles[loop] = heap.alloc(allocationLength);
+        ASSERT_NE(ngen::memory::kInvalidHandle, handles[loop]);
+        fillAllocation(heap, handles[loop], static_cast<unsigned char>(loop));
+    }
+
+    for (size_t loop = 0; loop < allocationCount; loop += 2) {
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+
+    // Without a budget each call examines a single allocation, so at most one allocation moves per call.
+    size_t calls = 0;
+    size_t relocations = 0;
+
+    while (!heap.isCompacted() && calls < 100000) {
+        const auto moved = heap.compact(std::chrono::nanoseconds(0));
+        EXPECT_GE(1, moved);
+
+        relocations += moved;
+        calls++;
+
+        // Allocations made between calls are accounted for by a later sweep.
+        if (8 == calls) {
+            handles[0] = heap.alloc(allocationLength);
+            ASSERT_NE(ngen::memory::kInvalidHandle, handles[0]);
+            fillAllocation(heap, handles[0], 0);
+        }
+    }
+
+    EXPECT_TRUE(heap.isCompacted());
+    EXPECT_LT(relocations, calls);
+    EXPECT_EQ(relocations, heap.getRelocations());
+
+    EXPECT_TRUE(validateAllocation(heap, handles[0], 0));
+    EXPECT_TRUE(heap.release(handles[0]));
+
+    for (size_t loop = 1; loop < allocationCount; loop += 2) {
+        EXPECT_TRUE(validateAllocation(heap, handles[loop], static_cast<unsigned char>(loop)));
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+}
+
+TEST(HandleHeap, AlignedCompaction) {
+    const size_t alignments[] = {16, 64, 256, 1024};
+    const size_t allocationCount = 32;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kHandleHeapBufferSize]);
+
+    ngen::memory::HandleHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kHandleHeapBufferSize, kHandleHeapHandleCount));
+
+    ngen::memory::MemoryHandle handles[allocationCount];
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        handles[loop] = heap.alignedAlloc(100 + loop * 8, alignments[loop % 4]);
+        ASSERT_NE(ngen::memory::kInvalidHandle, handles[loop]);
+        fillAllocation(heap, handles[loop], static_cast<unsigned char>(loop));
+    }
+
+    for (size_t loop = 0; loop < allocationCount; loop += 3) {
+        EXPECT_TRUE(heap.release(handles[loop]));
+    }
+
+    compactHeap(heap, std::chrono::seconds(1));
+    EXPECT_TRUE(heap.isCompacted());
+    EXPECT_LT(0, heap.getRelocations());
+
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        if (loop % 3) {
+            auto ptr = reinterpret_cast<uintptr_t>(heap.resolve(handles[loop]));
+            EXPECT_EQ(0, ptr & (alignments[loop % 4] - 1));
+
+            EXPECT_TRUE(validateAllocation(heap, handles[loop], static_cast<unsigned char>(loop)));
+            EXPECT_TRUE(heap.release(handles[loop]));
+        }
+    }
+
+    EXPECT_EQ(0, heap.getLiveHandles());
+}
@@ -1,22 +1,16 @@
 
 #include <memory>
+#include <vector>
+#include <cstring>
+#include <thread>
 #include "heap.h"
+#include "ngen_memory.h"
+#include "test_utilities.h"
 #include "gtest/gtest.h"
 
 const size_t kTestAllocationBufferSize = 1024;
 const size_t kInvalidAllocationBufferSize = 0;
 
-namespace {
-    //! \brief  Helper method that determines whether or not the specified pointer has the specified alignment.
-    //! \param ptr [in] - The pointer whose alignment is to be verified.
-    //! \param alignment [in] - The alignment the pointer is expected to have *must* be a power of two (this is not verified).
-    //! \returns True if the pointer has the specified alignment otherwise false.
-    bool validateAlignment(void *ptr, size_t alignment) {
-        const auto raw = reinterpret_cast<uintptr_t>(ptr);
-        return (0 == (raw & (alignment - 1)));
-    }
-}
-
 TEST(Heap, Construction) {
     ngen::memory::Heap heap;
 
@@ -41,6 +35,11 @@ TEST(Heap, FailedInitialization) {
     EXPECT_FALSE(heap.initialize(nullptr, kTestAllocationBufferSize, ngen::memory::kAllocationStrategy::Smallest));
     EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kInvalidAllocationBufferSize, ngen::memory::kAllocationStrategy::Smallest));
 
+    EXPECT_FALSE(heap.initialize(nullptr, kInvalidAllocationBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+    EXPECT_FALSE(heap.initialize(nullptr, kTestAllocationBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), kInvalidAllocationBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+    EXPECT_FALSE(heap.initialize(allocationBuffer.get(), 64, ngen::memory::kAllocationStrategy::TLSF));
+
     // Make sure these variables haven't changed during the above calls.
     EXPECT_EQ(0, heap.getAllocations());
     EXPECT_EQ(0, heap.getTotalAllocations());
@@ -85,6 +84,23 @@ TEST(Heap, Initialize_Smallest) {
     EXPECT_EQ(ngen::memory::kAllocationStrategy::Smallest, heap.getAllocationStrategy());
 }
 
+TEST(Heap, Initialize_TLSF) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kTestAllocationBufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kTestAllocationBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+    EXPECT_EQ(kTestAllocationBufferSize, heap.getSize());
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getTotalAllocations());
+    EXPECT_EQ(ngen::memory::kAllocationStrategy::TLSF, heap.getAllocationStrategy());
+
+    void *testAllocation = heap.alloc(64);
+    EXPECT_NE(nullptr, testAllocation);
+    EXPECT_TRUE(heap.deallocate(testAllocation, false, nullptr, 0));
+}
+
 TEST(Heap, SingleAllocation) {
     std::unique_ptr<char[]> allocationBuffer(new char[kTestAllocationBufferSize]);
 
@@ -376,3 +392,766 @@ TEST(Heap, FullAllocation) {
 
     EXPECT_TRUE(heap.deallocate(testAllocation, false, nullptr, 0));
 }
+
+//! \brief Fragments a TLSF heap into many free blocks of varying sizes and verifies requests are still satisfied.
+TEST(Heap, TLSF_Fragmented) {
+    const size_t bufferSize = 1024 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, ngen::memory::kAllocationStrategy::TLSF));
+
+    std::vector<void *> allocations;
+
+    for (size_t loop = 0; loop < 2048; ++loop) {
+        void *allocation = heap.alloc(16 + (loop % 13) * 24);
+
+        EXPECT_NE(nullptr, allocation);
+        allocations.push_back(allocation);
+    }
+
+    // Release every other allocation, leaving isolated free blocks between the live ones.
+    for (size_t loop = 0; loop < allocations.size(); loop += 2) {
+        EXPECT_TRUE(heap.deallocate(allocations[loop], false, nullptr, 0));
+        allocations[loop] = nullptr;
+    }
+
+    for (size_t loop = 0; loop < allocations.size(); loop += 2) {
+        allocations[loop] = heap.alignedAlloc(16 + (loop % 7) * 8, 32);
+
+        EXPECT_NE(nullptr, allocations[loop]);
+        EXPECT_TRUE(validateAlignment(allocations[loop], 32));
+    }
+
+    EXPECT_EQ(allocations.size(), heap.getAllocations());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+
+    for (auto allocation : allocations) {
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+
+    // With everything released the heap should have coalesced back into a single block.
+    void *large = heap.alloc(bufferSize / 2);
+    EXPECT_NE(nullptr, large);
+    EXPECT_TRUE(heap.deallocate(large, false, nullptr, 0));
+}
+
+//! \brief Verifies TLSF never hands out a block that is too small for the requested alignment.
+TEST(Heap, TLSF_Alignment) {
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, ngen::memory::kAllocationStrategy::TLSF));
+
+    for (size_t alignment = 4; alignment <= 128; alignment *= 2) {
+        void *allocation = heap.alignedAlloc(100, alignment);
+
+        EXPECT_NE(nullptr, allocation);
+        EXPECT_TRUE(validateAlignment(allocation, alignment));
+
+        memset(allocation, 0xcd, 100);
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(nullptr, heap.alloc(bufferSize));
+    EXPECT_EQ(1, heap.getFailedAllocations());
+}
+
+//! \brief Verifies the Smallest strategy selects the smallest free block able to hold a request, not the first.
+TEST(Heap, Smallest_SelectsSmallestBlock) {
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, ngen::memory::kAllocationStrategy::Smallest));
+
+    void *largeHole = heap.alloc(512);
+    void *separatorA = heap.alloc(64);
+    void *smallHole = heap.alloc(128);
+    void *separatorB = heap.alloc(64);
+    void *exactHole = heap.alloc(256);
+    void *separatorC = heap.alloc(64);
+
+    EXPECT_TRUE(heap.deallocate(largeHole, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(smallHole, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(exactHole, false, nullptr, 0));
+
+    // The request is too large for the small hole and fits the 256 byte hole exactly.
+    void *allocation = heap.alloc(256);
+    EXPECT_EQ(exactHole, allocation);
+
+    void *smallAllocation = heap.alloc(100);
+    EXPECT_EQ(smallHole, smallAllocation);
+
+    void *largeAllocation = heap.alloc(300);
+    EXPECT_EQ(largeHole, largeAllocation);
+
+    for (auto ptr : { allocation, smallAllocation, largeAllocation, separatorA, separatorB, separatorC }) {
+        EXPECT_TRUE(heap.deallocate(ptr, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+
+    void *full = heap.alloc(bufferSize / 2);
+    EXPECT_NE(nullptr, full);
+    EXPECT_TRUE(heap.deallocate(full, false, nullptr, 0));
+}
+
+//! \brief Churns a Smallest heap with many free blocks to exercise the balancing of the size index.
+TEST(Heap, Smallest_ManyFreeBlocks) {
+    const size_t bufferSize = 1024 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, ngen::memory::kAllocationStrategy::Smallest));
+
+    std::vector<void *> allocations;
+
+    for (size_t loop = 0; loop < 4096; ++loop) {
+        void *allocation = heap.alloc(8 + (loop * 37) % 120);
+
+        EXPECT_NE(nullptr, allocation);
+        allocations.push_back(allocation);
+    }
+
+    for (size_t pass = 0; pass < 4; ++pass) {
+        for (size_t loop = pass; loop < allocations.size(); loop += 3) {
+            EXPECT_TRUE(heap.deallocate(allocations[loop], false, nullptr, 0));
+            allocations[loop] = nullptr;
+        }
+
+        for (size_t loop = pass; loop < allocations.size(); loop += 3) {
+            allocations[loop] = heap.alignedAlloc(8 + (loop * 53) % 120, 16);
+
+            EXPECT_NE(nullptr, allocations[loop]);
+            EXPECT_TRUE(validateAlignment(allocations[loop], 16));
+        }
+    }
+
+    for (auto allocation : allocations) {
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+}
+
+//! \brief Releases neighbouring allocations in every order and verifies the heap always coalesces back to a single block.
+TEST(Heap, DeallocateCoalesceNeighbours) {
+    const size_t bufferSize = 4096;
+
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    const size_t releaseOrders[][4] = {
+        { 0, 1, 2, 3 }, { 3, 2, 1, 0 }, { 0, 2, 1, 3 }, { 1, 3, 0, 2 }, { 2, 0, 3, 1 },
+    };
+
+    for (auto strategy : strategies) {
+        for (const auto &order : releaseOrders) {
+            std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+            ngen::memory::Heap heap;
+            EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, strategy));
+
+            void *allocations[4];
+            for (auto &allocation : allocations) {
+                allocation = heap.alloc(64);
+                EXPECT_NE(nullptr, allocation);
+            }
+
+            // Each release must join with whichever physical neighbours are already free.
+            for (auto index : order) {
+                EXPECT_TRUE(heap.deallocate(allocations[index], false, nullptr, 0));
+            }
+
+            EXPECT_EQ(0, heap.getAllocations());
+
+            // TLSF stores its control structure within the block, so cannot satisfy a request for the whole heap.
+            const size_t largest = (strategy == ngen::memory::kAllocationStrategy::TLSF) ? bufferSize / 2 : bufferSize - sizeof(ngen::memory::Allocation);
+
+            void *full = heap.alloc(largest);
+            EXPECT_NE(nullptr, full);
+            EXPECT_TRUE(heap.deallocate(full, false, nullptr, 0));
+        }
+    }
+}
+
+TEST(Heap, RemoteFrees_Enable) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kTestAllocationBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_FALSE(heap.enableRemoteFrees());
+    EXPECT_FALSE(heap.hasRemoteFrees());
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kTestAllocationBufferSize));
+    EXPECT_TRUE(heap.enableRemoteFrees());
+    EXPECT_TRUE(heap.hasRemoteFrees());
+
+    // Deallocations made by the owning thread are released immediately.
+    void *allocation = heap.alloc(64);
+    EXPECT_NE(nullptr, allocation);
+    EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.processRemoteFrees());
+}
+
+TEST(Heap, RemoteFrees_Queued) {
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(16 * 1024));
+    EXPECT_TRUE(heap.enableRemoteFrees());
+
+    void *allocations[] = { heap.alloc(0), heap.alloc(32), heap.alloc(512), heap.allocArray(1024) };
+    for (auto allocation : allocations) {
+        EXPECT_NE(nullptr, allocation);
+    }
+
+    std::thread consumer([&heap, &allocations]() {
+        EXPECT_TRUE(heap.deallocate(allocations[0], false, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(allocations[1], false, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(allocations[2], false, nullptr, 0));
+
+        // Queued allocations are still validated by the releasing thread.
+        EXPECT_FALSE(heap.deallocate(allocations[2], false, nullptr, 0));
+        EXPECT_FALSE(heap.deallocate(allocations[3], false, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(allocations[3], true, nullptr, 0));
+    });
+
+    consumer.join();
+
+    // Nothing is released until the owning thread processes the queue.
+    EXPECT_EQ(4, heap.getAllocations());
+    EXPECT_EQ(4, heap.processRemoteFrees());
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.processRemoteFrees());
+
+    EXPECT_EQ(0, heap.getSmallObjects().getAllocations());
+}
+
+TEST(Heap, RemoteFrees_ProducerConsumer) {
+    const size_t bufferSize = 1024 * 1024;
+    const size_t allocationCount = 20000;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    for (auto strategy : { ngen::memory::kAllocationStrategy::First, ngen::memory::kAllocationStrategy::Smallest, ngen::memory::kAllocationStrategy::TLSF }) {
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, strategy));
+        EXPECT_TRUE(heap.enableSmallObjects(64 * 1024));
+        EXPECT_TRUE(heap.enableRemoteFrees());
+
+        std::atomic<void *> slots[64] = {};
+        std::atomic<bool> finished(false);
+
+        // The consumer releases whatever the producer publishes, while the producer keeps allocating.
+        std::thread consumer([&slots, &finished, &heap]() {
+            bool done = false;
+            while (!done) {
+                done = finished.load();
+
+                for (auto &slot : slots) {
+                    auto allocation = slot.exchange(nullptr);
+                    if (allocation) {
+                        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+                    }
+                }
+            }
+        });
+
+        for (size_t loop = 0; loop < allocationCount; ++loop) {
+            auto allocation = heap.alloc(16 + (loop * 29) % 400);
+            ASSERT_NE(nullptr, allocation);
+
+            auto &slot = slots[loop % 64];
+            while (slot.load()) {
+                std::this_thread::yield();
+            }
+
+            slot.store(allocation);
+        }
+
+        finished.store(true);
+        consumer.join();
+
+        heap.processRemoteFrees();
+        EXPECT_EQ(0, heap.getAllocations());
+        EXPECT_EQ(0, heap.getFailedAllocations());
+    }
+}
+
+TEST(Heap, AllocationHeaderSize) {
+#if NGEN_MEMORY_TRACKING
+    EXPECT_LT(16, sizeof(ngen::memory::Allocation));
+#else
+    EXPECT_GE(16, sizeof(ngen::memory::Allocation));
+#endif //NGEN_MEMORY_TRACKING
+
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+
+    // Each block costs its data and header, but is never smaller than a free block.
+    size_t count = 0;
+    while (heap.alloc(64)) {
+        count++;
+    }
+
+    EXPECT_LE(bufferSize / (64 + sizeof(ngen::memory::Allocation) + sizeof(size_t)), count);
+
+    // The header still records the array state and owner of each allocation.
+    std::unique_ptr<char[]> otherBuffer(new char[kTestAllocationBufferSize]);
+
+    ngen::memory::Heap otherHeap;
+    EXPECT_TRUE(otherHeap.initialize(otherBuffer.get(), kTestAllocationBufferSize));
+
+    void *single = otherHeap.alloc(16);
+    void *array = otherHeap.allocArray(16);
+
+    EXPECT_FALSE(heap.deallocate(single, false, nullptr, 0));
+    EXPECT_FALSE(otherHeap.deallocate(single, true, nullptr, 0));
+    EXPECT_FALSE(otherHeap.deallocate(array, false, nullptr, 0));
+    EXPECT_TRUE(otherHeap.deallocate(single, false, nullptr, 0));
+    EXPECT_TRUE(otherHeap.deallocate(array, true, nullptr, 0));
+}
+
+TEST(Heap, TryExpandInPlace) {
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    for (auto strategy : { ngen::memory::kAllocationStrategy::First, ngen::memory::kAllocationStrategy::Smallest, ngen::memory::kAllocationStrategy::TLSF }) {
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, strategy));
+
+        void *first = heap.alloc(64);
+        void *second = heap.alloc(64);
+        void *third = heap.alloc(64);
+        EXPECT_NE(nullptr, third);
+
+        // An allocation followed by another live allocation cannot grow.
+        EXPECT_FALSE(heap.tryExpandInPlace(first, 1024));
+        EXPECT_TRUE(heap.tryExpandInPlace(first, 32));
+        EXPECT_LE(32, heap.getUsableSize(first));
+
+        // Once its neighbour is released it absorbs the free block.
+        EXPECT_TRUE(heap.deallocate(second, false, nullptr, 0));
+        EXPECT_TRUE(heap.tryExpandInPlace(first, 96));
+        EXPECT_LE(96, heap.getUsableSize(first));
+
+        // The last allocation grows into the remainder of the heap, and returns it once shrunk.
+        EXPECT_TRUE(heap.tryExpandInPlace(third, 32 * 1024));
+        EXPECT_LE(32 * 1024, heap.getUsableSize(third));
+        EXPECT_TRUE(heap.tryExpandInPlace(third, 64));
+        EXPECT_GT(1024, heap.getUsableSize(third));
+
+        void *large = heap.alloc(32 * 1024);
+        EXPECT_NE(nullptr, large);
+
+        EXPECT_FALSE(heap.tryExpandInPlace(nullptr, 64));
+        EXPECT_EQ(3, heap.getAllocations());
+
+        EXPECT_TRUE(heap.deallocate(first, false, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(third, false, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(large, false, nullptr, 0));
+
+        // Every block has been returned, so the whole heap is available once more.
+        void *whole = heap.alloc(bufferSize / 2);
+        EXPECT_NE(nullptr, whole);
+        EXPECT_TRUE(heap.deallocate(whole, false, nullptr, 0));
+    }
+}
+
+TEST(Heap, Reallocate) {
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+
+    auto buffer = static_cast<unsigned char *>(heap.reallocate(nullptr, 100));
+    EXPECT_NE(nullptr, buffer);
+    EXPECT_EQ(1, heap.getAllocations());
+
+    for (size_t loop = 0; loop < 100; ++loop) {
+        buffer[loop] = static_cast<unsigned char>(loop);
+    }
+
+    // A neighbouring allocation forces the buffer to move, its contents are preserved.
+    void *blocker = heap.alloc(16);
+    auto moved = static_cast<unsigned char *>(heap.reallocate(buffer, 4000));
+    EXPECT_NE(nullptr, moved);
+    EXPECT_NE(buffer, moved);
+    EXPECT_EQ(2, heap.getAllocations());
+
+    for (size_t loop = 0; loop < 100; ++loop) {
+        EXPECT_EQ(static_cast<unsigned char>(loop), moved[loop]);
+    }
+
+    // Shrinking never moves the allocation.
+    EXPECT_EQ(moved, heap.reallocate(moved, 50));
+
+    // A request that cannot be satisfied leaves the allocation untouched.
+    EXPECT_EQ(nullptr, heap.reallocate(moved, bufferSize));
+    EXPECT_EQ(static_cast<unsigned char>(49), moved[49]);
+
+    // Array allocations remain array allocations once moved.
+    void *array = heap.allocArray(64);
+    void *grown = heap.reallocate(array, 8000);
+    EXPECT_NE(nullptr, grown);
+    EXPECT_FALSE(heap.deallocate(grown, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(grown, true, nullptr, 0));
+
+    EXPECT_TRUE(heap.deallocate(moved, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(blocker, false, nullptr, 0));
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(Heap, AllocBatch) {
+    const size_t bufferSize = 256 * 1024;
+    const size_t batchSize = 1000;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    for (auto strategy : { ngen::memory::kAllocationStrategy::First, ngen::memory::kAllocationStrategy::Smallest, ngen::memory::kAllocationStrategy::TLSF }) {
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, strategy));
+
+        std::vector<void *> allocations(batchSize);
+        EXPECT_EQ(0, heap.allocBatch(batchSize, 48, 24, allocations.data()));
+        EXPECT_EQ(batchSize, heap.getFailedAllocations());
+
+        EXPECT_EQ(batchSize, heap.allocBatch(batchSize, 48, 16, allocations.data()));
+        EXPECT_EQ(batchSize, heap.getAllocations());
+        EXPECT_EQ(batchSize, heap.getTotalAllocations());
+
+        for (auto allocation : allocations) {
+            EXPECT_TRUE(validateAlignment(allocation, 16));
+            EXPECT_LE(48, heap.getUsableSize(allocation));
+            memset(allocation, 0xff, 48);
+        }
+
+        // Batch allocations are single allocations, so may be released individually.
+        EXPECT_FALSE(heap.deallocate(allocations[0], true, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(allocations[0], false, nullptr, 0));
+        EXPECT_EQ(batchSize - 1, heap.getAllocations());
+
+        // A batch that exceeds the heap reports how many allocations could be made.
+        std::vector<void *> overflow(bufferSize / 64);
+        const auto made = heap.allocBatch(overflow.size(), 64, 8, overflow.data());
+        EXPECT_LT(0, made);
+        EXPECT_GT(overflow.size(), made);
+        EXPECT_EQ(batchSize - 1 + made, heap.getAllocations());
+        EXPECT_EQ(batchSize + overflow.size() - made, heap.getFailedAllocations());
+
+        EXPECT_EQ(made, heap.deallocateBatch(overflow.data(), made));
+        EXPECT_EQ(batchSize - 1, heap.deallocateBatch(allocations.data() + 1, batchSize - 1));
+        EXPECT_EQ(0, heap.getAllocations());
+
+        // Every block has been returned, so the whole heap is available once more.
+        void *whole = heap.alloc(bufferSize / 2);
+        EXPECT_NE(nullptr, whole);
+        EXPECT_TRUE(heap.deallocate(whole, false, nullptr, 0));
+    }
+}
+
+TEST(Heap, DeallocateBatch) {
+    const size_t bufferSize = 256 * 1024;
+    const size_t allocationCount = 1000;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    for (auto strategy : { ngen::memory::kAllocationStrategy::First, ngen::memory::kAllocationStrategy::Smallest, ngen::memory::kAllocationStrategy::TLSF }) {
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, strategy));
+
+        std::vector<void *> allocations(allocationCount);
+        for (size_t loop = 0; loop < allocationCount; ++loop) {
+            allocations[loop] = heap.alloc(16 + (loop * 37) % 200);
+            EXPECT_NE(nullptr, allocations[loop]);
+        }
+
+        // Release every third allocation individually, so the batch contains both runs and isolated blocks.
+        std::vector<void *> batch;
+        for (size_t loop = 0; loop < allocationCount; ++loop) {
+            if (loop % 3) {
+                batch.push_back(allocations[(loop * 7919) % allocationCount]);
+            } else {
+                EXPECT_TRUE(heap.deallocate(allocations[(loop * 7919) % allocationCount], false, nullptr, 0));
+            }
+        }
+
+        // Invalid entries are skipped and do not prevent the remainder being released.
+        void *array = heap.allocArray(32);
+        batch.push_back(nullptr);
+        batch.push_back(array);
+        batch.push_back(batch[0]);
+
+        EXPECT_EQ(batch.size() - 2, heap.deallocateBatch(batch.data(), batch.size()));
+        EXPECT_EQ(1, heap.getAllocations());
+
+        EXPECT_TRUE(heap.deallocate(array, true, nullptr, 0));
+        EXPECT_EQ(0, heap.getAllocations());
+
+        void *whole = heap.alloc(bufferSize / 2);
+        EXPECT_NE(nullptr, whole);
+        EXPECT_TRUE(heap.deallocate(whole, false, nullptr, 0));
+    }
+}
+
+TEST(Heap, Growable) {
+    const size_t reserveLength = 4 * 1024 * 1024;
+    const size_t commitLength = 64 * 1024;
+    const size_t allocationLength = 1000;
+
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    for (auto strategy : strategies) {
+        ngen::memory::Heap heap;
+        EXPECT_FALSE(heap.isGrowable());
+        EXPECT_FALSE(heap.initializeGrowable(commitLength, reserveLength, strategy));
+
+        EXPECT_TRUE(heap.initializeGrowable(reserveLength, commitLength, strategy));
+        EXPECT_FALSE(heap.initializeGrowable(reserveLength, commitLength, strategy));
+        EXPECT_TRUE(heap.isGrowable());
+        EXPECT_EQ(reserveLength, heap.getReservedSize());
+
+        const auto initialSize = heap.getSize();
+        EXPECT_LE(commitLength, initialSize);
+
+        // Allocating more than the committed memory grows the heap rather than failing.
+        std::vector<void *> allocations;
+        while (allocations.size() * allocationLength < initialSize * 4) {
+            auto allocation = heap.alloc(allocationLength);
+            EXPECT_NE(nullptr, allocation);
+            memset(allocation, 0xcd, allocationLength);
+
+            allocations.push_back(allocation);
+        }
+
+        EXPECT_LT(initialSize * 4, heap.getSize());
+        EXPECT_GE(reserveLength, heap.getSize());
+        EXPECT_EQ(0, heap.getFailedAllocations());
+
+        // Once released, the blocks of every extent are joined into a single free block.
+        for (auto allocation : allocations) {
+            EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+        }
+
+        const auto grownSize = heap.getSize();
+
+        void *whole = heap.alloc(grownSize / 2 + allocationLength);
+        EXPECT_NE(nullptr, whole);
+        EXPECT_EQ(grownSize, heap.getSize());
+        EXPECT_TRUE(heap.deallocate(whole, false, nullptr, 0));
+
+        // Requests beyond the reservation still fail, and are counted as failures.
+        EXPECT_EQ(nullptr, heap.alloc(reserveLength));
+        EXPECT_EQ(1, heap.getFailedAllocations());
+
+        void *batch[32];
+        EXPECT_EQ(32, heap.allocBatch(32, 64 * 1024, 8, batch));
+        EXPECT_EQ(32, heap.deallocateBatch(batch, 32));
+        EXPECT_EQ(0, heap.getAllocations());
+    }
+}
+
+//! \brief Verifies page and huge page alignments are satisfied, and that the leading padding returns to the free list.
+TEST(Heap, LargeAlignment) {
+    const size_t bufferSize = 32 * 1024;
+    const size_t pageAlignment = 4096;
+    const size_t hugePageAlignment = 2 * 1024 * 1024;
+    const size_t smallLength = 64;
+
+    const ngen::memory::kAllocationStrategy strategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    for (auto strategy : strategies) {
+        std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize, strategy));
+
+        std::vector<void *> aligned;
+        while (auto allocation = heap.alignedAlloc(smallLength, pageAlignment)) {
+            EXPECT_TRUE(validateAlignment(allocation, pageAlignment));
+            memset(allocation, 0xcd, smallLength);
+
+            aligned.push_back(allocation);
+        }
+
+        EXPECT_LE(6, aligned.size());
+
+        // Were the padding folded into each allocation, only the final remainder could hold further requests.
+        std::vector<void *> small;
+        while (auto allocation = heap.alloc(smallLength)) {
+            small.push_back(allocation);
+        }
+
+        EXPECT_LT(bufferSize / 4, small.size() * smallLength);
+
+        for (auto allocation : aligned) {
+            EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+        }
+
+        for (auto allocation : small) {
+            EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+        }
+
+        // Every block has been joined back together.
+        auto whole = heap.alloc(bufferSize / 2);
+        EXPECT_NE(nullptr, whole);
+        EXPECT_TRUE(heap.deallocate(whole, false, nullptr, 0));
+
+        // Alignments the memory of the heap could never satisfy fail.
+        const auto failures = heap.getFailedAllocations();
+        EXPECT_EQ(nullptr, heap.alignedAlloc(smallLength, hugePageAlignment));
+        EXPECT_EQ(failures + 1, heap.getFailedAllocations());
+
+        void *batch[4];
+        EXPECT_EQ(4, heap.allocBatch(4, smallLength, pageAlignment, batch));
+        for (auto allocation : batch) {
+            EXPECT_TRUE(validateAlignment(allocation, pageAlignment));
+        }
+
+        EXPECT_EQ(4, heap.deallocateBatch(batch, 4));
+        EXPECT_EQ(0, heap.getAllocations());
+    }
+
+    // A growable heap reserves enough address space for huge page alignments.
+    for (auto strategy : strategies) {
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(heap.initializeGrowable(hugePageAlignment * 4, 64 * 1024, strategy));
+
+        auto allocation = heap.alignedAlloc(smallLength, hugePageAlignment);
+        EXPECT_NE(nullptr, allocation);
+        EXPECT_TRUE(validateAlignment(allocation, hugePageAlignment));
+        memset(allocation, 0xcd, smallLength);
+
+        auto reallocated = heap.reallocate(allocation, smallLength * 2);
+        EXPECT_NE(nullptr, reallocated);
+        EXPECT_TRUE(validateAlignment(reallocated, pageAlignment));
+
+        EXPECT_TRUE(heap.deallocate(reallocated, false, nullptr, 0));
+        EXPECT_EQ(0, heap.getAllocations());
+    }
+}
+
+TEST(Heap, AllocAtLeast) {
+    const size_t bufferSize = 64 * 1024;
+    const size_t alignment = 64;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+
+    for (size_t length = 1; length < 300; length += 7) {
+        auto result = heap.allocAtLeast(length);
+        ASSERT_NE(nullptr, result.ptr);
+        EXPECT_LE(length, result.usableSize);
+        EXPECT_EQ(heap.getUsableSize(result.ptr), result.usableSize);
+
+        // The whole of the usable length may be written, and the allocation released with it.
+        memset(result.ptr, 0xcd, result.usableSize);
+        EXPECT_TRUE(heap.deallocate(result.ptr, result.usableSize, size_t(0)));
+    }
+
+    auto aligned = heap.allocAtLeast(100, alignment);
+    ASSERT_NE(nullptr, aligned.ptr);
+    EXPECT_TRUE(validateAlignment(aligned.ptr, alignment));
+    EXPECT_LE(100, aligned.usableSize);
+    EXPECT_TRUE(heap.deallocate(aligned.ptr, 100, alignment));
+
+    auto failed = heap.allocAtLeast(bufferSize);
+    EXPECT_EQ(nullptr, failed.ptr);
+    EXPECT_EQ(0, failed.usableSize);
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(Heap, SizedDeallocate) {
+    const size_t bufferSize = 256 * 1024;
+    const size_t allocationCount = 64;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(16 * 1024));
+
+    // Lengths on either side of the small object limit release through both paths.
+    void *allocations[allocationCount];
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        allocations[loop] = heap.alloc(loop * 8 + 1);
+        ASSERT_NE(nullptr, allocations[loop]);
+    }
+
+    EXPECT_NE(0, heap.getSmallObjects().getAllocations());
+
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        EXPECT_TRUE(heap.deallocate(allocations[loop], loop * 8 + 1, size_t(0)));
+    }
+
+    auto array = heap.alignedAllocArray(1000, 128);
+    ASSERT_NE(nullptr, array);
+    EXPECT_TRUE(heap.deallocateArray(array, 1000, 128));
+
+    EXPECT_TRUE(heap.deallocate(nullptr, 16, size_t(0)));
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getSmallObjects().getAllocations());
+
+    // The whole heap is available once more.
+    auto whole = heap.alloc(bufferSize / 2);
+    EXPECT_NE(nullptr, whole);
+    EXPECT_TRUE(heap.deallocate(whole, bufferSize / 2, size_t(0)));
+}
+
+TEST(Heap, SizedDeleteOperators) {
+    struct alignas(32) Vector {
+        float values[8];
+    };
+
+    const size_t bufferSize = 64 * 1024;
+    std::unique_ptr<char[]> allocationBuffer(new char[bufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), bufferSize));
+
+    auto value = new(&heap) uint64_t(42);
+    EXPECT_EQ(42, *value);
+    operator delete(value, sizeof(uint64_t), &heap);
+
+    auto vector = new(&heap, alignof(Vector)) Vector();
+    EXPECT_TRUE(validateAlignment(vector, alignof(Vector)));
+    vector->~Vector();
+    operator delete(vector, sizeof(Vector), &heap, alignof(Vector));
+
+    auto values = new(&heap) uint32_t[100];
+    operator delete[](values, sizeof(uint32_t) * 100, &heap);
+
+    auto vectors = new(&heap, alignof(Vector)) Vector[4];
+    EXPECT_TRUE(validateAlignment(vectors, alignof(Vector)));
+    operator delete[](vectors, sizeof(Vector) * 4, &heap, alignof(Vector));
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
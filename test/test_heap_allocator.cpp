@@ -0,0 +1,136 @@
+
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "concurrent_heap.h"
+#include "heap_allocator.h"
+#include "gtest/gtest.h"
+
+const size_t kAllocatorBufferSize = 256 * 1024;
+
+namespace {
+    //! \brief Helper method that determines whether or not an object lies entirely within a memory block.
+    //! \param object [in] - Pointer to the object to be verified.
+    //! \param buffer [in] - Pointer to the start of the memory block.
+    //! \param bufferSize [in] - Length (in bytes) of the memory block.
+    //! \returns True if the object lies within the memory block otherwise false.
+    template <typename T>
+    bool isWithinBuffer(const T *object, const char *buffer, size_t bufferSize) {
+        auto address = reinterpret_cast<const char *>(object);
+        return address >= buffer && address + sizeof(T) <= buffer + bufferSize;
+    }
+}
+
+TEST(HeapAllocator, Containers) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kAllocatorBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kAllocatorBufferSize));
+
+    {
+        ngen::memory::HeapAllocator<int> allocator(heap);
+
+        std::vector<int, ngen::memory::HeapAllocator<int>> numbers(allocator);
+        std::list<int, ngen::memory::HeapAllocator<int>> nodes(allocator);
+        std::map<int, int, std::less<>, ngen::memory::HeapAllocator<std::pair<const int, int>>> sorted(allocator);
+
+        for (int loop = 0; loop < 1000; ++loop) {
+            numbers.push_back(loop);
+            nodes.push_back(loop);
+            sorted[loop] = loop;
+        }
+
+        EXPECT_LT(0, heap.getAllocations());
+
+        for (auto &number : numbers) {
+            EXPECT_TRUE(isWithinBuffer(&number, allocationBuffer.get(), kAllocatorBufferSize));
+        }
+
+        for (auto &node : nodes) {
+            EXPECT_TRUE(isWithinBuffer(&node, allocationBuffer.get(), kAllocatorBufferSize));
+        }
+
+        for (auto &pair : sorted) {
+            EXPECT_TRUE(isWithinBuffer(&pair, allocationBuffer.get(), kAllocatorBufferSize));
+        }
+
+        // Rebound copies share the heap, so the containers may release memory allocated through one another.
+        ngen::memory::HeapAllocator<double> rebound(allocator);
+        EXPECT_TRUE(rebound == allocator);
+        EXPECT_EQ(&heap, rebound.getHeap());
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+
+    // Once the heap is exhausted, allocation failures are reported as they are by the standard allocator.
+    ngen::memory::HeapAllocator<char> allocator(heap);
+    EXPECT_THROW((void)allocator.allocate(kAllocatorBufferSize), std::bad_alloc);
+}
+
+TEST(HeapAllocator, MemoryResource) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kAllocatorBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kAllocatorBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+
+    ngen::memory::HeapMemoryResource<> resource(heap);
+    EXPECT_EQ(&heap, resource.getHeap());
+
+    {
+        std::pmr::unordered_map<int, std::pmr::string> names(&resource);
+
+        for (int loop = 0; loop < 500; ++loop) {
+            names.emplace(loop, std::string(64, static_cast<char>('a' + loop % 26)));
+        }
+
+        EXPECT_LT(0, heap.getAllocations());
+
+        // The strings are constructed using the resource of the map, so their contents are also held by the heap.
+        for (auto &pair : names) {
+            EXPECT_TRUE(isWithinBuffer(&pair, allocationBuffer.get(), kAllocatorBufferSize));
+            EXPECT_TRUE(isWithinBuffer(pair.second.data(), allocationBuffer.get(), kAllocatorBufferSize));
+        }
+
+        auto aligned = resource.allocate(256, 256);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(aligned) & 255);
+        resource.deallocate(aligned, 256, 256);
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+
+    ngen::memory::HeapMemoryResource<> shared(heap);
+    EXPECT_TRUE(resource.is_equal(shared));
+    EXPECT_FALSE(resource.is_equal(*std::pmr::new_delete_resource()));
+
+    EXPECT_THROW((void)resource.allocate(kAllocatorBufferSize), std::bad_alloc);
+}
+
+TEST(HeapAllocator, ConcurrentHeap) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kAllocatorBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kAllocatorBufferSize));
+
+    {
+        ngen::memory::HeapMemoryResource<ngen::memory::ConcurrentHeap> resource(heap);
+        std::pmr::vector<int> numbers(&resource);
+
+        ngen::memory::HeapAllocator<int, ngen::memory::ConcurrentHeap> allocator(heap);
+        std::vector<int, ngen::memory::HeapAllocator<int, ngen::memory::ConcurrentHeap>> others(allocator);
+
+        for (int loop = 0; loop < 1000; ++loop) {
+            numbers.push_back(loop);
+            others.push_back(loop);
+        }
+
+        EXPECT_TRUE(isWithinBuffer(numbers.data(), allocationBuffer.get(), kAllocatorBufferSize));
+        EXPECT_TRUE(isWithinBuffer(others.data(), allocationBuffer.get(), kAllocatorBufferSize));
+        EXPECT_EQ(2, heap.getAllocations());
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
@@ -0,0 +1,368 @@
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "heap.h"
+#include "heap_profiler.h"
+#include "gtest/gtest.h"
+
+const size_t kProfilerBufferSize = 1024 * 1024;
+
+namespace {
+    //! \brief Helper method that locates the site of the profile made at a source location.
+    //! \param sites [in] - The sites of the profile.
+    //! \param fileName [in] - The source file of the site.
+    //! \param line [in] - The line number of the site.
+    //! \returns Pointer to the site, or null if there is no site for the source location.
+    const ngen::memory::HeapProfileSite *findSite(const std::vector<ngen::memory::HeapProfileSite> &sites, const char *fileName, size_t line) {
+        for (auto &site : sites) {
+            if (site.fileName == fileName && site.line == line) {
+                return &site;
+            }
+        }
+
+        return nullptr;
+    }
+}
+
+TEST(HeapProfiler, Initialization) {
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_FALSE(profiler.isInitialized());
+    EXPECT_FALSE(profiler.dump(stdout));
+
+    EXPECT_FALSE(profiler.initialize(0));
+    EXPECT_FALSE(profiler.initialize(1024, 0, 16));
+    EXPECT_FALSE(profiler.initialize(1024, 16, 0));
+
+    EXPECT_TRUE(profiler.initialize());
+    EXPECT_FALSE(profiler.initialize());
+
+    EXPECT_TRUE(profiler.isInitialized());
+    EXPECT_EQ(ngen::memory::HeapProfiler::kDefaultSampleInterval, profiler.getSampleInterval());
+    EXPECT_EQ(0, profiler.getSamples());
+    EXPECT_TRUE(profiler.getSites().empty());
+
+    for (size_t loop = 0; loop < 1000; ++loop) {
+        EXPECT_LE(1, profiler.nextSampleInterval());
+    }
+}
+
+TEST(HeapProfiler, SourceLocations) {
+    static const char kFileName[] = "profiled.cpp";
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize));
+
+    // Sampling every byte records every allocation exactly.
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(1));
+
+    heap.setHeapProfiler(&profiler);
+    EXPECT_EQ(&profiler, heap.getHeapProfiler());
+
+    void *first[10];
+    for (auto &allocation : first) {
+        allocation = heap.alloc(100, kFileName, 10);
+        EXPECT_NE(nullptr, allocation);
+    }
+
+    auto second = heap.allocArray(1000, kFileName, 20);
+    EXPECT_NE(nullptr, second);
+
+    for (size_t loop = 0; loop < 4; ++loop) {
+        EXPECT_TRUE(heap.deallocate(first[loop], false, nullptr, 0));
+    }
+
+    auto sites = profiler.getSites();
+    ASSERT_EQ(2, sites.size());
+    EXPECT_EQ(11, profiler.getSamples());
+    EXPECT_EQ(7, profiler.getLiveSamples());
+    EXPECT_EQ(0, profiler.getDroppedSamples());
+
+    auto site = findSite(sites, kFileName, 10);
+    ASSERT_NE(nullptr, site);
+    EXPECT_EQ(0, site->frameCount);
+    EXPECT_EQ(10, site->samples);
+    EXPECT_EQ(1000, site->allocatedBytes);
+    EXPECT_EQ(10, site->allocatedCount);
+    EXPECT_EQ(600, site->liveBytes);
+    EXPECT_EQ(6, site->liveCount);
+    EXPECT_EQ(10, site->sizes[ngen::memory::detail::getHistogramBucket(100)]);
+
+    // Sites are ordered by their live bytes.
+    EXPECT_EQ(20, sites[0].line);
+    EXPECT_EQ(1000, sites[0].liveBytes);
+
+    EXPECT_TRUE(heap.deallocate(second, true, nullptr, 0));
+
+    for (size_t loop = 4; loop < 10; ++loop) {
+        EXPECT_TRUE(heap.deallocate(first[loop], false, nullptr, 0));
+    }
+
+    for (auto &released : profiler.getSites()) {
+        EXPECT_EQ(0, released.liveBytes);
+        EXPECT_EQ(0, released.liveCount);
+    }
+
+    // Allocations made once the profiler has been detached are not sampled.
+    heap.setHeapProfiler(nullptr);
+    heap.deallocate(heap.alloc(100, kFileName, 30), false, nullptr, 0);
+    EXPECT_EQ(11, profiler.getSamples());
+}
+
+TEST(HeapProfiler, CallStacks) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(1));
+    heap.setHeapProfiler(&profiler);
+
+    void *allocations[8];
+    for (auto &allocation : allocations) {
+        allocation = heap.alloc(64);
+        EXPECT_NE(nullptr, allocation);
+    }
+
+    // Batches are sampled as each allocation is carved.
+    void *batch[8];
+    EXPECT_EQ(8, heap.allocBatch(8, 32, 16, batch));
+
+    EXPECT_EQ(16, profiler.getSamples());
+    EXPECT_EQ(16, profiler.getLiveSamples());
+
+    size_t samples = 0;
+    for (auto &site : profiler.getSites()) {
+        EXPECT_EQ(nullptr, site.fileName);
+        EXPECT_LE(site.frameCount, ngen::memory::kHeapProfileMaximumFrames);
+
+#if defined(__GLIBC__) || defined(__APPLE__) || defined(_WIN32)
+        EXPECT_LT(0, site.frameCount);
+#endif
+
+        samples += site.samples;
+    }
+
+    EXPECT_EQ(16, samples);
+
+    for (auto allocation : allocations) {
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(8, heap.deallocateBatch(batch, 8));
+    EXPECT_EQ(0, profiler.getLiveSamples());
+
+    heap.setHeapProfiler(nullptr);
+}
+
+TEST(HeapProfiler, Estimates) {
+    const size_t sampleInterval = 4096;
+    const size_t allocationLength = 64;
+    const size_t allocationCount = 200000;
+    const size_t liveCount = 1000;
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(sampleInterval));
+    heap.setHeapProfiler(&profiler);
+
+    std::vector<void *> live(liveCount, nullptr);
+
+    for (size_t loop = 0; loop < allocationCount; ++loop) {
+        auto &slot = live[loop % liveCount];
+        heap.deallocate(slot, false, nullptr, 0);
+
+        slot = heap.alloc(allocationLength);
+        ASSERT_NE(nullptr, slot);
+    }
+
+    // Only a small fraction of the allocations are sampled, yet the estimates are close to the true values.
+    const auto expectedSamples = allocationCount * allocationLength / sampleInterval;
+    EXPECT_LT(expectedSamples / 2, profiler.getSamples());
+    EXPECT_GT(expectedSamples * 2, profiler.getSamples());
+
+    size_t allocatedBytes = 0;
+    size_t allocatedCount = 0;
+
+    for (auto &site : profiler.getSites()) {
+        allocatedBytes += site.allocatedBytes;
+        allocatedCount += site.allocatedCount;
+    }
+
+    EXPECT_NEAR(static_cast<double>(allocationCount * allocationLength), static_cast<double>(allocatedBytes), allocationCount * allocationLength * 0.2);
+    EXPECT_NEAR(static_cast<double>(allocationCount), static_cast<double>(allocatedCount), allocationCount * 0.2);
+
+    for (auto &allocation : live) {
+        heap.deallocate(allocation, false, nullptr, 0);
+    }
+
+    // Releases remove exactly the weight each sample added.
+    EXPECT_EQ(0, profiler.getLiveSamples());
+
+    for (auto &site : profiler.getSites()) {
+        EXPECT_EQ(0, site.liveBytes);
+        EXPECT_EQ(0, site.liveCount);
+    }
+
+    heap.setHeapProfiler(nullptr);
+}
+
+TEST(HeapProfiler, SmallObjects) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(64 * 1024));
+
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(1));
+
+    auto unsampled = heap.alloc(16);
+    EXPECT_TRUE(heap.getSmallObjects().owns(unsampled));
+
+    // A sampled small object is made from a block instead, so its release can be recognized.
+    heap.setHeapProfiler(&profiler);
+
+    auto sampled = heap.alloc(16);
+    EXPECT_NE(nullptr, sampled);
+    EXPECT_FALSE(heap.getSmallObjects().owns(sampled));
+    EXPECT_EQ(1, profiler.getLiveSamples());
+
+    EXPECT_TRUE(heap.deallocate(unsampled, false, nullptr, 0));
+    EXPECT_EQ(1, profiler.getLiveSamples());
+
+    EXPECT_TRUE(heap.deallocate(sampled, false, nullptr, 0));
+    EXPECT_EQ(0, profiler.getLiveSamples());
+
+    heap.setHeapProfiler(nullptr);
+}
+
+TEST(HeapProfiler, Relocation) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize));
+
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(1));
+    heap.setHeapProfiler(&profiler);
+
+    auto first = heap.alloc(256);
+    auto second = heap.alloc(256);
+    EXPECT_TRUE(heap.deallocate(first, false, nullptr, 0));
+
+    // The sample follows an allocation that is moved by its heap.
+    auto moved = heap.slideAllocation(second, 8);
+    ASSERT_NE(nullptr, moved);
+    EXPECT_EQ(1, profiler.getLiveSamples());
+
+    // Moving the allocation leaves the live estimates of its site unchanged.
+    size_t liveBytes = 0;
+    size_t liveCount = 0;
+
+    for (auto &site : profiler.getSites()) {
+        liveBytes += site.liveBytes;
+        liveCount += site.liveCount;
+    }
+
+    EXPECT_EQ(256, liveBytes);
+    EXPECT_EQ(1, liveCount);
+
+    EXPECT_TRUE(heap.deallocate(moved, false, nullptr, 0));
+    EXPECT_EQ(0, profiler.getLiveSamples());
+
+    for (auto &released : profiler.getSites()) {
+        EXPECT_EQ(0, released.liveBytes);
+        EXPECT_EQ(0, released.liveCount);
+    }
+
+    // Reallocating samples the new allocation and releases the old one.
+    auto block = heap.alloc(100);
+    block = heap.reallocate(block, 64 * 1024);
+    ASSERT_NE(nullptr, block);
+    EXPECT_EQ(1, profiler.getLiveSamples());
+
+    EXPECT_TRUE(heap.deallocate(block, false, nullptr, 0));
+    EXPECT_EQ(0, profiler.getLiveSamples());
+
+    heap.setHeapProfiler(nullptr);
+}
+
+TEST(HeapProfiler, TableCapacity) {
+    static const char kFileName[] = "capacity.cpp";
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize));
+
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(1, 2, 4));
+    heap.setHeapProfiler(&profiler);
+
+    void *allocations[8];
+    for (size_t loop = 0; loop < 8; ++loop) {
+        allocations[loop] = heap.alloc(32, kFileName, loop < 6 ? 1 + loop % 2 : 3);
+        EXPECT_NE(nullptr, allocations[loop]);
+    }
+
+    // Samples from a third site, and those beyond the capacity of the sample table, are dropped.
+    EXPECT_EQ(8, profiler.getSamples());
+    EXPECT_EQ(4, profiler.getLiveSamples());
+    EXPECT_EQ(4, profiler.getDroppedSamples());
+    EXPECT_EQ(2, profiler.getSites().size());
+
+    for (auto allocation : allocations) {
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(0, profiler.getLiveSamples());
+
+    heap.setHeapProfiler(nullptr);
+}
+
+TEST(HeapProfiler, Dump) {
+    static const char kFileName[] = "dumped.cpp";
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kProfilerBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kProfilerBufferSize));
+
+    ngen::memory::HeapProfiler profiler;
+    EXPECT_TRUE(profiler.initialize(1));
+    heap.setHeapProfiler(&profiler);
+
+    auto located = heap.alloc(128, kFileName, 42);
+    auto unlocated = heap.alloc(256);
+
+    auto file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    EXPECT_FALSE(profiler.dump(nullptr));
+    EXPECT_TRUE(profiler.dump(file));
+
+    std::string report(static_cast<size_t>(ftell(file)), '\0');
+    rewind(file);
+    EXPECT_EQ(report.size(), fread(&report[0], 1, report.size(), file));
+    fclose(file);
+
+    EXPECT_NE(std::string::npos, report.find("heap profile: 2 sites, 2 samples"));
+    EXPECT_NE(std::string::npos, report.find("dumped.cpp:42"));
+    EXPECT_NE(std::string::npos, report.find("128+:1"));
+    EXPECT_NE(std::string::npos, report.find("256+:1"));
+
+    EXPECT_TRUE(heap.deallocate(located, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(unlocated, false, nullptr, 0));
+
+    heap.setHeapProfiler(nullptr);
+}
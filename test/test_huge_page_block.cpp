@@ -0,0 +1,52 @@
+
+#include <cstring>
+#include "huge_page_block.h"
+#include "heap.h"
+#include "gtest/gtest.h"
+
+TEST(HugePageBlock, Allocate) {
+    ngen::memory::HugePageBlock block;
+    EXPECT_EQ(nullptr, block.getMemory());
+    EXPECT_EQ(ngen::memory::kPageBacking::Invalid, block.getBacking());
+
+    EXPECT_FALSE(block.allocate(0));
+    EXPECT_FALSE(block.allocate(1024, ngen::memory::kPageBacking::Invalid));
+
+    // Whichever backing is available, the block is rounded up to a whole number of huge pages.
+    EXPECT_TRUE(block.allocate(1024));
+    EXPECT_FALSE(block.allocate(1024));
+    EXPECT_NE(nullptr, block.getMemory());
+    EXPECT_EQ(ngen::memory::kHugePageSize, block.getSize());
+    EXPECT_NE(ngen::memory::kPageBacking::Invalid, block.getBacking());
+
+    memset(block.getMemory(), 0xcd, block.getSize());
+
+    block.release();
+    EXPECT_EQ(nullptr, block.getMemory());
+    EXPECT_EQ(0, block.getSize());
+
+    EXPECT_TRUE(block.allocate(1024, ngen::memory::kPageBacking::Standard));
+    EXPECT_EQ(ngen::memory::kPageBacking::Standard, block.getBacking());
+}
+
+TEST(HugePageBlock, InitializeHeap) {
+    ngen::memory::HugePageBlock block;
+
+    ngen::memory::Heap uninitialized;
+    EXPECT_FALSE(block.initializeHeap(uninitialized));
+
+    EXPECT_TRUE(block.allocate(ngen::memory::kHugePageSize * 2, ngen::memory::kPageBacking::Transparent));
+    EXPECT_NE(ngen::memory::kPageBacking::HugeTLB, block.getBacking());
+
+    {
+        ngen::memory::Heap heap;
+        EXPECT_TRUE(block.initializeHeap(heap, ngen::memory::kAllocationStrategy::TLSF));
+        EXPECT_EQ(block.getSize(), heap.getSize());
+
+        auto allocation = heap.alloc(ngen::memory::kHugePageSize);
+        EXPECT_NE(nullptr, allocation);
+        memset(allocation, 0xcd, ngen::memory::kHugePageSize);
+
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+}
@@ -0,0 +1,126 @@
+
+#include <cstring>
+#include <memory>
+#include "ring_allocator.h"
+#include "test_utilities.h"
+#include "gtest/gtest.h"
+
+const size_t kRingBufferSize = 1024;
+
+TEST(RingAllocator, Initialize) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kRingBufferSize]);
+
+    ngen::memory::RingAllocator ring;
+    EXPECT_EQ(nullptr, ring.alloc(16));
+    EXPECT_EQ(1, ring.getFailedAllocations());
+
+    EXPECT_FALSE(ring.initialize(nullptr, kRingBufferSize));
+    EXPECT_FALSE(ring.initialize(allocationBuffer.get(), 8));
+
+    EXPECT_TRUE(ring.initialize(allocationBuffer.get(), kRingBufferSize));
+    EXPECT_FALSE(ring.initialize(allocationBuffer.get(), kRingBufferSize));
+
+    EXPECT_LE(kRingBufferSize - ngen::memory::RingAllocator::kDefaultAlignment * 2, ring.getSize());
+    EXPECT_EQ(0, ring.getUsed());
+    EXPECT_FALSE(ring.isMirrored());
+}
+
+TEST(RingAllocator, FirstInFirstOut) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kRingBufferSize]);
+
+    ngen::memory::RingAllocator ring;
+    EXPECT_TRUE(ring.initialize(allocationBuffer.get(), kRingBufferSize));
+
+    // Cycling messages through the buffer many times wraps the head around its end.
+    void *messages[3] = {};
+    for (size_t loop = 0; loop < 64; ++loop) {
+        for (auto &message : messages) {
+            message = ring.alloc(100);
+            EXPECT_NE(nullptr, message);
+            EXPECT_TRUE(validateAlignment(message, ngen::memory::RingAllocator::kDefaultAlignment));
+            memset(message, static_cast<int>(loop), 100);
+        }
+
+        EXPECT_EQ(3, ring.getAllocations());
+
+        for (auto message : messages) {
+            EXPECT_TRUE(ring.deallocate(message));
+        }
+    }
+
+    EXPECT_EQ(0, ring.getAllocations());
+    EXPECT_EQ(0, ring.getUsed());
+    EXPECT_EQ(0, ring.getOutOfOrderReleases());
+    EXPECT_EQ(0, ring.getFailedAllocations());
+
+    auto aligned = ring.alignedAlloc(1, 128);
+    EXPECT_TRUE(validateAlignment(aligned, 128));
+    EXPECT_EQ(nullptr, ring.alignedAlloc(1, 3));
+    EXPECT_EQ(nullptr, ring.alloc(kRingBufferSize));
+
+    EXPECT_TRUE(ring.deallocate(nullptr));
+    EXPECT_TRUE(ring.deallocate(aligned));
+    EXPECT_FALSE(ring.deallocate(aligned));
+    EXPECT_FALSE(ring.deallocate(allocationBuffer.get() + kRingBufferSize));
+}
+
+TEST(RingAllocator, OutOfOrderRelease) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kRingBufferSize]);
+
+    ngen::memory::RingAllocator ring;
+    EXPECT_TRUE(ring.initialize(allocationBuffer.get(), kRingBufferSize));
+
+    auto first = ring.alloc(200);
+    auto second = ring.alloc(200);
+    auto third = ring.alloc(200);
+    EXPECT_NE(nullptr, third);
+
+    // Releasing the newer allocations first does not reclaim any memory.
+    const auto used = ring.getUsed();
+    EXPECT_TRUE(ring.deallocate(third));
+    EXPECT_TRUE(ring.deallocate(second));
+    EXPECT_EQ(2, ring.getOutOfOrderReleases());
+    EXPECT_EQ(used, ring.getUsed());
+
+    // Once the oldest allocation is released, everything behind it is reclaimed.
+    EXPECT_TRUE(ring.deallocate(first));
+    EXPECT_EQ(2, ring.getOutOfOrderReleases());
+    EXPECT_EQ(0, ring.getUsed());
+}
+
+TEST(RingAllocator, Mirrored) {
+    if (!ngen::memory::RingAllocator::isMirroringSupported()) {
+        return;
+    }
+
+    ngen::memory::RingAllocator ring;
+    EXPECT_TRUE(ring.initializeMirrored(kRingBufferSize));
+    EXPECT_TRUE(ring.isMirrored());
+
+    const auto capacity = ring.getSize();
+    EXPECT_LE(kRingBufferSize, capacity);
+
+    // Fill most of the buffer then release it, so the next allocation must straddle the end of the buffer.
+    auto filler = ring.alloc(capacity - 256);
+    auto pending = ring.alloc(64);
+    EXPECT_NE(nullptr, filler);
+    EXPECT_TRUE(ring.deallocate(filler));
+
+    auto wrapped = static_cast<unsigned char *>(ring.alloc(512));
+    EXPECT_NE(nullptr, wrapped);
+    EXPECT_TRUE(ring.owns(wrapped + 511));
+
+    for (size_t index = 0; index < 512; ++index) {
+        wrapped[index] = static_cast<unsigned char>(index);
+    }
+
+    // The part of the message beyond the end of the buffer is visible at the start of the buffer.
+    auto base = static_cast<unsigned char *>(filler) - 16;
+    const auto overflow = static_cast<size_t>(wrapped + 512 - (base + capacity));
+    EXPECT_LT(0, overflow);
+    EXPECT_EQ(0, memcmp(base, wrapped + 512 - overflow, overflow));
+
+    EXPECT_TRUE(ring.deallocate(pending));
+    EXPECT_TRUE(ring.deallocate(wrapped));
+    EXPECT_EQ(0, ring.getUsed());
+}
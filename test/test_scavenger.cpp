@@ -0,0 +1,116 @@
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "concurrent_heap.h"
+#include "heap.h"
+#include "huge_page_block.h"
+#include "scavenger.h"
+#include "gtest/gtest.h"
+
+const size_t kScavengerHeapSize = 8 * 1024 * 1024;
+const size_t kScavengerBlockSize = 1024 * 1024;
+
+TEST(Scavenger, DiscardFreeBlocks) {
+    ngen::memory::HugePageBlock block;
+    EXPECT_TRUE(block.allocate(kScavengerHeapSize, ngen::memory::kPageBacking::Standard));
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(block.initializeHeap(heap, ngen::memory::kAllocationStrategy::First));
+
+    auto first = static_cast<unsigned char *>(heap.alloc(kScavengerBlockSize));
+    auto separator = heap.alloc(64);
+    auto second = static_cast<unsigned char *>(heap.alloc(kScavengerBlockSize));
+    auto remainder = heap.alloc(heap.getSize() - kScavengerBlockSize * 2 - 64 * 1024);
+    EXPECT_NE(nullptr, remainder);
+
+    memset(first, 0xcd, kScavengerBlockSize);
+    memset(second, 0xcd, kScavengerBlockSize);
+
+    EXPECT_TRUE(heap.deallocate(first, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(second, false, nullptr, 0));
+
+    // Small blocks are skipped, and a pass stops once it has discarded the maximum number of bytes.
+    EXPECT_EQ(0, heap.scavenge(kScavengerBlockSize * 2, SIZE_MAX));
+
+    const auto pageSize = ngen::memory::VirtualMemory::getPageSize();
+
+    const auto scavengedSecond = heap.scavenge(kScavengerBlockSize / 2, 1);
+    EXPECT_LT(kScavengerBlockSize - 2 * pageSize, scavengedSecond);
+    EXPECT_GE(kScavengerBlockSize, scavengedSecond);
+    EXPECT_EQ(scavengedSecond, heap.getScavengedBytes());
+
+    const auto scavengedFirst = heap.scavenge(kScavengerBlockSize / 2, SIZE_MAX);
+    EXPECT_LT(kScavengerBlockSize - 2 * pageSize, scavengedFirst);
+    EXPECT_EQ(0, heap.scavenge(kScavengerBlockSize / 2, SIZE_MAX));
+    EXPECT_EQ(scavengedFirst + scavengedSecond, heap.getScavengedBytes());
+    EXPECT_EQ(0, heap.getRefaultedBytes());
+
+    // Reusing a scavenged block is counted, and the discarded pages fault back in as zero.
+    auto reused = static_cast<unsigned char *>(heap.alloc(kScavengerBlockSize));
+    EXPECT_EQ(second, reused);
+    EXPECT_EQ(scavengedSecond, heap.getRefaultedBytes());
+    EXPECT_EQ(0, reused[kScavengerBlockSize / 2]);
+
+    // Joining a scavenged block with its neighbours keeps its pages discarded, and still produces a single free block.
+    EXPECT_TRUE(heap.deallocate(remainder, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(reused, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(separator, false, nullptr, 0));
+    EXPECT_EQ(scavengedSecond, heap.getRefaultedBytes());
+
+    // Only the discarded pages handed out by an allocation are counted, the remainder of the block stays scavenged.
+    auto small = heap.alloc(64);
+    EXPECT_NE(nullptr, small);
+    EXPECT_EQ(scavengedSecond, heap.getRefaultedBytes());
+    EXPECT_TRUE(heap.deallocate(small, false, nullptr, 0));
+    EXPECT_EQ(scavengedSecond, heap.getRefaultedBytes());
+
+    // A block joined with resident memory is scavenged again, counting only the newly discarded pages.
+    const auto scavengedJoined = heap.scavenge(kScavengerBlockSize / 2, SIZE_MAX);
+    EXPECT_LT(heap.getSize() - scavengedFirst - 4 * pageSize, scavengedJoined);
+    EXPECT_GE(heap.getSize() - scavengedFirst, scavengedJoined);
+    EXPECT_EQ(0, heap.scavenge(kScavengerBlockSize / 2, SIZE_MAX));
+
+    auto whole = heap.alloc(heap.getSize() - kScavengerBlockSize);
+    EXPECT_NE(nullptr, whole);
+    EXPECT_TRUE(heap.deallocate(whole, false, nullptr, 0));
+
+    const auto discarded = heap.getScavengedBytes() - heap.getRefaultedBytes();
+    EXPECT_LT(kScavengerBlockSize - 4 * pageSize, discarded);
+    EXPECT_GE(kScavengerBlockSize, discarded);
+}
+
+TEST(Scavenger, BackgroundThread) {
+    ngen::memory::HugePageBlock block;
+    EXPECT_TRUE(block.allocate(kScavengerHeapSize, ngen::memory::kPageBacking::Standard));
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(block.getMemory(), block.getSize()));
+
+    ngen::memory::ScavengerLimits limits;
+    limits.interval = std::chrono::milliseconds(1);
+
+    ngen::memory::Scavenger<ngen::memory::ConcurrentHeap> scavenger(heap);
+    EXPECT_FALSE(scavenger.isRunning());
+    EXPECT_TRUE(scavenger.start(limits));
+    EXPECT_FALSE(scavenger.start(limits));
+    EXPECT_TRUE(scavenger.isRunning());
+
+    // Allocations continue while the background thread scavenges.
+    for (size_t loop = 0; loop < 100; ++loop) {
+        auto allocation = heap.alloc(kScavengerBlockSize);
+        EXPECT_NE(nullptr, allocation);
+        memset(allocation, 0xcd, kScavengerBlockSize);
+
+        EXPECT_TRUE(heap.deallocate(allocation, false, nullptr, 0));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!heap.getScavengedBytes() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    scavenger.stop();
+    EXPECT_FALSE(scavenger.isRunning());
+    EXPECT_LT(0, heap.getScavengedBytes());
+}
@@ -0,0 +1,256 @@
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ngen_memory.h"
+#include "small_object_allocator.h"
+#include "test_utilities.h"
+#include "gtest/gtest.h"
+
+const size_t kSmallObjectBufferSize = 64 * 1024;
+const size_t kSmallObjectRegionSize = 16 * 1024;
+
+namespace {
+    struct SmallObject {
+        uint32_t a;
+        uint32_t b;
+        uint64_t c;
+    };
+}
+
+TEST(SmallObjectAllocator, Initialize) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectRegionSize]);
+
+    ngen::memory::SmallObjectAllocator allocator;
+
+    EXPECT_FALSE(allocator.initialize(nullptr, kSmallObjectRegionSize));
+    EXPECT_FALSE(allocator.initialize(allocationBuffer.get(), 64));
+
+    EXPECT_TRUE(allocator.initialize(allocationBuffer.get(), kSmallObjectRegionSize));
+    EXPECT_FALSE(allocator.initialize(allocationBuffer.get(), kSmallObjectRegionSize));
+
+    EXPECT_EQ(3, allocator.getPageCount());
+    EXPECT_EQ(3, allocator.getFreePageCount());
+    EXPECT_EQ(0, allocator.getAllocations());
+}
+
+TEST(SmallObjectAllocator, SizeClasses) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectRegionSize]);
+
+    ngen::memory::SmallObjectAllocator allocator;
+    EXPECT_TRUE(allocator.initialize(allocationBuffer.get(), kSmallObjectRegionSize));
+
+    void *a = allocator.alloc(1, 4, false);
+    void *b = allocator.alloc(20, 4, false);
+    void *c = allocator.alloc(ngen::memory::SmallObjectAllocator::kMaximumObjectSize, 4, false);
+
+    EXPECT_NE(nullptr, a);
+    EXPECT_NE(nullptr, b);
+    EXPECT_NE(nullptr, c);
+    EXPECT_EQ(nullptr, allocator.alloc(ngen::memory::SmallObjectAllocator::kMaximumObjectSize + 1, 4, false));
+
+    EXPECT_EQ(8, allocator.getObjectSize(a));
+    EXPECT_EQ(24, allocator.getObjectSize(b));
+    EXPECT_EQ(128, allocator.getObjectSize(c));
+    EXPECT_EQ(0, allocator.getFreePageCount());
+
+    // Alignment larger than a size class guarantees moves the request to a larger class.
+    EXPECT_EQ(nullptr, allocator.alloc(20, 16, false));
+
+    EXPECT_TRUE(allocator.deallocate(a, false));
+    EXPECT_TRUE(allocator.deallocate(b, false));
+    EXPECT_TRUE(allocator.deallocate(c, false));
+    EXPECT_FALSE(allocator.deallocate(&a, false));
+
+    EXPECT_EQ(0, allocator.getAllocations());
+    EXPECT_EQ(3, allocator.getFreePageCount());
+
+    void *d = allocator.alloc(20, 16, false);
+    EXPECT_NE(nullptr, d);
+    EXPECT_EQ(32, allocator.getObjectSize(d));
+    EXPECT_TRUE(validateAlignment(d, 16));
+    EXPECT_TRUE(allocator.deallocate(d, false));
+}
+
+TEST(SmallObjectAllocator, FillPage) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectRegionSize]);
+
+    ngen::memory::SmallObjectAllocator allocator;
+    EXPECT_TRUE(allocator.initialize(allocationBuffer.get(), kSmallObjectRegionSize));
+
+    const size_t objectCount = ngen::memory::SmallObjectAllocator::kPageSize / 16 * allocator.getPageCount();
+    std::vector<void *> objects;
+
+    for (size_t loop = 0; loop < objectCount; ++loop) {
+        void *object = allocator.alloc(16, 16, false);
+
+        EXPECT_NE(nullptr, object);
+        EXPECT_TRUE(validateAlignment(object, 16));
+
+        objects.push_back(object);
+    }
+
+    EXPECT_EQ(nullptr, allocator.alloc(16, 16, false));
+    EXPECT_EQ(objectCount, allocator.getAllocations());
+
+    // Release in an interleaved order to exercise the per-page free lists.
+    for (size_t loop = 0; loop < objectCount; loop += 2) {
+        EXPECT_TRUE(allocator.deallocate(objects[loop], false));
+    }
+
+    for (size_t loop = 0; loop < objectCount; loop += 2) {
+        objects[loop] = allocator.alloc(16, 16, false);
+        EXPECT_NE(nullptr, objects[loop]);
+    }
+
+    for (auto object : objects) {
+        EXPECT_TRUE(allocator.deallocate(object, false));
+    }
+
+    EXPECT_EQ(0, allocator.getAllocations());
+    EXPECT_EQ(allocator.getPageCount(), allocator.getFreePageCount());
+}
+
+TEST(SmallObjectAllocator, ReleaseValidation) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectRegionSize]);
+
+    ngen::memory::SmallObjectAllocator allocator;
+    EXPECT_TRUE(allocator.initialize(allocationBuffer.get(), kSmallObjectRegionSize));
+
+    void *a = allocator.alloc(16, 8, false);
+    void *b = allocator.alloc(16, 8, false);
+    void *array = allocator.alloc(16, 8, true);
+
+    EXPECT_FALSE(allocator.isArrayObject(a));
+    EXPECT_TRUE(allocator.isArrayObject(array));
+
+    // Objects released twice are rejected, whether or not their page still holds live objects.
+    EXPECT_TRUE(allocator.deallocate(a, false));
+    EXPECT_FALSE(allocator.deallocate(a, false));
+
+    // Objects within the page that were never handed out are also rejected.
+    EXPECT_FALSE(allocator.deallocate(static_cast<char *>(array) + 16, false));
+
+    EXPECT_FALSE(allocator.deallocate(array, false));
+    EXPECT_FALSE(allocator.deallocate(b, true));
+    EXPECT_TRUE(allocator.deallocate(array, true));
+
+    // An object claimed for release by another thread may only be released through the queue, and only once.
+    EXPECT_FALSE(allocator.queueRelease(b, true));
+    EXPECT_TRUE(allocator.queueRelease(b, false));
+    EXPECT_FALSE(allocator.queueRelease(b, false));
+    EXPECT_FALSE(allocator.deallocate(b, false));
+    EXPECT_TRUE(allocator.releaseQueued(b));
+    EXPECT_FALSE(allocator.releaseQueued(b));
+    EXPECT_FALSE(allocator.deallocate(b, false));
+
+    EXPECT_EQ(0, allocator.getAllocations());
+    EXPECT_EQ(allocator.getPageCount(), allocator.getFreePageCount());
+}
+
+TEST(SmallObjectAllocator, HeapFrontEnd) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectBufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_FALSE(heap.enableSmallObjects(kSmallObjectRegionSize));
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kSmallObjectBufferSize));
+    EXPECT_FALSE(heap.enableSmallObjects(64));
+    EXPECT_TRUE(heap.enableSmallObjects(kSmallObjectRegionSize));
+    EXPECT_FALSE(heap.enableSmallObjects(kSmallObjectRegionSize));
+    EXPECT_TRUE(heap.hasSmallObjects());
+
+    // The small object region is owned by the heap and does not count as an allocation.
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getTotalAllocations());
+
+    auto object = new(&heap) SmallObject;
+    EXPECT_NE(nullptr, object);
+    EXPECT_TRUE(heap.getSmallObjects().owns(object));
+
+    void *large = heap.alloc(ngen::memory::SmallObjectAllocator::kMaximumObjectSize + 1);
+    EXPECT_NE(nullptr, large);
+    EXPECT_FALSE(heap.getSmallObjects().owns(large));
+
+    EXPECT_EQ(2, heap.getAllocations());
+    EXPECT_EQ(2, heap.getTotalAllocations());
+    EXPECT_EQ(1, heap.getSmallObjects().getAllocations());
+
+    EXPECT_TRUE(heap.deallocate(object, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(large, false, nullptr, 0));
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getSmallObjects().getAllocations());
+}
+
+TEST(SmallObjectAllocator, HeapFallback) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectBufferSize]);
+
+    ngen::memory::Heap heap;
+
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kSmallObjectBufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(ngen::memory::SmallObjectAllocator::kPageSize * 2));
+    EXPECT_EQ(1, heap.getSmallObjects().getPageCount());
+
+    const size_t objectCount = ngen::memory::SmallObjectAllocator::kPageSize / 8;
+    std::vector<void *> objects;
+
+    for (size_t loop = 0; loop < objectCount; ++loop) {
+        objects.push_back(heap.alloc(8));
+    }
+
+    // Once the region is exhausted, small allocations are served by the general heap.
+    void *overflow = heap.alloc(8);
+    EXPECT_NE(nullptr, overflow);
+    EXPECT_FALSE(heap.getSmallObjects().owns(overflow));
+    EXPECT_EQ(objectCount + 1, heap.getAllocations());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+
+    EXPECT_TRUE(heap.deallocate(overflow, false, nullptr, 0));
+
+    for (auto object : objects) {
+        EXPECT_TRUE(heap.getSmallObjects().owns(object));
+        EXPECT_TRUE(heap.deallocate(object, false, nullptr, 0));
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(SmallObjectAllocator, HeapReleaseValidation) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSmallObjectBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kSmallObjectBufferSize));
+    EXPECT_TRUE(heap.enableSmallObjects(kSmallObjectRegionSize));
+
+    void *object = heap.alloc(16);
+    void *array = heap.allocArray(16);
+    EXPECT_TRUE(heap.getSmallObjects().owns(object));
+    EXPECT_TRUE(heap.getSmallObjects().owns(array));
+
+    EXPECT_TRUE(heap.deallocate(object, false, nullptr, 0));
+    EXPECT_FALSE(heap.deallocate(object, false, nullptr, 0));
+
+    EXPECT_FALSE(heap.deallocate(array, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(array, true, nullptr, 0));
+    EXPECT_FALSE(heap.deallocate(array, true, nullptr, 0));
+
+    // Releases queued by another thread are validated before they are queued.
+    EXPECT_TRUE(heap.enableRemoteFrees());
+
+    object = heap.alloc(16);
+    array = heap.allocArray(16);
+
+    std::thread consumer([&heap, object, array]() {
+        EXPECT_TRUE(heap.deallocate(object, false, nullptr, 0));
+        EXPECT_FALSE(heap.deallocate(object, false, nullptr, 0));
+        EXPECT_FALSE(heap.deallocate(array, false, nullptr, 0));
+        EXPECT_TRUE(heap.deallocate(array, true, nullptr, 0));
+    });
+
+    consumer.join();
+
+    EXPECT_EQ(2, heap.processRemoteFrees());
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getSmallObjects().getAllocations());
+}
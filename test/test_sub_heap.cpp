@@ -0,0 +1,293 @@
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "heap_allocator.h"
+#include "sub_heap.h"
+#include "gtest/gtest.h"
+
+const size_t kSubHeapParentSize = 256 * 1024;
+const size_t kSubHeapBudget = 16 * 1024;
+const size_t kSubHeapAllocationSize = 1024;
+
+TEST(SubHeap, Initialization) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    ngen::memory::SubHeap heap;
+    EXPECT_FALSE(heap.isInitialized());
+    EXPECT_EQ(nullptr, heap.getTag());
+    EXPECT_EQ(nullptr, heap.getHeap());
+    EXPECT_EQ(nullptr, heap.alloc(kSubHeapAllocationSize));
+    EXPECT_EQ(1, heap.getFailedAllocations());
+
+    EXPECT_FALSE(heap.initialize(parent, nullptr, kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+    EXPECT_FALSE(heap.initialize(parent, "audio", 0, ngen::memory::kBudgetPolicy::FailFast));
+    EXPECT_FALSE(heap.initialize(parent, "audio", kSubHeapParentSize * 2, ngen::memory::kBudgetPolicy::FailFast));
+    EXPECT_EQ(0, parent.getAllocations());
+
+    EXPECT_TRUE(heap.initialize(parent, "audio", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+    EXPECT_FALSE(heap.initialize(parent, "audio", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+
+    EXPECT_TRUE(heap.isInitialized());
+    EXPECT_STREQ("audio", heap.getTag());
+    EXPECT_EQ(kSubHeapBudget, heap.getBudget());
+    EXPECT_EQ(ngen::memory::kBudgetPolicy::FailFast, heap.getBudgetPolicy());
+    EXPECT_EQ(&parent, heap.getParent());
+    EXPECT_NE(nullptr, heap.getHeap());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+
+    // The region is the only allocation made from the parent.
+    EXPECT_EQ(1, parent.getAllocations());
+}
+
+TEST(SubHeap, Counters) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    ngen::memory::SubHeap heap;
+    EXPECT_TRUE(heap.initialize(parent, "render", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+
+    void *first = heap.alloc(kSubHeapAllocationSize);
+    void *second = heap.alignedAlloc(kSubHeapAllocationSize, 64);
+    void *third = heap.alloc(100, __FILE__, __LINE__);
+
+    EXPECT_NE(nullptr, first);
+    EXPECT_NE(nullptr, second);
+    EXPECT_NE(nullptr, third);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(second) % 64);
+
+    EXPECT_TRUE(heap.owns(first));
+    EXPECT_TRUE(heap.owns(second));
+    EXPECT_TRUE(heap.owns(third));
+    EXPECT_FALSE(heap.owns(allocationBuffer.get()));
+
+    const auto firstSize = heap.getHeap()->getUsableSize(first);
+    const auto secondSize = heap.getHeap()->getUsableSize(second);
+    const auto thirdSize = heap.getHeap()->getUsableSize(third);
+    const auto inUse = firstSize + secondSize + thirdSize;
+
+    EXPECT_EQ(3, heap.getAllocations());
+    EXPECT_EQ(3, heap.getTotalAllocations());
+    EXPECT_EQ(inUse, heap.getBytesInUse());
+    EXPECT_EQ(inUse, heap.getPeakBytesInUse());
+    EXPECT_LE(100 + 2 * kSubHeapAllocationSize, heap.getBytesInUse());
+
+    EXPECT_TRUE(heap.deallocate(second, false, nullptr, 0));
+    EXPECT_EQ(2, heap.getAllocations());
+    EXPECT_EQ(firstSize + thirdSize, heap.getBytesInUse());
+    EXPECT_EQ(inUse, heap.getPeakBytesInUse());
+
+    EXPECT_TRUE(heap.deallocate(first, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(third, false, nullptr, 0));
+    EXPECT_TRUE(heap.deallocate(nullptr, false, nullptr, 0));
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getBytesInUse());
+    EXPECT_EQ(inUse, heap.getPeakBytesInUse());
+    EXPECT_EQ(3, heap.getTotalAllocations());
+    EXPECT_EQ(0, heap.getFallbackAllocations());
+}
+
+TEST(SubHeap, FailFast) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    ngen::memory::SubHeap heap;
+    EXPECT_TRUE(heap.initialize(parent, "physics", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+
+    std::vector<void *> allocations;
+
+    for (size_t loop = 0; loop < kSubHeapBudget / kSubHeapAllocationSize; ++loop) {
+        auto ptr = heap.alloc(kSubHeapAllocationSize);
+        if (!ptr) {
+            break;
+        }
+
+        allocations.push_back(ptr);
+    }
+
+    // Allocation overhead is charged against the budget, so fewer allocations fit than the budget alone suggests.
+    EXPECT_LT(allocations.size(), kSubHeapBudget / kSubHeapAllocationSize);
+    EXPECT_LT(0, allocations.size());
+    EXPECT_EQ(1, heap.getFailedAllocations());
+    EXPECT_GE(kSubHeapBudget, heap.getBytesInUse());
+
+    EXPECT_EQ(nullptr, heap.alloc(kSubHeapAllocationSize));
+    EXPECT_EQ(nullptr, heap.alloc(kSubHeapBudget));
+    EXPECT_EQ(3, heap.getFailedAllocations());
+    EXPECT_EQ(0, heap.getTotalFallbackAllocations());
+    EXPECT_EQ(1, parent.getAllocations());
+
+    // Memory that was not allocated by the sub heap is rejected.
+    void *foreign = parent.alloc(kSubHeapAllocationSize);
+    EXPECT_FALSE(heap.deallocate(foreign, false, nullptr, 0));
+    EXPECT_TRUE(parent.deallocate(foreign, false, nullptr, 0));
+
+    for (auto ptr : allocations) {
+        EXPECT_TRUE(heap.deallocate(ptr, false, nullptr, 0));
+    }
+
+    EXPECT_NE(nullptr, heap.alloc(kSubHeapAllocationSize));
+}
+
+TEST(SubHeap, FallbackToParent) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    ngen::memory::SubHeap heap;
+    EXPECT_TRUE(heap.initialize(parent, "streaming", kSubHeapBudget, ngen::memory::kBudgetPolicy::FallbackToParent));
+
+    void *large = heap.alloc(kSubHeapBudget);
+    EXPECT_NE(nullptr, large);
+    EXPECT_FALSE(heap.owns(large));
+
+    void *small = heap.alignedAlloc(kSubHeapAllocationSize, 32);
+    EXPECT_NE(nullptr, small);
+    EXPECT_TRUE(heap.owns(small));
+
+    const auto largeSize = parent.getUsableSize(large);
+    const auto smallSize = heap.getHeap()->getUsableSize(small);
+
+    EXPECT_EQ(2, heap.getAllocations());
+    EXPECT_EQ(1, heap.getFallbackAllocations());
+    EXPECT_EQ(1, heap.getTotalFallbackAllocations());
+    EXPECT_EQ(largeSize, heap.getFallbackBytes());
+    EXPECT_EQ(largeSize + smallSize, heap.getBytesInUse());
+    EXPECT_EQ(0, heap.getFailedAllocations());
+    EXPECT_EQ(2, parent.getAllocations());
+
+    // Requests the parent cannot satisfy still fail.
+    EXPECT_EQ(nullptr, heap.alloc(kSubHeapParentSize));
+    EXPECT_EQ(1, heap.getFailedAllocations());
+
+    EXPECT_TRUE(heap.deallocate(large, false, nullptr, 0));
+    EXPECT_EQ(0, heap.getFallbackAllocations());
+    EXPECT_EQ(0, heap.getFallbackBytes());
+    EXPECT_EQ(smallSize, heap.getBytesInUse());
+    EXPECT_EQ(1, parent.getAllocations());
+
+    EXPECT_TRUE(heap.deallocate(small, false, nullptr, 0));
+    EXPECT_EQ(0, heap.getAllocations());
+}
+
+TEST(SubHeap, ForeignAllocations) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    {
+        ngen::memory::SubHeap audio;
+        ngen::memory::SubHeap physics;
+        EXPECT_TRUE(audio.initialize(parent, "audio", kSubHeapBudget, ngen::memory::kBudgetPolicy::FallbackToParent));
+        EXPECT_TRUE(physics.initialize(parent, "physics", kSubHeapBudget, ngen::memory::kBudgetPolicy::FallbackToParent));
+
+        void *audioFallback = audio.alloc(kSubHeapBudget);
+        void *physicsFallback = physics.alloc(kSubHeapBudget);
+        void *unrelated = parent.alloc(kSubHeapAllocationSize);
+
+        ASSERT_NE(nullptr, audioFallback);
+        ASSERT_NE(nullptr, physicsFallback);
+        ASSERT_NE(nullptr, unrelated);
+
+        // Allocations of the parent made by other users are rejected, leaving the budget accounting untouched.
+        const auto bytesInUse = audio.getBytesInUse();
+
+        EXPECT_FALSE(audio.deallocate(physicsFallback, false, nullptr, 0));
+        EXPECT_FALSE(audio.deallocate(unrelated, false, nullptr, 0));
+        EXPECT_EQ(1, audio.getFallbackAllocations());
+        EXPECT_EQ(bytesInUse, audio.getBytesInUse());
+        EXPECT_EQ(5, parent.getAllocations());
+
+        EXPECT_TRUE(audio.deallocate(audioFallback, false, nullptr, 0));
+        EXPECT_FALSE(audio.deallocate(audioFallback, false, nullptr, 0));
+        EXPECT_EQ(0, audio.getAllocations());
+
+        EXPECT_TRUE(parent.deallocate(unrelated, false, nullptr, 0));
+        EXPECT_EQ(3, parent.getAllocations());
+    }
+
+    // Destroying a sub heap returns its allocations made from the parent along with its region.
+    EXPECT_EQ(0, parent.getAllocations());
+}
+
+TEST(SubHeap, Release) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    {
+        ngen::memory::SubHeap heap;
+        EXPECT_TRUE(heap.initialize(parent, "ui", kSubHeapBudget, ngen::memory::kBudgetPolicy::FallbackToParent));
+
+        EXPECT_NE(nullptr, heap.alloc(kSubHeapAllocationSize));
+        EXPECT_NE(nullptr, heap.alloc(kSubHeapAllocationSize));
+
+        void *fallback = heap.alloc(kSubHeapBudget);
+        EXPECT_NE(nullptr, fallback);
+        EXPECT_EQ(2, parent.getAllocations());
+
+        // The region returns to the parent along with the allocations abandoned within it.
+        EXPECT_EQ(2, heap.release());
+        EXPECT_FALSE(heap.isInitialized());
+        EXPECT_EQ(nullptr, heap.getHeap());
+        EXPECT_EQ(0, heap.release());
+        EXPECT_EQ(1, parent.getAllocations());
+
+        // Allocations made from the parent outlive the region, and must be released before the sub heap is reused.
+        EXPECT_EQ(1, heap.getAllocations());
+        EXPECT_EQ(parent.getUsableSize(fallback), heap.getBytesInUse());
+        EXPECT_FALSE(heap.initialize(parent, "ui", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+        EXPECT_EQ(nullptr, heap.alloc(kSubHeapAllocationSize));
+
+        EXPECT_TRUE(heap.deallocate(fallback, false, nullptr, 0));
+        EXPECT_EQ(0, heap.getAllocations());
+        EXPECT_EQ(0, parent.getAllocations());
+
+        EXPECT_TRUE(heap.initialize(parent, "ui", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+        EXPECT_EQ(0, heap.getTotalAllocations());
+        EXPECT_NE(nullptr, heap.alloc(kSubHeapAllocationSize));
+        EXPECT_EQ(1, parent.getAllocations());
+    }
+
+    // Destroying the sub heap releases its region.
+    EXPECT_EQ(0, parent.getAllocations());
+    EXPECT_NE(nullptr, parent.alloc(kSubHeapParentSize / 2));
+}
+
+TEST(SubHeap, MemoryResource) {
+    std::unique_ptr<char[]> allocationBuffer(new char[kSubHeapParentSize]);
+
+    ngen::memory::Heap parent;
+    EXPECT_TRUE(parent.initialize(allocationBuffer.get(), kSubHeapParentSize));
+
+    ngen::memory::SubHeap heap;
+    EXPECT_TRUE(heap.initialize(parent, "containers", kSubHeapBudget, ngen::memory::kBudgetPolicy::FailFast));
+
+    ngen::memory::HeapMemoryResource<ngen::memory::SubHeap> resource(heap);
+
+    {
+        std::pmr::vector<uint32_t> values(&resource);
+
+        for (uint32_t loop = 0; loop < 256; ++loop) {
+            values.push_back(loop);
+        }
+
+        EXPECT_EQ(1, heap.getAllocations());
+        EXPECT_LE(256 * sizeof(uint32_t), heap.getBytesInUse());
+        EXPECT_TRUE(heap.owns(values.data()));
+    }
+
+    EXPECT_EQ(0, heap.getAllocations());
+    EXPECT_EQ(0, heap.getBytesInUse());
+}
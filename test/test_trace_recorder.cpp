@@ -0,0 +1,226 @@
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "concurrent_heap.h"
+#include "heap.h"
+#include "trace_recorder.h"
+#include "gtest/gtest.h"
+
+const size_t kTraceBufferSize = 64 * 1024;
+
+namespace {
+    //! \brief Helper method that reads every event stored within a trace file.
+    //! \param path [in] - Path of the trace file to be read.
+    //! \param events [out] - Receives the events stored within the trace file.
+    //! \returns True if the trace file could be opened otherwise false.
+    bool readTrace(const std::string &path, std::vector<ngen::memory::TraceEvent> &events) {
+        ngen::memory::TraceReader reader;
+        if (!reader.open(path.c_str())) {
+            return false;
+        }
+
+        for (ngen::memory::TraceEvent event; reader.next(event);) {
+            events.push_back(event);
+        }
+
+        return true;
+    }
+}
+
+TEST(TraceRecorder, RecordHeap) {
+    const auto path = (std::filesystem::temp_directory_path() / "ngen_memory_trace_record.bin").string();
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kTraceBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kTraceBufferSize));
+
+    // A small capacity writes the events to the file several times while recording.
+    ngen::memory::TraceRecorder recorder;
+    EXPECT_TRUE(recorder.open(path.c_str(), 4));
+    EXPECT_TRUE(recorder.isOpen());
+    EXPECT_EQ(4, recorder.getCapacity());
+
+    heap.setTraceRecorder(&recorder);
+    EXPECT_EQ(&recorder, heap.getTraceRecorder());
+
+    void *blocks[8] = {};
+
+    for (size_t loop = 0; loop < 8; ++loop) {
+        blocks[loop] = heap.alloc(100 + loop);
+        EXPECT_NE(nullptr, blocks[loop]);
+    }
+
+    auto array = heap.alignedAllocArray(200, 64);
+    EXPECT_NE(nullptr, array);
+    EXPECT_EQ(nullptr, heap.alloc(kTraceBufferSize));
+
+    heap.deallocate(blocks[1], false, nullptr, 0);
+    EXPECT_TRUE(heap.tryExpandInPlace(blocks[0], 180));
+
+    for (size_t loop = 0; loop < 8; ++loop) {
+        if (1 != loop) {
+            heap.deallocate(blocks[loop], false, nullptr, 0);
+        }
+    }
+
+    heap.deallocate(array, true, nullptr, 0);
+
+    // Operations made once the recorder has been detached are not recorded.
+    heap.setTraceRecorder(nullptr);
+    heap.deallocate(heap.alloc(32), false, nullptr, 0);
+
+    EXPECT_EQ(20, recorder.getRecordedEvents());
+    recorder.close();
+    EXPECT_FALSE(recorder.isOpen());
+    EXPECT_EQ(0, recorder.getFailedWrites());
+
+    std::vector<ngen::memory::TraceEvent> events;
+    EXPECT_TRUE(readTrace(path, events));
+    ASSERT_EQ(20, events.size());
+
+    for (size_t loop = 0; loop < 8; ++loop) {
+        EXPECT_EQ(ngen::memory::kTraceEvent::Allocate, events[loop].type);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(blocks[loop]), events[loop].handle);
+        EXPECT_EQ(100 + loop, events[loop].size);
+        EXPECT_EQ(0, events[loop].flags);
+    }
+
+    EXPECT_EQ(ngen::memory::kTraceEvent::Allocate, events[8].type);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(array), events[8].handle);
+    EXPECT_EQ(64, events[8].alignment);
+    EXPECT_EQ(ngen::memory::kTraceEventArray, events[8].flags);
+
+    // A failed allocation is recorded without a handle.
+    EXPECT_EQ(ngen::memory::kTraceEvent::Allocate, events[9].type);
+    EXPECT_EQ(0, events[9].handle);
+    EXPECT_EQ(kTraceBufferSize, events[9].size);
+
+    EXPECT_EQ(ngen::memory::kTraceEvent::Deallocate, events[10].type);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(blocks[1]), events[10].handle);
+
+    EXPECT_EQ(ngen::memory::kTraceEvent::Resize, events[11].type);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(blocks[0]), events[11].handle);
+    EXPECT_EQ(180, events[11].size);
+
+    for (size_t loop = 12; loop < 19; ++loop) {
+        EXPECT_EQ(ngen::memory::kTraceEvent::Deallocate, events[loop].type);
+    }
+
+    EXPECT_EQ(ngen::memory::kTraceEvent::Deallocate, events[19].type);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(array), events[19].handle);
+    EXPECT_EQ(ngen::memory::kTraceEventArray, events[19].flags);
+
+    for (size_t loop = 1; loop < events.size(); ++loop) {
+        EXPECT_LE(events[loop - 1].timestamp, events[loop].timestamp);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(TraceRecorder, Batches) {
+    const auto path = (std::filesystem::temp_directory_path() / "ngen_memory_trace_batches.bin").string();
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kTraceBufferSize]);
+
+    ngen::memory::Heap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kTraceBufferSize, ngen::memory::kAllocationStrategy::TLSF));
+
+    ngen::memory::TraceRecorder recorder;
+    EXPECT_TRUE(recorder.open(path.c_str()));
+    heap.setTraceRecorder(&recorder);
+
+    void *blocks[16] = {};
+    EXPECT_EQ(16, heap.allocBatch(16, 48, 16, blocks));
+    EXPECT_EQ(16, heap.deallocateBatch(blocks, 16));
+
+    heap.setTraceRecorder(nullptr);
+
+    // Events held in memory are written by flush, without closing the file.
+    EXPECT_TRUE(recorder.flush());
+
+    std::vector<ngen::memory::TraceEvent> events;
+    EXPECT_TRUE(readTrace(path, events));
+    ASSERT_EQ(32, events.size());
+
+    size_t allocations = 0;
+    size_t releases = 0;
+
+    for (auto &event : events) {
+        if (ngen::memory::kTraceEvent::Allocate == event.type) {
+            EXPECT_NE(0, event.handle);
+            EXPECT_EQ(48, event.size);
+            EXPECT_EQ(16, event.alignment);
+            allocations++;
+        } else if (ngen::memory::kTraceEvent::Deallocate == event.type) {
+            releases++;
+        }
+    }
+
+    EXPECT_EQ(16, allocations);
+    EXPECT_EQ(16, releases);
+
+    recorder.close();
+    std::remove(path.c_str());
+}
+
+TEST(TraceRecorder, ConcurrentHeap) {
+    const auto path = (std::filesystem::temp_directory_path() / "ngen_memory_trace_concurrent.bin").string();
+
+    std::unique_ptr<char[]> allocationBuffer(new char[kTraceBufferSize]);
+
+    ngen::memory::ConcurrentHeap heap;
+    EXPECT_TRUE(heap.initialize(allocationBuffer.get(), kTraceBufferSize));
+
+    ngen::memory::TraceRecorder recorder;
+    EXPECT_TRUE(recorder.open(path.c_str()));
+    heap.setTraceRecorder(&recorder);
+
+    // Allocations larger than the thread caches serve are made directly from the underlying heap.
+    auto ptr = heap.alloc(heap.getLimits().maximumBlockSize * 2);
+    EXPECT_NE(nullptr, ptr);
+    EXPECT_TRUE(heap.deallocate(ptr, false, nullptr, 0));
+
+    heap.setTraceRecorder(nullptr);
+    recorder.close();
+
+    std::vector<ngen::memory::TraceEvent> events;
+    EXPECT_TRUE(readTrace(path, events));
+    ASSERT_EQ(2, events.size());
+
+    EXPECT_EQ(ngen::memory::kTraceEvent::Allocate, events[0].type);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr), events[0].handle);
+    EXPECT_EQ(ngen::memory::kTraceEvent::Deallocate, events[1].type);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr), events[1].handle);
+
+    std::remove(path.c_str());
+}
+
+TEST(TraceRecorder, InvalidFiles) {
+    const auto path = (std::filesystem::temp_directory_path() / "ngen_memory_trace_invalid.bin").string();
+
+    ngen::memory::TraceRecorder recorder;
+    EXPECT_FALSE(recorder.open(nullptr));
+    EXPECT_FALSE(recorder.open(path.c_str(), 0));
+    EXPECT_FALSE(recorder.flush());
+
+    // Recording without an open file does nothing.
+    recorder.record(ngen::memory::kTraceEvent::Allocate, &recorder, 16, 16, false);
+    EXPECT_EQ(0, recorder.getRecordedEvents());
+
+    auto file = fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    fputs("not an allocation trace", file);
+    fclose(file);
+
+    ngen::memory::TraceReader reader;
+    EXPECT_FALSE(reader.open(path.c_str()));
+
+    ngen::memory::TraceEvent event = {};
+    EXPECT_FALSE(reader.next(event));
+
+    std::remove(path.c_str());
+}
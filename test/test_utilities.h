@@ -0,0 +1,24 @@
+
+#if !defined(MEMORY_TEST_UTILITIES_HEADER_INCLUDED_STRANGE_SECRETS)
+#define MEMORY_TEST_UTILITIES_HEADER_INCLUDED_STRANGE_SECRETS
+
+////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////////////////////
+
+//! \brief  Helper method that determines whether or not the specified pointer has the specified alignment.
+//! \param ptr [in] - The pointer whose alignment is to be verified.
+//! \param alignment [in] - The alignment the pointer is expected to have *must* be a power of two (this is not verified).
+//! \returns True if the pointer has the specified alignment otherwise false.
+inline bool validateAlignment(const void *ptr, size_t alignment) {
+    const auto raw = reinterpret_cast<uintptr_t>(ptr);
+    return (0 == (raw & (alignment - 1)));
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+#endif //!defined(MEMORY_TEST_UTILITIES_HEADER_INCLUDED_STRANGE_SECRETS)
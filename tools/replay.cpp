@@ -0,0 +1,211 @@
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "heap.h"
+#include "trace_recorder.h"
+
+namespace {
+    constexpr size_t kDefaultReserveLength = size_t(4) * 1024 * 1024 * 1024;
+    constexpr size_t kCommitLength = 1024 * 1024;
+
+    //! \brief Results of replaying a trace against a single allocation strategy.
+    struct ReplayResult {
+        uint64_t elapsedNanoseconds = 0;        // Time taken to replay every event, including the lookup of handles
+        size_t events = 0;                      // Number of events that were replayed
+        size_t failures = 0;                    // Number of allocations that failed during the replay
+        size_t peakBytesInUse = 0;              // Largest number of bytes in use by the heap, zero without NGEN_MEMORY_STATISTICS
+        size_t committedBytes = 0;              // Memory committed by the heap once the replay completed
+    };
+
+    //! \brief An allocation made by the replay.
+    struct ReplayAllocation {
+        void *ptr;
+        bool isArray;
+    };
+
+    //! \brief Replays the events of a trace against a growable heap using the specified allocation strategy.
+    //!
+    //! Each handle within the trace is mapped to the allocation made for it by the replay. Releases of handles the
+    //! replay has no allocation for, because the allocation failed or was made before recording began, are skipped.
+    //! Allocations that failed when the trace was recorded are still attempted, and are held until the replay ends.
+    //! \param events [in] - The events to be replayed.
+    //! \param strategy [in] - The allocation strategy used by the heap.
+    //! \param reserveLength [in] - Length (in bytes) of the address space reserved by the heap.
+    //! \param result [out] - Receives the results of the replay.
+    //! \returns True if the trace was replayed otherwise false, if the heap could not be created.
+    bool replay(const std::vector<ngen::memory::TraceEvent> &events, ngen::memory::kAllocationStrategy strategy, size_t reserveLength, ReplayResult &result) {
+        ngen::memory::Heap heap;
+        if (!heap.initializeGrowable(reserveLength, kCommitLength, strategy)) {
+            return false;
+        }
+
+        std::unordered_map<uint64_t, ReplayAllocation> allocations;
+        allocations.reserve(events.size());
+
+        std::vector<ReplayAllocation> unnamed;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto &event : events) {
+            const auto isArray = 0 != (event.flags & ngen::memory::kTraceEventArray);
+
+            switch (event.type) {
+                case ngen::memory::kTraceEvent::Allocate: {
+                    auto ptr = isArray ? heap.alignedAllocArray(event.size, event.alignment) : heap.alignedAlloc(event.size, event.alignment);
+
+                    if (!ptr) {
+                        result.failures++;
+                    } else if (event.handle) {
+                        allocations[event.handle] = {ptr, isArray};
+                    } else {
+                        unnamed.push_back({ptr, isArray});
+                    }
+                    break;
+                }
+
+                case ngen::memory::kTraceEvent::Deallocate: {
+                    auto allocation = allocations.find(event.handle);
+
+                    if (allocation != allocations.end()) {
+                        heap.deallocate(allocation->second.ptr, allocation->second.isArray, nullptr, 0);
+                        allocations.erase(allocation);
+                    }
+                    break;
+                }
+
+                case ngen::memory::kTraceEvent::Resize: {
+                    auto allocation = allocations.find(event.handle);
+
+                    // Another strategy may be unable to resize in place, in which case the allocation moves.
+                    if (allocation != allocations.end() && !heap.tryExpandInPlace(allocation->second.ptr, event.size)) {
+                        auto ptr = heap.reallocate(allocation->second.ptr, event.size);
+
+                        if (ptr) {
+                            allocation->second.ptr = ptr;
+                        } else {
+                            result.failures++;
+                        }
+                    }
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        result.elapsedNanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        result.events = events.size();
+        result.peakBytesInUse = heap.getStats().peakBytesInUse;
+        result.committedBytes = heap.getSize();
+
+        for (const auto &allocation : allocations) {
+            heap.deallocate(allocation.second.ptr, allocation.second.isArray, nullptr, 0);
+        }
+
+        for (const auto &allocation : unnamed) {
+            heap.deallocate(allocation.ptr, allocation.isArray, nullptr, 0);
+        }
+
+        return true;
+    }
+
+    //! \brief Outputs a single result of a replay.
+    //! \param variant [in] - Name of the allocation strategy that was measured.
+    //! \param metric [in] - Name of the value that was measured.
+    //! \param value [in] - The measured value.
+    void report(const char *variant, const char *metric, double value) {
+        printf("%-24s %-32s %-16s %14.2f\n", "replay", variant, metric, value);
+    }
+
+    //! \brief Outputs the usage of the replay executable.
+    void printUsage() {
+        printf("usage: memory_replay <trace> [First|Smallest|TLSF]... [--reserve <MiB>]\n");
+        printf("Replays an allocation trace written by TraceRecorder against each allocation strategy, or only those named.\n");
+    }
+}
+
+//! \brief Replays an allocation trace against the allocation strategies named on the command line, or all of them.
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    const ngen::memory::kAllocationStrategy allStrategies[] = {
+        ngen::memory::kAllocationStrategy::First,
+        ngen::memory::kAllocationStrategy::Smallest,
+        ngen::memory::kAllocationStrategy::TLSF,
+    };
+
+    std::vector<ngen::memory::kAllocationStrategy> strategies;
+    size_t reserveLength = kDefaultReserveLength;
+
+    for (int loop = 2; loop < argc; ++loop) {
+        if (0 == strcmp(argv[loop], "--reserve") && loop + 1 < argc) {
+            reserveLength = static_cast<size_t>(strtoull(argv[++loop], nullptr, 10)) * 1024 * 1024;
+            continue;
+        }
+
+        bool isKnown = false;
+
+        for (auto strategy : allStrategies) {
+            if (0 == strcmp(argv[loop], ngen::memory::getAllocationStrategyName(strategy))) {
+                strategies.push_back(strategy);
+                isKnown = true;
+            }
+        }
+
+        if (!isKnown) {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (strategies.empty()) {
+        strategies.assign(std::begin(allStrategies), std::end(allStrategies));
+    }
+
+    ngen::memory::TraceReader reader;
+    if (!reader.open(argv[1])) {
+        fprintf(stderr, "unable to read the trace '%s'\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<ngen::memory::TraceEvent> events;
+    size_t recordedFailures = 0;
+
+    for (ngen::memory::TraceEvent event; reader.next(event);) {
+        if (ngen::memory::kTraceEvent::Allocate == event.type && !event.handle) {
+            recordedFailures++;
+        }
+
+        events.push_back(event);
+    }
+
+    printf("%zu events, %zu allocations failed while recording\n", events.size(), recordedFailures);
+
+    for (auto strategy : strategies) {
+        ReplayResult result;
+
+        if (!replay(events, strategy, reserveLength, result)) {
+            fprintf(stderr, "unable to reserve %zu bytes for the %s heap\n", reserveLength, ngen::memory::getAllocationStrategyName(strategy));
+            return 1;
+        }
+
+        report(ngen::memory::getAllocationStrategyName(strategy), "ms", static_cast<double>(result.elapsedNanoseconds) / 1000000.0);
+        report(ngen::memory::getAllocationStrategyName(strategy), "ns/event", result.events ? static_cast<double>(result.elapsedNanoseconds) / result.events : 0.0);
+        report(ngen::memory::getAllocationStrategyName(strategy), "peak_bytes", static_cast<double>(result.peakBytesInUse));
+        report(ngen::memory::getAllocationStrategyName(strategy), "committed_bytes", static_cast<double>(result.committedBytes));
+        report(ngen::memory::getAllocationStrategyName(strategy), "failures", static_cast<double>(result.failures));
+    }
+
+    return 0;
+}